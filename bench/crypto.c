@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../helpers/console.c"
+#include "../helpers/crypto.c"
+#include "../helpers/exception.c"
+#include "../helpers/file.c"
+#include "../quickjs/quickjs.h"
+
+/*
+ * 运行 crypto.js：对比 helpers/crypto.c 的原生哈希和纯 JS 实现的吞吐量，
+ * 并检查两者的结果一致。
+ */
+
+int main(int argc, char **argv) {
+  const char *filename = argc > 1 ? argv[1] : "crypto.js";
+  char *source = read_file_to_string(filename);
+  if (!source)
+    return 1;
+
+  JSRuntime *rt = JS_NewRuntime();
+  JSContext *ctx = JS_NewContext(rt);
+  js_std_init_console(ctx);
+  js_init_crypto_module(ctx, "crypto");
+
+  JSValue val =
+      JS_Eval(ctx, source, strlen(source), filename, JS_EVAL_TYPE_MODULE);
+  int failed = JS_IsException(val);
+  if (!failed) {
+    JSContext *job_ctx;
+    while (JS_ExecutePendingJob(rt, &job_ctx) > 0)
+      ;
+    // 模块求值的结果是 Promise，脚本抛出的错误在这里取出
+    if (JS_IsObject(val) && JS_PromiseState(ctx, val) == JS_PROMISE_REJECTED) {
+      JS_Throw(ctx, JS_PromiseResult(ctx, val));
+      failed = 1;
+    }
+  }
+  if (failed)
+    check_and_print_exception(ctx);
+  JS_FreeValue(ctx, val);
+
+  JS_FreeContext(ctx);
+  JS_FreeRuntime(rt);
+  free(source);
+  return failed ? 1 : 0;
+}
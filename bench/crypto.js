@@ -0,0 +1,193 @@
+// crypto 模块与纯 JS 实现的吞吐量对比，两者的结果必须一致
+import { digest, createHash } from "crypto";
+
+const K = new Int32Array([
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+]);
+
+function hex32(v) {
+  return (v >>> 0).toString(16).padStart(8, "0");
+}
+
+function sha256Js(bytes) {
+  const n = bytes.length;
+  const padded = new Uint8Array(((n + 72) >> 6) << 6);
+  padded.set(bytes);
+  padded[n] = 0x80;
+  const view = new DataView(padded.buffer);
+  view.setUint32(padded.length - 8, Math.floor(n / 0x20000000));
+  view.setUint32(padded.length - 4, n << 3);
+
+  const h = new Int32Array([
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c,
+    0x1f83d9ab, 0x5be0cd19,
+  ]);
+  const w = new Int32Array(64);
+  for (let off = 0; off < padded.length; off += 64) {
+    for (let i = 0; i < 16; i++) w[i] = view.getInt32(off + i * 4);
+    for (let i = 16; i < 64; i++) {
+      const a = w[i - 15], b = w[i - 2];
+      const s0 = ((a >>> 7) | (a << 25)) ^ ((a >>> 18) | (a << 14)) ^ (a >>> 3);
+      const s1 = ((b >>> 17) | (b << 15)) ^ ((b >>> 19) | (b << 13)) ^ (b >>> 10);
+      w[i] = (w[i - 16] + s0 + w[i - 7] + s1) | 0;
+    }
+    let a = h[0], b = h[1], c = h[2], d = h[3];
+    let e = h[4], f = h[5], g = h[6], hh = h[7];
+    for (let i = 0; i < 64; i++) {
+      const s1 = ((e >>> 6) | (e << 26)) ^ ((e >>> 11) | (e << 21)) ^
+                 ((e >>> 25) | (e << 7));
+      const t1 = (hh + s1 + ((e & f) ^ (~e & g)) + K[i] + w[i]) | 0;
+      const s0 = ((a >>> 2) | (a << 30)) ^ ((a >>> 13) | (a << 19)) ^
+                 ((a >>> 22) | (a << 10));
+      const t2 = (s0 + ((a & b) ^ (a & c) ^ (b & c))) | 0;
+      hh = g; g = f; f = e; e = (d + t1) | 0;
+      d = c; c = b; b = a; a = (t1 + t2) | 0;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+  }
+  let out = "";
+  for (let i = 0; i < 8; i++) out += hex32(h[i]);
+  return out;
+}
+
+const CRC_TABLE = new Int32Array(256);
+for (let i = 0; i < 256; i++) {
+  let c = i;
+  for (let k = 0; k < 8; k++) c = c & 1 ? (c >>> 1) ^ 0xedb88320 : c >>> 1;
+  CRC_TABLE[i] = c;
+}
+
+function crc32Js(bytes) {
+  let crc = -1;
+  for (let i = 0; i < bytes.length; i++)
+    crc = (crc >>> 8) ^ CRC_TABLE[(crc ^ bytes[i]) & 0xff];
+  return hex32(~crc);
+}
+
+// xxHash64 需要 64 位乘法，只能用 BigInt
+const M64 = (1n << 64n) - 1n;
+const P1 = 0x9e3779b185ebca87n, P2 = 0xc2b2ae3d27d4eb4fn;
+const P3 = 0x165667b19e3779f9n, P4 = 0x85ebca77c2b2ae63n;
+const P5 = 0x27d4eb2f165667c5n;
+
+function rotl64(x, r) {
+  return ((x << r) | (x >> (64n - r))) & M64;
+}
+
+function round64(acc, input) {
+  acc = (acc + input * P2) & M64;
+  return (rotl64(acc, 31n) * P1) & M64;
+}
+
+function merge64(acc, val) {
+  return (((acc ^ round64(0n, val)) * P1) + P4) & M64;
+}
+
+function xxh64Js(bytes) {
+  const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.length);
+  const n = bytes.length;
+  let i = 0, h;
+  if (n >= 32) {
+    let v1 = (P1 + P2) & M64, v2 = P2, v3 = 0n, v4 = (-P1) & M64;
+    for (; i + 32 <= n; i += 32) {
+      v1 = round64(v1, view.getBigUint64(i, true));
+      v2 = round64(v2, view.getBigUint64(i + 8, true));
+      v3 = round64(v3, view.getBigUint64(i + 16, true));
+      v4 = round64(v4, view.getBigUint64(i + 24, true));
+    }
+    h = (rotl64(v1, 1n) + rotl64(v2, 7n) + rotl64(v3, 12n) +
+         rotl64(v4, 18n)) & M64;
+    h = merge64(merge64(merge64(merge64(h, v1), v2), v3), v4);
+  } else {
+    h = P5;
+  }
+  h = (h + BigInt(n)) & M64;
+  for (; i + 8 <= n; i += 8) {
+    h ^= round64(0n, view.getBigUint64(i, true));
+    h = (rotl64(h, 27n) * P1 + P4) & M64;
+  }
+  if (i + 4 <= n) {
+    h ^= (BigInt(view.getUint32(i, true)) * P1) & M64;
+    h = (rotl64(h, 23n) * P2 + P3) & M64;
+    i += 4;
+  }
+  for (; i < n; i++) {
+    h ^= (BigInt(bytes[i]) * P5) & M64;
+    h = (rotl64(h, 11n) * P1) & M64;
+  }
+  h ^= h >> 33n;
+  h = (h * P2) & M64;
+  h ^= h >> 29n;
+  h = (h * P3) & M64;
+  h ^= h >> 32n;
+  return h.toString(16).padStart(16, "0");
+}
+
+// 至少运行 200 ms，返回 MB/s
+function throughput(fn, bytes) {
+  let runs = 0;
+  const start = Date.now();
+  let elapsed;
+  do {
+    fn(bytes);
+    runs++;
+    elapsed = Date.now() - start;
+  } while (elapsed < 200);
+  return (bytes.length * runs) / (elapsed / 1000) / 1e6;
+}
+
+function pad(s, n) {
+  return String(s).padStart(n);
+}
+
+const data = new Uint8Array(64 << 20);
+let seed = 1;
+for (let i = 0; i < data.length; i++) {
+  seed = (seed * 1103515245 + 12345) | 0;
+  data[i] = seed >>> 16;
+}
+
+const algorithms = [
+  { name: "sha256", js: sha256Js, sizes: [1 << 10, 64 << 10, 1 << 20] },
+  { name: "crc32", js: crc32Js, sizes: [1 << 10, 64 << 10, 1 << 20] },
+  { name: "xxh64", js: xxh64Js, sizes: [1 << 10, 64 << 10] },
+];
+
+console.log("algorithm      size   native MB/s      JS MB/s   speedup");
+for (const { name, js, sizes } of algorithms) {
+  for (const size of sizes) {
+    const bytes = data.subarray(0, size);
+    if (js(bytes) !== digest(name, bytes, "hex"))
+      throw new Error(`${name}: native and JS results differ at ${size} bytes`);
+    const nativeRate = throughput((b) => digest(name, b), bytes);
+    const jsRate = throughput(js, bytes);
+    console.log(`${name.padEnd(9)} ${pad(size >> 10, 7)} KB ${pad(
+      nativeRate.toFixed(1), 12)} ${pad(jsRate.toFixed(1), 12)} ${pad(
+      (nativeRate / jsRate).toFixed(0), 8)}x`);
+  }
+}
+
+// 分块更新与一次性计算的结果一致
+for (const name of ["sha256", "xxh64", "crc32", "crc32c"]) {
+  const hash = createHash(name);
+  for (let off = 0; off < 1 << 20; off += 4099)
+    hash.update(data.subarray(off, Math.min(off + 4099, 1 << 20)));
+  if (hash.digest("hex") !== digest(name, data.subarray(0, 1 << 20), "hex"))
+    throw new Error(`${name}: streaming result differs`);
+}
+
+console.log("\nnative only, 64 MB");
+for (const name of ["sha256", "xxh64", "crc32", "crc32c"]) {
+  console.log(`${name.padEnd(9)} ${pad(throughput((b) => digest(name, b), data).toFixed(1), 12)} MB/s`);
+}
@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../helpers/clock.c"
+#include "../helpers/encoding.c"
+#include "../helpers/exception.c"
+#include "../quickjs/quickjs.h"
+
+/*
+ * helpers/encoding.c 的吞吐量基准：1 KB 到 100 MB 的输入，分别经过
+ * 脚本可见的 API 和直接调用 SIMD / 标量内核，输出 GB/s（按输入字节数）。
+ *
+ * 文本输入大部分是 ASCII，混有 2、3、4 字节的字符，接近实际的 JSON
+ * 负载；base64 和 hex 的输入由随机字节编码得到。
+ */
+
+// 每个大小处理的总字节数，小输入重复多次以摊薄计时误差
+#define ENC_BENCH_BYTES ((size_t)256 << 20)
+#define ENC_BENCH_MIN_REPS 3
+
+static const size_t enc_bench_sizes[] = {
+    1 << 10, 64 << 10, 1 << 20, 16 << 20, 100 << 20,
+};
+static const char *const enc_bench_size_names[] = {
+    "1 KB", "64 KB", "1 MB", "16 MB", "100 MB",
+};
+#define ENC_BENCH_SIZE_COUNT                                                   \
+  (int)(sizeof(enc_bench_sizes) / sizeof(enc_bench_sizes[0]))
+
+typedef enum {
+  INPUT_TEXT,   // 字符串
+  INPUT_UTF8,   // 字符串的 UTF-8 字节
+  INPUT_BYTES,  // 随机字节
+  INPUT_BASE64, // 字符串
+  INPUT_HEX,    // 字符串
+} EncodingInput;
+
+typedef struct {
+  const char *name;
+  EncodingInput input;
+  const char *func; // 接受一个输入参数的脚本函数
+} EncodingOp;
+
+static const EncodingOp enc_bench_ops[] = {
+    {"TextEncoder.encode", INPUT_TEXT, "s => encoder.encode(s)"},
+    {"TextDecoder.decode", INPUT_UTF8, "b => decoder.decode(b)"},
+    {"toBase64", INPUT_BYTES, "b => b.toBase64()"},
+    {"fromBase64", INPUT_BASE64, "s => Uint8Array.fromBase64(s)"},
+    {"atob", INPUT_BASE64, "s => atob(s)"},
+    {"toHex", INPUT_BYTES, "b => b.toHex()"},
+    {"fromHex", INPUT_HEX, "s => Uint8Array.fromHex(s)"},
+};
+#define ENC_BENCH_OP_COUNT                                                     \
+  (int)(sizeof(enc_bench_ops) / sizeof(enc_bench_ops[0]))
+
+typedef enum {
+  KERNEL_UTF8_VALID,
+  KERNEL_UTF8_VALID_SCALAR,
+  KERNEL_BASE64_ENCODE,
+  KERNEL_BASE64_ENCODE_SCALAR,
+  KERNEL_BASE64_DECODE,
+  KERNEL_HEX_ENCODE,
+  KERNEL_HEX_ENCODE_SCALAR,
+  KERNEL_HEX_DECODE,
+  KERNEL_COUNT,
+} EncodingKernel;
+
+static const char *const enc_bench_kernel_names[] = {
+    "utf8 valid",    "utf8 valid (scalar)", "base64 encode",
+    "base64 encode (scalar)", "base64 decode", "hex encode",
+    "hex encode (scalar)",    "hex decode",
+};
+
+static uint64_t enc_bench_seed = 88172645463325252ull;
+
+static uint32_t enc_bench_random(void) {
+  enc_bench_seed ^= enc_bench_seed << 13;
+  enc_bench_seed ^= enc_bench_seed >> 7;
+  enc_bench_seed ^= enc_bench_seed << 17;
+  return (uint32_t)enc_bench_seed;
+}
+
+// 恰好 n 字节的合法 UTF-8 文本
+static void enc_bench_fill_text(uint8_t *p, size_t n) {
+  static const char *const samples[] = {"é", "中", "😀"};
+  size_t i = 0;
+  while (i < n) {
+    uint32_t r = enc_bench_random();
+    const char *s = r % 16 == 0 ? samples[(r >> 8) % 3] : NULL;
+    size_t len = s ? strlen(s) : 1;
+    if (i + len > n) {
+      s = NULL;
+      len = 1;
+    }
+    if (s)
+      memcpy(p + i, s, len);
+    else
+      p[i] = ' ' + (r >> 8) % 95;
+    i += len;
+  }
+}
+
+static void enc_bench_fill_bytes(uint8_t *p, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    p[i] = enc_bench_random();
+}
+
+static size_t enc_bench_reps(size_t size) {
+  size_t reps = ENC_BENCH_BYTES / size;
+  return reps < ENC_BENCH_MIN_REPS ? ENC_BENCH_MIN_REPS : reps;
+}
+
+static double enc_bench_gbps(size_t size, size_t reps, double ms) {
+  return ms > 0 ? (double)size * reps / (ms / 1000.0) / 1e9 : 0;
+}
+
+static void enc_bench_print_header(const char *title) {
+  printf("%-24s", title);
+  for (int s = 0; s < ENC_BENCH_SIZE_COUNT; s++)
+    printf("%10s", enc_bench_size_names[s]);
+  printf("\n");
+}
+
+// 直接调用内核，带 (scalar) 的用例绕过 SIMD 分派
+static double enc_bench_kernel(EncodingKernel kernel, const uint8_t *text,
+                               const uint8_t *bytes, const char *base64,
+                               const char *hex, size_t size, void *out) {
+  size_t reps = enc_bench_reps(size);
+  size_t sink = 0;
+  double start = get_time_ms();
+  for (size_t r = 0; r < reps; r++) {
+    switch (kernel) {
+    case KERNEL_UTF8_VALID:
+      sink += enc_utf8_valid(text, size);
+      break;
+    case KERNEL_UTF8_VALID_SCALAR:
+      sink += enc_utf8_valid_scalar(text, size);
+      break;
+    case KERNEL_BASE64_ENCODE:
+      sink += enc_base64_encode(out, bytes, size, 0, 1);
+      break;
+    case KERNEL_BASE64_ENCODE_SCALAR:
+      sink += enc_base64_encode_scalar(out, bytes, size, enc_base64_chars);
+      break;
+    case KERNEL_BASE64_DECODE:
+      sink += enc_base64_decode(out, base64, size, 0, 0);
+      break;
+    case KERNEL_HEX_ENCODE:
+      enc_hex_encode(out, bytes, size);
+      sink++;
+      break;
+    case KERNEL_HEX_ENCODE_SCALAR:
+      enc_hex_encode_scalar(out, bytes, size);
+      sink++;
+      break;
+    case KERNEL_HEX_DECODE:
+      sink += enc_hex_decode(out, hex, size);
+      break;
+    default:
+      break;
+    }
+  }
+  double ms = get_time_ms() - start;
+  if (sink == 0)
+    fprintf(stderr, "Error: %s returned nothing\n",
+            enc_bench_kernel_names[kernel]);
+  return enc_bench_gbps(size, reps, ms);
+}
+
+// 经过脚本 API 调用一次 op，失败返回 -1
+static double enc_bench_script(JSContext *ctx, JSValueConst func,
+                               JSValueConst input, size_t size) {
+  size_t reps = enc_bench_reps(size);
+  JSValue global = JS_GetGlobalObject(ctx);
+  double start = get_time_ms();
+  for (size_t r = 0; r < reps; r++) {
+    JSValue ret = JS_Call(ctx, func, global, 1, &input);
+    if (JS_IsException(ret)) {
+      check_and_print_exception(ctx);
+      JS_FreeValue(ctx, global);
+      return -1;
+    }
+    JS_FreeValue(ctx, ret);
+  }
+  double ms = get_time_ms() - start;
+  JS_FreeValue(ctx, global);
+  return enc_bench_gbps(size, reps, ms);
+}
+
+static JSValue enc_bench_eval(JSContext *ctx, const char *code) {
+  JSValue val =
+      JS_Eval(ctx, code, strlen(code), "<encoding>", JS_EVAL_TYPE_GLOBAL);
+  if (JS_IsException(val))
+    check_and_print_exception(ctx);
+  return val;
+}
+
+int main(void) {
+  size_t max_size = enc_bench_sizes[ENC_BENCH_SIZE_COUNT - 1];
+  uint8_t *text = malloc(max_size);
+  uint8_t *bytes = malloc(max_size);
+  char *base64 = malloc(max_size + 4);
+  char *hex = malloc(max_size);
+  // 编码输出最多是输入的 2 倍（hex），解码要额外留出 32 字节
+  void *out = malloc(2 * max_size + 64);
+  if (!text || !bytes || !base64 || !hex || !out) {
+    fprintf(stderr, "Error: out of memory\n");
+    return 1;
+  }
+  enc_bench_fill_text(text, max_size);
+  enc_bench_fill_bytes(bytes, max_size);
+  // max_size 个字符的 base64 和 hex
+  enc_base64_encode(base64, bytes, max_size / 4 * 3, 0, 1);
+  enc_hex_encode(hex, bytes, max_size / 2);
+
+  double kernel_gbps[KERNEL_COUNT][ENC_BENCH_SIZE_COUNT];
+  double op_gbps[ENC_BENCH_OP_COUNT][ENC_BENCH_SIZE_COUNT];
+
+  for (int s = 0; s < ENC_BENCH_SIZE_COUNT; s++) {
+    size_t size = enc_bench_sizes[s];
+    // 大小截到 UTF-8 字符和编码组的边界
+    size_t text_size = size - enc_utf8_incomplete_tail(text, size);
+    size_t hex_size = size & ~(size_t)1;
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+      size_t n = k == KERNEL_UTF8_VALID || k == KERNEL_UTF8_VALID_SCALAR
+                     ? text_size
+                     : k == KERNEL_HEX_DECODE ? hex_size : size;
+      kernel_gbps[k][s] =
+          enc_bench_kernel(k, text, bytes, base64, hex, n, out);
+    }
+
+    // 每个大小一个新的运行时，大输入的结果不会留到下一轮
+    JSRuntime *rt = JS_NewRuntime();
+    JSContext *ctx = JS_NewContext(rt);
+    js_std_init_encoding(ctx);
+    JSValue global = JS_GetGlobalObject(ctx);
+    JS_FreeValue(ctx, enc_bench_eval(
+                          ctx, "globalThis.encoder = new TextEncoder();"
+                               "globalThis.decoder = new TextDecoder();"));
+
+    JSValue inputs[5];
+    inputs[INPUT_TEXT] = JS_NewStringLen(ctx, (const char *)text, text_size);
+    inputs[INPUT_BASE64] = JS_NewStringLen(ctx, base64, size);
+    inputs[INPUT_HEX] = JS_NewStringLen(ctx, hex, hex_size);
+    uint8_t *copy = js_malloc(ctx, size);
+    memcpy(copy, bytes, size);
+    inputs[INPUT_BYTES] = js_encoding_new_uint8_array(ctx, copy, size);
+    JS_SetPropertyStr(ctx, global, "text",
+                      JS_DupValue(ctx, inputs[INPUT_TEXT]));
+    inputs[INPUT_UTF8] = enc_bench_eval(ctx, "encoder.encode(text)");
+
+    for (int i = 0; i < ENC_BENCH_OP_COUNT; i++) {
+      const EncodingOp *op = &enc_bench_ops[i];
+      size_t n = op->input == INPUT_TEXT || op->input == INPUT_UTF8
+                     ? text_size
+                     : op->input == INPUT_HEX ? hex_size : size;
+      JSValue func = enc_bench_eval(ctx, op->func);
+      op_gbps[i][s] = JS_IsException(func)
+                          ? -1
+                          : enc_bench_script(ctx, func, inputs[op->input], n);
+      JS_FreeValue(ctx, func);
+    }
+
+    for (int i = 0; i < 5; i++)
+      JS_FreeValue(ctx, inputs[i]);
+    JS_FreeValue(ctx, global);
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+  }
+
+  printf("Throughput in GB/s of input\n\n");
+  enc_bench_print_header("script API");
+  for (int i = 0; i < ENC_BENCH_OP_COUNT; i++) {
+    printf("%-24s", enc_bench_ops[i].name);
+    for (int s = 0; s < ENC_BENCH_SIZE_COUNT; s++)
+      printf("%10.2f", op_gbps[i][s]);
+    printf("\n");
+  }
+  printf("\n");
+  enc_bench_print_header("kernel");
+  for (int k = 0; k < KERNEL_COUNT; k++) {
+    printf("%-24s", enc_bench_kernel_names[k]);
+    for (int s = 0; s < ENC_BENCH_SIZE_COUNT; s++)
+      printf("%10.2f", kernel_gbps[k][s]);
+    printf("\n");
+  }
+
+  free(text);
+  free(bytes);
+  free(base64);
+  free(hex);
+  free(out);
+  return 0;
+}
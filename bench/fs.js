@@ -0,0 +1,64 @@
+// 多 GB 文件的吞吐量：mmap 的 readFile 和预先分配缓冲区的流式
+// read/write，同步版本和线程池上的 fs/promises 版本
+import * as fs from "fs";
+import * as fsp from "fs/promises";
+
+const INPUT = "fs.bin";
+const OUTPUT = "fs.out";
+const WINDOW = 1 << 30; // readFile 每次映射 1 GB
+const CHUNK = 4 << 20;
+
+function report(name, bytes, ms) {
+  console.log(`${name.padEnd(24)} ${(bytes / ms / 1e6).toFixed(2)} GB/s`);
+}
+
+// 每页读一个字节，确认映射的数据确实可以访问
+function touch(u8) {
+  let sum = 0;
+  for (let i = 0; i < u8.length; i += 4096) sum += u8[i];
+  return sum;
+}
+
+async function main() {
+  const size = fs.stat(INPUT).size;
+  const chunk = new Uint8Array(CHUNK);
+  console.log(`${INPUT}: ${(size / 1e9).toFixed(2)} GB`);
+
+  let start = Date.now();
+  for (let off = 0; off < size; off += WINDOW)
+    touch(new Uint8Array(fs.readFile(INPUT, { offset: off, length: WINDOW })));
+  report("readFile", size, Date.now() - start);
+
+  start = Date.now();
+  for (let off = 0; off < size; off += WINDOW)
+    touch(new Uint8Array(await fsp.readFile(INPUT, { offset: off, length: WINDOW })));
+  report("readFile async", size, Date.now() - start);
+
+  start = Date.now();
+  let fd = fs.open(INPUT);
+  let total = 0, n;
+  while ((n = fs.read(fd, chunk)) > 0) total += n;
+  fs.close(fd);
+  report("read", total, Date.now() - start);
+
+  start = Date.now();
+  fd = await fsp.open(INPUT);
+  total = 0;
+  while ((n = await fsp.read(fd, chunk)) > 0) total += n;
+  await fsp.close(fd);
+  report("read async", total, Date.now() - start);
+
+  start = Date.now();
+  fd = fs.open(OUTPUT, "w");
+  for (total = 0; total < size; total += CHUNK) fs.write(fd, chunk);
+  fs.close(fd);
+  report("write", total, Date.now() - start);
+
+  start = Date.now();
+  fd = await fsp.open(OUTPUT, "w");
+  for (total = 0; total < size; total += CHUNK) await fsp.write(fd, chunk);
+  await fsp.close(fd);
+  report("write async", total, Date.now() - start);
+}
+
+main().catch((e) => console.log(`Error: ${e}`));
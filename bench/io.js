@@ -0,0 +1,113 @@
+// fs/promises 和 net 在 libuv 后端（线程池 + epoll）与 io_uring 后端上
+// 的对比：4 KB 随机读、小文件 writeFile 和大量并发的回环连接
+import * as fsp from "fs/promises";
+import * as net from "net";
+
+const INPUT = "io.bin";
+const BLOCK = 4096;
+const READERS = 64;
+const READS = 200000;
+const WRITERS = 64;
+const WRITES = 20000;
+const CONNECTIONS = 256;
+const ROUND_TRIPS = 200;
+const MESSAGE = 64;
+
+function report(name, ops, ms, unit) {
+  console.log(`${name.padEnd(28)} ${(ops / ms * 1000).toFixed(0).padStart(10)} ${unit}/s`);
+}
+
+// 每个 worker 一个 4 KB 的块，全部落在一个注册过的缓冲区里
+async function randomReads(size) {
+  const buffer = new Uint8Array(READERS * BLOCK);
+  const registered = fsp.registerBuffer(buffer);
+  const fd = await fsp.open(INPUT);
+  const blocks = Math.floor(size / BLOCK);
+  let remaining = READS;
+  async function worker(i) {
+    let seed = i + 1;
+    while (remaining-- > 0) {
+      seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+      const n = await fsp.read(fd, buffer, i * BLOCK, BLOCK, (seed % blocks) * BLOCK);
+      if (n !== BLOCK) throw new Error(`short read: ${n}`);
+    }
+  }
+  const start = Date.now();
+  await Promise.all(Array.from({ length: READERS }, (_, i) => worker(i)));
+  report(`read 4 KB x ${READERS} in flight`, READS, Date.now() - start, "reads");
+  await fsp.close(fd);
+  if (registered) fsp.unregisterBuffer(buffer);
+}
+
+async function smallWrites() {
+  const data = new Uint8Array(1024).fill(120);
+  let remaining = WRITES;
+  async function worker(i) {
+    while (remaining-- > 0) await fsp.writeFile(`io.out.${i}`, data);
+  }
+  const start = Date.now();
+  await Promise.all(Array.from({ length: WRITERS }, (_, i) => worker(i)));
+  report(`writeFile 1 KB x ${WRITERS} in flight`, WRITES, Date.now() - start, "files");
+}
+
+// 读满 buf，对端关闭时返回 false
+async function recvAll(fd, buf) {
+  for (let off = 0; off < buf.length;) {
+    const n = await net.recv(fd, buf, off);
+    if (n === 0) return false;
+    off += n;
+  }
+  return true;
+}
+
+async function sendAll(fd, buf) {
+  for (let off = 0; off < buf.length;) off += await net.send(fd, buf, off);
+}
+
+async function echo(fd) {
+  const buf = new Uint8Array(MESSAGE);
+  while (await recvAll(fd, buf)) await sendAll(fd, buf);
+  await net.close(fd);
+}
+
+async function pingPong() {
+  const server = net.listen(0);
+  const port = net.localPort(server);
+  // close(server) 之后等待中的 accept 以 ECANCELED 结束
+  const acceptLoop = (async () => {
+    try {
+      for (;;) echo(await net.accept(server));
+    } catch (e) {
+      if (e.errno === undefined) throw e;
+    }
+  })();
+
+  async function client() {
+    const fd = await net.connect(port);
+    const buf = new Uint8Array(MESSAGE).fill(7);
+    for (let i = 0; i < ROUND_TRIPS; i++) {
+      await sendAll(fd, buf);
+      if (!(await recvAll(fd, buf))) throw new Error("server closed early");
+    }
+    await net.close(fd);
+  }
+  const start = Date.now();
+  await Promise.all(Array.from({ length: CONNECTIONS }, client));
+  report(`ping-pong x ${CONNECTIONS} connections`, CONNECTIONS * ROUND_TRIPS,
+         Date.now() - start, "round trips");
+  await net.close(server);
+  await acceptLoop;
+}
+
+async function main() {
+  const size = (await fsp.stat(INPUT)).size;
+  const probe = new Uint8Array(1);
+  const backend = fsp.registerBuffer(probe) && fsp.unregisterBuffer(probe)
+    ? "io_uring" : "libuv";
+  console.log(`backend: ${backend}, ${INPUT}: ${size >> 20} MB`);
+  await randomReads(size);
+  await smallWrites();
+  await pingPong();
+}
+
+main().catch((e) => console.log(`Error: ${e}`));
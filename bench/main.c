@@ -0,0 +1,476 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../helpers/clock.c"
+#include "../helpers/console.c"
+#include "../helpers/exception.c"
+#include "../helpers/file.c"
+#include "../quickjs/quickjs.h"
+#include "../demo05/point.c"
+
+/*
+ * 基准套件：同一组工作负载经过每条宿主路径执行，每个用例运行多次取
+ * 中位数，结果可保存为基线文件并与之对比。
+ *
+ * eval、bytecode、load、native、console 在本进程内调用与各个 demo 相同
+ * 的 API；pool 和 loop 直接运行 demo08 与 demo09 的可执行文件，计入的是
+ * 它们各自的完整宿主（线程池调度、libuv 事件循环）。
+ */
+
+// 结果文件格式版本，格式变化时递增，旧基线需要重新记录
+#define BENCH_FORMAT_VERSION 1
+#define BENCH_RUNS_DEFAULT 5
+#define BENCH_THRESHOLD_DEFAULT 10.0
+// load 用例每次运行反序列化字节码的次数
+#define BENCH_LOAD_REPS 200
+#define BENCH_POOL_BIN "../demo08/main"
+#define BENCH_POOL_THREADS 4
+#define BENCH_POOL_TASKS 64
+#define BENCH_LOOP_BIN "../demo09/main"
+#define BENCH_NAME_MAX 64
+#define BENCH_METRICS_MAX 64
+
+typedef enum {
+  BENCH_EVAL,     // 源码 JS_Eval
+  BENCH_BYTECODE, // JS_ReadObject + JS_EvalFunction，同 demo10
+  BENCH_LOAD,     // 只反序列化字节码
+  BENCH_POOL,     // demo08 线程池
+  BENCH_LOOP,     // demo09 事件循环
+  BENCH_NATIVE,   // demo05 的 Point 原生类
+  BENCH_CONSOLE,  // console.log 输出到 /dev/null
+} BenchPath;
+
+static const char *const bench_path_names[] = {
+    "eval", "bytecode", "load", "pool", "loop", "native", "console",
+};
+
+typedef struct {
+  const char *workload; // workloads/<workload>.js
+  BenchPath path;
+  const char *expect; // 子进程输出中必须出现的内容，可以为 NULL
+} BenchCase;
+
+static const BenchCase bench_cases[] = {
+    {"json", BENCH_EVAL},          {"json", BENCH_BYTECODE},
+    {"json", BENCH_LOAD},          {"json", BENCH_POOL},
+    {"regex", BENCH_EVAL},         {"regex", BENCH_BYTECODE},
+    {"regex", BENCH_LOAD},         {"regex", BENCH_POOL},
+    {"closure", BENCH_EVAL},       {"closure", BENCH_BYTECODE},
+    {"closure", BENCH_LOAD},       {"closure", BENCH_POOL},
+    {"typedarray", BENCH_EVAL},    {"typedarray", BENCH_BYTECODE},
+    {"typedarray", BENCH_LOAD},    {"typedarray", BENCH_POOL},
+    {"timers", BENCH_LOOP, "timers: ok"},
+    {"point", BENCH_NATIVE},       {"console", BENCH_CONSOLE},
+};
+
+#define BENCH_CASE_COUNT (int)(sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+// 一个用例的中位数，name 为 "<workload>/<path>"
+typedef struct {
+  char name[BENCH_NAME_MAX];
+  double ms;
+} BenchMetric;
+
+typedef struct {
+  int version;
+  char machine[128];
+  int count;
+  BenchMetric metrics[BENCH_METRICS_MAX];
+} BenchResults;
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+static void bench_machine(char *buf, size_t size) {
+  struct utsname u;
+  if (uname(&u) < 0)
+    snprintf(u.machine, sizeof(u.machine), "unknown");
+  snprintf(buf, size, "%s %ld cpus", u.machine, sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+static uint8_t *bench_compile(const char *source, const char *filename,
+                              size_t *len) {
+  JSRuntime *rt = JS_NewRuntime();
+  JSContext *ctx = JS_NewContext(rt);
+  uint8_t *bytecode = NULL;
+  JSValue obj = JS_Eval(ctx, source, strlen(source), filename,
+                        JS_EVAL_FLAG_COMPILE_ONLY | JS_EVAL_TYPE_GLOBAL);
+  if (JS_IsException(obj)) {
+    check_and_print_exception(ctx);
+  } else {
+    bytecode = JS_WriteObject(ctx, len, obj, JS_WRITE_OBJ_BYTECODE);
+    JS_FreeValue(ctx, obj);
+  }
+  JS_FreeContext(ctx);
+  JS_FreeRuntime(rt);
+  return bytecode;
+}
+
+// 模块没有完成值，由脚本把结果写到 benchmarkResult
+static int bench_check_result(JSContext *ctx) {
+  JSValue global = JS_GetGlobalObject(ctx);
+  JSValue result = JS_GetPropertyStr(ctx, global, "benchmarkResult");
+  int ok = JS_IsNumber(result);
+  if (!ok)
+    fprintf(stderr, "Error: benchmarkResult is not a number\n");
+  JS_FreeValue(ctx, result);
+  JS_FreeValue(ctx, global);
+  return ok ? 0 : -1;
+}
+
+// 本进程内的一次运行，返回毫秒数，失败返回 -1
+static double bench_run_local(const BenchCase *c, const char *filename,
+                              const char *source, const uint8_t *bytecode,
+                              size_t bytecode_len) {
+  JSRuntime *rt = JS_NewRuntime();
+  JSContext *ctx = JS_NewContext(rt);
+  if (c->path == BENCH_CONSOLE)
+    js_std_init_console(ctx);
+  if (c->path == BENCH_NATIVE)
+    js_init_module(ctx, "point");
+
+  // console 用例把标准输出临时重定向到 /dev/null
+  int saved_stdout = -1;
+  if (c->path == BENCH_CONSOLE) {
+    fflush(stdout);
+    int null_fd = open("/dev/null", O_WRONLY);
+    saved_stdout = dup(STDOUT_FILENO);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+  }
+
+  int failed = 0;
+  double start = get_time_ms();
+  switch (c->path) {
+  case BENCH_LOAD:
+    for (int i = 0; i < BENCH_LOAD_REPS && !failed; i++) {
+      JSValue func =
+          JS_ReadObject(ctx, bytecode, bytecode_len, JS_READ_OBJ_BYTECODE);
+      failed = JS_IsException(func);
+      JS_FreeValue(ctx, func);
+    }
+    break;
+  case BENCH_BYTECODE: {
+    JSValue func =
+        JS_ReadObject(ctx, bytecode, bytecode_len, JS_READ_OBJ_BYTECODE);
+    JSValue val = JS_IsException(func) ? func : JS_EvalFunction(ctx, func);
+    failed = JS_IsException(val);
+    JS_FreeValue(ctx, val);
+    break;
+  }
+  default: {
+    int flags = c->path == BENCH_NATIVE ? JS_EVAL_TYPE_MODULE
+                                        : JS_EVAL_TYPE_GLOBAL;
+    JSValue val = JS_Eval(ctx, source, strlen(source), filename, flags);
+    failed = JS_IsException(val);
+    JS_FreeValue(ctx, val);
+    break;
+  }
+  }
+  if (c->path == BENCH_NATIVE && !failed) {
+    JSContext *job_ctx;
+    while (JS_ExecutePendingJob(rt, &job_ctx) > 0)
+      ;
+  }
+  double elapsed = get_time_ms() - start;
+
+  if (saved_stdout >= 0) {
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+  }
+  if (failed)
+    check_and_print_exception(ctx);
+  else if (c->path == BENCH_NATIVE)
+    failed = bench_check_result(ctx) < 0;
+
+  JS_FreeContext(ctx);
+  JS_FreeRuntime(rt);
+  return failed ? -1 : elapsed;
+}
+
+// 运行 demo 的可执行文件并读取全部输出，调用方释放
+static char *bench_spawn(const char *cmd, int *status) {
+  FILE *p = popen(cmd, "r");
+  if (!p)
+    return NULL;
+  size_t len = 0, cap = 4096;
+  char *out = malloc(cap);
+  size_t n;
+  while (out && (n = fread(out + len, 1, cap - len - 1, p)) > 0) {
+    len += n;
+    if (cap - len < 1024)
+      out = realloc(out, cap *= 2);
+  }
+  *status = pclose(p);
+  if (out)
+    out[len] = '\0';
+  return out;
+}
+
+// 在子进程中的一次运行。pool 取 demo08 自己统计的墙钟时间（不含进程
+// 启动和脚本读取），loop 取整个进程的时间
+static double bench_run_process(const BenchCase *c, const char *filename) {
+  char cmd[512];
+  if (c->path == BENCH_POOL)
+    snprintf(cmd, sizeof(cmd), "%s --threads %d %s %d 2>&1", BENCH_POOL_BIN,
+             BENCH_POOL_THREADS, filename, BENCH_POOL_TASKS);
+  else
+    snprintf(cmd, sizeof(cmd), "%s %s 2>&1", BENCH_LOOP_BIN, filename);
+
+  int status;
+  double start = get_time_ms();
+  char *out = bench_spawn(cmd, &status);
+  double elapsed = get_time_ms() - start;
+  if (!out) {
+    fprintf(stderr, "Failed to run %s\n", cmd);
+    return -1;
+  }
+
+  // 脚本异常只打印不退出，从输出里检查
+  int failed = !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+               strstr(out, "Error") || strstr(out, "exception") ||
+               (c->expect && !strstr(out, c->expect));
+  if (c->path == BENCH_POOL && !failed) {
+    const char *line = strstr(out, "Throughput:");
+    double seconds;
+    if (line && sscanf(line, "Throughput: %*f tasks/s (%lf s wall clock)",
+                       &seconds) == 1)
+      elapsed = seconds * 1000;
+    else
+      failed = 1;
+  }
+  if (failed)
+    fprintf(stderr, "%s failed:\n%s", cmd, out);
+  free(out);
+  return failed ? -1 : elapsed;
+}
+
+// 运行一个用例 runs 次，返回中位数
+static double bench_run_case(const BenchCase *c, int runs, double *min,
+                             double *max) {
+  char filename[256];
+  snprintf(filename, sizeof(filename), "workloads/%s.js", c->workload);
+  char *source = NULL;
+  uint8_t *bytecode = NULL;
+  size_t bytecode_len = 0;
+  int local = c->path != BENCH_POOL && c->path != BENCH_LOOP;
+  if (local) {
+    source = read_file_to_string(filename);
+    if (!source)
+      return -1;
+    if (c->path == BENCH_BYTECODE || c->path == BENCH_LOAD) {
+      bytecode = bench_compile(source, filename, &bytecode_len);
+      if (!bytecode) {
+        free(source);
+        return -1;
+      }
+    }
+  }
+
+  double *samples = malloc(runs * sizeof(double));
+  double median = -1;
+  int i;
+  for (i = 0; i < runs; i++) {
+    samples[i] = local ? bench_run_local(c, filename, source, bytecode,
+                                         bytecode_len)
+                       : bench_run_process(c, filename);
+    if (samples[i] < 0)
+      break;
+  }
+  if (i == runs) {
+    qsort(samples, runs, sizeof(double), compare_double);
+    median = runs % 2 ? samples[runs / 2]
+                      : (samples[runs / 2 - 1] + samples[runs / 2]) / 2;
+    *min = samples[0];
+    *max = samples[runs - 1];
+  }
+
+  free(samples);
+  free(bytecode);
+  free(source);
+  return median;
+}
+
+static int bench_write(const BenchResults *r, int runs, const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  fprintf(f, "# QuickJS demo benchmark, median ms per case (bench/main.c)\n");
+  fprintf(f, "version %d\n", r->version);
+  fprintf(f, "machine %s\n", r->machine);
+  fprintf(f, "runs %d\n", runs);
+  for (int i = 0; i < r->count; i++)
+    fprintf(f, "%s %.3f\n", r->metrics[i].name, r->metrics[i].ms);
+  return fclose(f);
+}
+
+static int bench_read(BenchResults *r, const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return -1;
+  }
+  memset(r, 0, sizeof(*r));
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    line[strcspn(line, "\n")] = '\0';
+    if (line[0] == '#' || line[0] == '\0' || strncmp(line, "runs ", 5) == 0)
+      continue;
+    if (strncmp(line, "machine ", 8) == 0) {
+      snprintf(r->machine, sizeof(r->machine), "%.100s", line + 8);
+    } else if (sscanf(line, "version %d", &r->version) == 1) {
+    } else if (r->count < BENCH_METRICS_MAX &&
+               sscanf(line, "%63s %lf", r->metrics[r->count].name,
+                      &r->metrics[r->count].ms) == 2) {
+      r->count++;
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+// 与基线对比，中位数比基线慢 threshold% 以上的用例算作退化
+static int bench_compare(const BenchResults *base, const BenchResults *cur,
+                         double threshold) {
+  if (strcmp(base->machine, cur->machine) != 0)
+    printf("Warning: baseline recorded on %s, running on %s\n", base->machine,
+           cur->machine);
+
+  int regressed = 0;
+  printf("\n%-22s | %-13s | %-12s | %-8s\n", "Case", "Baseline (ms)",
+         "Current (ms)", "Change");
+  printf("---------------------------------------------------------------\n");
+  for (int i = 0; i < cur->count; i++) {
+    const BenchMetric *m = &cur->metrics[i];
+    const BenchMetric *b = NULL;
+    for (int j = 0; j < base->count && !b; j++) {
+      if (strcmp(base->metrics[j].name, m->name) == 0)
+        b = &base->metrics[j];
+    }
+    if (!b) {
+      printf("%-22s | %-13s | %-12.3f | new\n", m->name, "-", m->ms);
+      continue;
+    }
+    double change = b->ms > 0 ? (m->ms - b->ms) / b->ms * 100 : 0;
+    int bad = change > threshold;
+    regressed += bad;
+    printf("%-22s | %-13.3f | %-12.3f | %+6.1f%%%s\n", m->name, b->ms, m->ms,
+           change, bad ? "  REGRESSED" : "");
+  }
+  printf("---------------------------------------------------------------\n");
+  if (regressed)
+    printf("%d of %d cases regressed by more than %.1f%%\n", regressed,
+           cur->count, threshold);
+  else
+    printf("No case regressed by more than %.1f%%\n", threshold);
+  return regressed;
+}
+
+static void print_usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [--runs N] [--filter TEXT] [--output FILE] "
+          "[--compare BASELINE] [--threshold PCT]\n"
+          "  --runs N          runs per case, the median is reported "
+          "(default %d)\n"
+          "  --filter TEXT     only run cases whose name contains TEXT\n"
+          "  --output FILE     write the results in baseline format\n"
+          "  --compare FILE    fail if a case is slower than in FILE\n"
+          "  --threshold PCT   allowed slowdown for --compare (default "
+          "%.0f%%)\n",
+          prog, BENCH_RUNS_DEFAULT, BENCH_THRESHOLD_DEFAULT);
+}
+
+int main(int argc, char **argv) {
+  int runs = BENCH_RUNS_DEFAULT;
+  double threshold = BENCH_THRESHOLD_DEFAULT;
+  const char *filter = NULL;
+  const char *output = NULL;
+  const char *baseline = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+      runs = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+      baseline = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+      threshold = atof(argv[++i]);
+    } else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+  if (runs <= 0) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  // 先读基线，文件有问题时不必等全部用例跑完
+  BenchResults base;
+  if (baseline) {
+    if (bench_read(&base, baseline) < 0)
+      return 1;
+    if (base.version != BENCH_FORMAT_VERSION) {
+      fprintf(stderr,
+              "%s has format version %d, expected %d: re-record it with "
+              "make baseline\n",
+              baseline, base.version, BENCH_FORMAT_VERSION);
+      return 1;
+    }
+  }
+
+  BenchResults results = {.version = BENCH_FORMAT_VERSION};
+  bench_machine(results.machine, sizeof(results.machine));
+  printf("%d runs per case on %s\n\n", runs, results.machine);
+  printf("%-22s | %-11s | %-9s | %-9s\n", "Case", "Median (ms)", "Min (ms)",
+         "Max (ms)");
+  printf("---------------------------------------------------------\n");
+
+  int failed = 0;
+  for (int i = 0; i < BENCH_CASE_COUNT; i++) {
+    const BenchCase *c = &bench_cases[i];
+    BenchMetric *m = &results.metrics[results.count];
+    snprintf(m->name, sizeof(m->name), "%s/%s", c->workload,
+             bench_path_names[c->path]);
+    if (filter && !strstr(m->name, filter))
+      continue;
+
+    double min, max;
+    m->ms = bench_run_case(c, runs, &min, &max);
+    if (m->ms < 0) {
+      printf("%-22s | failed\n", m->name);
+      failed++;
+      continue;
+    }
+    printf("%-22s | %-11.3f | %-9.3f | %-9.3f\n", m->name, m->ms, min, max);
+    fflush(stdout);
+    results.count++;
+  }
+  printf("---------------------------------------------------------\n");
+
+  if (failed) {
+    fprintf(stderr, "%d cases failed\n", failed);
+    return 1;
+  }
+  if (output) {
+    if (bench_write(&results, runs, output) < 0)
+      return 1;
+    printf("Results written to %s\n", output);
+  }
+  if (baseline && bench_compare(&base, &results, threshold) != 0)
+    return 1;
+  return 0;
+}
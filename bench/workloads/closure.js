@@ -0,0 +1,85 @@
+// 闭包密集：组合函数、柯里化、记忆化和回调分发
+function compose() {
+  var fns = arguments;
+  return function (x) {
+    for (var i = fns.length - 1; i >= 0; i--)
+      x = fns[i](x);
+    return x;
+  };
+}
+
+function curry(fn) {
+  return function curried(a) {
+    return function (b) {
+      return function (c) {
+        return fn(a, b, c);
+      };
+    };
+  };
+}
+
+function memoize(fn) {
+  var cache = new Map();
+  return function (n) {
+    if (cache.has(n)) return cache.get(n);
+    var v = fn(n);
+    cache.set(n, v);
+    return v;
+  };
+}
+
+// 简单的事件分发器，每个监听器都是一个闭包
+function emitter() {
+  var listeners = {};
+  return {
+    on: function (name, fn) {
+      (listeners[name] || (listeners[name] = [])).push(fn);
+    },
+    emit: function (name, value) {
+      var list = listeners[name] || [];
+      for (var i = 0; i < list.length; i++) list[i](value);
+    }
+  };
+}
+
+var pipeline = compose(function (x) { return x * 3; },
+                       function (x) { return x + 1; },
+                       function (x) { return x % 1009; });
+var mix = curry(function (a, b, c) { return (a * 31 + b * 17 + c) % 65521; });
+var fib = memoize(function (n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); });
+
+var total = 0;
+var bus = emitter();
+for (var i = 0; i < 50; i++) {
+  (function (k) {
+    bus.on('tick', function (v) { total = (total + v * k) % 1000003; });
+  })(i);
+}
+
+var values = [];
+for (var i = 0; i < 5000; i++)
+  values.push(pipeline(i));
+
+var reduced = values
+  .map(function (v, i) { return mix(v)(i)(i & 7); })
+  .filter(function (v) { return v % 3 !== 0; })
+  .reduce(function (acc, v) { return (acc + v) % 1000003; }, 0);
+
+for (var i = 0; i < 500; i++)
+  bus.emit('tick', values[i] + fib(i % 60) % 1000);
+
+var counters = [];
+for (var i = 0; i < 2000; i++) {
+  counters.push((function () {
+    var n = i;
+    return function () { return ++n; };
+  })());
+}
+var bumped = 0;
+for (var i = 0; i < counters.length; i++)
+  bumped += counters[i]() - i;
+
+if (bumped !== 2000 || fib(59) !== 956722026041 || !(reduced > 0) ||
+    !(total > 0))
+  throw new Error('closure workload: unexpected result');
+reduced + total;
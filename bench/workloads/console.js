@@ -0,0 +1,7 @@
+// console 输出：字符串、数字和对象混合的多参数日志
+var levels = ['debug', 'info', 'notice', 'warn'];
+for (var i = 0; i < 5000; i++) {
+  console.log('[' + levels[i & 3] + ']', 'request', i, 'took', (i % 97) / 10,
+              'ms', { id: i }, i % 2 === 0);
+}
+5000;
@@ -0,0 +1,42 @@
+// JSON 密集：构造订单记录，序列化、解析、再聚合
+var orders = [];
+for (var i = 0; i < 500; i++) {
+  var items = [];
+  for (var j = 0; j < 1 + (i % 5); j++) {
+    items.push({ sku: 'SKU-' + ((i * 7 + j) % 500), qty: 1 + (j % 3),
+                 price: ((i * 13 + j * 17) % 1000) / 10 });
+  }
+  orders.push({ id: i, customer: { id: i % 97, name: 'customer ' + (i % 97),
+                                   tags: ['t' + (i % 3), 't' + (i % 7)] },
+                items: items, paid: i % 4 !== 0, note: i % 10 === 0 ? null : 'ok' });
+}
+
+var text = JSON.stringify(orders);
+var parsed = JSON.parse(text);
+
+// 按客户汇总金额
+var totals = {};
+for (var i = 0; i < parsed.length; i++) {
+  var order = parsed[i];
+  if (!order.paid) continue;
+  var sum = 0;
+  for (var j = 0; j < order.items.length; j++)
+    sum += order.items[j].qty * order.items[j].price;
+  var key = order.customer.name;
+  totals[key] = (totals[key] || 0) + sum;
+}
+
+// 带 replacer/reviver 的往返
+var summary = JSON.stringify(totals, function (k, v) {
+  return typeof v === 'number' ? Math.round(v * 100) / 100 : v;
+}, 2);
+var restored = JSON.parse(summary, function (k, v) {
+  return typeof v === 'number' ? Math.round(v) : v;
+});
+
+var checksum = 0;
+for (var k in restored) checksum += restored[k];
+if (parsed.length !== 500 || Object.keys(restored).length !== 97 ||
+    !(checksum > 0))
+  throw new Error('json workload: unexpected result ' + checksum);
+checksum;
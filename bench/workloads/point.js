@@ -0,0 +1,34 @@
+// 原生类调用：逐个对象的构造、访问器和方法调用，以及 PointArray 的批量操作
+import { Point, PointArray } from "point";
+
+var N = 20000;
+var points = new Array(N);
+var pa = new PointArray(N);
+for (var i = 0; i < N; i++) {
+  var x = (i * 7) % 1000 - 500;
+  var y = (i * 13) % 1000 - 500;
+  points[i] = new Point(x, y);
+  pa.x[i] = x;
+  pa.y[i] = y;
+}
+
+var norms = 0;
+for (var i = 0; i < N; i++) {
+  var p = points[i];
+  p.x += 3;
+  p.y -= 2;
+  norms += p.norm();
+}
+
+var out = new Float64Array(N);
+pa.translate(3, -2);
+pa.norms(out);
+var bulk = 0;
+for (var i = 0; i < N; i++) bulk += out[i];
+
+pa.distanceTo(10, -20, out);
+pa.scale(2);
+
+if (Math.abs(norms - bulk) > 1e-6 * norms)
+  throw new Error('point workload: ' + norms + ' != ' + bulk);
+globalThis.benchmarkResult = norms;
@@ -0,0 +1,44 @@
+// 正则密集：生成访问日志，逐行解析、改写和统计
+var methods = ['GET', 'POST', 'PUT', 'DELETE'];
+var lines = [];
+for (var i = 0; i < 1000; i++) {
+  lines.push('10.0.' + (i % 256) + '.' + ((i * 7) % 256) + ' - - [19/Oct/2026:' +
+             (10 + i % 14) + ':' + (10 + i % 50) + ':00 +0000] "' +
+             methods[i % 4] + ' /api/v' + (1 + i % 3) + '/users/' + (i * 31 % 1000) +
+             '?page=' + (i % 9) + ' HTTP/1.1" ' + (i % 17 === 0 ? 500 : 200) +
+             ' ' + (100 + i * 37 % 5000) + ' "Mozilla/5.0 (X11; Linux x86_64)"');
+}
+var log = lines.join('\n');
+
+var lineRe = /^(\d+\.\d+\.\d+\.\d+) \S+ \S+ \[([^\]]+)\] "(\w+) ([^ ?"]+)(?:\?([^ "]*))? HTTP\/[\d.]+" (\d{3}) (\d+) "([^"]*)"$/;
+var byRoute = {};
+var errors = 0;
+var bytes = 0;
+var entries = log.split(/\r?\n/);
+for (var i = 0; i < entries.length; i++) {
+  var m = lineRe.exec(entries[i]);
+  if (!m) throw new Error('regex workload: no match on line ' + i);
+  // 把数字 id 归一化成路由模板
+  var route = m[3] + ' ' + m[4].replace(/\/\d+(?=\/|$)/g, '/:id');
+  byRoute[route] = (byRoute[route] || 0) + 1;
+  if (m[6] === '500') errors++;
+  bytes += +m[7];
+  if (m[5] && !/^page=\d$/.test(m[5]))
+    throw new Error('regex workload: bad query ' + m[5]);
+}
+
+// 全局匹配和替换回调
+var ips = log.match(/\b10\.0\.\d{1,3}\.\d{1,3}\b/g).length;
+var masked = log.replace(/(\d+)\.(\d+)\.(\d+)\.(\d+)/g, function (s, a, b, c) {
+  return a + '.' + b + '.' + c + '.x';
+});
+var hours = {};
+var hourRe = /:(\d{2}):\d{2}:00 /g;
+var h;
+while ((h = hourRe.exec(masked)) !== null)
+  hours[h[1]] = (hours[h[1]] || 0) + 1;
+
+if (Object.keys(byRoute).length !== 12 || ips !== 1000 || errors !== 59 ||
+    Object.keys(hours).length !== 14)
+  throw new Error('regex workload: unexpected result');
+bytes;
@@ -0,0 +1,40 @@
+// 事件循环：一条定时器链与 Promise 链交替推进，同时挂着一批并发定时器
+var STEPS = 300;
+var BURST = 200;
+var fired = 0;
+var resolved = 0;
+
+function work(i) {
+  var record = JSON.parse(JSON.stringify({ id: i, tags: ['a', 'b'], n: i * 2 }));
+  return record.n;
+}
+
+function finish() {
+  if (fired !== STEPS + BURST || resolved !== STEPS * (STEPS - 1))
+    throw new Error('timers workload: fired ' + fired + ', resolved ' + resolved);
+  console.log('timers: ok');
+}
+
+function step(i) {
+  if (i === STEPS) {
+    // 等并发定时器全部触发后再检查
+    setTimeout(finish, 10);
+    return;
+  }
+  setTimeout(function () {
+    fired++;
+    Promise.resolve(i)
+      .then(work)
+      .then(function (n) {
+        resolved += n;
+        step(i + 1);
+      });
+  }, 0);
+}
+
+for (var j = 0; j < BURST; j++) {
+  setTimeout(function () {
+    fired++;
+  }, j % 5);
+}
+step(0);
@@ -0,0 +1,59 @@
+// 类型化数组密集：矩阵乘法、直方图、DataView 编解码和校验和
+var N = 32;
+var a = new Float64Array(N * N);
+var b = new Float64Array(N * N);
+var c = new Float64Array(N * N);
+for (var i = 0; i < N * N; i++) {
+  a[i] = (i % 17) / 17;
+  b[i] = (i % 13) / 13;
+}
+for (var i = 0; i < N; i++) {
+  for (var k = 0; k < N; k++) {
+    var aik = a[i * N + k];
+    for (var j = 0; j < N; j++)
+      c[i * N + j] += aik * b[k * N + j];
+  }
+}
+var trace = 0;
+for (var i = 0; i < N; i++) trace += c[i * N + i];
+
+// 伪随机样本的直方图
+var samples = new Int32Array(30000);
+var seed = 12345;
+for (var i = 0; i < samples.length; i++) {
+  seed = (Math.imul(seed, 1103515245) + 12345) | 0;
+  samples[i] = (seed >>> 16) & 0xff;
+}
+var histogram = new Uint32Array(256);
+for (var i = 0; i < samples.length; i++) histogram[samples[i]]++;
+
+// 用 DataView 打包成定长记录再读回
+var records = 1024;
+var view = new DataView(new ArrayBuffer(records * 16));
+for (var i = 0; i < records; i++) {
+  view.setUint32(i * 16, i, true);
+  view.setFloat64(i * 16 + 4, i * 0.5, true);
+  view.setInt16(i * 16 + 12, i % 1000 - 500, true);
+  view.setUint16(i * 16 + 14, histogram[i & 0xff], true);
+}
+var decoded = 0;
+for (var i = 0; i < records; i++) {
+  decoded += view.getUint32(i * 16, true) + view.getFloat64(i * 16 + 4, true) +
+             view.getInt16(i * 16 + 12, true);
+}
+
+// Adler-32 校验整个记录缓冲区
+var bytes = new Uint8Array(view.buffer);
+var s1 = 1, s2 = 0;
+for (var i = 0; i < bytes.length; i++) {
+  s1 = (s1 + bytes[i]) % 65521;
+  s2 = (s2 + s1) % 65521;
+}
+var adler = (s2 * 65536 + s1) >>> 0;
+
+var counted = 0;
+for (var i = 0; i < 256; i++) counted += histogram[i];
+if (counted !== samples.length || !(trace > 0) || decoded !== 773440 ||
+    adler === 1)
+  throw new Error('typedarray workload: unexpected result');
+trace + adler;
@@ -1,4 +1,5 @@
 #include "../quickjs/quickjs.h"
+#include "../helpers/callhandle.c"
 #include <stdio.h>
 #include <string.h>
 
@@ -22,13 +23,12 @@ int main(int argc, char **argv) {
     JS_FreeValue(ctx, exc);
   }
 
-  // Get the add function from the global object
-  JSValue add_func = JS_GetPropertyStr(ctx, global_obj, "add");
-
-  // Check if the add function is valid
-  if (!JS_IsFunction(ctx, add_func)) {
+  // 解析一次 add 并缓存，之后的调用不再按名字查找
+  JSCallHandle add;
+  if (js_call_handle_init(ctx, &add, global_obj, "add") < 0) {
     fprintf(stderr, "Error: add function not found\n");
-    JS_FreeValue(ctx, add_func);
+    JS_FreeValue(ctx, JS_GetException(ctx));
+    JS_FreeValue(ctx, val);
     JS_FreeValue(ctx, global_obj);
     JS_FreeContext(ctx);
     JS_FreeRuntime(rt);
@@ -39,12 +39,13 @@ int main(int argc, char **argv) {
   JSValue args[2];
   args[0] = JS_NewInt32(ctx, 11);
   args[1] = JS_NewInt32(ctx, 22);
-  JSValue result = JS_Call(ctx, add_func, JS_UNDEFINED, 2, args);
+  JSValue result = js_call_handle_call(&add, 2, args);
   // Check if the result is valid
   if (!JS_IsNumber(result)) {
     fprintf(stderr, "Error: add function returned invalid result\n");
     JS_FreeValue(ctx, result);
-    JS_FreeValue(ctx, add_func);
+    js_call_handle_free(&add);
+    JS_FreeValue(ctx, val);
     JS_FreeValue(ctx, global_obj);
     JS_FreeContext(ctx);
     JS_FreeRuntime(rt);
@@ -56,13 +57,30 @@ int main(int argc, char **argv) {
   JS_ToInt32(ctx, &sum, result);
   printf("Result: %d\n", sum);
 
+  // 用预先构造好的参数批量调用 add(i, i * 10)
+  enum { BATCH = 4 };
+  JSValue batch_args[BATCH * 2];
+  JSValue batch_results[BATCH];
+  for (int i = 0; i < BATCH; i++) {
+    batch_args[i * 2] = JS_NewInt32(ctx, i);
+    batch_args[i * 2 + 1] = JS_NewInt32(ctx, i * 10);
+  }
+  int done = js_call_n(&add, BATCH, 2, batch_args, batch_results);
+  for (int i = 0; i < done; i++) {
+    JS_ToInt32(ctx, &sum, batch_results[i]);
+    printf("add(%d, %d) = %d\n", i, i * 10, sum);
+    JS_FreeValue(ctx, batch_results[i]);
+  }
+  if (done < BATCH) {
+    fprintf(stderr, "Error: add failed in batch call %d\n", done);
+    JS_FreeValue(ctx, JS_GetException(ctx));
+  }
+
   JS_FreeValue(ctx, val);
   JS_FreeValue(ctx, result);
-  JS_FreeValue(ctx, add_func);
+  js_call_handle_free(&add);
   JS_FreeValue(ctx, global_obj);
 
-  JS_RunGC(rt);
-
   JS_FreeContext(ctx);
   JS_FreeRuntime(rt);
 
@@ -0,0 +1,91 @@
+#include "../helpers/clock.c"
+#include "../helpers/exception.c"
+#include "../helpers/jsfunc.h"
+#include "../quickjs/quickjs.h"
+#include <stdio.h>
+#include <string.h>
+
+// 每个用例的调用次数
+#define CALLS 10000000
+#define STR(x) #x
+#define XSTR(x) STR(x)
+
+// 通用 JSCFunction 写法，用作对照
+static JSValue js_add(JSContext *ctx, JSValueConst this_val, int argc,
+                      JSValueConst *argv) {
+  int a, b;
+  if (JS_ToInt32(ctx, &a, argv[0]))
+    return JS_EXCEPTION;
+  if (JS_ToInt32(ctx, &b, argv[1]))
+    return JS_EXCEPTION;
+  return JS_NewInt32(ctx, a + b);
+}
+
+static int32_t add(int32_t a, int32_t b) {
+  return (int32_t)((uint32_t)a + (uint32_t)b);
+}
+
+JS_TYPED_FUNC2(add, int32, int32, int32)
+
+// 执行一段代码并打印每秒调用次数
+static int run_case(JSContext *ctx, const char *name, const char *js_code) {
+  double start = get_time_ms();
+  JSValue val = JS_Eval(ctx, js_code, strlen(js_code), "<benchmark>",
+                        JS_EVAL_TYPE_GLOBAL);
+  double elapsed = get_time_ms() - start;
+
+  if (JS_IsException(val)) {
+    check_and_print_exception(ctx);
+    return 1;
+  }
+
+  int32_t result = 0;
+  JS_ToInt32(ctx, &result, val);
+  JS_FreeValue(ctx, val);
+
+  printf("%-24s | %10.1f ms | %14.0f calls/s | result %d\n", name, elapsed,
+         CALLS / (elapsed / 1000), result);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  JSRuntime *rt = JS_NewRuntime();
+  JSContext *ctx = JS_NewContext(rt);
+  JSValue global_obj = JS_GetGlobalObject(ctx);
+
+  JS_SetPropertyStr(ctx, global_obj, "addGeneric",
+                    JS_NewCFunction(ctx, js_add, "addGeneric", 2));
+  JS_TYPED_FUNC_SET(ctx, global_obj, "add", add, 2);
+  JS_FreeValue(ctx, global_obj);
+
+  // 批量用例的输入，不计入耗时
+  const char *setup = "var N = " XSTR(CALLS) ";\n"
+                      "var xs = new Int32Array(N), ys = new Int32Array(N);\n"
+                      "var out = new Int32Array(N);\n"
+                      "for (var i = 0; i < N; i++) { xs[i] = i; ys[i] = 1; }\n"
+                      "function jsAdd(a, b) { return (a + b) | 0; }\n";
+  JSValue val =
+      JS_Eval(ctx, setup, strlen(setup), "<setup>", JS_EVAL_TYPE_GLOBAL);
+  if (JS_IsException(val)) {
+    check_and_print_exception(ctx);
+    return 1;
+  }
+  JS_FreeValue(ctx, val);
+
+  printf("%d calls per case\n", CALLS);
+
+  int ret = 0;
+  ret |= run_case(ctx, "JS function",
+                  "var s = 0; for (var i = 0; i < N; i++) s = jsAdd(s, i); s");
+  ret |= run_case(ctx, "generic C function",
+                  "var s = 0; for (var i = 0; i < N; i++) s = addGeneric(s, "
+                  "i); s");
+  ret |= run_case(ctx, "typed C function",
+                  "var s = 0; for (var i = 0; i < N; i++) s = add(s, i); s");
+  ret |= run_case(ctx, "typed C function batch",
+                  "add.batch(xs, ys, out); out[N - 1]");
+
+  JS_FreeContext(ctx);
+  JS_FreeRuntime(rt);
+  return ret;
+}
@@ -1,19 +1,18 @@
 #include "../helpers/exception.c"
+#include "../helpers/jsfunc.h"
 #include "../quickjs/quickjs.h"
 #include <stdio.h>
 #include <string.h>
 
-// C function to be called from JavaScript
-static JSValue js_add(JSContext *ctx, JSValueConst this_val, int argc,
-                      JSValueConst *argv) {
-  int a, b;
-  if (JS_ToInt32(ctx, &a, argv[0]))
-    return JS_EXCEPTION;
-  if (JS_ToInt32(ctx, &b, argv[1]))
-    return JS_EXCEPTION;
-  return JS_NewInt32(ctx, a + b);
+// C function to be called from JavaScript, int32 加法按补码回绕
+static int32_t add(int32_t a, int32_t b) {
+  return (int32_t)((uint32_t)a + (uint32_t)b);
 }
 
+// 声明签名 int32,int32 -> int32，生成带快速路径的包装 js_typed_add
+// 以及批量版本 add.batch(xs, ys)
+JS_TYPED_FUNC2(add, int32, int32, int32)
+
 int main(int argc, char **argv) {
   JSRuntime *rt = JS_NewRuntime();
   JSContext *ctx = JS_NewContext(rt);
@@ -22,8 +21,7 @@ int main(int argc, char **argv) {
   JSValue global_obj = JS_GetGlobalObject(ctx);
 
   // Define the C function in JavaScript environment
-  JSValue add_func = JS_NewCFunction(ctx, js_add, "add", 2);
-  JS_SetPropertyStr(ctx, global_obj, "add", add_func);
+  JS_TYPED_FUNC_SET(ctx, global_obj, "add", add, 2);
 
   // Execute JavaScript code that uses the C function
   const char *user_code = "add(11, 22)";
@@ -45,8 +43,6 @@ int main(int argc, char **argv) {
   JS_FreeValue(ctx, val);
   JS_FreeValue(ctx, global_obj);
 
-  JS_RunGC(rt);
-
   JS_FreeContext(ctx);
   JS_FreeRuntime(rt);
 
@@ -24,8 +24,6 @@ int main(int argc, char **argv) {
 
   JS_FreeValue(ctx, val);
 
-  JS_RunGC(rt);
-
   JS_FreeContext(ctx);
   JS_FreeRuntime(rt);
 
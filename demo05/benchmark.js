@@ -0,0 +1,80 @@
+/* per-object Point loops vs PointArray bulk operations */
+import { Point, PointArray } from "./point";
+
+const N = 1000000;
+
+function bench(name, fn) {
+    const start = Date.now();
+    const result = fn();
+    console.log(name.padEnd(32), String(Date.now() - start).padStart(6), "ms");
+    return result;
+}
+
+const points = new Array(N);
+const pa = new PointArray(N);
+for (let i = 0; i < N; i++) {
+    const x = (i * 7) % 1000 - 500;
+    const y = (i * 13) % 1000 - 500;
+    points[i] = new Point(x, y);
+    pa.x[i] = x;
+    pa.y[i] = y;
+}
+
+const out = new Float64Array(N);
+
+function check(name, a, b) {
+    if (Math.abs(a - b) > 1e-9 * Math.abs(a))
+        throw Error(name + " mismatch: " + a + " != " + b);
+}
+
+console.log(`${N} points`);
+
+const s1 = bench("Point norm()", () => {
+    let sum = 0;
+    for (let i = 0; i < N; i++)
+        sum += points[i].norm();
+    return sum;
+});
+const s2 = bench("PointArray norms()", () => {
+    pa.norms(out);
+    let sum = 0;
+    for (let i = 0; i < N; i++)
+        sum += out[i];
+    return sum;
+});
+check("norm", s1, s2);
+
+bench("Point translate loop", () => {
+    for (let i = 0; i < N; i++) {
+        const p = points[i];
+        p.x += 3;
+        p.y -= 2;
+    }
+});
+bench("PointArray translate()", () => pa.translate(3, -2));
+
+bench("Point scale loop", () => {
+    for (let i = 0; i < N; i++) {
+        const p = points[i];
+        p.x *= 2;
+        p.y *= 2;
+    }
+});
+bench("PointArray scale()", () => pa.scale(2));
+
+const d1 = bench("Point distanceTo loop", () => {
+    let sum = 0;
+    for (let i = 0; i < N; i++) {
+        const dx = points[i].x - 10, dy = points[i].y + 20;
+        sum += Math.sqrt(dx * dx + dy * dy);
+    }
+    return sum;
+});
+const d2 = bench("PointArray distanceTo()", () => {
+    pa.distanceTo(10, -20, out);
+    let sum = 0;
+    for (let i = 0; i < N; i++)
+        sum += out[i];
+    return sum;
+});
+check("distance", d1, d2);
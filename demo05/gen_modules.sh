@@ -0,0 +1,53 @@
+#!/bin/sh
+# 生成一个由 count 个模块组成的合成应用，以及把所有模块合并在一起的 bundle。
+# mod_i 导入 mod_{2i+1} 和 mod_{2i+2}，入口 main.js 导入 mod_0
+# 用法: ./gen_modules.sh <dir> <count>
+dir=$1
+count=$2
+functions=20
+
+mkdir -p "$dir"
+i=0
+while [ "$i" -lt "$count" ]; do
+  left=$((2 * i + 1))
+  right=$((2 * i + 2))
+  {
+    [ "$left" -lt "$count" ] && printf 'import { run%d } from "./mod_%d.js";\n' "$left" "$left"
+    [ "$right" -lt "$count" ] && printf 'import { run%d } from "./mod_%d.js";\n' "$right" "$right"
+    j=0
+    while [ "$j" -lt "$functions" ]; do
+      printf 'function f%d(a, b) {\n' "$j"
+      printf '  var s = "module %d function %d";\n' "$i" "$j"
+      printf '  for (var k = 0; k < 10; k++) a = (a * 31 + b + s.length) | 0;\n'
+      printf '  return a;\n}\n'
+      j=$((j + 1))
+    done
+    printf 'export function run%d(acc) {\n' "$i"
+    j=0
+    while [ "$j" -lt "$functions" ]; do
+      printf '  acc = f%d(acc, %d);\n' "$j" "$j"
+      j=$((j + 1))
+    done
+    [ "$left" -lt "$count" ] && printf '  acc = run%d(acc);\n' "$left"
+    [ "$right" -lt "$count" ] && printf '  acc = run%d(acc);\n' "$right"
+    printf '  return acc;\n}\n'
+  } > "$dir/mod_$i.js"
+  i=$((i + 1))
+done
+
+{
+  printf 'import { run0 } from "./mod_0.js";\n'
+  printf 'if (typeof run0(0) !== "number") throw new Error("unexpected result");\n'
+} > "$dir/main.js"
+
+# bundle 中的模块名与从 $dir/main.js 出发规范化后的名称一致
+{
+  printf '// @module %s/main.js\n' "$dir"
+  cat "$dir/main.js"
+  i=0
+  while [ "$i" -lt "$count" ]; do
+    printf '// @module %s/mod_%d.js\n' "$dir" "$i"
+    cat "$dir/mod_$i.js"
+    i=$((i + 1))
+  done
+} > "$dir.bundle"
@@ -1,36 +1,152 @@
 #include "../helpers/console.c"
 #include "../helpers/exception.c"
-#include "../helpers/file.c"
+#include "../helpers/modules.c"
 #include "../quickjs/quickjs.h"
 #include "./point.c"
 #include <stdlib.h>
 #include <string.h>
 
+static void print_usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [--jobs N] [--bundle FILE] [--cache-dir DIR] [--stats] "
+          "[<module.js>]\n"
+          "  --jobs N    read and compile the import graph on N threads "
+          "(0: load on demand)\n"
+          "  --bundle    load modules from a bundle instead of the file "
+          "system\n"
+          "  --cache-dir reuse compiled bytecode from DIR across runs\n",
+          prog);
+}
+
 int main(int argc, char **argv) {
+  int jobs = 0;
+  const char *bundle_path = NULL;
+  int show_stats = 0;
+  const char *cache_dir = NULL;
+
+  int argi = 1;
+  while (argi < argc && strncmp(argv[argi], "--", 2) == 0) {
+    if (strcmp(argv[argi], "--jobs") == 0 && argi + 1 < argc) {
+      jobs = atoi(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--bundle") == 0 && argi + 1 < argc) {
+      bundle_path = argv[argi + 1];
+      argi += 2;
+    } else if (strcmp(argv[argi], "--cache-dir") == 0 && argi + 1 < argc) {
+      cache_dir = argv[argi + 1];
+      argi += 2;
+    } else if (strcmp(argv[argi], "--stats") == 0) {
+      show_stats = 1;
+      argi++;
+    } else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  // 默认执行 point.js，也可以通过参数指定其他模块文件（如 benchmark.js）
+  const char *filename = argi < argc ? argv[argi] : "point.js";
+
+  double start = get_time_ms();
+  int ret = 1;
+  ModuleLoader loader;
+  if (module_loader_init(&loader, bundle_path) < 0)
+    goto free_loader;
+
+  // 编译缓存上限 256 MB
+  CompileCache cache;
+  if (cache_dir) {
+    if (compile_cache_init(&cache, cache_dir, 256 << 20) < 0)
+      goto free_cache;
+    loader.cache = &cache;
+  }
+
   JSRuntime *rt = JS_NewRuntime();
-  JSContext *ctx = JS_NewContext(rt);
+  JSContext *ctx = rt ? JS_NewContext(rt) : NULL;
+  if (!ctx) {
+    fprintf(stderr, "Failed to create JS runtime\n");
+    goto free_runtime;
+  }
 
   js_std_init_console(ctx);
 
   // Initialize Point module
-  js_init_module(ctx, "point");
+  if (!js_init_module(ctx, "point")) {
+    fprintf(stderr, "Failed to initialize the point module\n");
+    goto done;
+  }
+
+  module_loader_install(rt, &loader);
+
+  // 并行模式下先在线程池中编译整个导入图，再在本线程读入字节码并链接；
+  // 否则由 QuickJS 在链接时逐个回调加载器
+  JSValue module;
+  int module_count = 0;
+  double load_ms;
+  if (jobs > 0) {
+    ModuleGraph graph;
+    if (module_graph_load(&graph, &loader, filename, jobs) < 0) {
+      module_graph_free(&graph);
+      goto done;
+    }
+    load_ms = get_time_ms() - start;
+    module = module_graph_link(ctx, &graph);
+    for (int i = 0; i < graph.count; i++) {
+      module_count += graph.nodes[i].bytecode != NULL;
+    }
+    module_graph_free(&graph);
+  } else {
+    module = module_loader_compile(ctx, &loader, filename);
+    load_ms = get_time_ms() - start;
+    if (!JS_IsException(module) && JS_ResolveModule(ctx, module) < 0) {
+      JS_FreeValue(ctx, module);
+      module = JS_EXCEPTION;
+    }
+  }
 
-  char *js_code = read_file_to_string("point.js");
+  if (JS_IsException(module)) {
+    check_and_print_exception(ctx);
+    goto done;
+  }
+  double link_ms = get_time_ms() - start - load_ms;
 
-  JSValue val =
-      JS_Eval(ctx, js_code, strlen(js_code), "a.js", JS_EVAL_TYPE_MODULE);
-  free(js_code);
+  JSValue val = JS_EvalFunction(ctx, module);
 
   if (JS_IsException(val)) {
     check_and_print_exception(ctx);
-    return 1;
+    goto done;
   }
 
   JS_FreeValue(ctx, val);
+  double total_ms = get_time_ms() - start;
+
+  if (show_stats) {
+    if (jobs > 0) {
+      printf("Cold start with %d threads: %.2f ms (read + compile %d "
+             "modules %.2f ms, link %.2f ms, evaluate %.2f ms)\n",
+             jobs, total_ms, module_count, load_ms, link_ms,
+             total_ms - load_ms - link_ms);
+    } else {
+      // 按需加载时依赖在链接阶段才被读取和编译
+      printf("Cold start on demand: %.2f ms (read + compile + link %.2f ms, "
+             "evaluate %.2f ms)\n",
+             total_ms, load_ms + link_ms, total_ms - load_ms - link_ms);
+    }
+    if (cache_dir)
+      compile_cache_print_stats(&cache);
+  }
 
-  JS_RunGC(rt);
+  ret = 0;
 
+done:
   JS_FreeContext(ctx);
-  JS_FreeRuntime(rt);
-  return 0;
-}
\ No newline at end of file
+free_runtime:
+  if (rt)
+    JS_FreeRuntime(rt);
+free_cache:
+  if (cache_dir)
+    compile_cache_free(&cache);
+free_loader:
+  module_loader_free(&loader);
+  return ret;
+}
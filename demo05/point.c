@@ -21,119 +21,398 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
+#include "../helpers/jsfunc.h"
 #include "../quickjs/quickjs.h"
+#include "./point_kernels.c"
 #include <math.h>
+#include <stdint.h>
 
 #define countof(x) (sizeof(x) / sizeof((x)[0]))
 
-/* Point Class */
+/* Point Class
+
+   The struct, constructor, finalizer and x/y accessors are generated from
+   the field list below. */
+
+#define JS_CLASS_PREFIX point
+#define JS_CLASS_NAME "Point"
+#define JS_CLASS_STRUCT JSPointData
+#define JS_CLASS_FIELDS(F) F(int32, x) F(int32, y)
+#include "../helpers/jsclass_template.h"
+
+static double point_norm(JSPointData *s) {
+  return sqrt((double)s->x * s->x + (double)s->y * s->y);
+}
+
+/* signature: this Point -> float64, generates js_typed_point_norm */
+JS_TYPED_METHOD0(point_norm, JSPointData, js_point_class_id, float64)
+
+static const JSCFunctionListEntry js_point_proto_funcs[] = {
+    JS_CFUNC_DEF("norm", 0, js_typed_point_norm),
+};
+
+/* PointArray Class
+
+   Structure-of-arrays storage: one ArrayBuffer holds all x values followed
+   by all y values, exposed to JS as two Int32Array views. Bulk operations
+   run over the whole buffer in one native call. */
 
 typedef struct {
-  int x;
-  int y;
-} JSPointData;
+  uint32_t length;
+  JSValue buffer; /* ArrayBuffer of 2 * length int32 */
+  JSValue xs;     /* Int32Array view of the x values */
+  JSValue ys;     /* Int32Array view of the y values */
+} JSPointArrayData;
 
-static JSClassID js_point_class_id;
+static JSClassID js_point_array_class_id;
 
-static void js_point_finalizer(JSRuntime *rt, JSValue val) {
-  JSPointData *s = JS_GetOpaque(val, js_point_class_id);
-  /* Note: 's' can be NULL in case JS_SetOpaque() was not called */
-  js_free_rt(rt, s);
+static void js_point_array_finalizer(JSRuntime *rt, JSValue val) {
+  JSPointArrayData *pa = JS_GetOpaque(val, js_point_array_class_id);
+  if (pa) {
+    JS_FreeValueRT(rt, pa->buffer);
+    JS_FreeValueRT(rt, pa->xs);
+    JS_FreeValueRT(rt, pa->ys);
+    js_free_rt(rt, pa);
+  }
 }
 
-static JSValue js_point_ctor(JSContext *ctx, JSValueConst new_target, int argc,
-                             JSValueConst *argv) {
-  JSPointData *s;
+static void js_point_array_mark(JSRuntime *rt, JSValueConst val,
+                                JS_MarkFunc *mark_func) {
+  JSPointArrayData *pa = JS_GetOpaque(val, js_point_array_class_id);
+  if (pa) {
+    JS_MarkValue(rt, pa->buffer, mark_func);
+    JS_MarkValue(rt, pa->xs, mark_func);
+    JS_MarkValue(rt, pa->ys, mark_func);
+  }
+}
+
+static void js_point_array_buffer_free(JSRuntime *rt, void *opaque,
+                                       void *ptr) {
+  js_free_rt(rt, ptr);
+}
+
+/* new <ctor_name>(buffer, byte_offset, length) */
+static JSValue js_point_new_typed_array(JSContext *ctx, const char *ctor_name,
+                                        JSValueConst buffer,
+                                        uint32_t byte_offset,
+                                        uint32_t length) {
+  JSValue global_obj, ctor, ret;
+  JSValue args[3];
+
+  global_obj = JS_GetGlobalObject(ctx);
+  ctor = JS_GetPropertyStr(ctx, global_obj, ctor_name);
+  JS_FreeValue(ctx, global_obj);
+  if (JS_IsException(ctor))
+    return JS_EXCEPTION;
+  args[0] = buffer;
+  args[1] = JS_NewUint32(ctx, byte_offset);
+  args[2] = JS_NewUint32(ctx, length);
+  ret = JS_CallConstructor(ctx, ctor, 3, args);
+  JS_FreeValue(ctx, ctor);
+  return ret;
+}
+
+/* return the data pointer of a typed array whose element size is
+   'elem_size' and which holds at least 'min_length' elements */
+static void *js_point_typed_array_data(JSContext *ctx, JSValueConst obj,
+                                       size_t elem_size, size_t min_length) {
+  size_t byte_offset, byte_length, bytes_per_element, size;
+  JSValue buffer;
+  uint8_t *data;
+
+  buffer = JS_GetTypedArrayBuffer(ctx, obj, &byte_offset, &byte_length,
+                                  &bytes_per_element);
+  if (JS_IsException(buffer))
+    return NULL;
+  data = JS_GetArrayBuffer(ctx, &size, buffer);
+  JS_FreeValue(ctx, buffer);
+  if (!data)
+    return NULL;
+  if (bytes_per_element != elem_size || byte_length < min_length * elem_size) {
+    JS_ThrowRangeError(ctx, "invalid typed array");
+    return NULL;
+  }
+  return data + byte_offset;
+}
+
+static JSValue js_point_array_ctor(JSContext *ctx, JSValueConst new_target,
+                                   int argc, JSValueConst *argv) {
+  JSPointArrayData *pa;
   JSValue obj = JS_UNDEFINED;
   JSValue proto;
+  uint64_t length;
+  uint8_t *buf;
+  size_t size;
+
+  if (JS_ToIndex(ctx, &length, argv[0]))
+    return JS_EXCEPTION;
+  /* byte offsets of the views must fit in an int32 */
+  if (length > INT32_MAX / (2 * sizeof(int32_t)))
+    return JS_ThrowRangeError(ctx, "invalid PointArray length");
 
-  s = js_mallocz(ctx, sizeof(*s));
-  if (!s)
+  pa = js_mallocz(ctx, sizeof(*pa));
+  if (!pa)
     return JS_EXCEPTION;
-  if (JS_ToInt32(ctx, &s->x, argv[0]))
+  pa->length = length;
+  pa->buffer = JS_UNDEFINED;
+  pa->xs = JS_UNDEFINED;
+  pa->ys = JS_UNDEFINED;
+
+  size = 2 * length * sizeof(int32_t);
+  buf = js_mallocz(ctx, size ? size : 1);
+  if (!buf)
+    goto fail;
+  pa->buffer =
+      JS_NewArrayBuffer(ctx, buf, size, js_point_array_buffer_free, NULL, 0);
+  if (JS_IsException(pa->buffer)) {
+    js_free(ctx, buf);
+    goto fail;
+  }
+  pa->xs = js_point_new_typed_array(ctx, "Int32Array", pa->buffer, 0, length);
+  if (JS_IsException(pa->xs))
     goto fail;
-  if (JS_ToInt32(ctx, &s->y, argv[1]))
+  pa->ys = js_point_new_typed_array(ctx, "Int32Array", pa->buffer,
+                                    length * sizeof(int32_t), length);
+  if (JS_IsException(pa->ys))
     goto fail;
-  /* using new_target to get the prototype is necessary when the
-     class is extended. */
+
   proto = JS_GetPropertyStr(ctx, new_target, "prototype");
   if (JS_IsException(proto))
     goto fail;
-  obj = JS_NewObjectProtoClass(ctx, proto, js_point_class_id);
+  obj = JS_NewObjectProtoClass(ctx, proto, js_point_array_class_id);
   JS_FreeValue(ctx, proto);
   if (JS_IsException(obj))
     goto fail;
-  JS_SetOpaque(obj, s);
+  JS_SetOpaque(obj, pa);
   return obj;
 fail:
-  js_free(ctx, s);
+  JS_FreeValue(ctx, pa->buffer);
+  JS_FreeValue(ctx, pa->xs);
+  JS_FreeValue(ctx, pa->ys);
+  js_free(ctx, pa);
   JS_FreeValue(ctx, obj);
   return JS_EXCEPTION;
 }
 
-static JSValue js_point_get_xy(JSContext *ctx, JSValueConst this_val,
-                               int magic) {
-  JSPointData *s = JS_GetOpaque2(ctx, this_val, js_point_class_id);
-  if (!s)
+/* get the x/y arrays of 'this_val'. The pointers are fetched again on every
+   call because the buffer is visible to JS and may have been detached. */
+static JSPointArrayData *js_point_array_get_data(JSContext *ctx,
+                                                 JSValueConst this_val,
+                                                 int32_t **px, int32_t **py) {
+  JSPointArrayData *pa;
+  uint8_t *buf;
+  size_t size;
+
+  pa = JS_GetOpaque2(ctx, this_val, js_point_array_class_id);
+  if (!pa)
+    return NULL;
+  buf = JS_GetArrayBuffer(ctx, &size, pa->buffer);
+  if (!buf)
+    return NULL;
+  if (size < 2 * (size_t)pa->length * sizeof(int32_t)) {
+    JS_ThrowTypeError(ctx, "PointArray buffer is too small");
+    return NULL;
+  }
+  *px = (int32_t *)buf;
+  *py = (int32_t *)buf + pa->length;
+  return pa;
+}
+
+/* use 'out' if it is a Float64Array, otherwise allocate a new one.
+   Creating the array may run JS code (the global constructor can be
+   replaced), so callers fetch the point data only afterwards. */
+static JSValue js_point_array_output(JSContext *ctx, JSValueConst out,
+                                     uint32_t length, double **pdata) {
+  JSValue ret;
+
+  if (JS_IsUndefined(out)) {
+    size_t size = length * sizeof(double);
+    uint8_t *buf = js_mallocz(ctx, size ? size : 1);
+    if (!buf)
+      return JS_EXCEPTION;
+    JSValue buffer = JS_NewArrayBuffer(ctx, buf, size,
+                                       js_point_array_buffer_free, NULL, 0);
+    if (JS_IsException(buffer)) {
+      js_free(ctx, buf);
+      return JS_EXCEPTION;
+    }
+    ret = js_point_new_typed_array(ctx, "Float64Array", buffer, 0, length);
+    JS_FreeValue(ctx, buffer);
+  } else {
+    ret = JS_DupValue(ctx, out);
+  }
+  if (JS_IsException(ret))
     return JS_EXCEPTION;
-  if (magic == 0)
-    return JS_NewInt32(ctx, s->x);
-  else
-    return JS_NewInt32(ctx, s->y);
+  *pdata = js_point_typed_array_data(ctx, ret, sizeof(double), length);
+  if (!*pdata) {
+    JS_FreeValue(ctx, ret);
+    return JS_EXCEPTION;
+  }
+  return ret;
 }
 
-static JSValue js_point_set_xy(JSContext *ctx, JSValueConst this_val,
-                               JSValue val, int magic) {
-  JSPointData *s = JS_GetOpaque2(ctx, this_val, js_point_class_id);
-  int v;
-  if (!s)
+static JSValue js_point_array_get_length(JSContext *ctx,
+                                         JSValueConst this_val) {
+  JSPointArrayData *pa = JS_GetOpaque2(ctx, this_val, js_point_array_class_id);
+  if (!pa)
     return JS_EXCEPTION;
-  if (JS_ToInt32(ctx, &v, val))
+  return JS_NewUint32(ctx, pa->length);
+}
+
+static JSValue js_point_array_get_xy(JSContext *ctx, JSValueConst this_val,
+                                     int magic) {
+  JSPointArrayData *pa = JS_GetOpaque2(ctx, this_val, js_point_array_class_id);
+  if (!pa)
     return JS_EXCEPTION;
   if (magic == 0)
-    s->x = v;
+    return JS_DupValue(ctx, pa->xs);
   else
-    s->y = v;
-  return JS_UNDEFINED;
+    return JS_DupValue(ctx, pa->ys);
+}
+
+/* distanceTo(x, y[, out]) or distanceTo(point[, out]) */
+static JSValue js_point_array_distance_to(JSContext *ctx,
+                                          JSValueConst this_val, int argc,
+                                          JSValueConst *argv) {
+  JSPointArrayData *pa;
+  JSPointData *s;
+  int32_t *xs, *ys;
+  double px, py, *out;
+  JSValueConst out_val;
+  JSValue ret;
+
+  s = JS_GetOpaque(argv[0], js_point_class_id);
+  if (s) {
+    px = s->x;
+    py = s->y;
+    out_val = argc > 1 ? argv[1] : JS_UNDEFINED;
+  } else {
+    if (JS_ToFloat64(ctx, &px, argv[0]))
+      return JS_EXCEPTION;
+    if (JS_ToFloat64(ctx, &py, argv[1]))
+      return JS_EXCEPTION;
+    out_val = argc > 2 ? argv[2] : JS_UNDEFINED;
+  }
+
+  pa = JS_GetOpaque2(ctx, this_val, js_point_array_class_id);
+  if (!pa)
+    return JS_EXCEPTION;
+  ret = js_point_array_output(ctx, out_val, pa->length, &out);
+  if (JS_IsException(ret))
+    return JS_EXCEPTION;
+  if (!js_point_array_get_data(ctx, this_val, &xs, &ys)) {
+    JS_FreeValue(ctx, ret);
+    return JS_EXCEPTION;
+  }
+  point_distances(xs, ys, px, py, out, pa->length);
+  return ret;
 }
 
-static JSValue js_point_norm(JSContext *ctx, JSValueConst this_val, int argc,
-                             JSValueConst *argv) {
-  JSPointData *s = JS_GetOpaque2(ctx, this_val, js_point_class_id);
-  if (!s)
+/* norms([out]): distance of every point to the origin */
+static JSValue js_point_array_norms(JSContext *ctx, JSValueConst this_val,
+                                    int argc, JSValueConst *argv) {
+  JSPointArrayData *pa;
+  int32_t *xs, *ys;
+  double *out;
+  JSValue ret;
+
+  pa = JS_GetOpaque2(ctx, this_val, js_point_array_class_id);
+  if (!pa)
+    return JS_EXCEPTION;
+  ret = js_point_array_output(ctx, argc > 0 ? argv[0] : JS_UNDEFINED,
+                              pa->length, &out);
+  if (JS_IsException(ret))
+    return JS_EXCEPTION;
+  if (!js_point_array_get_data(ctx, this_val, &xs, &ys)) {
+    JS_FreeValue(ctx, ret);
     return JS_EXCEPTION;
-  return JS_NewFloat64(ctx, sqrt((double)s->x * s->x + (double)s->y * s->y));
+  }
+  point_distances(xs, ys, 0, 0, out, pa->length);
+  return ret;
 }
 
-static JSClassDef js_point_class = {
-    "Point",
-    .finalizer = js_point_finalizer,
+/* translate(dx, dy): in place, returns this */
+static JSValue js_point_array_translate(JSContext *ctx, JSValueConst this_val,
+                                        int argc, JSValueConst *argv) {
+  JSPointArrayData *pa;
+  int32_t *xs, *ys;
+  int32_t dx, dy;
+
+  if (JS_ToInt32(ctx, &dx, argv[0]))
+    return JS_EXCEPTION;
+  if (JS_ToInt32(ctx, &dy, argv[1]))
+    return JS_EXCEPTION;
+  pa = js_point_array_get_data(ctx, this_val, &xs, &ys);
+  if (!pa)
+    return JS_EXCEPTION;
+  point_translate(xs, ys, dx, dy, pa->length);
+  return JS_DupValue(ctx, this_val);
+}
+
+/* scale(sx[, sy]): in place, returns this */
+static JSValue js_point_array_scale(JSContext *ctx, JSValueConst this_val,
+                                    int argc, JSValueConst *argv) {
+  JSPointArrayData *pa;
+  int32_t *xs, *ys;
+  int32_t sx, sy;
+
+  if (JS_ToInt32(ctx, &sx, argv[0]))
+    return JS_EXCEPTION;
+  sy = sx;
+  if (argc > 1 && !JS_IsUndefined(argv[1]) && JS_ToInt32(ctx, &sy, argv[1]))
+    return JS_EXCEPTION;
+  pa = js_point_array_get_data(ctx, this_val, &xs, &ys);
+  if (!pa)
+    return JS_EXCEPTION;
+  point_scale(xs, ys, sx, sy, pa->length);
+  return JS_DupValue(ctx, this_val);
+}
+
+static JSClassDef js_point_array_class = {
+    "PointArray",
+    .finalizer = js_point_array_finalizer,
+    .gc_mark = js_point_array_mark,
 };
 
-static const JSCFunctionListEntry js_point_proto_funcs[] = {
-    JS_CGETSET_MAGIC_DEF("x", js_point_get_xy, js_point_set_xy, 0),
-    JS_CGETSET_MAGIC_DEF("y", js_point_get_xy, js_point_set_xy, 1),
-    JS_CFUNC_DEF("norm", 0, js_point_norm),
+static const JSCFunctionListEntry js_point_array_proto_funcs[] = {
+    JS_CGETSET_DEF("length", js_point_array_get_length, NULL),
+    JS_CGETSET_MAGIC_DEF("x", js_point_array_get_xy, NULL, 0),
+    JS_CGETSET_MAGIC_DEF("y", js_point_array_get_xy, NULL, 1),
+    JS_CFUNC_DEF("norms", 0, js_point_array_norms),
+    JS_CFUNC_DEF("distanceTo", 2, js_point_array_distance_to),
+    JS_CFUNC_DEF("translate", 2, js_point_array_translate),
+    JS_CFUNC_DEF("scale", 1, js_point_array_scale),
 };
 
 static int js_point_init(JSContext *ctx, JSModuleDef *m) {
-  JSValue point_proto, point_class;
+  JSValue point_class;
+  JSValue point_array_proto, point_array_class;
 
   /* create the Point class */
-  JS_NewClassID(&js_point_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_point_class_id, &js_point_class);
+  point_class = js_point_init_class(ctx, js_point_proto_funcs,
+                                    countof(js_point_proto_funcs));
 
-  point_proto = JS_NewObject(ctx);
-  JS_SetPropertyFunctionList(ctx, point_proto, js_point_proto_funcs,
-                             countof(js_point_proto_funcs));
+  JS_SetModuleExport(ctx, m, "Point", point_class);
 
-  point_class =
-      JS_NewCFunction2(ctx, js_point_ctor, "Point", 2, JS_CFUNC_constructor, 0);
-  /* set proto.constructor and ctor.prototype */
-  JS_SetConstructor(ctx, point_class, point_proto);
-  JS_SetClassProto(ctx, js_point_class_id, point_proto);
+  /* create the PointArray class */
+  /* the ID is allocated once, the class once per runtime, like Point */
+  JSRuntime *rt = JS_GetRuntime(ctx);
+  if (!js_point_array_class_id)
+    JS_NewClassID(&js_point_array_class_id);
+  if (!JS_IsRegisteredClass(rt, js_point_array_class_id))
+    JS_NewClass(rt, js_point_array_class_id, &js_point_array_class);
 
-  JS_SetModuleExport(ctx, m, "Point", point_class);
+  point_array_proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, point_array_proto,
+                             js_point_array_proto_funcs,
+                             countof(js_point_array_proto_funcs));
+
+  point_array_class = JS_NewCFunction2(ctx, js_point_array_ctor, "PointArray",
+                                       1, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, point_array_class, point_array_proto);
+  JS_SetClassProto(ctx, js_point_array_class_id, point_array_proto);
+
+  JS_SetModuleExport(ctx, m, "PointArray", point_array_class);
   return 0;
 }
 
@@ -143,5 +422,6 @@ JSModuleDef *js_init_module(JSContext *ctx, const char *module_name) {
   if (!m)
     return NULL;
   JS_AddModuleExport(ctx, m, "Point");
+  JS_AddModuleExport(ctx, m, "PointArray");
   return m;
 }
\ No newline at end of file
@@ -1,5 +1,5 @@
 /* example of JS module importing a C module */
-import { Point } from "./point";
+import { Point, PointArray } from "./point";
 
 function assert(b, str)
 {
@@ -36,6 +36,27 @@ function main()
     assert(pt2.color === 0xffffff);
     assert(pt2.get_color() === 0xffffff);
 
+    var pa = new PointArray(5), d;
+    assert(pa.length === 5);
+    assert(pa.x instanceof Int32Array && pa.x.length === 5);
+    for (var i = 0; i < pa.length; i++) {
+        pa.x[i] = 3 * i;
+        pa.y[i] = 4 * i;
+    }
+    d = pa.norms();
+    assert(d instanceof Float64Array && d.length === 5);
+    assert(d[2] === 10);
+    pa.translate(1, -1);
+    assert(pa.x[0] === 1 && pa.y[0] === -1);
+    pa.scale(2);
+    assert(pa.x[1] === 8 && pa.y[1] === 6);
+    pa.scale(1, -1);
+    assert(pa.y[1] === -6);
+    d = pa.distanceTo(new Point(8, -6));
+    assert(d[1] === 0);
+    pa.distanceTo(2, -2, d);
+    assert(d[0] === 0 && d[1] === 10);
+
     console.log("All point tests passed!");
 }
 
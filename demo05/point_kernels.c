@@ -0,0 +1,201 @@
+/* Bulk kernels for PointArray (structure-of-arrays int32 x[] / y[]) */
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define POINT_KERNELS_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define POINT_KERNELS_NEON 1
+#endif
+
+/* Scalar versions. Integer updates wrap like JS '|0' arithmetic, so they
+   are done on uint32_t to avoid signed overflow. */
+
+static void point_distances_scalar(const int32_t *x, const int32_t *y,
+                                   double px, double py, double *out,
+                                   size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    double dx = (double)x[i] - px;
+    double dy = (double)y[i] - py;
+    out[i] = sqrt(dx * dx + dy * dy);
+  }
+}
+
+static void point_translate_scalar(int32_t *x, int32_t *y, int32_t dx,
+                                   int32_t dy, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    x[i] = (int32_t)((uint32_t)x[i] + (uint32_t)dx);
+    y[i] = (int32_t)((uint32_t)y[i] + (uint32_t)dy);
+  }
+}
+
+static void point_scale_scalar(int32_t *x, int32_t *y, int32_t sx, int32_t sy,
+                               size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    x[i] = (int32_t)((uint32_t)x[i] * (uint32_t)sx);
+    y[i] = (int32_t)((uint32_t)y[i] * (uint32_t)sy);
+  }
+}
+
+#if defined(POINT_KERNELS_X86)
+
+/* AVX2 versions, selected at runtime. No FMA so that the results are
+   bit-identical to Point.prototype.norm(). */
+
+__attribute__((target("avx2"))) static void
+point_distances_avx2(const int32_t *x, const int32_t *y, double px, double py,
+                     double *out, size_t n) {
+  __m256d vpx = _mm256_set1_pd(px);
+  __m256d vpy = _mm256_set1_pd(py);
+  size_t i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    __m256d dx = _mm256_sub_pd(
+        _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(x + i))), vpx);
+    __m256d dy = _mm256_sub_pd(
+        _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(y + i))), vpy);
+    __m256d sum = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+    _mm256_storeu_pd(out + i, _mm256_sqrt_pd(sum));
+  }
+  point_distances_scalar(x + i, y + i, px, py, out + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+point_translate_avx2(int32_t *x, int32_t *y, int32_t dx, int32_t dy,
+                     size_t n) {
+  __m256i vdx = _mm256_set1_epi32(dx);
+  __m256i vdy = _mm256_set1_epi32(dy);
+  size_t i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m256i vx = _mm256_loadu_si256((const __m256i *)(x + i));
+    __m256i vy = _mm256_loadu_si256((const __m256i *)(y + i));
+    _mm256_storeu_si256((__m256i *)(x + i), _mm256_add_epi32(vx, vdx));
+    _mm256_storeu_si256((__m256i *)(y + i), _mm256_add_epi32(vy, vdy));
+  }
+  point_translate_scalar(x + i, y + i, dx, dy, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+point_scale_avx2(int32_t *x, int32_t *y, int32_t sx, int32_t sy, size_t n) {
+  __m256i vsx = _mm256_set1_epi32(sx);
+  __m256i vsy = _mm256_set1_epi32(sy);
+  size_t i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m256i vx = _mm256_loadu_si256((const __m256i *)(x + i));
+    __m256i vy = _mm256_loadu_si256((const __m256i *)(y + i));
+    _mm256_storeu_si256((__m256i *)(x + i), _mm256_mullo_epi32(vx, vsx));
+    _mm256_storeu_si256((__m256i *)(y + i), _mm256_mullo_epi32(vy, vsy));
+  }
+  point_scale_scalar(x + i, y + i, sx, sy, n - i);
+}
+
+static int point_has_avx2(void) {
+  static int has_avx2 = -1;
+  if (has_avx2 < 0) {
+    __builtin_cpu_init();
+    has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+  }
+  return has_avx2;
+}
+
+#elif defined(POINT_KERNELS_NEON)
+
+static void point_distances_neon(const int32_t *x, const int32_t *y, double px,
+                                 double py, double *out, size_t n) {
+  float64x2_t vpx = vdupq_n_f64(px);
+  float64x2_t vpy = vdupq_n_f64(py);
+  size_t i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    int32x4_t vx = vld1q_s32(x + i);
+    int32x4_t vy = vld1q_s32(y + i);
+    float64x2_t dx0 =
+        vsubq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(vx))), vpx);
+    float64x2_t dx1 = vsubq_f64(vcvtq_f64_s64(vmovl_high_s32(vx)), vpx);
+    float64x2_t dy0 =
+        vsubq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(vy))), vpy);
+    float64x2_t dy1 = vsubq_f64(vcvtq_f64_s64(vmovl_high_s32(vy)), vpy);
+    vst1q_f64(out + i, vsqrtq_f64(vaddq_f64(vmulq_f64(dx0, dx0),
+                                            vmulq_f64(dy0, dy0))));
+    vst1q_f64(out + i + 2, vsqrtq_f64(vaddq_f64(vmulq_f64(dx1, dx1),
+                                                vmulq_f64(dy1, dy1))));
+  }
+  point_distances_scalar(x + i, y + i, px, py, out + i, n - i);
+}
+
+static void point_translate_neon(int32_t *x, int32_t *y, int32_t dx,
+                                 int32_t dy, size_t n) {
+  int32x4_t vdx = vdupq_n_s32(dx);
+  int32x4_t vdy = vdupq_n_s32(dy);
+  size_t i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    vst1q_s32(x + i, vaddq_s32(vld1q_s32(x + i), vdx));
+    vst1q_s32(y + i, vaddq_s32(vld1q_s32(y + i), vdy));
+  }
+  point_translate_scalar(x + i, y + i, dx, dy, n - i);
+}
+
+static void point_scale_neon(int32_t *x, int32_t *y, int32_t sx, int32_t sy,
+                             size_t n) {
+  int32x4_t vsx = vdupq_n_s32(sx);
+  int32x4_t vsy = vdupq_n_s32(sy);
+  size_t i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    vst1q_s32(x + i, vmulq_s32(vld1q_s32(x + i), vsx));
+    vst1q_s32(y + i, vmulq_s32(vld1q_s32(y + i), vsy));
+  }
+  point_scale_scalar(x + i, y + i, sx, sy, n - i);
+}
+
+#endif
+
+/* Dispatchers */
+
+static void point_distances(const int32_t *x, const int32_t *y, double px,
+                            double py, double *out, size_t n) {
+#if defined(POINT_KERNELS_X86)
+  if (point_has_avx2()) {
+    point_distances_avx2(x, y, px, py, out, n);
+    return;
+  }
+#elif defined(POINT_KERNELS_NEON)
+  point_distances_neon(x, y, px, py, out, n);
+  return;
+#endif
+  point_distances_scalar(x, y, px, py, out, n);
+}
+
+static void point_translate(int32_t *x, int32_t *y, int32_t dx, int32_t dy,
+                            size_t n) {
+#if defined(POINT_KERNELS_X86)
+  if (point_has_avx2()) {
+    point_translate_avx2(x, y, dx, dy, n);
+    return;
+  }
+#elif defined(POINT_KERNELS_NEON)
+  point_translate_neon(x, y, dx, dy, n);
+  return;
+#endif
+  point_translate_scalar(x, y, dx, dy, n);
+}
+
+static void point_scale(int32_t *x, int32_t *y, int32_t sx, int32_t sy,
+                        size_t n) {
+#if defined(POINT_KERNELS_X86)
+  if (point_has_avx2()) {
+    point_scale_avx2(x, y, sx, sy, n);
+    return;
+  }
+#elif defined(POINT_KERNELS_NEON)
+  point_scale_neon(x, y, sx, sy, n);
+  return;
+#endif
+  point_scale_scalar(x, y, sx, sy, n);
+}
@@ -55,8 +55,6 @@ int main(int argc, char **argv) {
 
   JS_FreeValue(ctx, result);
 
-  JS_RunGC(rt);
-
   JS_FreeContext(ctx);
   JS_FreeRuntime(rt);
 
@@ -47,8 +47,6 @@ int main(int argc, char **argv) {
     }
   }
 
-  JS_RunGC(rt);
-
   JS_FreeContext(ctx);
   JS_FreeRuntime(rt);
   // Cleanup curl
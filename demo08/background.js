@@ -0,0 +1,6 @@
+// 耗时较长的后台批处理任务
+var acc = 0;
+for (var i = 0; i < 300000; i++) {
+  acc = (acc * 31 + i) | 0;
+}
+if (typeof acc !== 'number') throw new Error('unexpected result');
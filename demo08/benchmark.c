@@ -0,0 +1,129 @@
+#include "../helpers/clock.c"
+#include "../helpers/exception.c"
+#include "../quickjs/quickjs.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 结果大小从 64 B 到 16 MB，每档重复到累计传输约 256 MB
+#define MIN_PAYLOAD 64
+#define MAX_PAYLOAD (16 << 20)
+#define BYTES_PER_CASE (256 << 20)
+
+// new Float64Array(buffer)，接管 buffer 的引用
+static JSValue new_float64_array(JSContext *ctx, JSValue buffer) {
+  JSValue global = JS_GetGlobalObject(ctx);
+  JSValue ctor = JS_GetPropertyStr(ctx, global, "Float64Array");
+  JSValue ret = JS_CallConstructor(ctx, ctor, 1, &buffer);
+  JS_FreeValue(ctx, ctor);
+  JS_FreeValue(ctx, global);
+  JS_FreeValue(ctx, buffer);
+  return ret;
+}
+
+// copy 模式：工作线程的结果经 JS_WriteObject -> 复制 -> JS_ReadObject
+// 交给提交方的运行时，与 --io copy 的路径相同。返回每次的微秒数
+static double bench_copy(JSContext *worker, JSContext *submitter,
+                         JSValueConst result, int reps, double *checksum) {
+  double start = get_time_ms();
+  for (int i = 0; i < reps; i++) {
+    size_t len;
+    uint8_t *buf = JS_WriteObject(worker, &len, result, 0);
+    if (!buf) {
+      check_and_print_exception(worker);
+      return -1;
+    }
+    uint8_t *copy = malloc(len);
+    memcpy(copy, buf, len);
+    js_free(worker, buf);
+
+    JSValue val = JS_ReadObject(submitter, copy, len, 0);
+    free(copy);
+    if (JS_IsException(val)) {
+      check_and_print_exception(submitter);
+      return -1;
+    }
+
+    size_t byte_offset, byte_length, size;
+    JSValue ab = JS_GetTypedArrayBuffer(submitter, val, &byte_offset,
+                                        &byte_length, NULL);
+    const double *data =
+        (const double *)(JS_GetArrayBuffer(submitter, &size, ab) +
+                         byte_offset);
+    *checksum += data[byte_length / sizeof(double) - 1];
+    JS_FreeValue(submitter, ab);
+    JS_FreeValue(submitter, val);
+  }
+  return (get_time_ms() - start) * 1000 / reps;
+}
+
+// shared 模式：工作线程把宿主内存包装成 SharedArrayBuffer 并建立视图，
+// 与 --io shared 的路径相同，提交方直接读宿主内存。返回每次的微秒数
+static double bench_shared(JSContext *worker, double *host, size_t size,
+                           int reps, double *checksum) {
+  double start = get_time_ms();
+  for (int i = 0; i < reps; i++) {
+    JSValue view = new_float64_array(
+        worker, JS_NewArrayBuffer(worker, (uint8_t *)host, size, NULL, NULL, 1));
+    if (JS_IsException(view)) {
+      check_and_print_exception(worker);
+      return -1;
+    }
+    JS_FreeValue(worker, view);
+    *checksum += host[size / sizeof(double) - 1];
+  }
+  return (get_time_ms() - start) * 1000 / reps;
+}
+
+int main(int argc, char **argv) {
+  // 两个运行时分别代表工作线程和提交方
+  JSRuntime *worker_rt = JS_NewRuntime();
+  JSContext *worker = JS_NewContext(worker_rt);
+  JSRuntime *submitter_rt = JS_NewRuntime();
+  JSContext *submitter = JS_NewContext(submitter_rt);
+
+  double *host = malloc(MAX_PAYLOAD);
+  for (size_t i = 0; i < MAX_PAYLOAD / sizeof(double); i++) {
+    host[i] = i;
+  }
+
+  printf("%-10s | %-12s | %-12s | %-12s | %-8s\n", "Payload", "Copy (us)",
+         "Copy (MB/s)", "Shared (us)", "Speedup");
+  printf("------------------------------------------------------------------\n");
+
+  double checksum = 0;
+  for (size_t size = MIN_PAYLOAD; size <= MAX_PAYLOAD; size *= 4) {
+    int reps = BYTES_PER_CASE / size;
+    if (reps > 100000)
+      reps = 100000;
+
+    // 结果数组在计时之外构造，只度量传输本身
+    JSValue result = new_float64_array(
+        worker, JS_NewArrayBufferCopy(worker, (uint8_t *)host, size));
+    double copy_us = bench_copy(worker, submitter, result, reps, &checksum);
+    JS_FreeValue(worker, result);
+    double shared_us = bench_shared(worker, host, size, reps, &checksum);
+    if (copy_us < 0 || shared_us < 0)
+      return 1;
+
+    char label[16];
+    if (size >= (1 << 20))
+      snprintf(label, sizeof(label), "%zu MB", size >> 20);
+    else if (size >= (1 << 10))
+      snprintf(label, sizeof(label), "%zu KB", size >> 10);
+    else
+      snprintf(label, sizeof(label), "%zu B", size);
+
+    printf("%-10s | %-12.2f | %-12.0f | %-12.2f | %-7.1fx\n", label, copy_us,
+           size / copy_us, shared_us, copy_us / shared_us);
+  }
+  printf("(checksum %.0f)\n", checksum);
+
+  free(host);
+  JS_FreeContext(submitter);
+  JS_FreeRuntime(submitter_rt);
+  JS_FreeContext(worker);
+  JS_FreeRuntime(worker_rt);
+  return 0;
+}
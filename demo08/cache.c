@@ -1,4 +1,6 @@
+#include "../helpers/compile_cache.c"
 #include "../helpers/file.c"
+#include "../quickjs/quickjs.h"
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -11,6 +13,9 @@ typedef struct {
   const char *filename;
   char *content;
   size_t length;
+  // 编译一次后全进程共享的只读字节码，尚未编译时为 NULL
+  uint8_t *bytecode;
+  size_t bytecode_len;
 } FileCache;
 
 // 全局文件缓存数组
@@ -18,18 +23,30 @@ static FileCache *file_cache = NULL;
 static int cache_size = 0;
 static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// 磁盘编译缓存，为 NULL 时每次都解析源码
+static CompileCache *disk_cache = NULL;
+
+// 查找缓存项，调用方需持有 cache_mutex
+static FileCache *find_cache_entry(const char *filename) {
+  for (int i = 0; i < cache_size; i++) {
+    if (strcmp(file_cache[i].filename, filename) == 0) {
+      return &file_cache[i];
+    }
+  }
+  return NULL;
+}
+
 // 从缓存获取文件内容，如果不存在则读取并缓存
 static char *get_file_content(const char *filename, size_t *length) {
   pthread_mutex_lock(&cache_mutex);
 
   // 查找缓存
-  for (int i = 0; i < cache_size; i++) {
-    if (strcmp(file_cache[i].filename, filename) == 0) {
-      *length = file_cache[i].length;
-      char *content = file_cache[i].content;
-      pthread_mutex_unlock(&cache_mutex);
-      return content;
-    }
+  FileCache *entry = find_cache_entry(filename);
+  if (entry) {
+    *length = entry->length;
+    char *content = entry->content;
+    pthread_mutex_unlock(&cache_mutex);
+    return content;
   }
 
   // 缓存中不存在，读取文件
@@ -42,6 +59,8 @@ static char *get_file_content(const char *filename, size_t *length) {
       file_cache[cache_size].filename = strdup(filename);
       file_cache[cache_size].content = content;
       file_cache[cache_size].length = strlen(content);
+      file_cache[cache_size].bytecode = NULL;
+      file_cache[cache_size].bytecode_len = 0;
       *length = file_cache[cache_size].length;
       cache_size++;
     }
@@ -51,6 +70,105 @@ static char *get_file_content(const char *filename, size_t *length) {
   return content;
 }
 
+// 在临时运行时中把源码编译为字节码，结果复制到 malloc 的缓冲区，
+// 不依赖编译用的运行时，可被任意线程的运行时读取
+static uint8_t *compile_file_bytecode(const char *filename, const char *content,
+                                      size_t length, size_t *out_len) {
+  JSRuntime *rt = JS_NewRuntime();
+  JSContext *ctx = rt ? JS_NewContext(rt) : NULL;
+  uint8_t *out = NULL;
+  if (!ctx) {
+    fprintf(stderr, "Failed to create runtime to compile %s\n", filename);
+    if (rt)
+      JS_FreeRuntime(rt);
+    return NULL;
+  }
+
+  JSValue obj = compile_cache_compile(ctx, disk_cache, content, length,
+                                      filename, JS_EVAL_TYPE_GLOBAL);
+  if (JS_IsException(obj)) {
+    check_and_print_exception(ctx);
+  } else {
+    size_t len;
+    uint8_t *buf = JS_WriteObject(ctx, &len, obj, JS_WRITE_OBJ_BYTECODE);
+    if (buf) {
+      out = malloc(len);
+      if (out) {
+        memcpy(out, buf, len);
+        *out_len = len;
+      }
+      js_free(ctx, buf);
+    } else {
+      check_and_print_exception(ctx);
+    }
+    JS_FreeValue(ctx, obj);
+  }
+
+  JS_FreeContext(ctx);
+  JS_FreeRuntime(rt);
+  return out;
+}
+
+// 获取文件的共享字节码，第一次访问时编译，之后所有线程复用同一份缓冲区。
+// 编译在锁外进行，不阻塞其他文件的查找；同时编译同一文件的线程中
+// 先完成的写入缓存，其余的丢弃自己的结果
+static const uint8_t *get_file_bytecode(const char *filename, size_t *length) {
+  size_t content_length;
+  char *content = get_file_content(filename, &content_length);
+  if (!content)
+    return NULL;
+
+  // 缓存项只在 cleanup_file_cache 中释放，content 在锁外仍然有效；
+  // file_cache 数组可能被 realloc，所以不保留 entry 指针
+  pthread_mutex_lock(&cache_mutex);
+  FileCache *entry = find_cache_entry(filename);
+  uint8_t *bytecode = entry ? entry->bytecode : NULL;
+  if (bytecode)
+    *length = entry->bytecode_len;
+  pthread_mutex_unlock(&cache_mutex);
+  if (bytecode || !entry)
+    return bytecode;
+
+  size_t compiled_len = 0;
+  uint8_t *compiled =
+      compile_file_bytecode(filename, content, content_length, &compiled_len);
+  if (!compiled)
+    return NULL;
+
+  pthread_mutex_lock(&cache_mutex);
+  entry = find_cache_entry(filename);
+  if (entry->bytecode) {
+    free(compiled);
+  } else {
+    entry->bytecode = compiled;
+    entry->bytecode_len = compiled_len;
+  }
+  bytecode = entry->bytecode;
+  *length = entry->bytecode_len;
+  pthread_mutex_unlock(&cache_mutex);
+  return bytecode;
+}
+
+// 把文件读入 ctx 成为可执行的函数，不执行。shared_bytecode 为 1 时读取
+// 全进程共享的字节码，否则解析源码（有磁盘编译缓存时先查缓存）。
+// 失败时返回 JS_EXCEPTION，ctx 中有待处理的异常
+static JSValue load_file_function(JSContext *ctx, const char *filename,
+                                  int shared_bytecode) {
+  size_t length = 0;
+  if (shared_bytecode) {
+    const uint8_t *bytecode = get_file_bytecode(filename, &length);
+    if (!bytecode)
+      return JS_ThrowReferenceError(ctx, "could not compile '%s'", filename);
+    return JS_ReadObject(ctx, bytecode, length, JS_READ_OBJ_BYTECODE);
+  }
+
+  char *content = get_file_content(filename, &length);
+  if (!content)
+    return JS_ThrowReferenceError(ctx, "could not read '%s'", filename);
+  return compile_cache_compile(ctx, disk_cache, content, length, filename,
+                               JS_EVAL_TYPE_GLOBAL);
+}
+
 // 清理文件缓存
 static void cleanup_file_cache() {
   pthread_mutex_lock(&cache_mutex);
@@ -58,6 +176,7 @@ static void cleanup_file_cache() {
   for (int i = 0; i < cache_size; i++) {
     free((void *)file_cache[i].filename);
     free(file_cache[i].content);
+    free(file_cache[i].bytecode);
   }
 
   free(file_cache);
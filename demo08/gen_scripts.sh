@@ -0,0 +1,29 @@
+#!/bin/sh
+# 生成 count 个互不相同的测试脚本，用于内存基准
+# 用法: ./gen_scripts.sh <dir> <count>
+dir=$1
+count=$2
+functions=50
+
+mkdir -p "$dir"
+i=0
+while [ "$i" -lt "$count" ]; do
+  {
+    j=0
+    while [ "$j" -lt "$functions" ]; do
+      printf 'function f%d_%d(a, b) {\n' "$i" "$j"
+      printf '  var s = "script %d function %d";\n' "$i" "$j"
+      printf '  for (var k = 0; k < 10; k++) a = (a * 31 + b + s.length) | 0;\n'
+      printf '  return a;\n}\n'
+      j=$((j + 1))
+    done
+    printf 'var acc = 0;\n'
+    j=0
+    while [ "$j" -lt "$functions" ]; do
+      printf 'acc = f%d_%d(acc, %d);\n' "$i" "$j" "$j"
+      j=$((j + 1))
+    done
+    printf 'if (typeof acc !== "number") throw new Error("unexpected result");\n'
+  } > "$dir/script_$i.js"
+  i=$((i + 1))
+done
@@ -0,0 +1,6 @@
+// 对延迟敏感的小请求
+var total = 0;
+for (var i = 0; i < 1000; i++) {
+  total += i;
+}
+if (total !== 499500) throw new Error('unexpected total');
@@ -1,274 +1,443 @@
+// pthread_setaffinity_np / CPU_SET 需要
+#define _GNU_SOURCE
 #include "../helpers/console.c"
+#include "../helpers/crypto.c"
+#include "../helpers/encoding.c"
 #include "../helpers/exception.c"
+#include "../helpers/fs.c"
+#include "../helpers/gc.c"
+#include "../helpers/memory.c"
+#include "../helpers/metrics.c"
+#include "../helpers/profiler.c"
+#include "../helpers/trace.c"
 #include "../quickjs/quickjs.h"
 #include "./cache.c"
+#include "./queue.c"
+#include "./shared.c"
+#include "./taskio.c"
+#include "./topology.c"
+#include "./warmup.c"
+#include <errno.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 
-// 任务结构体
-typedef struct {
-  const char *filename;
-  int iterations;
-  double execution_time;
-  int task_id;
-} Task;
+// 每次入队/出队的最大任务数
+#define TASK_BATCH_MAX 64
+#define TASK_BATCH_DEFAULT 32
 
-// 任务队列节点
-typedef struct TaskNode {
-  Task task;
-  struct TaskNode *next;
-} TaskNode;
+// 为 1 时执行全进程共享的预编译字节码，而不是每次解析源码
+static int shared_bytecode_mode = 0;
 
-// 任务队列
+// --profile 时对所有工作线程的运行时采样，为 NULL 时不采样
+static Profiler *profiler = NULL;
+
+// 线程池的指标 id，创建线程池之前登记
 typedef struct {
-  TaskNode *head;
-  TaskNode *tail;
-  int size;
-  pthread_mutex_t mutex;
-  pthread_cond_t not_empty;
-} TaskQueue;
+  int tasks[TASK_STATUS_COUNT];
+  int service;
+  int latency;
+  int gc_pause;
+  int workers;
+  int live_bytes;
+  MetricsHeap heap;
+} PoolMetrics;
+
+static PoolMetrics pool_metrics;
+// 导出指标时工作线程空闲时顺带采集 JS 堆统计
+static int metrics_exporting = 0;
 
 typedef struct {
   int task_id;
   double execution_time;
+  double gc_time;
+  double latency_ms; // 从入队到执行完成的时间
+  double service_ms; // 执行任务本身的时间（墙钟），不含排队
+  int status;        // TASK_STATUS_*，非 OK 表示任务未执行
 } TaskExecutionTime;
 
+typedef struct ThreadData ThreadData;
+
 // 线程池
 typedef struct {
   pthread_t *threads;
   int thread_count;
-  TaskQueue queue;
+  // 绑核时每个 NUMA 节点一个队列，否则只有一个共享队列
+  TaskQueue *queues;
+  int queue_count;
+  int pin_threads;
+  Topology topology;
   int shutdown;
   pthread_mutex_t shutdown_mutex;
-  int completed_tasks;
+  int batch_size; // 工作线程每次最多取出的任务数
+  // 完成计数用原子操作累加，只有最后完成的线程才需要加锁通知主线程
+  atomic_int completed_tasks;
+  int total_tasks;
   pthread_mutex_t completed_mutex;
   pthread_cond_t all_completed;
+  // 完成启动预热的工作线程数，由 completed_mutex 保护
+  int warmed_workers;
+  pthread_cond_t warmed_up;
 
   TaskExecutionTime *task_execution_times;
+  ThreadData *thread_data;
 } ThreadPool;
 
 // 线程数据
-typedef struct {
+struct ThreadData {
   ThreadPool *pool;
   int thread_id;
   JSRuntime *runtime;
-} ThreadData;
-
-// 初始化任务队列
-void init_task_queue(TaskQueue *queue) {
-  queue->head = NULL;
-  queue->tail = NULL;
-  queue->size = 0;
-  pthread_mutex_init(&queue->mutex, NULL);
-  pthread_cond_init(&queue->not_empty, NULL);
-}
-
-// 添加任务到队列
-void enqueue_task(TaskQueue *queue, Task task) {
-  TaskNode *node = (TaskNode *)malloc(sizeof(TaskNode));
-  node->task = task;
-  node->next = NULL;
-
-  pthread_mutex_lock(&queue->mutex);
-
-  if (queue->tail == NULL) {
-    queue->head = node;
-    queue->tail = node;
-  } else {
-    queue->tail->next = node;
-    queue->tail = node;
-  }
-
-  queue->size++;
-  pthread_cond_signal(&queue->not_empty);
-  pthread_mutex_unlock(&queue->mutex);
-}
-
-// 从队列中获取任务
-int dequeue_task(TaskQueue *queue, Task *task, int *shutdown_flag) {
-  pthread_mutex_lock(&queue->mutex);
-
-  // 当队列为空且没有关闭信号时等待
-  // while (queue->size == 0 && !(*shutdown_flag)) {
-  //   pthread_cond_wait(&queue->not_empty, &queue->mutex);
-  // }
-
-  // 如果收到关闭信号且队列为空，返回0表示没有任务
-  if (queue->size == 0 || *shutdown_flag) {
-    pthread_mutex_unlock(&queue->mutex);
-    return 0;
-  }
-
-  if (queue->head == NULL) {
-    pthread_mutex_unlock(&queue->mutex);
-    return 0;
-  }
-
-  TaskNode *node = queue->head;
-  *task = node->task;
-
-  queue->head = node->next;
-  if (queue->head == NULL) {
-    queue->tail = NULL;
-  }
-
-  queue->size--;
-  pthread_mutex_unlock(&queue->mutex);
-
-  free(node);
-  return 1;
-}
-
-// 销毁任务队列
-void destroy_task_queue(TaskQueue *queue) {
-  pthread_mutex_lock(&queue->mutex);
-
-  TaskNode *current = queue->head;
-  while (current != NULL) {
-    TaskNode *next = current->next;
-    free(current);
-    current = next;
+  GCPolicy gc;
+  int node; // 所属节点在 topology.nodes 中的下标，也是本地队列的下标
+  int cpu;  // 绑定的 CPU，未绑核时为 -1
+  int tasks_run;
+  int tasks_stolen; // 从其他节点队列窃取的任务数
+  double sync_ms; // 花在出队和完成通知上的时间，不含等待任务的时间
+  WarmPool warm;
+  ProfilerThread profile;
+  MetricsHeap heap_metrics; // pool_metrics.heap 的本线程副本
+};
+
+// 执行已读入 ctx 的脚本函数，接管 func 的引用。
+// result 不为 NULL 时保存脚本最后一条语句的值，由调用方释放
+static int run_function(JSContext *ctx, JSValue func, JSValue *result) {
+  uint64_t trace_start = trace_begin();
+  JSValue val = JS_EvalFunction(ctx, func);
+  trace_end("js", "eval", trace_start);
+  if (JS_IsException(val)) {
+    check_and_print_exception(ctx);
+    return 1;
   }
-
-  queue->head = NULL;
-  queue->tail = NULL;
-  queue->size = 0;
-
-  pthread_mutex_unlock(&queue->mutex);
-  pthread_mutex_destroy(&queue->mutex);
-  pthread_cond_destroy(&queue->not_empty);
+  if (result)
+    *result = val;
+  else
+    JS_FreeValue(ctx, val);
+  return 0;
 }
 
 // Function to evaluate a JS file with QuickJS
-static int eval_file(JSContext *ctx, const char *filename) {
-  size_t length = 0;
-  char *js_code = get_file_content(filename, &length);
-
-  if (!js_code) {
-    fprintf(stderr, "Failed to read file: %s\n", filename);
-    return -1;
-  }
-
-  // Evaluate JS code
-  JSValue val =
-      JS_Eval(ctx, js_code, strlen(js_code), filename, JS_EVAL_TYPE_GLOBAL);
-
-  if (JS_IsException(val)) {
+// 共享字节码模式下 JS_ReadObject 在当前运行时中重建函数对象（原子需要
+// 映射到本运行时的原子表），源码解析和编译在整个进程中只做一次
+static int eval_file(JSContext *ctx, const char *filename, JSValue *result) {
+  uint64_t trace_start = trace_begin();
+  JSValue func = load_file_function(ctx, filename, shared_bytecode_mode);
+  trace_end_id("js", "compile", trace_start, TRACE_NO_ID, filename);
+  if (JS_IsException(func)) {
     check_and_print_exception(ctx);
-    return 1;
+    fprintf(stderr, "Failed to load file: %s\n", filename);
+    return -1;
   }
-  JS_FreeValue(ctx, val);
-  return 0;
+  return run_function(ctx, func, result);
 }
 
 // 执行任务
-void execute_task(JSRuntime *runtime, Task *task) {
+void execute_task(JSRuntime *runtime, GCPolicy *gc, WarmPool *warm,
+                  Task *task) {
   clock_t start, end;
   start = clock();
-
-  // 为任务创建新的 JSContext
-  JSContext *ctx = JS_NewContext(runtime);
+  warm_script_hit(task->filename);
+
+  // 优先使用预热好的就绪上下文，否则为任务创建新的 JSContext
+  WarmContext ready;
+  uint64_t trace_start = trace_begin();
+  int is_warm = warm_pool_take(warm, task->filename, &ready);
+  JSContext *ctx = is_warm ? ready.ctx : task_new_context(runtime);
+  trace_end("task", is_warm ? "context (warm)" : "context", trace_start);
   if (!ctx) {
     fprintf(stderr, "Failed to create JS context for task %d\n", task->task_id);
     return;
   }
 
-  js_std_init_console(ctx);
+  // 输入输出通道不完整时不执行脚本，也不产生结果
+  int io_ready = task_setup_io(ctx, task) == 0;
+  if (!io_ready) {
+    check_and_print_exception(ctx);
+    fprintf(stderr, "Failed to set up I/O of task %d\n", task->task_id);
+  }
 
-  // 执行指定次数的迭代
-  for (int i = 0; i < task->iterations; i++) {
-    if (eval_file(ctx, task->filename) < 0) {
+  // 执行指定次数的迭代，需要结果时保留最后一次的结果值
+  JSValue result = JS_UNDEFINED;
+  for (int i = 0; io_ready && i < task->iterations; i++) {
+    JS_FreeValue(ctx, result);
+    result = JS_UNDEFINED;
+    JSValue *out = task->result ? &result : NULL;
+    // 就绪上下文中的函数可以反复执行，每次创建新的闭包
+    int ret = is_warm ? run_function(ctx, JS_DupValue(ctx, ready.func), out)
+                      : eval_file(ctx, task->filename, out);
+    if (ret < 0) {
       fprintf(stderr, "Error executing %s in task %d\n", task->filename,
               task->task_id);
       break;
     }
   }
 
-  // 清理 JSContext
-  JS_FreeContext(ctx);
-  JS_RunGC(JS_GetRuntime(ctx));
+  if (io_ready && task->result &&
+      task_capture_result(ctx, task->result, result) < 0) {
+    check_and_print_exception(ctx);
+    fprintf(stderr, "Failed to serialize result of task %d\n", task->task_id);
+  }
+  JS_FreeValue(ctx, result);
+
+  // 清理 JSContext，是否回收由 GC 策略决定
+  if (is_warm)
+    warm_context_free(&ready);
+  else
+    JS_FreeContext(ctx);
+  trace_start = trace_begin();
+  task->gc_time = gc_policy_maybe_collect(gc, runtime);
+  if (task->gc_time > 0)
+    trace_end("gc", "gc", trace_start);
 
   end = clock();
   task->execution_time = ((double)(end - start)) / CLOCKS_PER_SEC;
 }
 
+// 任一队列中是否有比 priority 更高优先级的任务
+static int pool_has_higher_priority(ThreadPool *pool, int priority) {
+  if (priority == TASK_PRIORITY_HIGH)
+    return 0;
+  for (int i = 0; i < pool->queue_count; i++) {
+    if (task_queue_has_higher_priority(&pool->queues[i], priority))
+      return 1;
+  }
+  return 0;
+}
+
+// 获取下一批任务：先非阻塞地检查本节点队列，再按距离从近到远
+// 窃取其他节点的任务，都没有时在本节点队列上等待
+// *queue_index 为取到任务的队列，抢占时放回同一个队列
+static int worker_take_tasks(ThreadPool *pool, ThreadData *thread_data,
+                             Task *batch, int *queue_index) {
+  int share = pool->thread_count / pool->queue_count;
+  if (share < 1)
+    share = 1;
+
+  if (pool->queue_count > 1) {
+    const NumaNode *node = &pool->topology.nodes[thread_data->node];
+    for (int k = 0; k < pool->queue_count; k++) {
+      int index = k == 0 ? thread_data->node : node->steal_order[k - 1];
+      int got = dequeue_batch(&pool->queues[index], batch, pool->batch_size,
+                              share, &pool->shutdown, 0,
+                              &thread_data->sync_ms);
+      if (got != 0) {
+        if (got > 0 && k > 0)
+          thread_data->tasks_stolen += got;
+        *queue_index = index;
+        return got;
+      }
+    }
+  }
+
+  *queue_index = thread_data->node;
+  return dequeue_batch(&pool->queues[thread_data->node], batch,
+                       pool->batch_size, share, &pool->shutdown,
+                       thread_data->gc.idle_ms, &thread_data->sync_ms);
+}
+
+// 记录队列判定不执行的任务（过期、卸载等）
+static void pool_record_skipped(ThreadPool *pool, const Task *task) {
+  TaskExecutionTime *slot = &pool->task_execution_times[task->task_id - 1];
+  slot->task_id = task->task_id;
+  slot->status = task->status;
+  metrics_inc(pool_metrics.tasks[task->status]);
+}
+
+// 启动预热结束（或线程启动失败）时通知主线程
+static void pool_mark_warmed(ThreadPool *pool) {
+  pthread_mutex_lock(&pool->completed_mutex);
+  pool->warmed_workers++;
+  pthread_cond_signal(&pool->warmed_up);
+  pthread_mutex_unlock(&pool->completed_mutex);
+}
+
 // 线程工作函数
 void *worker_thread(void *arg) {
   ThreadData *thread_data = (ThreadData *)arg;
   ThreadPool *pool = thread_data->pool;
   int thread_id = thread_data->thread_id;
 
-  // 每个线程创建自己的 JSRuntime
-  JSRuntime *runtime = JS_NewRuntime();
+  // 先绑核并设置内存策略，再创建 JSRuntime，使运行时的堆落在本地节点上
+  if (thread_data->cpu >= 0) {
+    static atomic_int warned = 0;
+    int node_id = pool->topology.nodes[thread_data->node].id;
+    if ((topology_pin_thread(thread_data->cpu) < 0 ||
+         topology_bind_memory(node_id) < 0) &&
+        atomic_exchange(&warned, 1) == 0) {
+      fprintf(stderr, "Warning: CPU pinning or NUMA memory policy is not "
+                      "supported here, placement is best effort\n");
+    }
+  }
+
+  // 每个线程创建自己的 JSRuntime，GC 时机交给线程自己的策略
+  gc_policy_init(&thread_data->gc);
+  JSRuntime *runtime = gc_policy_new_runtime(&thread_data->gc);
   if (!runtime) {
     fprintf(stderr, "Failed to create JS runtime for thread %d\n", thread_id);
+    pool_mark_warmed(pool);
     return NULL;
   }
 
   thread_data->runtime = runtime;
+  // 工作线程允许在 Atomics.wait 上阻塞
+  JS_SetCanBlock(runtime, 1);
+
+  if (profiler && profiler_attach(profiler, &thread_data->profile, runtime) < 0)
+    fprintf(stderr, "Failed to start profiling thread %d\n", thread_id);
+
+  metrics_thread_attach();
+  metrics_gauge_add(pool_metrics.workers, 1);
+  thread_data->heap_metrics = pool_metrics.heap;
+  char trace_name[32];
+  snprintf(trace_name, sizeof(trace_name), "worker %d", thread_id);
+  trace_thread_attach(trace_name);
+
+  if (thread_data->cpu >= 0) {
+    printf("Thread %d started with its own JSRuntime (cpu %d, node %d)\n",
+           thread_id, thread_data->cpu,
+           pool->topology.nodes[thread_data->node].id);
+  } else {
+    printf("Thread %d started with its own JSRuntime\n", thread_id);
+  }
 
-  printf("Thread %d started with its own JSRuntime\n", thread_id);
+  // 在接收任务之前为清单中的脚本准备就绪上下文
+  warm_pool_init(&thread_data->warm, runtime, shared_bytecode_mode);
+  warm_pool_fill(&thread_data->warm, 0);
+  pool_mark_warmed(pool);
 
   // 循环处理任务
+  Task batch[TASK_BATCH_MAX];
   while (1) {
-    // 检查是否需要关闭线程
-    pthread_mutex_lock(&pool->shutdown_mutex);
-    int shutdown = pool->shutdown;
-    pthread_mutex_unlock(&pool->shutdown_mutex);
-
-    // 获取任务
-    Task task;
-    int got_task = dequeue_task(&pool->queue, &task, &shutdown);
-    // 如果没有任务且收到关闭信号，退出循环
-    if (!got_task && shutdown) {
+    // 批量获取任务，空闲超过 idle_ms 时返回 0
+    uint64_t trace_start = trace_begin();
+    int queue_index;
+    int got = worker_take_tasks(pool, thread_data, batch, &queue_index);
+    if (got > 0)
+      trace_end_id("pool", "dequeue", trace_start, got, NULL);
+    // 收到关闭信号，退出循环
+    if (got < 0) {
       break;
     }
 
-    if (got_task) {
-      // printf("Thread %d executing task %d: %s (%d iterations)\n", thread_id,
-      //        task.task_id, task.filename, task.iterations);
+    if (got == 0) {
+      // 线程空闲，先补足被取走的就绪上下文，再机会性地执行 GC
+      // 回收预执行和上一批任务留下的垃圾
+      int prepared = thread_data->warm.prepared;
+      trace_start = trace_begin();
+      warm_pool_fill(&thread_data->warm, WARM_IDLE_BUDGET_MS);
+      if (thread_data->warm.prepared != prepared)
+        trace_end_id("pool", "warm up", trace_start,
+                     thread_data->warm.prepared - prepared, NULL);
+      trace_start = trace_begin();
+      double pause = gc_policy_idle(&thread_data->gc, runtime);
+      if (pause > 0) {
+        trace_end_id("gc", "gc", trace_start, TRACE_NO_ID, "idle");
+        metrics_observe(pool_metrics.gc_pause, pause / 1000);
+      }
+      metrics_gauge_set(pool_metrics.live_bytes,
+                        thread_data->gc.alloc.live_bytes);
+      if (metrics_exporting)
+        metrics_heap_record(&thread_data->heap_metrics, runtime, 0);
+      continue;
+    }
 
-      // 执行任务
-      execute_task(runtime, &task);
+    int done = 0;
+    for (; done < got; done++) {
+      Task *task = &batch[done];
+
+      // 出现更高优先级的任务时，把本批中还没开始的任务放回取出它们的队列。
+      // 已判定过期或卸载的任务已经计数，直接记录完成，不再放回
+      if (done > 0 && pool_has_higher_priority(pool, task->priority)) {
+        int kept = done;
+        for (int j = done; j < got; j++) {
+          if (batch[j].status != TASK_STATUS_OK)
+            pool_record_skipped(pool, &batch[j]);
+          else
+            batch[kept++] = batch[j];
+        }
+        requeue_batch(&pool->queues[queue_index], &batch[done], kept - done);
+        done += got - kept;
+        break;
+      }
 
-      // printf("Thread %d completed task %d in %.6f seconds\n", thread_id,
-      //        task.task_id, task.execution_time);
+      // 每个任务的结果槽位互不重叠，写入无需加锁
+      TaskExecutionTime *slot = &pool->task_execution_times[task->task_id - 1];
+      slot->task_id = task->task_id;
 
-      // 将任务结果存储到主线程的任务数组中
-      pthread_mutex_lock(&pool->completed_mutex);
-      pool->task_execution_times[task.task_id - 1].task_id = task.task_id;
-      pool->task_execution_times[task.task_id - 1].execution_time =
-          task.execution_time;
-      pool->completed_tasks++;
-      // 打印任务结果
-      // printf("%-20s | %-15d | %-15.6f\n", task.filename, task.iterations,
-      //        task.execution_time);
-      pthread_mutex_unlock(&pool->completed_mutex);
-    } else {
-      printf("Thread %d got none task, completed %d tasks\n", thread_id,
-             pool->completed_tasks);
-      // 如果没有新任务了，发出信号
+      // 出队时只检查了那一刻，排在本批中较慢的任务之后可能已经过期
+      if (task->status == TASK_STATUS_OK && task->deadline_at > 0 &&
+          task->deadline_at < get_time_ms()) {
+        task->status = TASK_STATUS_EXPIRED;
+        task_queue_note_expired(&pool->queues[queue_index]);
+      }
+
+      // 错过截止时间或排队过久的任务直接丢弃
+      if (task->status != TASK_STATUS_OK) {
+        pool_record_skipped(pool, task);
+        continue;
+      }
+
+      // 执行任务
+      double service_start = get_time_ms();
+      trace_async("queue", "queue wait", trace_ms_to_ns(task->enqueue_ms),
+                  trace_ms_to_ns(service_start), task->task_id,
+                  task->filename);
+      trace_start = trace_begin();
+      execute_task(runtime, &thread_data->gc, &thread_data->warm, task);
+      trace_end_id("task", "task", trace_start, task->task_id,
+                   task->filename);
+
+      slot->service_ms = get_time_ms() - service_start;
+      slot->execution_time = task->execution_time;
+      slot->gc_time = task->gc_time;
+      slot->latency_ms = get_time_ms() - task->enqueue_ms;
+
+      metrics_inc(pool_metrics.tasks[TASK_STATUS_OK]);
+      metrics_observe(pool_metrics.service, slot->service_ms / 1000);
+      metrics_observe(pool_metrics.latency, slot->latency_ms / 1000);
+      if (slot->gc_time > 0)
+        metrics_observe(pool_metrics.gc_pause, slot->gc_time / 1000);
+    }
+    metrics_gauge_set(pool_metrics.live_bytes,
+                      thread_data->gc.alloc.live_bytes);
+    thread_data->tasks_run += done;
+
+    // 整批完成后累加一次完成计数，所有任务完成时通知主线程
+    double sync_start = get_time_ms();
+    if (atomic_fetch_add(&pool->completed_tasks, done) + done ==
+        pool->total_tasks) {
       pthread_mutex_lock(&pool->completed_mutex);
       pthread_cond_signal(&pool->all_completed);
       pthread_mutex_unlock(&pool->completed_mutex);
-
-      break;
     }
+    thread_data->sync_ms += get_time_ms() - sync_start;
   }
 
   // 清理 JSRuntime
+  profiler_detach(&thread_data->profile);
+  warm_pool_free(&thread_data->warm);
   JS_FreeRuntime(runtime);
-  printf("Thread %d shutting down\n", thread_id);
+  metrics_heap_clear(&thread_data->heap_metrics);
+  metrics_gauge_set(pool_metrics.live_bytes, 0);
+  metrics_gauge_add(pool_metrics.workers, -1);
+  metrics_thread_detach();
+  trace_thread_detach();
+  printf("Thread %d shutting down, %d GCs (%d idle), pause total %.3f ms, "
+         "max %.3f ms\n",
+         thread_id, thread_data->gc.gc_count, thread_data->gc.idle_gc_count,
+         thread_data->gc.gc_total_ms, thread_data->gc.gc_max_ms);
 
   return NULL;
 }
 
 // 初始化线程池
-ThreadPool *init_thread_pool(int thread_count, int task_count) {
+ThreadPool *init_thread_pool(int thread_count, int task_count,
+                             int batch_size, int pin_threads,
+                             const TaskQueueConfig *queue_config) {
   ThreadPool *pool = (ThreadPool *)malloc(sizeof(ThreadPool));
   if (!pool) {
     fprintf(stderr, "Failed to allocate memory for thread pool\n");
@@ -278,25 +447,45 @@ ThreadPool *init_thread_pool(int thread_count, int task_count) {
   pool->thread_count = thread_count;
   pool->threads = (pthread_t *)malloc(thread_count * sizeof(pthread_t));
   pool->shutdown = 0;
-  pool->completed_tasks = 0;
+  pool->batch_size = batch_size;
+  atomic_init(&pool->completed_tasks, 0);
+  pool->total_tasks = task_count;
   pool->task_execution_times =
       (TaskExecutionTime *)calloc(task_count, sizeof(TaskExecutionTime));
+  pool->thread_data = NULL;
 
   pthread_mutex_init(&pool->shutdown_mutex, NULL);
   pthread_mutex_init(&pool->completed_mutex, NULL);
   pthread_cond_init(&pool->all_completed, NULL);
-
-  init_task_queue(&pool->queue);
+  pool->warmed_workers = 0;
+  pthread_cond_init(&pool->warmed_up, NULL);
+
+  // 绑核时按 NUMA 节点拆分队列
+  topology_init(&pool->topology);
+  pool->pin_threads = pin_threads;
+  pool->queue_count = pin_threads ? pool->topology.node_count : 1;
+  pool->queues = (TaskQueue *)malloc(pool->queue_count * sizeof(TaskQueue));
+  for (int i = 0; i < pool->queue_count; i++) {
+    init_task_queue(&pool->queues[i], queue_config);
+  }
 
   // 创建线程数据
   ThreadData *thread_data =
       (ThreadData *)malloc(thread_count * sizeof(ThreadData));
+  pool->thread_data = thread_data;
 
   // 创建工作线程
   for (int i = 0; i < thread_count; i++) {
     thread_data[i].pool = pool;
     thread_data[i].thread_id = i;
     thread_data[i].runtime = NULL;
+    thread_data[i].node =
+        pin_threads ? topology_worker_node(&pool->topology, i) : 0;
+    thread_data[i].cpu =
+        pin_threads ? topology_worker_cpu(&pool->topology, i) : -1;
+    thread_data[i].tasks_run = 0;
+    thread_data[i].tasks_stolen = 0;
+    thread_data[i].sync_ms = 0;
 
     if (pthread_create(&pool->threads[i], NULL, worker_thread,
                        &thread_data[i]) != 0) {
@@ -328,30 +517,386 @@ void shutdown_thread_pool(ThreadPool *pool) {
   pthread_mutex_unlock(&pool->shutdown_mutex);
 
   // 唤醒所有等待任务的线程
-  pthread_mutex_lock(&pool->queue.mutex);
-  pthread_cond_broadcast(&pool->queue.not_empty);
-  pthread_mutex_unlock(&pool->queue.mutex);
+  for (int i = 0; i < pool->queue_count; i++) {
+    pthread_mutex_lock(&pool->queues[i].mutex);
+    pthread_cond_broadcast(&pool->queues[i].not_empty);
+    pthread_mutex_unlock(&pool->queues[i].mutex);
+  }
 
   // 等待所有线程结束
   for (int i = 0; i < pool->thread_count; i++) {
     pthread_join(pool->threads[i], NULL);
   }
 
+  // 线程已退出，可以安全读取各线程的分配统计
+  size_t heap_peak_total = 0;
+  size_t heap_peak_max = 0;
+  double sync_total_ms = 0;
+  int tasks_run = 0;
+  int tasks_stolen = 0;
+  int warm_hits = 0, warm_misses = 0, warm_prepared = 0;
+  double warm_prepare_ms = 0;
+  for (int i = 0; i < pool->thread_count; i++) {
+    tasks_stolen += pool->thread_data[i].tasks_stolen;
+    warm_hits += pool->thread_data[i].warm.hits;
+    warm_misses += pool->thread_data[i].warm.misses;
+    warm_prepared += pool->thread_data[i].warm.prepared;
+    warm_prepare_ms += pool->thread_data[i].warm.prepare_ms;
+    sync_total_ms += pool->thread_data[i].sync_ms;
+    tasks_run += pool->thread_data[i].tasks_run;
+
+    size_t peak = pool->thread_data[i].gc.alloc.peak_live_bytes;
+    heap_peak_total += peak;
+    if (peak > heap_peak_max)
+      heap_peak_max = peak;
+  }
+  printf("JS heap peak per worker: avg %.1f KB, max %.1f KB\n",
+         heap_peak_total / 1024.0 / pool->thread_count, heap_peak_max / 1024.0);
+  if (tasks_run > 0) {
+    printf("Dequeue + completion overhead: %.1f ns per task (batch size %d)\n",
+           sync_total_ms * 1e6 / tasks_run, pool->batch_size);
+  }
+  if (pool->queue_count > 1) {
+    printf("Tasks stolen from other NUMA nodes: %d of %d\n", tasks_stolen,
+           tasks_run);
+  }
+  if (warm_enabled) {
+    printf("Warm pool: %d of %d tasks ran in a prepared context, %d contexts "
+           "prepared off the request path in %.1f ms\n",
+           warm_hits, warm_hits + warm_misses, warm_prepared,
+           warm_prepare_ms);
+  }
+
   // 清理资源
-  destroy_task_queue(&pool->queue);
+  for (int i = 0; i < pool->queue_count; i++) {
+    destroy_task_queue(&pool->queues[i]);
+  }
+  free(pool->queues);
+  topology_free(&pool->topology);
   pthread_mutex_destroy(&pool->shutdown_mutex);
   pthread_mutex_destroy(&pool->completed_mutex);
   pthread_cond_destroy(&pool->all_completed);
+  pthread_cond_destroy(&pool->warmed_up);
 
   free(pool->task_execution_times);
+  free(pool->thread_data);
   free(pool->threads);
   free(pool);
 }
 
+static void print_usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [--threads N] [--batch N] [--pin] [--shared-bytecode] "
+          "[--weights H,N,L] [--rate R] [--capacity N] [--policy P] "
+          "[--max-wait-ms MS] [--gauges] [--map N] [--io copy|shared] [--reduce MB] "
+          "[--cache-dir DIR] [--cache-max-mb N] [--warmup FILE] "
+          "[--warmup-auto N] [--warmup-save FILE] [--first N] "
+          "[--profile PREFIX] [--profile-hz N] "
+          "[--metrics-file PATH] [--metrics-socket PATH] [--trace PATH] "
+          "[lane[@deadline_ms]:]<js_file1> [<js_file2> ...] <iterations>\n"
+          "  lane is one of high, normal (default), low\n"
+          "  policy is one of block (default), reject, drop-oldest\n"
+          "  --map N splits N doubles across <iterations> tasks of a single "
+          "script\n"
+          "  --reduce MB scans a shared table of MB megabytes in <iterations> "
+          "chunks\n"
+          "  --warmup FILE prepares contexts for the scripts listed in FILE "
+          "before accepting tasks\n"
+          "  --warmup-auto N warms a script up once it has run N times\n"
+          "  --warmup-save FILE writes observed hit counts as a manifest\n"
+          "  --first N compares the first N tasks of each file with the "
+          "rest\n"
+          "  --profile PREFIX samples JS stacks and writes PREFIX.folded and "
+          "PREFIX.pb\n"
+          "  --metrics-file PATH rewrites Prometheus metrics to PATH every "
+          "second\n"
+          "  --metrics-socket PATH serves Prometheus metrics on a Unix "
+          "socket\n"
+          "  --trace PATH writes a Chrome trace of task, GC and queue phases "
+          "to PATH\n",
+          prog);
+}
+
+// 命令行中的一个文件：[lane[@deadline_ms]:]filename
+typedef struct {
+  const char *filename;
+  int priority;
+  int deadline_ms;
+} FileSpec;
+
+static void parse_file_spec(const char *arg, FileSpec *spec) {
+  spec->filename = arg;
+  spec->priority = TASK_PRIORITY_NORMAL;
+  spec->deadline_ms = 0;
+
+  const char *colon = strchr(arg, ':');
+  if (!colon)
+    return;
+
+  size_t name_len = strcspn(arg, "@:");
+  for (int i = 0; i < TASK_PRIORITY_COUNT; i++) {
+    if (strlen(task_priority_names[i]) == name_len &&
+        strncmp(arg, task_priority_names[i], name_len) == 0) {
+      spec->filename = colon + 1;
+      spec->priority = i;
+      if (arg[name_len] == '@')
+        spec->deadline_ms = atoi(arg + name_len + 1);
+      return;
+    }
+  }
+  // 前缀不是通道名时把整个参数当作文件名
+}
+
+// 记录未进入队列或被淘汰的任务，它们同样计入完成数
+static void record_shed_tasks(ThreadPool *pool, const Task *shed, int count) {
+  if (count == 0)
+    return;
+
+  for (int i = 0; i < count; i++) {
+    pool->task_execution_times[shed[i].task_id - 1].task_id = shed[i].task_id;
+    pool->task_execution_times[shed[i].task_id - 1].status = shed[i].status;
+    metrics_inc(pool_metrics.tasks[shed[i].status]);
+  }
+  if (atomic_fetch_add(&pool->completed_tasks, count) + count ==
+      pool->total_tasks) {
+    pthread_mutex_lock(&pool->completed_mutex);
+    pthread_cond_signal(&pool->all_completed);
+    pthread_mutex_unlock(&pool->completed_mutex);
+  }
+}
+
+// 按批添加任务，每批只加锁一次；多个节点队列时轮流分配
+static void submit_tasks(ThreadPool *pool, const Task *tasks, int count,
+                         int *next_queue) {
+  Task shed[TASK_BATCH_MAX];
+  for (int i = 0; i < count; i += pool->batch_size) {
+    int n = count - i < pool->batch_size ? count - i : pool->batch_size;
+    uint64_t trace_start = trace_begin();
+    int shed_count =
+        enqueue_batch(&pool->queues[*next_queue], tasks + i, n, shed);
+    trace_end_id("pool", "enqueue", trace_start, n, NULL);
+    record_shed_tasks(pool, shed, shed_count);
+    *next_queue = (*next_queue + 1) % pool->queue_count;
+  }
+}
+
+// 打印所有队列的深度、排队时间和卸载计数
+static void print_gauges(ThreadPool *pool) {
+  TaskQueueGauges total;
+  memset(&total, 0, sizeof(total));
+  for (int i = 0; i < pool->queue_count; i++) {
+    TaskQueueGauges g;
+    task_queue_read_gauges(&pool->queues[i], &g);
+    total.depth += g.depth;
+    total.max_depth += g.max_depth;
+    if (g.wait_ewma_ms > total.wait_ewma_ms)
+      total.wait_ewma_ms = g.wait_ewma_ms;
+    if (g.wait_max_ms > total.wait_max_ms)
+      total.wait_max_ms = g.wait_max_ms;
+    total.accepted += g.accepted;
+    total.rejected += g.rejected;
+    total.evicted += g.evicted;
+    total.shed += g.shed;
+    total.expired += g.expired;
+  }
+  printf("[queue] depth %d (max %d), wait ewma %.1f ms (max %.1f ms), "
+         "accepted %lld, rejected %lld, evicted %lld, shed %lld, "
+         "expired %lld\n",
+         total.depth, total.max_depth, total.wait_ewma_ms, total.wait_max_ms,
+         total.accepted, total.rejected, total.evicted, total.shed,
+         total.expired);
+}
+
+// 任务耗时的桶（秒）
+static const double task_seconds_buckets[] = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5};
+// GC 停顿的桶（秒）
+static const double gc_seconds_buckets[] = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1};
+
+// 工作线程启动前登记，记录时只用登记返回的 id
+static void pool_metrics_register(void) {
+  for (int i = 0; i < TASK_STATUS_COUNT; i++) {
+    char labels[64];
+    snprintf(labels, sizeof(labels), "status=\"%s\"", task_status_names[i]);
+    pool_metrics.tasks[i] = metrics_counter(
+        "quickjs_tasks_total", "Tasks finished, by outcome", labels);
+  }
+  pool_metrics.service = metrics_histogram(
+      "quickjs_task_service_seconds", "Time spent executing a task", NULL,
+      task_seconds_buckets,
+      sizeof(task_seconds_buckets) / sizeof(task_seconds_buckets[0]));
+  pool_metrics.latency = metrics_histogram(
+      "quickjs_task_latency_seconds",
+      "Time from enqueue to completion of a task", NULL, task_seconds_buckets,
+      sizeof(task_seconds_buckets) / sizeof(task_seconds_buckets[0]));
+  pool_metrics.gc_pause = metrics_histogram(
+      "quickjs_gc_pause_seconds", "JS_RunGC pauses on worker threads", NULL,
+      gc_seconds_buckets,
+      sizeof(gc_seconds_buckets) / sizeof(gc_seconds_buckets[0]));
+  pool_metrics.workers = metrics_gauge("quickjs_worker_threads",
+                                       "Running worker threads", NULL);
+  pool_metrics.live_bytes =
+      metrics_gauge("quickjs_heap_live_bytes",
+                    "Live bytes seen by the worker allocators", NULL);
+  metrics_heap_register(&pool_metrics.heap);
+}
+
+static double pool_queue_depth(void *opaque) {
+  ThreadPool *pool = opaque;
+  int depth = 0;
+  for (int i = 0; i < pool->queue_count; i++) {
+    TaskQueueGauges g;
+    task_queue_read_gauges(&pool->queues[i], &g);
+    depth += g.depth;
+  }
+  return depth;
+}
+
+static double process_rss_bytes(void *opaque) { return get_rss_bytes(); }
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+// 已排序数组的百分位数（最近秩）
+static double percentile(const double *sorted, int n, double p) {
+  if (n == 0)
+    return 0;
+  int rank = (int)(p * n + 0.999999);
+  if (rank < 1)
+    rank = 1;
+  if (rank > n)
+    rank = n;
+  return sorted[rank - 1];
+}
+
 int main(int argc, char **argv) {
-  if (argc < 3) {
-    fprintf(stderr, "Usage: %s <js_file1> [<js_file2> ...] <iterations>\n",
-            argv[0]);
+  // 线程数默认等于处理器核心数
+  int num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  int batch_size = TASK_BATCH_DEFAULT;
+  int pin_threads = 0;
+  TaskQueueConfig queue_config;
+  task_queue_default_config(&queue_config);
+  int *weights = queue_config.weights;
+  double rate = 0;
+  int show_gauges = 0;
+  long map_length = 0;
+  int shared_io = 0;
+  long reduce_mb = 0;
+  const char *cache_dir = NULL;
+  long cache_max_mb = 256;
+  const char *warmup_manifest = NULL;
+  const char *warmup_save = NULL;
+  int first_n = 0;
+  const char *profile_prefix = NULL;
+  int profile_hz = PROFILER_DEFAULT_HZ;
+  const char *metrics_file = NULL;
+  const char *metrics_socket = NULL;
+  const char *trace_path = NULL;
+
+  // 解析选项
+  int argi = 1;
+  while (argi < argc && strncmp(argv[argi], "--", 2) == 0) {
+    if (strcmp(argv[argi], "--shared-bytecode") == 0) {
+      shared_bytecode_mode = 1;
+      argi++;
+    } else if (strcmp(argv[argi], "--pin") == 0) {
+      pin_threads = 1;
+      argi++;
+    } else if (strcmp(argv[argi], "--threads") == 0 && argi + 1 < argc) {
+      num_threads = atoi(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--batch") == 0 && argi + 1 < argc) {
+      batch_size = atoi(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--rate") == 0 && argi + 1 < argc) {
+      rate = atof(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--weights") == 0 && argi + 1 < argc &&
+               sscanf(argv[argi + 1], "%d,%d,%d", &weights[0], &weights[1],
+                      &weights[2]) == 3 &&
+               weights[0] > 0 && weights[1] > 0 && weights[2] > 0) {
+      argi += 2;
+    } else if (strcmp(argv[argi], "--capacity") == 0 && argi + 1 < argc) {
+      queue_config.capacity = atoi(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--policy") == 0 && argi + 1 < argc) {
+      queue_config.policy = -1;
+      for (int i = 0; i < TASK_POLICY_COUNT; i++) {
+        if (strcmp(argv[argi + 1], task_policy_names[i]) == 0)
+          queue_config.policy = i;
+      }
+      if (queue_config.policy < 0) {
+        print_usage(argv[0]);
+        return 1;
+      }
+      argi += 2;
+    } else if (strcmp(argv[argi], "--max-wait-ms") == 0 && argi + 1 < argc) {
+      queue_config.max_wait_ms = atof(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--gauges") == 0) {
+      show_gauges = 1;
+      argi++;
+    } else if (strcmp(argv[argi], "--map") == 0 && argi + 1 < argc) {
+      map_length = atol(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--io") == 0 && argi + 1 < argc &&
+               (strcmp(argv[argi + 1], "copy") == 0 ||
+                strcmp(argv[argi + 1], "shared") == 0)) {
+      shared_io = strcmp(argv[argi + 1], "shared") == 0;
+      argi += 2;
+    } else if (strcmp(argv[argi], "--cache-dir") == 0 && argi + 1 < argc) {
+      cache_dir = argv[argi + 1];
+      argi += 2;
+    } else if (strcmp(argv[argi], "--cache-max-mb") == 0 && argi + 1 < argc) {
+      cache_max_mb = atol(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--warmup") == 0 && argi + 1 < argc) {
+      warmup_manifest = argv[argi + 1];
+      argi += 2;
+    } else if (strcmp(argv[argi], "--warmup-auto") == 0 && argi + 1 < argc) {
+      warm_hot_threshold = atoi(argv[argi + 1]);
+      warm_enabled = 1;
+      argi += 2;
+    } else if (strcmp(argv[argi], "--warmup-save") == 0 && argi + 1 < argc) {
+      warmup_save = argv[argi + 1];
+      warm_enabled = 1;
+      argi += 2;
+    } else if (strcmp(argv[argi], "--profile") == 0 && argi + 1 < argc) {
+      profile_prefix = argv[argi + 1];
+      argi += 2;
+    } else if (strcmp(argv[argi], "--profile-hz") == 0 && argi + 1 < argc) {
+      profile_hz = atoi(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--metrics-file") == 0 && argi + 1 < argc) {
+      metrics_file = argv[argi + 1];
+      argi += 2;
+    } else if (strcmp(argv[argi], "--metrics-socket") == 0 &&
+               argi + 1 < argc) {
+      metrics_socket = argv[argi + 1];
+      argi += 2;
+    } else if (strcmp(argv[argi], "--trace") == 0 && argi + 1 < argc) {
+      trace_path = argv[argi + 1];
+      argi += 2;
+    } else if (strcmp(argv[argi], "--first") == 0 && argi + 1 < argc) {
+      first_n = atoi(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--reduce") == 0 && argi + 1 < argc) {
+      reduce_mb = atol(argv[argi + 1]);
+      argi += 2;
+    } else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (argc - argi < 2 || num_threads <= 0 || batch_size <= 0 ||
+      batch_size > TASK_BATCH_MAX || map_length < 0 || reduce_mb < 0 ||
+      (map_length > 0 && reduce_mb > 0) ||
+      ((map_length > 0 || reduce_mb > 0) && argc - argi != 2)) {
+    print_usage(argv[0]);
     return 1;
   }
 
@@ -365,97 +910,425 @@ int main(int argc, char **argv) {
   clock_t start, end;
   start = clock();
 
-  // JS文件数量
-  int num_files = argc - 2;
+  // JS文件列表及数量
+  int num_files = argc - argi - 1;
+  FileSpec *files = (FileSpec *)malloc(num_files * sizeof(FileSpec));
+  for (int i = 0; i < num_files; i++) {
+    parse_file_spec(argv[argi + i], &files[i]);
+  }
   // 任务数，总文件数乘以执行次数
   int total_tasks = num_files * iterations;
 
-  // 创建线程池（线程数等于处理器核心数）
-  int num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t rss_base = get_rss_bytes();
+
+  // 编译结果跨进程复用，工作线程启动前打开
+  CompileCache compile_cache;
+  if (cache_dir) {
+    if (compile_cache_init(&compile_cache, cache_dir,
+                           (size_t)cache_max_mb << 20) < 0)
+      return 1;
+    disk_cache = &compile_cache;
+  }
+
+  // 工作线程创建运行时后各自挂接
+  Profiler profile;
+  if (profile_prefix) {
+    if (profiler_init(&profile, profile_hz) < 0) {
+      fprintf(stderr, "Failed to install the SIGPROF handler\n");
+      return 1;
+    }
+    profiler = &profile;
+  }
+
+  // 清单中的脚本由工作线程在启动时预热
+  int warm_count = 0;
+  if (warmup_manifest &&
+      (warm_count = warm_load_manifest(warmup_manifest)) < 0)
+    return 1;
+
+  // 记录一直开着，只有导出是可选的；主线程记录被卸载的任务
+  pool_metrics_register();
+  metrics_thread_attach();
+  metrics_exporting = metrics_file || metrics_socket;
 
-  printf("Creating thread pool with %d threads for %d tasks\n", num_cores,
-         total_tasks);
+  // 工作线程启动前开启，各自挂接缓冲区
+  if (trace_path) {
+    trace_init(TRACE_DEFAULT_EVENTS);
+    trace_thread_attach("main");
+  }
+
+  if (queue_config.capacity > 0) {
+    printf("Queue capacity %d per queue, policy %s\n", queue_config.capacity,
+           task_policy_names[queue_config.policy]);
+  }
+  printf("Creating thread pool with %d threads for %d tasks (%s%s)\n",
+         num_threads, total_tasks,
+         shared_bytecode_mode ? "shared bytecode" : "per-runtime eval",
+         pin_threads ? ", pinned" : "");
   // 初始化线程池
-  ThreadPool *pool = init_thread_pool(num_cores, total_tasks);
+  double pool_start = get_time_ms();
+  ThreadPool *pool =
+      init_thread_pool(num_threads, total_tasks, batch_size, pin_threads,
+                       &queue_config);
 
   if (!pool) {
     fprintf(stderr, "Failed to initialize thread pool\n");
     return 1;
   }
+  // 从这里开始出错时经过 fail 关闭线程池
+  Task *tasks = NULL;
+  int exporter_running = 0;
+
+  // 导出时才读取的值
+  metrics_func(METRIC_GAUGE, "quickjs_queue_depth", "Tasks waiting in queues",
+               NULL, pool_queue_depth, pool);
+  metrics_func(METRIC_GAUGE, "process_resident_memory_bytes",
+               "Resident memory size in bytes", NULL, process_rss_bytes, NULL);
+  MetricsExporter exporter;
+  if (metrics_exporting) {
+    if (metrics_exporter_start(&exporter, metrics_file, metrics_socket,
+                               1000) < 0)
+      goto fail;
+    exporter_running = 1;
+  }
+
+  // 等所有工作线程预热完再提交任务，第一个请求就能命中就绪上下文
+  if (warm_count > 0) {
+    pthread_mutex_lock(&pool->completed_mutex);
+    while (pool->warmed_workers < num_threads) {
+      pthread_cond_wait(&pool->warmed_up, &pool->completed_mutex);
+    }
+    pthread_mutex_unlock(&pool->completed_mutex);
+    printf("Warmed up %d scripts on %d workers in %.1f ms\n", warm_count,
+           num_threads, get_time_ms() - pool_start);
+  }
+
+  // 共享字节码模式下先把所有文件编译一次
+  if (shared_bytecode_mode) {
+    size_t bytecode_total = 0;
+    double compile_start = get_time_ms();
+    for (int i = 0; i < num_files; i++) {
+      size_t length = 0;
+      if (get_file_bytecode(files[i].filename, &length))
+        bytecode_total += length;
+    }
+    printf("Compiled %d files into %.1f KB of shared bytecode in %.1f ms\n",
+           num_files, bytecode_total / 1024.0, get_time_ms() - compile_start);
+  }
 
   // 创建任务数组用于存储结果
-  Task *tasks = (Task *)malloc(total_tasks * sizeof(Task));
+  tasks = (Task *)malloc(total_tasks * sizeof(Task));
+  if (!tasks) {
+    fprintf(stderr, "Failed to allocate %d tasks\n", total_tasks);
+    goto fail;
+  }
 
   // 添加任务到队列
   int task_id = 0;
   for (int i = 0; i < num_files; i++) {
     for (int j = 0; j < iterations; j++) {
-      tasks[task_id].filename = argv[i + 1];
+      memset(&tasks[task_id], 0, sizeof(Task));
+      tasks[task_id].filename = files[i].filename;
+      tasks[task_id].file_index = i;
+      tasks[task_id].priority = files[i].priority;
+      tasks[task_id].deadline_ms = files[i].deadline_ms;
       tasks[task_id].iterations = 1; // 每个任务只执行一次
       tasks[task_id].execution_time = 0.0;
+      tasks[task_id].gc_time = 0.0;
       tasks[task_id].task_id = task_id + 1;
-      enqueue_task(&pool->queue, tasks[task_id]); // 添加任务到队列
       task_id++;
     }
   }
 
-  printf("Added %d tasks to the queue\n", total_tasks);
+  // --map 时每个任务处理输入数组的一段
+  MapJob map_job;
+  if (map_length > 0) {
+    if (map_job_init(&map_job, tasks, total_tasks, map_length, shared_io) <
+        0) {
+      fprintf(stderr, "Failed to prepare map input\n");
+      goto fail;
+    }
+    printf("Mapping %ld doubles in %d chunks (%s I/O), args serialized in "
+           "%.3f ms\n",
+           map_length, total_tasks, shared_io ? "shared" : "copy",
+           map_job.serialize_ms);
+  }
 
-  // 等待所有任务完成
-  pthread_mutex_lock(&pool->completed_mutex);
-  while (pool->completed_tasks < total_tasks) {
-    pthread_cond_wait(&pool->all_completed, &pool->completed_mutex);
+  // --reduce 时所有任务扫描同一张共享表，表只在这里加载一次
+  ReduceJob reduce_job;
+  if (reduce_mb > 0) {
+    if (reduce_job_init(&reduce_job, tasks, total_tasks,
+                        (size_t)reduce_mb << 20) < 0) {
+      fprintf(stderr, "Failed to prepare %ld MB reduce table\n", reduce_mb);
+      goto fail;
+    }
+    printf("Loaded %ld MB shared table in %.1f ms, reducing in %d chunks\n",
+           reduce_mb, reduce_job.fill_ms, total_tasks);
   }
-  pthread_mutex_unlock(&pool->completed_mutex);
 
-  // 打印结果
-  printf("\nExecution Results:\n");
-  printf("--------------------------------------------------\n");
-  printf("%-20s | %-15s\n", "File", "Time (seconds)");
-  printf("--------------------------------------------------\n");
+  NumaStat numa_before, numa_after;
+  int has_numastat = topology_read_numastat(&pool->topology, &numa_before) == 0;
+
+  // 指定 --rate 时第一个文件的任务按固定速率提交，模拟与积压的
+  // 批处理任务竞争的请求流；其余任务一次性批量入队
+  int paced = rate > 0 ? iterations : 0;
+  int next_queue = 0;
+  double enqueue_start = get_time_ms();
+  submit_tasks(pool, tasks + paced, total_tasks - paced, &next_queue);
+  double enqueue_ms = get_time_ms() - enqueue_start;
+
+  if (total_tasks > paced) {
+    printf("Added %d tasks to the queue in batches of %d (%.1f ns per task)\n",
+           total_tasks - paced, batch_size,
+           enqueue_ms * 1e6 / (total_tasks - paced));
+  }
 
-  double *file_times = (double *)calloc(num_files, sizeof(double));
-  // 累加每个文件的执行时间和迭代次数
-  for (int i = 0; i < total_tasks; i++) {
-    // 找出当前任务对应的文件索引
-    int file_index = -1;
-    for (int j = 0; j < num_files; j++) {
-      if (strcmp(tasks[i].filename, argv[j + 1]) == 0) {
-        file_index = j;
-        break;
+  if (paced) {
+    printf("Submitting %d tasks of %s at %.0f tasks/s\n", paced,
+           files[0].filename, rate);
+    double next_gauges = enqueue_start + 1000;
+    for (int i = 0; i < paced; i++) {
+      double due = enqueue_start + i * 1000.0 / rate;
+      double wait = due - get_time_ms();
+      if (wait > 0)
+        usleep((useconds_t)(wait * 1000));
+      submit_tasks(pool, tasks + i, 1, &next_queue);
+
+      if (show_gauges && get_time_ms() >= next_gauges) {
+        print_gauges(pool);
+        next_gauges += 1000;
       }
     }
+  }
 
-    if (file_index >= 0) {
-      file_times[file_index] += pool->task_execution_times[i].execution_time;
+  // 提交方在 Atomics.wait 上等待各段的部分和，由最后完成的工作线程唤醒
+  if (reduce_mb > 0) {
+    double sum = reduce_job_join(&reduce_job);
+    double scan_s = (get_time_ms() - enqueue_start) / 1000.0;
+    printf("Reduce: sum %.0f (%s), %.2f GB/s over %.3f s\n", sum,
+           sum == reduce_job.expected ? "verified" : "MISMATCH",
+           reduce_mb / 1024.0 / scan_s, scan_s);
+  }
+
+  // 等待所有任务完成，--gauges 时每秒打印一次队列指标
+  pthread_mutex_lock(&pool->completed_mutex);
+  while (atomic_load(&pool->completed_tasks) < total_tasks) {
+    if (show_gauges) {
+      struct timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_sec += 1;
+      if (pthread_cond_timedwait(&pool->all_completed, &pool->completed_mutex,
+                                 &deadline) == ETIMEDOUT) {
+        pthread_mutex_unlock(&pool->completed_mutex);
+        print_gauges(pool);
+        pthread_mutex_lock(&pool->completed_mutex);
+      }
+    } else {
+      pthread_cond_wait(&pool->all_completed, &pool->completed_mutex);
     }
   }
+  pthread_mutex_unlock(&pool->completed_mutex);
+  double wall_ms = get_time_ms() - enqueue_start;
+  if (has_numastat)
+    has_numastat = topology_read_numastat(&pool->topology, &numa_after) == 0;
+
+  // 所有运行时仍然存活时统计进程内存
+  size_t rss_loaded = get_rss_bytes();
+
+  if (map_length > 0) {
+    size_t mismatches = map_job_collect(&map_job);
+    printf("Map results: %s, %zu of %ld elements wrong, results "
+           "deserialized in %.3f ms\n",
+           mismatches ? "FAILED" : "verified", mismatches, map_length,
+           map_job.deserialize_ms);
+    map_job_free(&map_job);
+  }
+  // 所有任务都已完成，不再有工作线程引用参数
+  if (reduce_mb > 0)
+    reduce_job_free(&reduce_job);
+
+  // 打印结果
+  printf("\nExecution Results:\n");
+  printf("---------------------------------------------------------------------"
+         "-------------------\n");
+  printf("%-20s | %-6s | %-10s | %-9s | %-9s | %-9s | %-7s\n", "File", "Lane",
+         "Time (s)", "GC (ms)", "p50 (ms)", "p99 (ms)", "Dropped");
+  printf("---------------------------------------------------------------------"
+         "-------------------\n");
+
+  double *file_times = (double *)calloc(num_files, sizeof(double));
+  double *file_gc_times = (double *)calloc(num_files, sizeof(double));
+  int *file_dropped = (int *)calloc(num_files, sizeof(int));
+  // 任务按文件连续存放，每个文件 iterations 个
+  double *latencies = (double *)malloc(iterations * sizeof(double));
 
   double total_time = 0.0;
+  double total_gc_time = 0.0;
+  int total_dropped = 0;
+  int status_counts[TASK_STATUS_COUNT] = {0};
   for (int i = 0; i < num_files; i++) {
-    printf("%-20s | %-15.6f\n", argv[i + 1], file_times[i]);
+    int executed = 0;
+    for (int j = 0; j < iterations; j++) {
+      TaskExecutionTime *result =
+          &pool->task_execution_times[i * iterations + j];
+      status_counts[result->status]++;
+      if (result->status != TASK_STATUS_OK) {
+        file_dropped[i]++;
+        continue;
+      }
+      file_times[i] += result->execution_time;
+      file_gc_times[i] += result->gc_time;
+      latencies[executed++] = result->latency_ms;
+    }
+    qsort(latencies, executed, sizeof(double), compare_double);
+
+    printf("%-20s | %-6s | %-10.6f | %-9.3f | %-9.3f | %-9.3f | %-7d\n",
+           files[i].filename, task_priority_names[files[i].priority],
+           file_times[i], file_gc_times[i],
+           percentile(latencies, executed, 0.50),
+           percentile(latencies, executed, 0.99), file_dropped[i]);
     total_time += file_times[i];
+    total_gc_time += file_gc_times[i];
+    total_dropped += file_dropped[i];
   }
 
-  printf("--------------------------------------------------\n");
+  printf("---------------------------------------------------------------------"
+         "-------------------\n");
+
+  // 每个文件最先提交的 first_n 个任务与其余任务的执行时间（不含排队）
+  if (first_n > 0) {
+    double first_sum = 0, first_max = 0, rest_sum = 0;
+    int first_count = 0, rest_count = 0;
+    for (int i = 0; i < num_files; i++) {
+      for (int j = 0; j < iterations; j++) {
+        TaskExecutionTime *result =
+            &pool->task_execution_times[i * iterations + j];
+        if (result->status != TASK_STATUS_OK)
+          continue;
+        if (j < first_n) {
+          first_sum += result->service_ms;
+          first_count++;
+          if (result->service_ms > first_max)
+            first_max = result->service_ms;
+        } else {
+          rest_sum += result->service_ms;
+          rest_count++;
+        }
+      }
+    }
+    printf("First %d tasks per file: avg %.3f ms, max %.3f ms; later tasks: "
+           "avg %.3f ms\n",
+           first_n, first_count ? first_sum / first_count : 0, first_max,
+           rest_count ? rest_sum / rest_count : 0);
+  }
   printf("Total execution time across all tasks: %.6f seconds.\n", total_time);
   printf("Average execution time per task: %.6f ms.\n",
-         total_time / total_tasks * 1000);
+         total_tasks > total_dropped
+             ? total_time / (total_tasks - total_dropped) * 1000
+             : 0);
+  if (total_dropped > 0) {
+    printf("Dropped %d tasks:", total_dropped);
+    for (int i = TASK_STATUS_OK + 1; i < TASK_STATUS_COUNT; i++) {
+      printf(" %s %d%s", task_status_names[i], status_counts[i],
+             i + 1 < TASK_STATUS_COUNT ? "," : ".\n");
+    }
+  }
+  if (show_gauges || queue_config.capacity > 0 ||
+      queue_config.max_wait_ms > 0) {
+    print_gauges(pool);
+  }
+
+  printf("Total GC pause inside tasks: %.3f ms.\n", total_gc_time);
+
+  printf("Throughput: %.0f tasks/s (%.3f s wall clock).\n",
+         total_tasks / (wall_ms / 1000.0), wall_ms / 1000.0);
+  printf("Goodput: %.0f executed tasks/s.\n",
+         (total_tasks - total_dropped) / (wall_ms / 1000.0));
+  // numastat 是整机计数，包含同一时间其他进程的分配
+  if (has_numastat) {
+    printf("NUMA page allocations during run: %llu local, %llu other-node, "
+           "%llu missed preferred node (%d nodes).\n",
+           numa_after.local_node - numa_before.local_node,
+           numa_after.other_node - numa_before.other_node,
+           numa_after.numa_miss - numa_before.numa_miss,
+           pool->topology.node_count);
+  }
+
+  if (disk_cache)
+    compile_cache_print_stats(disk_cache);
+  if (warmup_save && warm_save_manifest(warmup_save) == 0)
+    printf("Saved warm-up manifest to %s\n", warmup_save);
+
+  size_t rss_workers = rss_loaded > rss_base ? rss_loaded - rss_base : 0;
+  printf("RSS: %.1f MB total, %.1f KB per worker above baseline.\n",
+         rss_loaded / 1024.0 / 1024.0, rss_workers / 1024.0 / num_threads);
 
   free(file_times);
+  free(file_gc_times);
+  free(file_dropped);
+  free(latencies);
 
   // 在关闭线程池之前清理文件缓存
   cleanup_file_cache();
 
+  // 队列深度的回调引用线程池，先停止导出
+  if (exporter_running) {
+    metrics_exporter_stop(&exporter);
+    if (metrics_file)
+      printf("Metrics written to %s\n", metrics_file);
+  }
+
   // 关闭线程池
   shutdown_thread_pool(pool);
+  shared_regions_free();
+  warm_scripts_free();
+
+  // 工作线程都已退出，缓冲区不再写入
+  if (trace_path) {
+    long dropped;
+    long events = trace_write_json(trace_path, &dropped);
+    if (events < 0)
+      fprintf(stderr, "Failed to write trace to %s\n", trace_path);
+    else
+      printf("Trace written to %s (%ld events, %ld overwritten)\n",
+             trace_path, events, dropped);
+    trace_free();
+  }
+
+  // 工作线程都已解除挂接，样本已完整
+  if (profiler) {
+    char path[1024];
+    profiler_print_top(profiler, 20);
+    snprintf(path, sizeof(path), "%s.folded", profile_prefix);
+    if (profiler_write_folded(profiler, path) == 0)
+      printf("Folded stacks written to %s\n", path);
+    snprintf(path, sizeof(path), "%s.pb", profile_prefix);
+    if (profiler_write_pprof(profiler, path) == 0)
+      printf("pprof profile written to %s\n", path);
+    profiler_free(profiler);
+    profiler = NULL;
+  }
+  if (disk_cache) {
+    compile_cache_free(disk_cache);
+    disk_cache = NULL;
+  }
 
   // 清理资源
+  metrics_free();
   free(tasks);
+  free(files);
 
   end = clock();
   printf("Total execution time: %.6f seconds.\n",
          ((double)(end - start)) / CLOCKS_PER_SEC);
 
   return 0;
+
+fail:
+  // 线程池已经启动：先停止导出，再让工作线程退出
+  if (exporter_running)
+    metrics_exporter_stop(&exporter);
+  shutdown_thread_pool(pool);
+  free(tasks);
+  return 1;
 }
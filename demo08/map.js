@@ -0,0 +1,14 @@
+// 并行 map 的一段：args = { offset, length[, values] }
+// --io copy 时输入在 args.values 中，结果作为脚本的值序列化传回；
+// --io shared 时 input/output 是宿主内存上的 SharedArrayBuffer，直接读写
+var src = typeof input !== "undefined" ? new Float64Array(input) : args.values;
+var dst =
+  typeof output !== "undefined"
+    ? new Float64Array(output)
+    : new Float64Array(args.length);
+
+for (var i = 0; i < args.length; i++) {
+  dst[i] = src[i] * src[i] + 1;
+}
+
+dst;
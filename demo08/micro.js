@@ -0,0 +1,2 @@
+// 几乎不做事的微任务，用于测量线程池自身的同步开销
+var x = 1 + 1;
@@ -0,0 +1,484 @@
+#include "../helpers/clock.c"
+#include <errno.h>
+#include <float.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// 优先级通道，数值越小优先级越高
+#define TASK_PRIORITY_HIGH 0
+#define TASK_PRIORITY_NORMAL 1
+#define TASK_PRIORITY_LOW 2
+#define TASK_PRIORITY_COUNT 3
+
+// 各通道的默认权重：队列都有积压时按 8:3:1 的比例出队
+#define TASK_WEIGHT_HIGH 8
+#define TASK_WEIGHT_NORMAL 3
+#define TASK_WEIGHT_LOW 1
+
+// 步幅调度的基数，通道步幅为 TASK_STRIDE_SCALE / weight
+#define TASK_STRIDE_SCALE (1 << 16)
+
+static const char *const task_priority_names[TASK_PRIORITY_COUNT] = {
+    "high", "normal", "low"};
+
+// 队列满时的处理策略
+#define TASK_POLICY_BLOCK 0       // 入队方等待队列有空位
+#define TASK_POLICY_REJECT 1      // 拒绝新任务
+#define TASK_POLICY_DROP_OLDEST 2 // 淘汰排在最前面的低优先级任务
+#define TASK_POLICY_COUNT 3
+
+static const char *const task_policy_names[TASK_POLICY_COUNT] = {
+    "block", "reject", "drop-oldest"};
+
+// 任务结果状态，除 TASK_STATUS_OK 外的任务都没有执行
+#define TASK_STATUS_OK 0
+#define TASK_STATUS_EXPIRED 1  // 出队时已错过截止时间
+#define TASK_STATUS_SHED 2     // 排队时间过长被卸载
+#define TASK_STATUS_REJECTED 3 // 队列已满被拒绝
+#define TASK_STATUS_EVICTED 4  // 被 drop-oldest 淘汰
+#define TASK_STATUS_COUNT 5
+
+static const char *const task_status_names[TASK_STATUS_COUNT] = {
+    "ok", "expired", "shed", "rejected", "evicted"};
+
+// 排队时间指数移动平均的平滑系数
+#define TASK_WAIT_EWMA_ALPHA 0.1
+
+// 任务结果：JS_WriteObject 序列化后的脚本返回值，malloc 分配，由提交方释放
+typedef struct {
+  uint8_t *data;
+  size_t len;
+} TaskResult;
+
+// 任务结构体
+typedef struct {
+  const char *filename;
+  int file_index;
+  int iterations;
+  int priority;    // TASK_PRIORITY_*
+  int deadline_ms; // 相对入队时间的截止时间，0 表示没有截止时间
+  double execution_time;
+  double gc_time; // 任务结束后 GC 停顿时长（毫秒）
+  int task_id;
+
+  // 输入输出通道，均为可选
+  const uint8_t *args; // JS_WriteObject 序列化的参数，还原为 globalThis.args
+  size_t args_len;
+  void *input; // 宿主内存，以 SharedArrayBuffer 暴露为 globalThis.input
+  size_t input_len;
+  void *output; // 宿主内存，以 SharedArrayBuffer 暴露为 globalThis.output
+  size_t output_len;
+  TaskResult *result; // 不为 NULL 时序列化脚本的返回值写入这里
+
+  // 以下字段由队列在入队/出队时填写
+  double enqueue_ms;  // 入队时间（get_time_ms）
+  double deadline_at; // 绝对截止时间，0 表示没有
+  uint64_t seq;       // 入队序号，同一截止时间内保持先进先出
+  int status;         // TASK_STATUS_*，未执行的任务由队列标记原因
+} Task;
+
+// 一个优先级通道：按（截止时间，入队序号）排序的最小堆，
+// 没有截止时间的任务排在有截止时间的任务之后，彼此之间先进先出
+typedef struct {
+  Task *heap;
+  int size;
+  int capacity;
+  int weight;
+  uint64_t pass; // 步幅调度的虚拟时间，越小越先出队
+} TaskLane;
+
+// 队列配置
+typedef struct {
+  int weights[TASK_PRIORITY_COUNT];
+  int capacity;       // 最多容纳的任务数，0 表示不限
+  int policy;         // 队列满时的 TASK_POLICY_*
+  double max_wait_ms; // 排队超过该时长的非高优先级任务被卸载，0 表示不限
+} TaskQueueConfig;
+
+// 队列的运行指标
+typedef struct {
+  int depth;
+  int max_depth;
+  double wait_ewma_ms; // 出队任务排队时间的指数移动平均
+  double wait_max_ms;
+  long long accepted;
+  long long rejected;
+  long long evicted;
+  long long shed;
+  long long expired;
+} TaskQueueGauges;
+
+// 任务队列
+typedef struct {
+  TaskLane lanes[TASK_PRIORITY_COUNT];
+  TaskQueueConfig config;
+  TaskQueueGauges gauges;
+  // 各通道的任务数，供工作线程不加锁地检查是否有更高优先级的任务
+  atomic_int lane_size[TASK_PRIORITY_COUNT];
+  int size;
+  uint64_t next_seq;
+  uint64_t virtual_time; // 最近一次出队的通道的 pass
+  pthread_mutex_t mutex;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+} TaskQueue;
+
+// 默认配置：默认权重、不限容量
+static void task_queue_default_config(TaskQueueConfig *config) {
+  config->weights[TASK_PRIORITY_HIGH] = TASK_WEIGHT_HIGH;
+  config->weights[TASK_PRIORITY_NORMAL] = TASK_WEIGHT_NORMAL;
+  config->weights[TASK_PRIORITY_LOW] = TASK_WEIGHT_LOW;
+  config->capacity = 0;
+  config->policy = TASK_POLICY_BLOCK;
+  config->max_wait_ms = 0;
+}
+
+// 初始化任务队列，config 为 NULL 时使用默认配置。
+// 有容量上限时各通道的堆一次性分配好，入队不再分配内存
+void init_task_queue(TaskQueue *queue, const TaskQueueConfig *config) {
+  if (config) {
+    queue->config = *config;
+  } else {
+    task_queue_default_config(&queue->config);
+  }
+  memset(&queue->gauges, 0, sizeof(queue->gauges));
+
+  memset(queue->lanes, 0, sizeof(queue->lanes));
+  for (int i = 0; i < TASK_PRIORITY_COUNT; i++) {
+    TaskLane *lane = &queue->lanes[i];
+    lane->weight = queue->config.weights[i];
+    if (queue->config.capacity > 0) {
+      lane->capacity = queue->config.capacity;
+      lane->heap = (Task *)malloc(lane->capacity * sizeof(Task));
+    }
+    atomic_init(&queue->lane_size[i], 0);
+  }
+  queue->size = 0;
+  queue->next_seq = 0;
+  queue->virtual_time = 0;
+  pthread_mutex_init(&queue->mutex, NULL);
+  pthread_cond_init(&queue->not_empty, NULL);
+  pthread_cond_init(&queue->not_full, NULL);
+}
+
+static int task_before(const Task *a, const Task *b) {
+  double da = a->deadline_at > 0 ? a->deadline_at : DBL_MAX;
+  double db = b->deadline_at > 0 ? b->deadline_at : DBL_MAX;
+  if (da != db)
+    return da < db;
+  return a->seq < b->seq;
+}
+
+static void task_lane_push(TaskLane *lane, const Task *task) {
+  if (lane->size == lane->capacity) {
+    lane->capacity = lane->capacity ? lane->capacity * 2 : 64;
+    lane->heap = (Task *)realloc(lane->heap, lane->capacity * sizeof(Task));
+  }
+
+  int i = lane->size++;
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!task_before(task, &lane->heap[parent]))
+      break;
+    lane->heap[i] = lane->heap[parent];
+    i = parent;
+  }
+  lane->heap[i] = *task;
+}
+
+static void task_lane_pop(TaskLane *lane, Task *task) {
+  *task = lane->heap[0];
+  Task last = lane->heap[--lane->size];
+
+  int i = 0;
+  while (1) {
+    int child = i * 2 + 1;
+    if (child >= lane->size)
+      break;
+    if (child + 1 < lane->size &&
+        task_before(&lane->heap[child + 1], &lane->heap[child]))
+      child++;
+    if (!task_before(&lane->heap[child], &last))
+      break;
+    lane->heap[i] = lane->heap[child];
+    i = child;
+  }
+  if (lane->size > 0)
+    lane->heap[i] = last;
+}
+
+// 加入一个任务，调用方需持有 queue->mutex
+static void task_queue_push_locked(TaskQueue *queue, const Task *task) {
+  TaskLane *lane = &queue->lanes[task->priority];
+
+  // 通道从空变为非空时不补偿之前空闲的时间，避免突发抢占其他通道
+  if (lane->size == 0 && lane->pass < queue->virtual_time)
+    lane->pass = queue->virtual_time;
+
+  task_lane_push(lane, task);
+  atomic_store(&queue->lane_size[task->priority], lane->size);
+  queue->size++;
+
+  queue->gauges.depth = queue->size;
+  if (queue->size > queue->gauges.max_depth)
+    queue->gauges.max_depth = queue->size;
+}
+
+// 从指定通道取出下一个任务，调用方需持有 queue->mutex
+static void task_queue_pop_locked(TaskQueue *queue, int priority, Task *task) {
+  TaskLane *lane = &queue->lanes[priority];
+  task_lane_pop(lane, task);
+  atomic_store(&queue->lane_size[priority], lane->size);
+  queue->size--;
+  queue->gauges.depth = queue->size;
+}
+
+// drop-oldest 的淘汰对象：优先级不高于新任务的通道中最低优先级的非空通道，
+// 淘汰该通道中排在最前面（下一个将要执行）的任务。没有可淘汰的通道时返回 -1
+static int task_queue_victim_lane(TaskQueue *queue, int priority) {
+  for (int i = TASK_PRIORITY_COUNT - 1; i >= priority; i--) {
+    if (queue->lanes[i].size > 0)
+      return i;
+  }
+  return -1;
+}
+
+// 按步幅调度选出下一个出队的通道：非空通道中 pass 最小的，
+// 相同时优先级高的优先。调用方需持有 queue->mutex 且队列非空
+static int task_queue_pick_lane(TaskQueue *queue) {
+  int best = -1;
+  for (int i = 0; i < TASK_PRIORITY_COUNT; i++) {
+    TaskLane *lane = &queue->lanes[i];
+    if (lane->size > 0 && (best < 0 || lane->pass < queue->lanes[best].pass))
+      best = i;
+  }
+
+  TaskLane *lane = &queue->lanes[best];
+  queue->virtual_time = lane->pass;
+  lane->pass += TASK_STRIDE_SCALE / lane->weight;
+  return best;
+}
+
+static void wake_dequeuers(TaskQueue *queue, int count) {
+  if (count > 1) {
+    pthread_cond_broadcast(&queue->not_empty);
+  } else {
+    pthread_cond_signal(&queue->not_empty);
+  }
+}
+
+static void wake_full_waiters(TaskQueue *queue, int count) {
+  if (count > 1) {
+    pthread_cond_broadcast(&queue->not_full);
+  } else {
+    pthread_cond_signal(&queue->not_full);
+  }
+}
+
+// 读取队列指标
+void task_queue_read_gauges(TaskQueue *queue, TaskQueueGauges *gauges) {
+  pthread_mutex_lock(&queue->mutex);
+  *gauges = queue->gauges;
+  pthread_mutex_unlock(&queue->mutex);
+}
+
+// 批量添加任务，只加锁一次。入队时记录入队时间并计算绝对截止时间。
+// 未被接受的任务（拒绝、卸载）以及被淘汰的任务标记状态后写入 shed，
+// 由调用方记录结果；shed 至少要能容纳 count 个任务。
+// 返回 shed 中的任务数
+int enqueue_batch(TaskQueue *queue, const Task *tasks, int count,
+                  Task *shed) {
+  int shed_count = 0;
+  if (count <= 0)
+    return 0;
+
+  double now = get_time_ms();
+  pthread_mutex_lock(&queue->mutex);
+
+  for (int i = 0; i < count; i++) {
+    Task task = tasks[i];
+    task.enqueue_ms = now;
+    task.deadline_at = task.deadline_ms > 0 ? now + task.deadline_ms : 0;
+    task.seq = queue->next_seq++;
+    task.status = TASK_STATUS_OK;
+
+    // 队列仍有积压且近期排队时间超过阈值时，在入口处卸载非高优先级任务
+    if (queue->config.max_wait_ms > 0 && queue->size > 0 &&
+        task.priority != TASK_PRIORITY_HIGH &&
+        queue->gauges.wait_ewma_ms > queue->config.max_wait_ms) {
+      task.status = TASK_STATUS_SHED;
+      queue->gauges.shed++;
+      shed[shed_count++] = task;
+      continue;
+    }
+
+    if (queue->config.capacity > 0 && queue->size >= queue->config.capacity) {
+      if (queue->config.policy == TASK_POLICY_BLOCK) {
+        // 先唤醒工作线程处理本批已入队的任务，再等待空位
+        pthread_cond_broadcast(&queue->not_empty);
+        while (queue->size >= queue->config.capacity) {
+          pthread_cond_wait(&queue->not_full, &queue->mutex);
+        }
+        // 等待的时间不算作排队时间
+        task.enqueue_ms = get_time_ms();
+        if (task.deadline_ms > 0)
+          task.deadline_at = task.enqueue_ms + task.deadline_ms;
+      } else {
+        int victim = queue->config.policy == TASK_POLICY_DROP_OLDEST
+                         ? task_queue_victim_lane(queue, task.priority)
+                         : -1;
+        if (victim < 0) {
+          task.status = TASK_STATUS_REJECTED;
+          queue->gauges.rejected++;
+          shed[shed_count++] = task;
+          continue;
+        }
+        Task evicted;
+        task_queue_pop_locked(queue, victim, &evicted);
+        evicted.status = TASK_STATUS_EVICTED;
+        queue->gauges.evicted++;
+        shed[shed_count++] = evicted;
+      }
+    }
+
+    task_queue_push_locked(queue, &task);
+    queue->gauges.accepted++;
+  }
+
+  wake_dequeuers(queue, count);
+  pthread_mutex_unlock(&queue->mutex);
+  return shed_count;
+}
+
+// 把已出队但尚未开始执行的任务放回原来的队列，保留原来的入队时间和序号。
+// 这些任务已经被接受过，不受容量限制，工作线程也因此不会在这里阻塞。
+// 出队时已判定过期或卸载的任务已经计数，调用方应直接记录完成而不是放回
+void requeue_batch(TaskQueue *queue, const Task *tasks, int count) {
+  if (count <= 0)
+    return;
+
+  pthread_mutex_lock(&queue->mutex);
+  for (int i = 0; i < count; i++) {
+    task_queue_push_locked(queue, &tasks[i]);
+  }
+  wake_dequeuers(queue, count);
+  pthread_mutex_unlock(&queue->mutex);
+}
+
+// 队列中是否有比 priority 更高优先级的任务，不加锁
+int task_queue_has_higher_priority(TaskQueue *queue, int priority) {
+  for (int i = 0; i < priority; i++) {
+    if (atomic_load_explicit(&queue->lane_size[i], memory_order_relaxed) > 0)
+      return 1;
+  }
+  return 0;
+}
+
+// 从队列中批量获取任务，最多 max 个，且不超过剩余任务的 1/share，
+// 避免队列快空时一个线程拿走全部任务。每个任务按加权公平的方式选择通道，
+// 通道内按截止时间先后出队；已经错过截止时间或排队过久的任务标记状态后
+// 一并返回，由调用方记录而不执行。队列为空时最多等待 timeout_ms 毫秒。
+// 返回取到的任务数，0 表示等待超时（线程空闲），-1 表示线程池已关闭。
+// 出队耗时（不含等待任务的时间）累加到 *sync_ms
+int dequeue_batch(TaskQueue *queue, Task *tasks, int max, int share,
+                  int *shutdown_flag, int timeout_ms, double *sync_ms) {
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += timeout_ms / 1000;
+  deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  double start = get_time_ms();
+  pthread_mutex_lock(&queue->mutex);
+
+  // 当队列为空且没有关闭信号时等待
+  int waited = 0;
+  while (queue->size == 0 && !(*shutdown_flag)) {
+    waited = 1;
+    if (pthread_cond_timedwait(&queue->not_empty, &queue->mutex, &deadline) ==
+        ETIMEDOUT) {
+      break;
+    }
+  }
+  if (waited) {
+    start = get_time_ms();
+  }
+
+  // 如果收到关闭信号，返回-1表示线程应当退出
+  if (*shutdown_flag) {
+    pthread_mutex_unlock(&queue->mutex);
+    return -1;
+  }
+
+  if (queue->size == 0) {
+    pthread_mutex_unlock(&queue->mutex);
+    return 0;
+  }
+
+  int count = queue->size / share;
+  if (count < 1)
+    count = 1;
+  if (count > max)
+    count = max;
+
+  TaskQueueGauges *gauges = &queue->gauges;
+  for (int i = 0; i < count; i++) {
+    Task *task = &tasks[i];
+    task_queue_pop_locked(queue, task_queue_pick_lane(queue), task);
+
+    double wait = start - task->enqueue_ms;
+    gauges->wait_ewma_ms += TASK_WAIT_EWMA_ALPHA * (wait - gauges->wait_ewma_ms);
+    if (wait > gauges->wait_max_ms)
+      gauges->wait_max_ms = wait;
+
+    if (task->deadline_at > 0 && task->deadline_at < start) {
+      task->status = TASK_STATUS_EXPIRED;
+      gauges->expired++;
+    } else if (queue->config.max_wait_ms > 0 &&
+               task->priority != TASK_PRIORITY_HIGH &&
+               wait > queue->config.max_wait_ms) {
+      task->status = TASK_STATUS_SHED;
+      gauges->shed++;
+    }
+  }
+
+  if (queue->config.capacity > 0) {
+    wake_full_waiters(queue, count);
+  }
+  pthread_mutex_unlock(&queue->mutex);
+
+  *sync_ms += get_time_ms() - start;
+  return count;
+}
+
+// 出队之后、开始执行之前才过期的任务同样计入 expired
+static void task_queue_note_expired(TaskQueue *queue) {
+  pthread_mutex_lock(&queue->mutex);
+  queue->gauges.expired++;
+  pthread_mutex_unlock(&queue->mutex);
+}
+
+// 销毁任务队列
+void destroy_task_queue(TaskQueue *queue) {
+  pthread_mutex_lock(&queue->mutex);
+
+  for (int i = 0; i < TASK_PRIORITY_COUNT; i++) {
+    free(queue->lanes[i].heap);
+    queue->lanes[i].heap = NULL;
+    queue->lanes[i].size = 0;
+    queue->lanes[i].capacity = 0;
+  }
+  queue->size = 0;
+
+  pthread_mutex_unlock(&queue->mutex);
+  pthread_mutex_destroy(&queue->mutex);
+  pthread_cond_destroy(&queue->not_empty);
+  pthread_cond_destroy(&queue->not_full);
+}
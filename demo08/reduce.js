@@ -0,0 +1,16 @@
+// 并行归约的一段：args = { offset, length, chunk, chunks }
+// shared.table 是宿主只加载一次的只读大表，所有工作线程直接读取
+var state = new Int32Array(shared.state);
+
+try {
+  var table = new Float64Array(shared.table, args.offset * 8, args.length);
+  var sum = 0;
+  for (var i = 0; i < table.length; i++) {
+    sum += table[i];
+  }
+  new Float64Array(shared.partials)[args.chunk] = sum;
+} finally {
+  // 出错时也要计数，否则提交方会一直等待
+  Atomics.add(state, 0, 1);
+  Atomics.notify(state, 0);
+}
@@ -0,0 +1,235 @@
+#include "../helpers/clock.c"
+#include "../quickjs/quickjs.h"
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// 最多可以注册的共享内存区域数
+#define SHARED_REGION_MAX 16
+
+// 宿主分配的一块共享内存，以同名的 SharedArrayBuffer 暴露给所有工作线程
+typedef struct {
+  char name[32];
+  void *data;
+  size_t size;
+} SharedRegion;
+
+// 区域在提交任务之前注册，之后只读，工作线程访问无需加锁
+static SharedRegion shared_regions[SHARED_REGION_MAX];
+static int shared_region_count = 0;
+
+// 分配并注册一块共享内存，内容初始化为 0，失败时返回 NULL
+static void *shared_region_create(const char *name, size_t size) {
+  if (shared_region_count == SHARED_REGION_MAX)
+    return NULL;
+
+  // mmap 按页分配且由内核清零，大区域不会先被 malloc 逐页写一遍
+  void *data = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED)
+    return NULL;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  // 只读扫描的大表用透明大页减少 TLB 缺失
+  if (size >= (2 << 20))
+    madvise(data, size, MADV_HUGEPAGE);
+#endif
+
+  SharedRegion *region = &shared_regions[shared_region_count++];
+  snprintf(region->name, sizeof(region->name), "%s", name);
+  region->data = data;
+  region->size = size;
+  return data;
+}
+
+static void shared_regions_free(void) {
+  for (int i = 0; i < shared_region_count; i++) {
+    munmap(shared_regions[i].data, shared_regions[i].size);
+  }
+  shared_region_count = 0;
+}
+
+// 在 ctx 中定义全局对象 shared，每个区域一个 SharedArrayBuffer。
+// 缓冲区直接引用宿主内存，free_func 为 NULL，由宿主负责释放
+static void shared_regions_expose(JSContext *ctx) {
+  if (shared_region_count == 0)
+    return;
+
+  JSValue global = JS_GetGlobalObject(ctx);
+  JSValue obj = JS_NewObject(ctx);
+  for (int i = 0; i < shared_region_count; i++) {
+    SharedRegion *region = &shared_regions[i];
+    JS_SetPropertyStr(ctx, obj, region->name,
+                      JS_NewArrayBuffer(ctx, region->data, region->size, NULL,
+                                        NULL, 1));
+  }
+  JS_SetPropertyStr(ctx, global, "shared", obj);
+  JS_FreeValue(ctx, global);
+}
+
+#if defined(__linux__)
+
+// 取 Atomics.wait/notify 的目标地址。只处理落在宿主共享区域内的
+// Int32Array 元素，其他情况 *paddr 为 NULL，交给 QuickJS 内置实现：
+// BigInt64Array 由内置实现等待和唤醒，其余类型由它抛出 TypeError。
+// 转换 index 时抛出异常则返回 -1
+static int shared_atomics_addr(JSContext *ctx, int argc, JSValueConst *argv,
+                               int32_t **paddr) {
+  *paddr = NULL;
+  // 只看元素大小会把 Uint32Array、Float32Array 也当成 Int32Array
+  if (argc < 2 || JS_GetTypedArrayType(argv[0]) != JS_TYPED_ARRAY_INT32)
+    return 0;
+
+  size_t byte_offset, byte_length, bytes_per_element, size;
+  JSValue buffer = JS_GetTypedArrayBuffer(ctx, argv[0], &byte_offset,
+                                          &byte_length, &bytes_per_element);
+  if (JS_IsException(buffer))
+    return -1;
+  uint8_t *data = JS_GetArrayBuffer(ctx, &size, buffer);
+  JS_FreeValue(ctx, buffer);
+  if (!data) {
+    // 已分离的缓冲区同样交给内置实现报告
+    JS_FreeValue(ctx, JS_GetException(ctx));
+    return 0;
+  }
+
+  double index;
+  // index 的 valueOf 可能抛出，不能带着未处理的异常回到内置实现
+  if (JS_ToFloat64(ctx, &index, argv[1]) < 0)
+    return -1;
+  if (index < 0 || index >= byte_length / sizeof(int32_t) ||
+      index != (size_t)index)
+    return 0;
+
+  int32_t *addr = (int32_t *)(data + byte_offset) + (size_t)index;
+  for (int i = 0; i < shared_region_count; i++) {
+    uint8_t *start = shared_regions[i].data;
+    if ((uint8_t *)addr >= start &&
+        (uint8_t *)(addr + 1) <= start + shared_regions[i].size) {
+      *paddr = addr;
+      break;
+    }
+  }
+  return 0;
+}
+
+static long shared_futex(int32_t *addr, int op, int32_t val,
+                         const struct timespec *timeout) {
+  return syscall(SYS_futex, addr, op, val, timeout, NULL, 0);
+}
+
+// Atomics.wait(typedArray, index, value[, timeout])。
+// 共享区域内的地址直接在 futex 上等待，func_data[0] 为内置实现
+static JSValue js_shared_atomics_wait(JSContext *ctx, JSValueConst this_val,
+                                      int argc, JSValueConst *argv, int magic,
+                                      JSValue *func_data) {
+  int32_t *addr;
+  if (shared_atomics_addr(ctx, argc, argv, &addr) < 0)
+    return JS_EXCEPTION;
+  if (!addr)
+    return JS_Call(ctx, func_data[0], this_val, argc, argv);
+
+  int32_t value;
+  double timeout = INFINITY;
+  if (JS_ToInt32(ctx, &value, argc > 2 ? argv[2] : JS_UNDEFINED) < 0)
+    return JS_EXCEPTION;
+  if (argc > 3 && !JS_IsUndefined(argv[3]) &&
+      JS_ToFloat64(ctx, &timeout, argv[3]) < 0)
+    return JS_EXCEPTION;
+  if (isnan(timeout) || timeout < 0)
+    timeout = isnan(timeout) ? INFINITY : 0;
+
+  double deadline = get_time_ms() + timeout;
+  for (;;) {
+    struct timespec ts, *pts = NULL;
+    if (isfinite(timeout)) {
+      double remaining = deadline - get_time_ms();
+      if (remaining < 0)
+        remaining = 0;
+      ts.tv_sec = (time_t)(remaining / 1000);
+      ts.tv_nsec = (long)((remaining - ts.tv_sec * 1000.0) * 1e6);
+      pts = &ts;
+    }
+
+    // 内核在挂起前原子地比较 *addr 与 value，不会丢失唤醒
+    if (shared_futex(addr, FUTEX_WAIT_PRIVATE, value, pts) == 0)
+      return JS_NewAtomString(ctx, "ok");
+    if (errno == EAGAIN)
+      return JS_NewAtomString(ctx, "not-equal");
+    if (errno == ETIMEDOUT)
+      return JS_NewAtomString(ctx, "timed-out");
+    if (errno != EINTR)
+      return JS_ThrowInternalError(ctx, "futex wait failed: %s",
+                                   strerror(errno));
+  }
+}
+
+// Atomics.notify(typedArray, index[, count])，返回被唤醒的等待者数量
+static JSValue js_shared_atomics_notify(JSContext *ctx, JSValueConst this_val,
+                                        int argc, JSValueConst *argv,
+                                        int magic, JSValue *func_data) {
+  int32_t *addr;
+  if (shared_atomics_addr(ctx, argc, argv, &addr) < 0)
+    return JS_EXCEPTION;
+  if (!addr)
+    return JS_Call(ctx, func_data[0], this_val, argc, argv);
+
+  double count = INFINITY;
+  if (argc > 2 && !JS_IsUndefined(argv[2]) &&
+      JS_ToFloat64(ctx, &count, argv[2]) < 0)
+    return JS_EXCEPTION;
+  int n = count >= INT_MAX ? INT_MAX : count > 0 ? (int)count : 0;
+
+  long woken = shared_futex(addr, FUTEX_WAKE_PRIVATE, n, NULL);
+  if (woken < 0)
+    return JS_ThrowInternalError(ctx, "futex wake failed: %s",
+                                 strerror(errno));
+  return JS_NewInt32(ctx, (int32_t)woken);
+}
+
+static void shared_atomics_override(JSContext *ctx, JSValueConst atomics,
+                                    const char *name, JSCFunctionData *func,
+                                    int length) {
+  JSValue builtin = JS_GetPropertyStr(ctx, atomics, name);
+  JS_SetPropertyStr(ctx, atomics, name,
+                    JS_NewCFunctionData(ctx, func, length, 0, 1, &builtin));
+  JS_FreeValue(ctx, builtin);
+}
+
+#endif
+
+// 让 ctx 中的 Atomics.wait/notify 在宿主共享区域上直接使用 futex，
+// 不同运行时的线程因此可以互相等待和唤醒。其他平台保留 QuickJS 的
+// 内置实现，它同样支持跨线程等待，但所有等待者共用一把全局锁。
+// can_block 与运行时的 JS_SetCanBlock 一致；不能阻塞时 wait 保留内置
+// 实现，由它抛出 TypeError，而不是在 futex 上挂起线程
+static void shared_atomics_install(JSContext *ctx, int can_block) {
+#if defined(__linux__)
+  if (shared_region_count == 0)
+    return;
+
+  JSValue global = JS_GetGlobalObject(ctx);
+  JSValue atomics = JS_GetPropertyStr(ctx, global, "Atomics");
+  if (JS_IsObject(atomics)) {
+    if (can_block)
+      shared_atomics_override(ctx, atomics, "wait", js_shared_atomics_wait,
+                              4);
+    shared_atomics_override(ctx, atomics, "notify", js_shared_atomics_notify,
+                            3);
+  }
+  JS_FreeValue(ctx, atomics);
+  JS_FreeValue(ctx, global);
+#else
+  (void)ctx;
+  (void)can_block;
+#endif
+}
@@ -0,0 +1,384 @@
+#include "../quickjs/quickjs.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 创建执行任务用的上下文，挂上 console、编码、哈希和文件 API 以及宿主
+// 注册的共享区域。工作线程的运行时都允许阻塞（见 worker_thread）
+static JSContext *task_new_context(JSRuntime *runtime) {
+  JSContext *ctx = JS_NewContext(runtime);
+  if (!ctx)
+    return NULL;
+  js_std_init_console(ctx);
+  js_std_init_encoding(ctx);
+  js_std_init_crypto(ctx);
+  js_std_init_fs(ctx);
+  shared_regions_expose(ctx);
+  shared_atomics_install(ctx, 1);
+  return ctx;
+}
+
+// 把 val 挂到全局对象上，接管 val 的引用。val 为异常或设置失败时返回 -1
+static int task_set_global(JSContext *ctx, JSValueConst global,
+                           const char *name, JSValue val) {
+  if (JS_IsException(val))
+    return -1;
+  return JS_SetPropertyStr(ctx, global, name, val) < 0 ? -1 : 0;
+}
+
+// 把任务的输入输出通道挂到全局对象上：args 从序列化数据还原，
+// input/output 直接以宿主内存创建 SharedArrayBuffer，不复制数据。
+// free_func 为 NULL，内存由提交方持有，生命周期覆盖整个任务。
+// 任一通道创建失败时返回 -1，异常留在 ctx 中
+static int task_setup_io(JSContext *ctx, const Task *task) {
+  JSValue global = JS_GetGlobalObject(ctx);
+  int ret = 0;
+
+  if (task->args &&
+      task_set_global(ctx, global, "args",
+                      JS_ReadObject(ctx, task->args, task->args_len, 0)) < 0)
+    ret = -1;
+  if (ret == 0 && task->input &&
+      task_set_global(ctx, global, "input",
+                      JS_NewArrayBuffer(ctx, task->input, task->input_len,
+                                        NULL, NULL, 1)) < 0)
+    ret = -1;
+  if (ret == 0 && task->output &&
+      task_set_global(ctx, global, "output",
+                      JS_NewArrayBuffer(ctx, task->output, task->output_len,
+                                        NULL, NULL, 1)) < 0)
+    ret = -1;
+
+  JS_FreeValue(ctx, global);
+  return ret;
+}
+
+// 以对象模式序列化脚本的结果值，复制到 malloc 分配的缓冲区中。
+// 序列化结果只包含数据，可以在提交方的运行时中用 JS_ReadObject 还原
+static int task_capture_result(JSContext *ctx, TaskResult *result,
+                               JSValueConst val) {
+  size_t len = 0;
+  uint8_t *buf = JS_WriteObject(ctx, &len, val, 0);
+  if (!buf)
+    return -1;
+
+  result->data = malloc(len);
+  if (!result->data) {
+    js_free(ctx, buf);
+    JS_ThrowOutOfMemory(ctx);
+    return -1;
+  }
+  memcpy(result->data, buf, len);
+  result->len = len;
+  js_free(ctx, buf);
+  return 0;
+}
+
+// 序列化任务参数并复制到 malloc 分配的缓冲区，接管 obj 的引用
+static uint8_t *task_write_args(JSContext *ctx, JSValue obj, size_t *len) {
+  uint8_t *buf = JS_WriteObject(ctx, len, obj, 0);
+  JS_FreeValue(ctx, obj);
+  if (!buf) {
+    check_and_print_exception(ctx);
+    return NULL;
+  }
+  uint8_t *copy = malloc(*len);
+  if (copy)
+    memcpy(copy, buf, *len);
+  else
+    fprintf(stderr, "Failed to allocate %zu bytes for task arguments\n",
+            *len);
+  js_free(ctx, buf);
+  return copy;
+}
+
+// 并行 map：把 length 个 double 切成 chunk_count 段，每段一个任务。
+// copy 模式下输入随 args 序列化，结果由脚本返回后序列化传回；
+// shared 模式下每个任务的 input/output 直接指向宿主数组的对应段
+typedef struct {
+  int shared;
+  size_t length;
+  int chunk_count;
+  double *input;
+  double *output;
+  uint8_t **args;       // 每段序列化后的参数
+  TaskResult *results;  // copy 模式下每段的结果
+  JSRuntime *runtime;   // 提交方用于序列化/反序列化的运行时
+  JSContext *ctx;
+  double serialize_ms;
+  double deserialize_ms;
+} MapJob;
+
+// 每个元素上执行的函数，需要与 map.js 保持一致
+static double map_job_expected(double x) { return x * x + 1; }
+
+static size_t map_job_chunk_start(const MapJob *job, int chunk) {
+  return job->length * chunk / job->chunk_count;
+}
+
+// 序列化一段的参数：{ offset, length[, values] }
+static uint8_t *map_job_write_args(MapJob *job, size_t offset, size_t count,
+                                   size_t *len) {
+  JSContext *ctx = job->ctx;
+  JSValue obj = JS_NewObject(ctx);
+  if (JS_IsException(obj) ||
+      JS_SetPropertyStr(ctx, obj, "offset", JS_NewInt64(ctx, offset)) < 0 ||
+      JS_SetPropertyStr(ctx, obj, "length", JS_NewInt64(ctx, count)) < 0)
+    goto fail;
+
+  if (!job->shared) {
+    JSValue buffer = JS_NewArrayBufferCopy(
+        ctx, (const uint8_t *)(job->input + offset), count * sizeof(double));
+    JSValue global = JS_GetGlobalObject(ctx);
+    JSValue ctor = JS_GetPropertyStr(ctx, global, "Float64Array");
+    JSValue values = JS_CallConstructor(ctx, ctor, 1, &buffer);
+    JS_FreeValue(ctx, ctor);
+    JS_FreeValue(ctx, global);
+    JS_FreeValue(ctx, buffer);
+    if (JS_IsException(values) ||
+        JS_SetPropertyStr(ctx, obj, "values", values) < 0)
+      goto fail;
+  }
+
+  return task_write_args(ctx, obj, len);
+
+fail:
+  check_and_print_exception(ctx);
+  JS_FreeValue(ctx, obj);
+  return NULL;
+}
+
+static void map_job_free(MapJob *job) {
+  for (int i = 0; job->args && i < job->chunk_count; i++) {
+    free(job->args[i]);
+  }
+  for (int i = 0; job->results && i < job->chunk_count; i++) {
+    free(job->results[i].data);
+  }
+  free(job->args);
+  free(job->results);
+  free(job->input);
+  free(job->output);
+  if (job->ctx)
+    JS_FreeContext(job->ctx);
+  if (job->runtime)
+    JS_FreeRuntime(job->runtime);
+}
+
+// 准备输入数据并填写 tasks 中每段的输入输出通道，失败时释放已分配的部分
+static int map_job_init(MapJob *job, Task *tasks, int chunk_count,
+                        size_t length, int shared) {
+  memset(job, 0, sizeof(*job));
+  job->shared = shared;
+  job->length = length;
+  job->chunk_count = chunk_count;
+  job->input = malloc(length * sizeof(double));
+  job->output = calloc(length, sizeof(double));
+  job->args = calloc(chunk_count, sizeof(uint8_t *));
+  job->results = calloc(chunk_count, sizeof(TaskResult));
+  if (!job->input || !job->output || !job->args || !job->results)
+    goto fail;
+  for (size_t i = 0; i < length; i++) {
+    job->input[i] = i * 0.5;
+  }
+
+  job->runtime = JS_NewRuntime();
+  job->ctx = job->runtime ? JS_NewContext(job->runtime) : NULL;
+  if (!job->ctx)
+    goto fail;
+
+  double start = get_time_ms();
+  for (int i = 0; i < chunk_count; i++) {
+    size_t offset = map_job_chunk_start(job, i);
+    size_t count = map_job_chunk_start(job, i + 1) - offset;
+    size_t args_len = 0;
+
+    job->args[i] = map_job_write_args(job, offset, count, &args_len);
+    if (!job->args[i])
+      goto fail;
+    tasks[i].args = job->args[i];
+    tasks[i].args_len = args_len;
+
+    if (shared) {
+      tasks[i].input = job->input + offset;
+      tasks[i].input_len = count * sizeof(double);
+      tasks[i].output = job->output + offset;
+      tasks[i].output_len = count * sizeof(double);
+    } else {
+      tasks[i].result = &job->results[i];
+    }
+  }
+  job->serialize_ms = get_time_ms() - start;
+  return 0;
+
+fail:
+  map_job_free(job);
+  return -1;
+}
+
+// copy 模式下把各段结果反序列化回宿主数组，然后逐个元素校验。
+// 返回不匹配的元素个数
+static size_t map_job_collect(MapJob *job) {
+  JSContext *ctx = job->ctx;
+
+  if (!job->shared) {
+    double start = get_time_ms();
+    for (int i = 0; i < job->chunk_count; i++) {
+      TaskResult *result = &job->results[i];
+      if (!result->data)
+        continue;
+
+      JSValue val = JS_ReadObject(ctx, result->data, result->len, 0);
+      if (JS_IsException(val)) {
+        check_and_print_exception(ctx);
+        continue;
+      }
+
+      size_t byte_offset, byte_length, size;
+      JSValue buffer =
+          JS_GetTypedArrayBuffer(ctx, val, &byte_offset, &byte_length, NULL);
+      uint8_t *data = JS_IsException(buffer)
+                          ? NULL
+                          : JS_GetArrayBuffer(ctx, &size, buffer);
+      if (data) {
+        size_t offset = map_job_chunk_start(job, i);
+        size_t count = map_job_chunk_start(job, i + 1) - offset;
+        if (byte_length > count * sizeof(double))
+          byte_length = count * sizeof(double);
+        memcpy(job->output + offset, data + byte_offset, byte_length);
+      } else {
+        check_and_print_exception(ctx);
+      }
+      JS_FreeValue(ctx, buffer);
+      JS_FreeValue(ctx, val);
+    }
+    job->deserialize_ms = get_time_ms() - start;
+  }
+
+  size_t mismatches = 0;
+  for (size_t i = 0; i < job->length; i++) {
+    if (job->output[i] != map_job_expected(job->input[i]))
+      mismatches++;
+  }
+  return mismatches;
+}
+
+// 并行归约：宿主把只读大表放进共享区域 table，所有任务直接扫描
+// 各自的一段，部分和写入 partials[chunk]，state[0] 为已完成的段数
+typedef struct {
+  size_t length; // table 中的 double 个数
+  int chunk_count;
+  double *table;
+  double *partials;
+  int32_t *state;
+  uint8_t **args;
+  JSRuntime *runtime; // 提交方用于等待结果的运行时
+  JSContext *ctx;
+  double expected;
+  double fill_ms;
+} ReduceJob;
+
+// 在提交方等待所有段完成并汇总。进度停滞 10 秒（例如有任务被丢弃）时返回 NaN
+static const char reduce_job_join_js[] =
+    "(function () {\n"
+    "  var state = new Int32Array(shared.state);\n"
+    "  var partials = new Float64Array(shared.partials);\n"
+    "  var n, idle = 0;\n"
+    "  while ((n = Atomics.load(state, 0)) < partials.length) {\n"
+    "    if (Atomics.wait(state, 0, n, 1000) !== 'timed-out') idle = 0;\n"
+    "    else if (++idle === 10) return NaN;\n"
+    "  }\n"
+    "  var sum = 0;\n"
+    "  for (var i = 0; i < partials.length; i++) sum += partials[i];\n"
+    "  return sum;\n"
+    "})()";
+
+// 共享区域本身由 shared_regions_free 释放
+static void reduce_job_free(ReduceJob *job) {
+  for (int i = 0; job->args && i < job->chunk_count; i++) {
+    free(job->args[i]);
+  }
+  free(job->args);
+  if (job->ctx)
+    JS_FreeContext(job->ctx);
+  if (job->runtime)
+    JS_FreeRuntime(job->runtime);
+}
+
+// 失败时释放已分配的部分
+static int reduce_job_init(ReduceJob *job, Task *tasks, int chunk_count,
+                           size_t bytes) {
+  memset(job, 0, sizeof(*job));
+  job->length = bytes / sizeof(double);
+  job->chunk_count = chunk_count;
+  job->table = shared_region_create("table", job->length * sizeof(double));
+  job->partials = shared_region_create("partials", chunk_count * sizeof(double));
+  job->state = shared_region_create("state", sizeof(int32_t));
+  if (!job->table || !job->partials || !job->state)
+    return -1;
+
+  // 只加载一次，所有工作线程共享同一份物理内存。
+  // 元素都是小整数，部分和的累加顺序不影响结果
+  double start = get_time_ms();
+  for (size_t i = 0; i < job->length; i++) {
+    job->table[i] = (double)(i & 1023);
+    job->expected += job->table[i];
+  }
+  job->fill_ms = get_time_ms() - start;
+
+  job->runtime = JS_NewRuntime();
+  job->ctx = job->runtime ? JS_NewContext(job->runtime) : NULL;
+  if (!job->ctx)
+    goto fail;
+  // 提交方要在 Atomics.wait 上阻塞
+  JS_SetCanBlock(job->runtime, 1);
+  shared_regions_expose(job->ctx);
+  shared_atomics_install(job->ctx, 1);
+
+  job->args = calloc(chunk_count, sizeof(uint8_t *));
+  if (!job->args)
+    goto fail;
+  for (int i = 0; i < chunk_count; i++) {
+    JSContext *ctx = job->ctx;
+    size_t offset = job->length * i / chunk_count;
+    size_t count = job->length * (i + 1) / chunk_count - offset;
+    JSValue obj = JS_NewObject(ctx);
+    if (JS_IsException(obj) ||
+        JS_SetPropertyStr(ctx, obj, "offset", JS_NewInt64(ctx, offset)) < 0 ||
+        JS_SetPropertyStr(ctx, obj, "length", JS_NewInt64(ctx, count)) < 0 ||
+        JS_SetPropertyStr(ctx, obj, "chunk", JS_NewInt32(ctx, i)) < 0 ||
+        JS_SetPropertyStr(ctx, obj, "chunks", JS_NewInt32(ctx, chunk_count)) <
+            0) {
+      check_and_print_exception(ctx);
+      JS_FreeValue(ctx, obj);
+      goto fail;
+    }
+
+    size_t args_len = 0;
+    job->args[i] = task_write_args(ctx, obj, &args_len);
+    if (!job->args[i])
+      goto fail;
+    tasks[i].args = job->args[i];
+    tasks[i].args_len = args_len;
+  }
+  return 0;
+
+fail:
+  reduce_job_free(job);
+  return -1;
+}
+
+// 阻塞在 Atomics.wait 上直到所有段完成，返回汇总结果
+static double reduce_job_join(ReduceJob *job) {
+  JSValue val =
+      JS_Eval(job->ctx, reduce_job_join_js, strlen(reduce_job_join_js),
+              "<reduce>", JS_EVAL_TYPE_GLOBAL);
+  double sum = NAN;
+  if (JS_IsException(val))
+    check_and_print_exception(job->ctx);
+  else
+    JS_ToFloat64(job->ctx, &sum, val);
+  JS_FreeValue(job->ctx, val);
+  return sum;
+}
@@ -0,0 +1,307 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+// 最多识别的 NUMA 节点数
+#define TOPOLOGY_MAX_NODES 64
+// set_mempolicy 的 MPOL_PREFERRED，避免依赖 libnuma 的头文件
+#define TOPOLOGY_MPOL_PREFERRED 1
+
+// 一个 NUMA 节点
+typedef struct {
+  int id;         // 内核中的节点编号
+  int cpu_count;
+  int *cpus;
+  // 其他节点按距离从近到远排列（下标为 Topology.nodes 的下标），用于窃取任务
+  int *steal_order;
+} NumaNode;
+
+typedef struct {
+  int node_count;
+  NumaNode *nodes;
+} Topology;
+
+// 节点上的页面分配计数，来自 /sys/devices/system/node/nodeN/numastat
+typedef struct {
+  unsigned long long local_node;
+  unsigned long long other_node;
+  unsigned long long numa_miss;
+} NumaStat;
+
+// 读取一个 sysfs 小文件，失败时返回 NULL
+static char *topology_read_sysfs(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return NULL;
+
+  char *buf = malloc(4096);
+  if (!buf) {
+    fclose(f);
+    return NULL;
+  }
+  size_t len = fread(buf, 1, 4095, f);
+  fclose(f);
+  buf[len] = '\0';
+  return buf;
+}
+
+// 解析 "0-3,8-11" 形式的 CPU 列表，内存不足时返回 -1
+static int topology_parse_cpulist(const char *list, int **out) {
+  int count = 0, capacity = 16;
+  int *cpus = malloc(capacity * sizeof(int));
+  const char *p = list;
+  *out = NULL;
+  if (!cpus)
+    return -1;
+
+  while (*p && *p != '\n') {
+    char *end;
+    long first = strtol(p, &end, 10);
+    long last = first;
+    if (end == p)
+      break;
+    if (*end == '-')
+      last = strtol(end + 1, &end, 10);
+
+    for (long cpu = first; cpu <= last; cpu++) {
+      if (count == capacity) {
+        int *grown = realloc(cpus, capacity * 2 * sizeof(int));
+        if (!grown) {
+          free(cpus);
+          return -1;
+        }
+        cpus = grown;
+        capacity *= 2;
+      }
+      cpus[count++] = (int)cpu;
+    }
+    p = *end == ',' ? end + 1 : end;
+  }
+
+  *out = cpus;
+  return count;
+}
+
+// 按 distance 文件计算从 index 节点出发的窃取顺序，内存不足时返回 -1
+static int topology_init_steal_order(Topology *t, int index) {
+  NumaNode *node = &t->nodes[index];
+  int distance[TOPOLOGY_MAX_NODES];
+  char path[128];
+
+  for (int i = 0; i < t->node_count; i++) {
+    distance[i] = i == index ? 0 : 100;
+  }
+
+  // distance 文件按节点编号列出到所有在线节点的距离，其中包括 t->nodes
+  // 中跳过的无 CPU 节点（如 CXL 内存），所以先按 online 列表换算成节点编号
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/distance",
+           node->id);
+  char *buf = topology_read_sysfs(path);
+  char *online = topology_read_sysfs("/sys/devices/system/node/online");
+  if (buf && online) {
+    int *ids;
+    int id_count = topology_parse_cpulist(online, &ids);
+    int by_id[TOPOLOGY_MAX_NODES];
+    for (int id = 0; id < TOPOLOGY_MAX_NODES; id++)
+      by_id[id] = -1;
+    char *p = buf;
+    for (int k = 0; k < id_count; k++) {
+      char *end;
+      long d = strtol(p, &end, 10);
+      if (end == p)
+        break;
+      if (ids[k] >= 0 && ids[k] < TOPOLOGY_MAX_NODES)
+        by_id[ids[k]] = (int)d;
+      p = end;
+    }
+    for (int i = 0; i < t->node_count; i++) {
+      if (i != index && by_id[t->nodes[i].id] >= 0)
+        distance[i] = by_id[t->nodes[i].id];
+    }
+    free(ids);
+  }
+  free(buf);
+  free(online);
+
+  node->steal_order = malloc(t->node_count * sizeof(int));
+  if (!node->steal_order)
+    return -1;
+  int n = 0;
+  for (int i = 0; i < t->node_count; i++) {
+    if (i != index)
+      node->steal_order[n++] = i;
+  }
+  // 节点数很少，插入排序即可
+  for (int i = 1; i < n; i++) {
+    int v = node->steal_order[i];
+    int j = i - 1;
+    while (j >= 0 && distance[node->steal_order[j]] > distance[v]) {
+      node->steal_order[j + 1] = node->steal_order[j];
+      j--;
+    }
+    node->steal_order[j + 1] = v;
+  }
+  return 0;
+}
+
+// 连单节点拓扑都分配不了时使用的静态节点，只包含 0 号 CPU
+static int topology_static_cpu = 0;
+static NumaNode topology_static_node = {0, 1, &topology_static_cpu, NULL};
+
+static void topology_free(Topology *t) {
+  if (t->nodes != &topology_static_node) {
+    for (int i = 0; i < t->node_count; i++) {
+      free(t->nodes[i].cpus);
+      free(t->nodes[i].steal_order);
+    }
+    free(t->nodes);
+  }
+  t->nodes = NULL;
+  t->node_count = 0;
+}
+
+// 包含所有在线 CPU 的单个节点。只有一个队列，不需要窃取顺序
+static void topology_init_single(Topology *t) {
+  int cpu_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  NumaNode *node = calloc(1, sizeof(NumaNode));
+  int *cpus = cpu_count > 0 ? malloc(cpu_count * sizeof(int)) : NULL;
+  t->node_count = 1;
+  if (!node || !cpus) {
+    free(node);
+    free(cpus);
+    t->nodes = &topology_static_node;
+    return;
+  }
+  for (int i = 0; i < cpu_count; i++) {
+    cpus[i] = i;
+  }
+  node->cpu_count = cpu_count;
+  node->cpus = cpus;
+  t->nodes = node;
+}
+
+// 探测 NUMA 拓扑，无法识别或内存不足时退化为包含所有 CPU 的单个节点
+static void topology_init(Topology *t) {
+  t->node_count = 0;
+  t->nodes = calloc(TOPOLOGY_MAX_NODES, sizeof(NumaNode));
+  int failed = !t->nodes;
+
+  for (int id = 0; !failed && id < TOPOLOGY_MAX_NODES; id++) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+             id);
+    char *list = topology_read_sysfs(path);
+    if (!list)
+      continue;
+
+    NumaNode *node = &t->nodes[t->node_count];
+    node->id = id;
+    node->cpu_count = topology_parse_cpulist(list, &node->cpus);
+    free(list);
+    if (node->cpu_count < 0) {
+      failed = 1;
+      break;
+    }
+
+    // 只有内存没有 CPU 的节点不参与调度
+    if (node->cpu_count == 0) {
+      free(node->cpus);
+      continue;
+    }
+    t->node_count++;
+  }
+
+  for (int i = 0; !failed && i < t->node_count; i++) {
+    failed = topology_init_steal_order(t, i) < 0;
+  }
+
+  if (failed || t->node_count == 0) {
+    topology_free(t);
+    topology_init_single(t);
+  }
+}
+
+// 第 worker 个线程所在的节点：线程按节点轮流分配
+static int topology_worker_node(const Topology *t, int worker) {
+  return worker % t->node_count;
+}
+
+// 第 worker 个线程绑定的 CPU
+static int topology_worker_cpu(const Topology *t, int worker) {
+  const NumaNode *node = &t->nodes[topology_worker_node(t, worker)];
+  return node->cpus[(worker / t->node_count) % node->cpu_count];
+}
+
+// 把当前线程绑定到 cpu，不支持时返回 -1
+static int topology_pin_thread(int cpu) {
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? 0
+                                                                         : -1;
+#else
+  (void)cpu;
+  return -1;
+#endif
+}
+
+// 让当前线程之后的内存分配优先落在 node_id 节点上。
+// 内存策略是线程级的，需要在创建 JSRuntime 之前调用
+static int topology_bind_memory(int node_id) {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+  unsigned long mask[TOPOLOGY_MAX_NODES / (8 * sizeof(unsigned long)) + 1];
+  memset(mask, 0, sizeof(mask));
+  mask[node_id / (8 * sizeof(unsigned long))] |=
+      1UL << (node_id % (8 * sizeof(unsigned long)));
+  return syscall(SYS_set_mempolicy, TOPOLOGY_MPOL_PREFERRED, mask,
+                 sizeof(mask) * 8) == 0
+             ? 0
+             : -1;
+#else
+  (void)node_id;
+  return -1;
+#endif
+}
+
+// 累加所有节点的 numastat，读取失败时返回 -1
+static int topology_read_numastat(const Topology *t, NumaStat *stat) {
+  memset(stat, 0, sizeof(*stat));
+  int found = 0;
+
+  for (int i = 0; i < t->node_count; i++) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/numastat",
+             t->nodes[i].id);
+    char *buf = topology_read_sysfs(path);
+    if (!buf)
+      continue;
+
+    char *line = buf;
+    while (line && *line) {
+      char name[32];
+      unsigned long long value;
+      if (sscanf(line, "%31s %llu", name, &value) == 2) {
+        if (strcmp(name, "local_node") == 0)
+          stat->local_node += value;
+        else if (strcmp(name, "other_node") == 0)
+          stat->other_node += value;
+        else if (strcmp(name, "numa_miss") == 0)
+          stat->numa_miss += value;
+      }
+      line = strchr(line, '\n');
+      if (line)
+        line++;
+    }
+    free(buf);
+    found = 1;
+  }
+
+  return found ? 0 : -1;
+}
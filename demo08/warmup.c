@@ -0,0 +1,283 @@
+#include "../helpers/clock.c"
+#include "../quickjs/quickjs.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * 预热：为热点脚本提前准备好"就绪上下文"——已创建并挂好 console、
+ * 共享区域，脚本函数也已读入（解析或从字节码还原）的 JSContext。
+ * 任务到来时直接执行，请求路径上不再创建上下文和解析源码。
+ *
+ * 热点脚本来自清单文件（--warmup），或在运行中执行次数达到阈值
+ * （--warmup-auto）。清单中的脚本在工作线程启动时准备，之后每次
+ * 线程空闲时补足被取走的上下文。执行次数可以写回清单（--warmup-save），
+ * 下次启动直接使用。
+ *
+ * 上下文执行过脚本后全局对象已被修改，不能复用，用完即释放。
+ */
+
+// 最多跟踪的脚本数
+#define WARM_SCRIPT_MAX 64
+// 每个脚本在每个工作线程上最多保持的就绪上下文数
+#define WARM_POOL_MAX 8
+// 空闲时每次补充的时间预算（毫秒），超出后先回去检查队列
+#define WARM_IDLE_BUDGET_MS 2.0
+
+typedef struct {
+  char *filename;
+  int contexts;        // 每个工作线程保持的就绪上下文数
+  atomic_int hits;     // 执行次数
+  atomic_int hot;      // 为 1 时工作线程为它准备就绪上下文
+} WarmScript;
+
+// 登记表只追加：条目先填好再递增计数，读者无需加锁
+static WarmScript warm_scripts[WARM_SCRIPT_MAX];
+static atomic_int warm_script_count = 0;
+static pthread_mutex_t warm_mutex = PTHREAD_MUTEX_INITIALIZER;
+// 为 0 时不统计执行次数也不准备上下文
+static int warm_enabled = 0;
+// 执行次数达到该值的脚本自动成为热点，0 表示只使用清单
+static int warm_hot_threshold = 0;
+
+// 一个就绪上下文
+typedef struct {
+  JSContext *ctx;
+  JSValue func; // 已读入 ctx 的脚本函数
+  int regions;  // 准备时已注册的共享区域数
+} WarmContext;
+
+// 每个工作线程的就绪上下文池，按脚本在登记表中的下标分组，只由所属线程访问
+typedef struct {
+  JSRuntime *runtime;
+  int shared_bytecode;
+  WarmContext ready[WARM_SCRIPT_MAX][WARM_POOL_MAX];
+  int ready_count[WARM_SCRIPT_MAX];
+
+  int hits;   // 在就绪上下文中执行的任务数
+  int misses; // 没有就绪上下文、走普通路径的任务数
+  int prepared;
+  double prepare_ms;
+} WarmPool;
+
+// 查找脚本，create 为 1 时不存在则登记。登记表已满时返回 NULL
+static WarmScript *warm_script_find(const char *filename, int create) {
+  int count = atomic_load(&warm_script_count);
+  for (int i = 0; i < count; i++) {
+    if (strcmp(warm_scripts[i].filename, filename) == 0)
+      return &warm_scripts[i];
+  }
+  if (!create)
+    return NULL;
+
+  pthread_mutex_lock(&warm_mutex);
+  // 加锁后重新检查，其他线程可能刚登记了同一个脚本
+  WarmScript *script = NULL;
+  count = atomic_load(&warm_script_count);
+  for (int i = 0; i < count && !script; i++) {
+    if (strcmp(warm_scripts[i].filename, filename) == 0)
+      script = &warm_scripts[i];
+  }
+  if (!script && count < WARM_SCRIPT_MAX) {
+    script = &warm_scripts[count];
+    script->filename = strdup(filename);
+    script->contexts = 1;
+    atomic_init(&script->hits, 0);
+    atomic_init(&script->hot, 0);
+    atomic_store(&warm_script_count, count + 1);
+  }
+  pthread_mutex_unlock(&warm_mutex);
+  return script;
+}
+
+// 读取清单：每行 "<脚本> [就绪上下文数]"，# 之后为注释。
+// 返回登记的热点脚本数，读取失败时返回 -1
+static int warm_load_manifest(const char *path) {
+  char *content = read_file_to_string(path);
+  if (!content) {
+    fprintf(stderr, "Failed to read warm-up manifest: %s\n", path);
+    return -1;
+  }
+
+  int loaded = 0;
+  char *save = NULL;
+  for (char *line = strtok_r(content, "\n", &save); line;
+       line = strtok_r(NULL, "\n", &save)) {
+    char *comment = strchr(line, '#');
+    if (comment)
+      *comment = '\0';
+
+    char name[512];
+    int contexts = 1;
+    if (sscanf(line, "%511s %d", name, &contexts) < 1)
+      continue;
+
+    WarmScript *script = warm_script_find(name, 1);
+    if (!script) {
+      fprintf(stderr, "Warm-up manifest has more than %d scripts, ignoring "
+                      "the rest\n",
+              WARM_SCRIPT_MAX);
+      break;
+    }
+    script->contexts = contexts < 1               ? 1
+                       : contexts > WARM_POOL_MAX ? WARM_POOL_MAX
+                                                  : contexts;
+    atomic_store(&script->hot, 1);
+    loaded++;
+  }
+
+  free(content);
+  warm_enabled = 1;
+  return loaded;
+}
+
+static int warm_compare_hits(const void *a, const void *b) {
+  int x = atomic_load(&(*(WarmScript *const *)a)->hits);
+  int y = atomic_load(&(*(WarmScript *const *)b)->hits);
+  return y - x;
+}
+
+// 把执行次数写成清单，按次数从多到少排列。
+// 设置了自动阈值时只写入达到阈值的脚本
+static int warm_save_manifest(const char *path) {
+  int count = atomic_load(&warm_script_count);
+  WarmScript *sorted[WARM_SCRIPT_MAX];
+  for (int i = 0; i < count; i++) {
+    sorted[i] = &warm_scripts[i];
+  }
+  qsort(sorted, count, sizeof(WarmScript *), warm_compare_hits);
+
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    fprintf(stderr, "Failed to write warm-up manifest: %s\n", path);
+    return -1;
+  }
+  for (int i = 0; i < count; i++) {
+    int hits = atomic_load(&sorted[i]->hits);
+    if (hits == 0 || hits < warm_hot_threshold)
+      continue;
+    fprintf(f, "%s %d # %d hits\n", sorted[i]->filename, sorted[i]->contexts,
+            hits);
+  }
+  fclose(f);
+  return 0;
+}
+
+// 记录一次执行，次数达到阈值时把脚本标记为热点
+static void warm_script_hit(const char *filename) {
+  if (!warm_enabled)
+    return;
+  WarmScript *script = warm_script_find(filename, 1);
+  if (!script)
+    return;
+  int hits = atomic_fetch_add(&script->hits, 1) + 1;
+  if (warm_hot_threshold > 0 && hits == warm_hot_threshold)
+    atomic_store(&script->hot, 1);
+}
+
+static void warm_scripts_free(void) {
+  int count = atomic_load(&warm_script_count);
+  for (int i = 0; i < count; i++) {
+    free(warm_scripts[i].filename);
+  }
+  atomic_store(&warm_script_count, 0);
+}
+
+static void warm_pool_init(WarmPool *pool, JSRuntime *runtime,
+                           int shared_bytecode) {
+  memset(pool, 0, sizeof(*pool));
+  pool->runtime = runtime;
+  pool->shared_bytecode = shared_bytecode;
+}
+
+static void warm_context_free(WarmContext *w) {
+  JS_FreeValue(w->ctx, w->func);
+  JS_FreeContext(w->ctx);
+}
+
+// 为第 index 个脚本准备一个就绪上下文
+static int warm_pool_prepare(WarmPool *pool, int index) {
+  WarmScript *script = &warm_scripts[index];
+
+  // 只读入（编译或从字节码还原）脚本，不执行顶层代码：脚本可能依赖任务
+  // 参数，或通过共享区域和 Atomics 产生副作用，提前执行会影响真实任务
+  // 先记下区域数再创建上下文：之后新注册的区域会让取出时的比较失败
+  int regions = shared_region_count;
+  JSContext *ctx = task_new_context(pool->runtime);
+  if (!ctx)
+    return -1;
+  JSValue func = load_file_function(ctx, script->filename,
+                                    pool->shared_bytecode);
+  if (JS_IsException(func)) {
+    // 无法编译的脚本不再预热，任务照常走普通路径并报告错误
+    JS_FreeValue(ctx, JS_GetException(ctx));
+    JS_FreeContext(ctx);
+    atomic_store(&script->hot, 0);
+    return -1;
+  }
+
+  WarmContext *w = &pool->ready[index][pool->ready_count[index]++];
+  w->ctx = ctx;
+  w->func = func;
+  w->regions = regions;
+  pool->prepared++;
+  return 0;
+}
+
+// 为所有热点脚本补足就绪上下文。budget_ms > 0 时超出预算即返回，
+// 剩下的留到下次空闲；返回 1 表示还没有补足
+static int warm_pool_fill(WarmPool *pool, double budget_ms) {
+  double start = get_time_ms();
+  int count = atomic_load(&warm_script_count);
+  int pending = 0;
+
+  for (int i = 0; i < count && !pending; i++) {
+    WarmScript *script = &warm_scripts[i];
+    while (atomic_load(&script->hot) &&
+           pool->ready_count[i] < script->contexts) {
+      if (budget_ms > 0 && get_time_ms() - start >= budget_ms) {
+        pending = 1;
+        break;
+      }
+      if (warm_pool_prepare(pool, i) < 0)
+        break;
+    }
+  }
+
+  pool->prepare_ms += get_time_ms() - start;
+  return pending;
+}
+
+// 取出 filename 的一个就绪上下文，没有时返回 0。
+// 取出的上下文和函数归调用方所有，用 warm_context_free 释放
+static int warm_pool_take(WarmPool *pool, const char *filename,
+                          WarmContext *out) {
+  int count = atomic_load(&warm_script_count);
+  for (int i = 0; i < count; i++) {
+    if (strcmp(warm_scripts[i].filename, filename) != 0)
+      continue;
+    while (pool->ready_count[i] > 0) {
+      WarmContext *w = &pool->ready[i][--pool->ready_count[i]];
+      if (w->regions == shared_region_count) {
+        *out = *w;
+        pool->hits++;
+        return 1;
+      }
+      // 准备之后宿主又注册了共享区域，这个上下文缺少对应的全局对象
+      warm_context_free(w);
+    }
+    break;
+  }
+  pool->misses++;
+  return 0;
+}
+
+static void warm_pool_free(WarmPool *pool) {
+  for (int i = 0; i < WARM_SCRIPT_MAX; i++) {
+    while (pool->ready_count[i] > 0) {
+      warm_context_free(&pool->ready[i][--pool->ready_count[i]]);
+    }
+  }
+}
@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <uv.h>
 
+#include "../helpers/metrics.c"
+#include "../helpers/trace.c"
 #include "../quickjs/quickjs.h"
 
 // 定时器结构体，用于跟踪定时器
@@ -10,6 +12,7 @@ typedef struct {
   JSContext *ctx;
   JSValue callback;
   int timer_id;
+  uint64_t due_ns; // 预定触发时间，用于追踪定时器延迟
 } timer_data_t;
 
 // 全局变量
@@ -18,12 +21,42 @@ static int next_timer_id = 1;
 static int active_timers = 0;
 static uv_timer_t microtask_timer; // 用于执行微任务的定时器
 
+// 事件循环的指标 id，由 init_loop_metrics 登记，未登记时不记录
+static struct {
+  int timers_active;
+  int timers_fired;
+  int callback_seconds;
+  int jobs;
+  MetricsHeap heap;
+} loop_metrics = {-1, -1, -1, -1, {-1, -1, -1, 0}};
+// 导出指标时才采集 JS 堆统计，JS_ComputeMemoryUsage 需要遍历整个堆
+static int metrics_exporting = 0;
+
+// 定时器回调耗时的桶（秒）
+static const double callback_seconds_buckets[] = {
+    0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1};
+
 void init_loop() {
   loop = uv_default_loop();
   // 初始化微任务定时器
   uv_timer_init(loop, &microtask_timer);
 }
 
+void init_loop_metrics() {
+  loop_metrics.timers_active = metrics_gauge(
+      "quickjs_timers_in_flight", "Timers scheduled and not yet closed", NULL);
+  loop_metrics.timers_fired =
+      metrics_counter("quickjs_timers_fired_total", "Timer callbacks run", NULL);
+  loop_metrics.callback_seconds = metrics_histogram(
+      "quickjs_timer_callback_seconds",
+      "Time spent in a timer callback, including the microtasks it queued",
+      NULL, callback_seconds_buckets,
+      sizeof(callback_seconds_buckets) / sizeof(callback_seconds_buckets[0]));
+  loop_metrics.jobs = metrics_counter("quickjs_jobs_total",
+                                      "Promise jobs executed", NULL);
+  metrics_heap_register(&loop_metrics.heap);
+}
+
 // 执行 QuickJS 的微任务队列
 void execute_microtask_timer(JSContext *ctx) {
   // JSContext *ctx = (JSContext *)handle->data;
@@ -31,9 +64,17 @@ void execute_microtask_timer(JSContext *ctx) {
 
   // 执行所有待处理的任务
   int hasPending;
+  int jobs = 0;
+  uint64_t trace_start = trace_begin();
   do {
     hasPending = JS_ExecutePendingJob(rt, &ctx);
+    if (hasPending > 0) {
+      metrics_inc(loop_metrics.jobs);
+      jobs++;
+    }
   } while (hasPending > 0);
+  if (jobs > 0)
+    trace_end_id("loop", "microtasks", trace_start, jobs, NULL);
 
   // 如果没有更多待处理任务，停止定时器
   // uv_timer_stop(handle);
@@ -57,6 +98,7 @@ void close_timer_callback(uv_handle_t *handle) {
 
   // 减少活跃定时器计数
   active_timers--;
+  metrics_gauge_add(loop_metrics.timers_active, -1);
 }
 
 // 定时器回调函数
@@ -64,6 +106,11 @@ void timer_callback(uv_timer_t *handle) {
   timer_data_t *timer_data = (timer_data_t *)handle->data;
   JSContext *ctx = timer_data->ctx;
   JSValue ret;
+  double start = get_time_ms();
+  uint64_t trace_start = trace_begin();
+  // 从预定时间到实际触发的延迟
+  trace_async("loop", "timer latency", timer_data->due_ns, trace_start,
+              timer_data->timer_id, NULL);
 
   // 调用JS回调函数
   ret = JS_Call(ctx, timer_data->callback, JS_UNDEFINED, 0, NULL);
@@ -82,6 +129,13 @@ void timer_callback(uv_timer_t *handle) {
 
   // 启动微任务定时器，处理可能产生的微任务
   execute_microtask_timer(ctx);
+
+  trace_end_id("loop", "timer", trace_start, timer_data->timer_id, NULL);
+  metrics_inc(loop_metrics.timers_fired);
+  metrics_observe(loop_metrics.callback_seconds,
+                  (get_time_ms() - start) / 1000);
+  if (metrics_exporting)
+    metrics_heap_record(&loop_metrics.heap, JS_GetRuntime(ctx), 0);
 }
 
 // setTimeout 实现
@@ -108,10 +162,12 @@ static JSValue js_setTimeout(JSContext *ctx, JSValueConst this_val, int argc,
   timer_data->callback = JS_DupValue(ctx, argv[0]);
   timer_data->timer_id = next_timer_id++;
   timer_data->timer.data = timer_data;
+  timer_data->due_ns = trace_enabled ? trace_now_ns() + delay * 1000000ull : 0;
 
   // 启动定时器
   uv_timer_start(&timer_data->timer, timer_callback, delay, 0);
   active_timers++;
+  metrics_gauge_add(loop_metrics.timers_active, 1);
 
   return JS_NewInt32(ctx, timer_data->timer_id);
 }
@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <uv.h>
+
+#include "../helpers/fs.c"
+#include "../helpers/trace.c"
+#include "../quickjs/quickjs.h"
+
+// fs/promises：与 fs 模块相同的函数，返回 Promise。系统调用在 libuv 的
+// 线程池上执行（默认 4 个线程，UV_THREADPOOL_SIZE 可调），完成后回到
+// 事件循环线程 resolve/reject 并执行微任务。readFile 在线程池上预先读入
+// 所有页，事件循环线程访问时不会再因缺页阻塞在磁盘上。
+// read/write/writeFile 经过宿主缓冲区（fs_request_bounce），请求期间脚本
+// 转移或缩小传入的缓冲区不会让系统调用写到已释放的内存，read 的结果在
+// 完成时复制回去，缓冲区已经放不下时以 TypeError 拒绝。
+//
+// --io uring 时除 readFile 以外的请求改由 io_uring 执行（见 uring.c），
+// registerBuffer(buf) 把缓冲区注册到内核，之后落在其中的 read/write
+// 使用 READ_FIXED/WRITE_FIXED，省去每次映射用户内存。libuv 后端上
+// registerBuffer 返回 false。
+
+typedef struct {
+  uv_work_t work;
+  JSContext *ctx;
+  JSValue resolving_funcs[2];
+  FsRequest request;
+  int id;
+  uint64_t queued_ns; // 入队时间，用于追踪
+} FsWork;
+
+static int next_fs_id = 1;
+
+// 由 --io uring 开启，见 uring.c
+static int io_uring_enabled = 0;
+// 接管 resolving_funcs 和 request（按值复制）
+static void uring_submit_fs(JSContext *ctx, JSValue resolving_funcs[2],
+                            FsRequest *request);
+// registerBuffer/unregisterBuffer，magic 为 1 时注册
+static JSValue js_uring_register_buffer(JSContext *ctx, JSValueConst this_val,
+                                        int argc, JSValueConst *argv,
+                                        int magic);
+
+static const char *const fs_op_names[] = {
+    "readFile", "writeFile", "open", "close", "read", "write", "stat",
+};
+
+// 线程池上执行，不访问 JS 对象
+static void fs_work_run(uv_work_t *req) {
+  FsWork *w = (FsWork *)req->data;
+  fs_request_run(&w->request);
+}
+
+// 用 value 兑现 Promise，value 为 JS_EXCEPTION 时用当前的异常拒绝。
+// 不执行微任务，由事件循环的回调在处理完一批完成事件后统一执行
+static void io_settle(JSContext *ctx, JSValue resolving_funcs[2],
+                      JSValue value) {
+  int ok = !JS_IsException(value);
+  if (!ok)
+    value = JS_GetException(ctx);
+  JSValue ret =
+      JS_Call(ctx, resolving_funcs[ok ? 0 : 1], JS_UNDEFINED, 1, &value);
+  JS_FreeValue(ctx, ret);
+  JS_FreeValue(ctx, value);
+  JS_FreeValue(ctx, resolving_funcs[0]);
+  JS_FreeValue(ctx, resolving_funcs[1]);
+}
+
+// 事件循环线程上执行
+static void fs_work_done(uv_work_t *req, int status) {
+  FsWork *w = (FsWork *)req->data;
+  JSContext *ctx = w->ctx;
+  uint64_t trace_start = trace_begin();
+  trace_async("fs", fs_op_names[w->request.op], w->queued_ns, trace_start,
+              w->id, NULL);
+
+  JSValue value = status < 0 ? JS_ThrowInternalError(ctx, "%s cancelled",
+                                                     fs_op_names[w->request.op])
+                             : fs_request_result(ctx, &w->request);
+  int id = w->id;
+  fs_request_free(ctx, &w->request);
+  // value 持有结果，可以先释放请求
+  io_settle(ctx, w->resolving_funcs, value);
+  free(w);
+
+  // 执行 await 之后的代码
+  execute_microtask_timer(ctx);
+  trace_end_id("loop", "fs", trace_start, id, NULL);
+}
+
+// 把解析好的请求交给线程池
+static void fs_queue_work(JSContext *ctx, FsWork *w) {
+  w->request.populate = 1;
+  w->ctx = ctx;
+  w->id = next_fs_id++;
+  w->queued_ns = trace_begin();
+  w->work.data = w;
+  uv_queue_work(loop, &w->work, fs_work_run, fs_work_done);
+}
+
+// 异步版本，magic 为 FsOp，参数错误时返回 rejected 的 Promise
+static JSValue js_fs_async(JSContext *ctx, JSValueConst this_val, int argc,
+                           JSValueConst *argv, int magic) {
+  FsWork *w = calloc(1, sizeof(FsWork));
+  if (!w)
+    return JS_ThrowOutOfMemory(ctx);
+  JSValue promise = JS_NewPromiseCapability(ctx, w->resolving_funcs);
+  if (JS_IsException(promise)) {
+    free(w);
+    return JS_EXCEPTION;
+  }
+
+  if (fs_request_parse(ctx, &w->request, magic, argc, argv) < 0) {
+    fs_request_free(ctx, &w->request);
+    io_settle(ctx, w->resolving_funcs, JS_EXCEPTION);
+    free(w);
+    return promise;
+  }
+  // io_uring 后端接管除 readFile（mmap 没有对应的操作）以外的请求
+  if (io_uring_enabled && magic != FS_READ_FILE) {
+    uring_submit_fs(ctx, w->resolving_funcs, &w->request);
+    free(w);
+    return promise;
+  }
+  if (fs_request_bounce(&w->request, NULL) < 0) {
+    fs_request_free(ctx, &w->request);
+    io_settle(ctx, w->resolving_funcs, JS_ThrowOutOfMemory(ctx));
+    free(w);
+    return promise;
+  }
+  fs_queue_work(ctx, w);
+  return promise;
+}
+
+static const JSCFunctionListEntry js_fs_async_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("readFile", 1, js_fs_async, FS_READ_FILE),
+    JS_CFUNC_MAGIC_DEF("writeFile", 2, js_fs_async, FS_WRITE_FILE),
+    JS_CFUNC_MAGIC_DEF("open", 1, js_fs_async, FS_OPEN),
+    JS_CFUNC_MAGIC_DEF("close", 1, js_fs_async, FS_CLOSE),
+    JS_CFUNC_MAGIC_DEF("read", 2, js_fs_async, FS_READ),
+    JS_CFUNC_MAGIC_DEF("write", 2, js_fs_async, FS_WRITE),
+    JS_CFUNC_MAGIC_DEF("stat", 1, js_fs_async, FS_STAT),
+    JS_CFUNC_MAGIC_DEF("registerBuffer", 1, js_uring_register_buffer, 1),
+    JS_CFUNC_MAGIC_DEF("unregisterBuffer", 1, js_uring_register_buffer, 0),
+};
+
+static int js_fs_async_init(JSContext *ctx, JSModuleDef *m) {
+  return JS_SetModuleExportList(ctx, m, js_fs_async_funcs,
+                                sizeof(js_fs_async_funcs) /
+                                    sizeof(js_fs_async_funcs[0]));
+}
+
+JSModuleDef *js_init_fs_promises_module(JSContext *ctx,
+                                        const char *module_name) {
+  JSModuleDef *m = JS_NewCModule(ctx, module_name, js_fs_async_init);
+  if (!m)
+    return NULL;
+  JS_AddModuleExportList(ctx, m, js_fs_async_funcs,
+                         sizeof(js_fs_async_funcs) /
+                             sizeof(js_fs_async_funcs[0]));
+  return m;
+}
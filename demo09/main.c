@@ -1,19 +1,29 @@
+// accept4 和 struct statx 需要
+#define _GNU_SOURCE
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 #include <uv.h>
 
 #include "../helpers/console.c"
+#include "../helpers/crypto.c"
+#include "../helpers/encoding.c"
 #include "../helpers/exception.c"
 #include "../quickjs/quickjs.h"
 #include "./cache.c"
 #include "./eventloop.c"
+#include "./fsasync.c"
+#include "./net.c"
+#include "./uring.c"
 
 void eval_script(JSContext *ctx, const char *script) {
+  uint64_t trace_start = trace_begin();
   JSValue result =
       JS_Eval(ctx, script, strlen(script), "<input>", JS_EVAL_TYPE_MODULE);
+  trace_end("js", "eval", trace_start);
   if (JS_IsException(result)) {
     check_and_print_exception(ctx);
   }
@@ -23,17 +33,80 @@ void eval_script(JSContext *ctx, const char *script) {
   execute_microtask_timer(ctx);
 }
 
+static void print_usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [--metrics-file PATH] [--metrics-socket PATH] "
+          "[--trace PATH] [--io uv|uring] <js_file1> [<js_file2> ...]\n"
+          "  --metrics-file PATH rewrites Prometheus metrics to PATH every "
+          "second\n"
+          "  --metrics-socket PATH serves Prometheus metrics on a Unix "
+          "socket\n"
+          "  --trace PATH writes a Chrome trace of evals, timers and "
+          "microtask drains to PATH\n"
+          "  --io uring runs fs/promises and net on io_uring instead of "
+          "the libuv threadpool and epoll\n",
+          prog);
+}
+
 int main(int argc, char **argv) {
-  if (argc < 2) {
-    fprintf(stderr, "Usage: %s <js_file1> [<js_file2> ...]\n", argv[0]);
+  const char *metrics_file = NULL;
+  const char *metrics_socket = NULL;
+  const char *trace_path = NULL;
+  const char *io_backend = "uv";
+
+  int argi = 1;
+  while (argi < argc && strncmp(argv[argi], "--", 2) == 0) {
+    if (strcmp(argv[argi], "--metrics-file") == 0 && argi + 1 < argc) {
+      metrics_file = argv[argi + 1];
+      argi += 2;
+    } else if (strcmp(argv[argi], "--metrics-socket") == 0 &&
+               argi + 1 < argc) {
+      metrics_socket = argv[argi + 1];
+      argi += 2;
+    } else if (strcmp(argv[argi], "--trace") == 0 && argi + 1 < argc) {
+      trace_path = argv[argi + 1];
+      argi += 2;
+    } else if (strcmp(argv[argi], "--io") == 0 && argi + 1 < argc &&
+               (strcmp(argv[argi + 1], "uv") == 0 ||
+                strcmp(argv[argi + 1], "uring") == 0)) {
+      io_backend = argv[argi + 1];
+      argi += 2;
+    } else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+  if (argi >= argc) {
+    print_usage(argv[0]);
     return 1;
   }
 
   // 初始化 libuv 事件循环
   init_loop();
+  if (strcmp(io_backend, "uring") == 0) {
+    int err = uring_init();
+    if (err < 0) {
+      fprintf(stderr, "io_uring unavailable: %s\n", strerror(-err));
+      return 1;
+    }
+  }
+
+  // 事件循环只在主线程上运行，记录写入主线程的分片
+  init_loop_metrics();
+  metrics_thread_attach();
+  if (trace_path) {
+    trace_init(TRACE_DEFAULT_EVENTS);
+    trace_thread_attach("event loop");
+  }
+  MetricsExporter exporter;
+  metrics_exporting = metrics_file || metrics_socket;
+  if (metrics_exporting &&
+      metrics_exporter_start(&exporter, metrics_file, metrics_socket, 1000) <
+          0)
+    return 1;
 
   // JS文件数量
-  int num_files = argc - 1;
+  int num_files = argc - argi;
 
   clock_t start, end;
   start = clock();
@@ -45,13 +118,18 @@ int main(int argc, char **argv) {
   char *codes = (char *)calloc(num_files, sizeof(char *));
   for (int i = 0; i < num_files; i++) {
     size_t length = 0;
-    const char *filename = argv[i + 1];
+    const char *filename = argv[argi + i];
     char *js_code = get_file_content(filename, &length);
 
     ctxs[i] = JS_NewContext(rt);
     codes[i] = *js_code;
 
     js_std_init_console(ctxs[i]);
+    js_std_init_encoding(ctxs[i]);
+    js_init_crypto_module(ctxs[i], "crypto");
+    js_init_fs_module(ctxs[i], "fs");
+    js_init_fs_promises_module(ctxs[i], "fs/promises");
+    js_init_net_module(ctxs[i], "net");
     js_std_init_timeout(ctxs[i]);
 
     eval_script(ctxs[i], js_code);
@@ -59,8 +137,17 @@ int main(int argc, char **argv) {
 
   uv_run(loop, UV_RUN_DEFAULT);
 
+  // 事件循环结束时的堆大小作为最后一次快照
+  if (metrics_exporting) {
+    metrics_heap_record(&loop_metrics.heap, rt, 1);
+    metrics_exporter_stop(&exporter);
+    if (metrics_file)
+      printf("Metrics written to %s\n", metrics_file);
+  }
+
   // cleanup:
-  // 清理并释放资源
+  // 清理并释放资源，注册的缓冲区引用着 JS 对象，先放开
+  uring_cleanup();
   for (int i = 0; i < num_files; i++) {
     JS_FreeContext(ctxs[i]);
   }
@@ -70,6 +157,18 @@ int main(int argc, char **argv) {
   free(ctxs);
   uv_loop_close(loop);
   JS_FreeRuntime(rt);
+  metrics_free();
+
+  if (trace_path) {
+    long dropped;
+    long events = trace_write_json(trace_path, &dropped);
+    if (events < 0)
+      fprintf(stderr, "Failed to write trace to %s\n", trace_path);
+    else
+      printf("Trace written to %s (%ld events, %ld overwritten)\n",
+             trace_path, events, dropped);
+    trace_free();
+  }
 
   end = clock();
   printf("Total execution time: %.6f seconds.\n",
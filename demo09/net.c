@@ -0,0 +1,465 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <uv.h>
+
+#include "../helpers/encoding.c"
+#include "../quickjs/quickjs.h"
+
+/*
+ * net：TCP（IPv4）套接字，数据同 fs 一样直接读写 ArrayBuffer：
+ *
+ *   import * as net from "net";
+ *   const server = net.listen(8080);               // 同步，返回 fd
+ *   const fd = await net.accept(server);
+ *   const buf = new Uint8Array(4096);
+ *   const n = await net.recv(fd, buf);             // 0 表示对端关闭
+ *   await net.send(fd, buf, 0, n);                 // 返回实际发送的字节数
+ *   await net.close(fd);
+ *   const client = await net.connect(8080, "127.0.0.1");
+ *
+ * 默认按 epoll 的方式工作：先以非阻塞方式尝试系统调用，EAGAIN 时用
+ * uv_poll_t 等待 fd 可读/可写后重试。同一个 fd 同时只能有一个读
+ * （accept/recv）和一个写（connect/send），多出的请求以 EBUSY 拒绝。
+ * --io uring 时请求交给 uring.c，由内核完成整个操作。
+ *
+ * 需要等待的 send/recv 和 fs/promises 一样改用宿主内存
+ * （net_request_bounce），recv 的数据在完成时复制回缓冲区。
+ */
+
+typedef enum {
+  NET_ACCEPT,
+  NET_CONNECT,
+  NET_SEND,
+  NET_RECV,
+  NET_CLOSE,
+} NetOp;
+
+typedef struct {
+  NetOp op;
+  int fd;
+  struct sockaddr_in addr; // connect 的地址
+  uint8_t *data;           // send/recv 的缓冲区
+  size_t size;
+  JSValue hold;        // 在请求完成之前保持缓冲区存活
+  int64_t hold_offset; // data 在 hold 中的起始位置
+  uint8_t *bounce;     // net_request_bounce 分配的宿主缓冲区
+
+  // 执行结果
+  int err; // errno，0 表示成功
+  const char *syscall;
+  int64_t result;
+} NetRequest;
+
+static const char *const net_op_names[] = {
+    "accept", "connect", "send", "recv", "close",
+};
+
+// 接管 resolving_funcs 和 request（按值复制）
+static void uring_submit_net(JSContext *ctx, JSValue resolving_funcs[2],
+                             NetRequest *request);
+
+// 等待中的请求
+typedef struct {
+  JSContext *ctx;
+  JSValue resolving_funcs[2];
+  NetRequest request;
+  int started; // connect 已经发出，等待完成
+} NetPending;
+
+// 每个 fd 一个 poll 句柄，按 fd 索引
+typedef struct {
+  uv_poll_t poll;
+  int fd;
+  NetPending *reader; // accept/recv
+  NetPending *writer; // connect/send
+} NetWatch;
+
+static NetWatch **net_watches;
+static int net_watches_cap;
+
+static int net_socket_flags(void) {
+  // io_uring 自己等待就绪，用阻塞的套接字
+  return SOCK_CLOEXEC | (io_uring_enabled ? 0 : SOCK_NONBLOCK);
+}
+
+static int net_set_nodelay(int fd) {
+  int one = 1;
+  return setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+static int net_parse_addr(JSContext *ctx, struct sockaddr_in *addr, int argc,
+                          JSValueConst *argv) {
+  int32_t port;
+  if (JS_ToInt32(ctx, &port, argv[0]))
+    return -1;
+  if (port < 0 || port > 65535) {
+    JS_ThrowRangeError(ctx, "invalid port %d", port);
+    return -1;
+  }
+  memset(addr, 0, sizeof(*addr));
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(port);
+  if (argc < 2 || JS_IsUndefined(argv[1])) {
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return 0;
+  }
+  const char *host = JS_ToCString(ctx, argv[1]);
+  if (!host)
+    return -1;
+  int ok = inet_pton(AF_INET, host, &addr->sin_addr);
+  if (!ok)
+    JS_ThrowTypeError(ctx, "invalid IPv4 address: %s", host);
+  JS_FreeCString(ctx, host);
+  return ok ? 0 : -1;
+}
+
+static JSValue net_throw_errno(JSContext *ctx, int err, const char *syscall) {
+  JSValue error = JS_NewError(ctx);
+  char message[128];
+  snprintf(message, sizeof(message), "%s: %s", syscall, strerror(err));
+  JS_SetPropertyStr(ctx, error, "message", JS_NewString(ctx, message));
+  JS_SetPropertyStr(ctx, error, "errno", JS_NewInt32(ctx, err));
+  return JS_Throw(ctx, error);
+}
+
+// listen(port, host = "127.0.0.1", backlog = 511)，同步，返回 fd
+static JSValue js_net_listen(JSContext *ctx, JSValueConst this_val, int argc,
+                             JSValueConst *argv) {
+  struct sockaddr_in addr;
+  int32_t backlog = 511;
+  if (net_parse_addr(ctx, &addr, argc, argv) < 0 ||
+      (argc > 2 && JS_ToInt32(ctx, &backlog, argv[2])))
+    return JS_EXCEPTION;
+  int fd = socket(AF_INET, SOCK_STREAM | net_socket_flags(), 0);
+  if (fd < 0)
+    return net_throw_errno(ctx, errno, "socket");
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(fd, backlog) < 0) {
+    int err = errno;
+    close(fd);
+    return net_throw_errno(ctx, err, "listen");
+  }
+  return JS_NewInt32(ctx, fd);
+}
+
+// localPort(fd)，listen(0) 之后取得系统分配的端口
+static JSValue js_net_local_port(JSContext *ctx, JSValueConst this_val,
+                                 int argc, JSValueConst *argv) {
+  int32_t fd;
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  if (JS_ToInt32(ctx, &fd, argv[0]))
+    return JS_EXCEPTION;
+  if (getsockname(fd, (struct sockaddr *)&addr, &len) < 0)
+    return net_throw_errno(ctx, errno, "getsockname");
+  return JS_NewInt32(ctx, ntohs(addr.sin_port));
+}
+
+// 在 JS 线程上解析参数，失败时抛出异常并返回 -1
+static int net_request_parse(JSContext *ctx, NetRequest *r, NetOp op,
+                             int argc, JSValueConst *argv) {
+  memset(r, 0, sizeof(*r));
+  r->op = op;
+  r->fd = -1;
+  r->hold = JS_UNDEFINED;
+
+  if (op == NET_CONNECT) {
+    if (net_parse_addr(ctx, &r->addr, argc, argv) < 0)
+      return -1;
+    r->fd = socket(AF_INET, SOCK_STREAM | net_socket_flags(), 0);
+    if (r->fd < 0) {
+      net_throw_errno(ctx, errno, "socket");
+      return -1;
+    }
+    net_set_nodelay(r->fd);
+    return 0;
+  }
+  if (JS_ToInt32(ctx, &r->fd, argv[0]))
+    return -1;
+  if (op != NET_SEND && op != NET_RECV)
+    return 0;
+
+  // (fd, buffer, offset, length)，先转换整数参数再取缓冲区，同 fs_parse_io
+  int64_t offset, length;
+  size_t size;
+  if (fs_get_int64(ctx, &offset, argc, argv, 2, 0) ||
+      fs_get_int64(ctx, &length, argc, argv, 3, -1))
+    return -1;
+  uint8_t *data = js_encoding_get_bytes(ctx, argv[1], &size);
+  if (!data)
+    return -1;
+  if (length < 0)
+    length = offset <= (int64_t)size ? (int64_t)size - offset : 0;
+  if (offset > (int64_t)size || length > (int64_t)size - offset) {
+    JS_ThrowRangeError(ctx, "offset and length exceed the buffer");
+    return -1;
+  }
+  r->data = data + offset;
+  r->size = length;
+  r->hold = JS_DupValue(ctx, argv[1]);
+  r->hold_offset = offset;
+  return 0;
+}
+
+// 请求要等待时 JS 会继续运行，send 的数据复制一份，recv 读到新分配的
+// 内存，完成时由 net_request_result 复制回去。失败时返回 -1
+static int net_request_bounce(NetRequest *r) {
+  if ((r->op != NET_SEND && r->op != NET_RECV) || r->bounce)
+    return 0;
+  r->bounce = malloc(r->size ? r->size : 1);
+  if (!r->bounce)
+    return -1;
+  if (r->op == NET_SEND)
+    memcpy(r->bounce, r->data, r->size);
+  r->data = r->bounce;
+  return 0;
+}
+
+static JSValue net_request_result(JSContext *ctx, NetRequest *r) {
+  if (r->err)
+    return net_throw_errno(ctx, r->err, r->syscall);
+  if (r->op == NET_CLOSE)
+    return JS_UNDEFINED;
+  if (r->op == NET_RECV && r->bounce &&
+      fs_copy_to_hold(ctx, r->hold, r->hold_offset, r->bounce, r->result) < 0)
+    return JS_EXCEPTION;
+  return JS_NewInt64(ctx, r->result);
+}
+
+static void net_request_free(JSContext *ctx, NetRequest *r) {
+  free(r->bounce);
+  JS_FreeValue(ctx, r->hold);
+}
+
+// 非阻塞地尝试一次，返回 0 表示已完成，-1 表示需要等待就绪
+static int net_try(NetPending *p) {
+  NetRequest *r = &p->request;
+  ssize_t n;
+  r->syscall = net_op_names[r->op];
+  switch (r->op) {
+  case NET_ACCEPT:
+    n = accept4(r->fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (n >= 0)
+      net_set_nodelay(n);
+    break;
+  case NET_CONNECT:
+    if (!p->started) {
+      p->started = 1;
+      n = connect(r->fd, (struct sockaddr *)&r->addr, sizeof(r->addr));
+      if (n < 0 && errno == EINPROGRESS)
+        return -1;
+    } else {
+      // 可写之后从 SO_ERROR 取得连接的结果
+      int err = 0;
+      socklen_t len = sizeof(err);
+      n = getsockopt(r->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+      if (n == 0 && err) {
+        errno = err;
+        n = -1;
+      }
+    }
+    if (n == 0)
+      n = r->fd;
+    break;
+  case NET_SEND:
+    n = send(r->fd, r->data, r->size, MSG_NOSIGNAL | MSG_DONTWAIT);
+    break;
+  case NET_RECV:
+    n = recv(r->fd, r->data, r->size, MSG_DONTWAIT);
+    break;
+  default:
+    return 0;
+  }
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    return -1;
+  if (n < 0) {
+    r->err = errno;
+    // 连接失败时 fd 不会交给脚本，在这里关闭
+    if (r->op == NET_CONNECT)
+      close(r->fd);
+  }
+  r->result = n;
+  return 0;
+}
+
+static void net_pending_settle(NetPending *p) {
+  JSContext *ctx = p->ctx;
+  JSValue value = net_request_result(ctx, &p->request);
+  net_request_free(ctx, &p->request);
+  io_settle(ctx, p->resolving_funcs, value);
+  free(p);
+}
+
+static void net_watch_update(NetWatch *w);
+
+static void net_poll_cb(uv_poll_t *handle, int status, int events) {
+  NetWatch *w = (NetWatch *)handle->data;
+  JSContext *ctx = NULL;
+  NetPending **slots[2] = {&w->reader, &w->writer};
+  int ready[2] = {UV_READABLE, UV_WRITABLE};
+
+  for (int i = 0; i < 2; i++) {
+    NetPending *p = *slots[i];
+    if (!p || !(status < 0 || (events & (ready[i] | UV_DISCONNECT))))
+      continue;
+    if (status < 0) {
+      p->request.err = -status;
+      p->request.syscall = "poll";
+    } else if (net_try(p) < 0) {
+      continue;
+    }
+    *slots[i] = NULL;
+    ctx = p->ctx;
+    net_pending_settle(p);
+  }
+  net_watch_update(w);
+
+  // 微任务可能关闭这个 fd，放在最后执行
+  if (ctx)
+    execute_microtask_timer(ctx);
+}
+
+// 按等待中的请求调整关注的事件
+static void net_watch_update(NetWatch *w) {
+  int events = (w->reader ? UV_READABLE : 0) | (w->writer ? UV_WRITABLE : 0);
+  if (events)
+    uv_poll_start(&w->poll, events | UV_DISCONNECT, net_poll_cb);
+  else
+    uv_poll_stop(&w->poll);
+}
+
+static NetWatch *net_watch_get(int fd) {
+  if (fd >= net_watches_cap) {
+    int cap = net_watches_cap ? net_watches_cap : 64;
+    while (cap <= fd)
+      cap *= 2;
+    NetWatch **grown = realloc(net_watches, cap * sizeof(NetWatch *));
+    if (!grown)
+      return NULL;
+    memset(grown + net_watches_cap, 0,
+           (cap - net_watches_cap) * sizeof(NetWatch *));
+    net_watches = grown;
+    net_watches_cap = cap;
+  }
+  if (!net_watches[fd]) {
+    NetWatch *w = calloc(1, sizeof(NetWatch));
+    if (!w || uv_poll_init_socket(loop, &w->poll, fd) < 0) {
+      free(w);
+      return NULL;
+    }
+    w->fd = fd;
+    w->poll.data = w;
+    net_watches[fd] = w;
+  }
+  return net_watches[fd];
+}
+
+static void net_watch_close_cb(uv_handle_t *handle) { free(handle->data); }
+
+// 关闭 fd 之前拒绝等待中的请求并关闭 poll 句柄
+static void net_watch_release(int fd) {
+  NetWatch *w = fd < net_watches_cap ? net_watches[fd] : NULL;
+  if (!w)
+    return;
+  net_watches[fd] = NULL;
+  NetPending *pending[2] = {w->reader, w->writer};
+  for (int i = 0; i < 2; i++) {
+    if (!pending[i])
+      continue;
+    pending[i]->request.err = ECANCELED;
+    net_pending_settle(pending[i]);
+  }
+  uv_close((uv_handle_t *)&w->poll, net_watch_close_cb);
+}
+
+// epoll 方式：立即尝试，未就绪时挂到 fd 的 poll 句柄上
+static void net_submit_uv(NetPending *p) {
+  NetRequest *r = &p->request;
+  if (r->op == NET_CLOSE) {
+    net_watch_release(r->fd);
+    r->syscall = "close";
+    if (close(r->fd) < 0)
+      r->err = errno;
+    net_pending_settle(p);
+    return;
+  }
+  if (net_try(p) == 0) {
+    net_pending_settle(p);
+    return;
+  }
+
+  NetWatch *w = net_watch_get(r->fd);
+  NetPending **slot = NULL;
+  if (w)
+    slot = r->op == NET_ACCEPT || r->op == NET_RECV ? &w->reader : &w->writer;
+  if (!slot || *slot || net_request_bounce(r) < 0) {
+    r->err = slot && *slot ? EBUSY : ENOMEM;
+    if (r->op == NET_CONNECT)
+      close(r->fd);
+    net_pending_settle(p);
+    return;
+  }
+  *slot = p;
+  net_watch_update(w);
+}
+
+// 异步版本，magic 为 NetOp，参数错误时返回 rejected 的 Promise
+static JSValue js_net_async(JSContext *ctx, JSValueConst this_val, int argc,
+                            JSValueConst *argv, int magic) {
+  NetPending *p = calloc(1, sizeof(NetPending));
+  if (!p)
+    return JS_ThrowOutOfMemory(ctx);
+  JSValue promise = JS_NewPromiseCapability(ctx, p->resolving_funcs);
+  if (JS_IsException(promise)) {
+    free(p);
+    return JS_EXCEPTION;
+  }
+
+  if (net_request_parse(ctx, &p->request, magic, argc, argv) < 0) {
+    net_request_free(ctx, &p->request);
+    io_settle(ctx, p->resolving_funcs, JS_EXCEPTION);
+    free(p);
+    return promise;
+  }
+  if (io_uring_enabled) {
+    uring_submit_net(ctx, p->resolving_funcs, &p->request);
+    free(p);
+    return promise;
+  }
+  p->ctx = ctx;
+  net_submit_uv(p);
+  return promise;
+}
+
+static const JSCFunctionListEntry js_net_funcs[] = {
+    JS_CFUNC_DEF("listen", 1, js_net_listen),
+    JS_CFUNC_DEF("localPort", 1, js_net_local_port),
+    JS_CFUNC_MAGIC_DEF("accept", 1, js_net_async, NET_ACCEPT),
+    JS_CFUNC_MAGIC_DEF("connect", 1, js_net_async, NET_CONNECT),
+    JS_CFUNC_MAGIC_DEF("send", 2, js_net_async, NET_SEND),
+    JS_CFUNC_MAGIC_DEF("recv", 2, js_net_async, NET_RECV),
+    JS_CFUNC_MAGIC_DEF("close", 1, js_net_async, NET_CLOSE),
+};
+
+static int js_net_init(JSContext *ctx, JSModuleDef *m) {
+  return JS_SetModuleExportList(ctx, m, js_net_funcs,
+                                sizeof(js_net_funcs) / sizeof(js_net_funcs[0]));
+}
+
+JSModuleDef *js_init_net_module(JSContext *ctx, const char *module_name) {
+  JSModuleDef *m = JS_NewCModule(ctx, module_name, js_net_init);
+  if (!m)
+    return NULL;
+  JS_AddModuleExportList(ctx, m, js_net_funcs,
+                         sizeof(js_net_funcs) / sizeof(js_net_funcs[0]));
+  return m;
+}
@@ -0,0 +1,67 @@
+console.log('==== test7.js ====');
+import * as fs from "fs";
+import * as fsp from "fs/promises";
+
+function assert(b, str)
+{
+    if (b) {
+        return;
+    } else {
+        throw Error("assertion failed: " + str);
+    }
+}
+
+// 伪造的视图不能让 read/write 越过真实的 ArrayBuffer
+const forged = { buffer: new ArrayBuffer(8), byteOffset: 1e9, byteLength: 100 };
+const negative = { buffer: new ArrayBuffer(8), byteOffset: -4, byteLength: 8 };
+
+const fd = fs.open("test7.js");
+for (const view of [forged, negative]) {
+    let error;
+    try {
+        fs.read(fd, view);
+    } catch (e) {
+        error = e;
+    }
+    assert(error instanceof TypeError, "fs.read accepted a forged view");
+
+    error = undefined;
+    try {
+        await fsp.read(fd, view);
+    } catch (e) {
+        error = e;
+    }
+    assert(error instanceof TypeError, "fs/promises read accepted a forged view");
+}
+
+// 真正的 DataView 仍然可以使用，并且只读到它覆盖的范围
+const view = new DataView(new ArrayBuffer(16), 4, 8);
+assert(fs.read(fd, view, 0, 8, 0) === 8, "DataView read");
+assert(String.fromCharCode(view.getUint8(0)) === "c", "DataView contents");
+
+// 整数参数的 valueOf 和等待中的请求都可能转移缓冲区
+if (typeof ArrayBuffer.prototype.transfer === "function") {
+    const ab = new ArrayBuffer(64);
+    const evil = { valueOf() { ab.transfer(); return 0; } };
+    let error;
+    try {
+        fs.read(fd, new Uint8Array(ab), evil, 64, 0);
+    } catch (e) {
+        error = e;
+    }
+    assert(error instanceof TypeError, "fs.read used a transferred buffer");
+
+    const pending = new Uint8Array(64);
+    const promise = fsp.read(fd, pending, 0, 64, 0);
+    const moved = new Uint8Array(pending.buffer.transfer());
+    error = undefined;
+    try {
+        await promise;
+    } catch (e) {
+        error = e;
+    }
+    assert(error instanceof TypeError, "fs/promises read wrote a transferred buffer");
+    assert(moved[0] === 0, "transferred buffer was written");
+}
+fs.close(fd);
+console.log('==== test7.js done ====');
@@ -0,0 +1,679 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <uv.h>
+
+#include "../helpers/trace.c"
+#include "../quickjs/quickjs.h"
+
+/*
+ * --io uring：fs/promises 和 net 的请求改由 io_uring 执行，直接使用
+ * 系统调用，不依赖 liburing。
+ *
+ * JS 运行期间发起的请求只写入提交队列（SQ），事件循环进入 poll 之前
+ * 由 uv_prepare_t 一次 io_uring_enter 全部提交；环的 fd 挂在 uv_poll_t
+ * 上，可读时一次取出完成队列（CQ）里所有的结果，全部兑现之后再执行
+ * 一次微任务。套接字不再需要先等就绪再调用，文件 I/O 也不再经过线程池。
+ *
+ * writeFile 是一条链：OPENAT 打开到固定文件槽，WRITE 用这个槽写入，
+ * CLOSE 关闭槽，三个操作一次提交，文件的 fd 不会回到用户态。close
+ * 套接字时先 ASYNC_CANCEL 这个 fd 上等待中的请求再关闭。
+ *
+ * readFile 依赖 mmap，没有对应的操作，仍在线程池上执行。
+ */
+
+#define URING_ENTRIES 256
+#define URING_CQ_ENTRIES 4096
+#define URING_FILES 64   // writeFile 链用的固定文件槽
+#define URING_BUFFERS 64 // registerBuffer 的上限
+
+// user_data 的低 3 位区分同一个请求的多个 CQE
+enum {
+  URING_STEP_MAIN,
+  URING_STEP_OPEN,
+  URING_STEP_WRITE,
+  URING_STEP_CLOSE,
+  URING_STEP_CANCEL,
+};
+
+typedef struct {
+  JSContext *ctx;
+  JSValue resolving_funcs[2];
+  int is_net;
+  union {
+    FsRequest fs;
+    NetRequest net;
+  } u;
+  int pending;   // 还没有收到的 CQE 数
+  int file_slot; // writeFile 占用的固定文件槽，-1 表示没有
+  int buffer;    // 使用的注册缓冲区，-1 表示没有
+  struct statx stx;
+} UringOp;
+
+// 注册到内核的是 malloc 的副本 shadow，落在 base 范围内的 read/write
+// 经过副本中相同的位置，脚本转移 base 的缓冲区也不会影响内核
+typedef struct {
+  uint8_t *base; // 为 NULL 时已注销，shadow 等最后一个请求完成后释放
+  size_t len;
+  uint8_t *shadow;
+  int refs; // 正在使用 shadow 的请求数
+  JSContext *ctx;
+  JSValue hold; // 注册期间保持缓冲区存活
+} UringBuffer;
+
+static struct {
+  int fd;
+  unsigned sq_entries;
+  unsigned *sq_head, *sq_tail, *sq_mask, *sq_array, *sq_flags;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_ptr, *cq_ptr;
+  size_t sq_size, cq_size, sqes_size;
+  unsigned sq_tail_local; // 已写入、还没有发布给内核的尾部
+  unsigned to_submit;
+  unsigned inflight; // 未完成的请求数，不为 0 时事件循环保持运行
+  uv_poll_t poll;
+  uv_prepare_t prepare;
+  int buffers_enabled;
+  UringBuffer buffers[URING_BUFFERS];
+  char file_used[URING_FILES];
+} ring = {.fd = -1};
+
+static int uring_setup(unsigned entries, struct io_uring_params *p) {
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(unsigned to_submit, unsigned min_complete,
+                       unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, ring.fd, to_submit, min_complete,
+                      flags, NULL, 0);
+}
+
+static int uring_register(unsigned opcode, const void *arg, unsigned nr) {
+  return (int)syscall(__NR_io_uring_register, ring.fd, opcode, arg, nr);
+}
+
+// 提交已写入的 SQE，内核暂时不能接收时留到下一轮
+static void uring_flush(void) {
+  if (!ring.to_submit)
+    return;
+  __atomic_store_n(ring.sq_tail, ring.sq_tail_local, __ATOMIC_RELEASE);
+  int n;
+  do {
+    n = uring_enter(ring.to_submit, 0, 0);
+  } while (n < 0 && errno == EINTR);
+  if (n > 0)
+    ring.to_submit -= n;
+}
+
+// 保证 SQ 里有 n 个空位，链上的 SQE 必须在同一次提交里
+static int uring_reserve(unsigned n) {
+  unsigned head = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+  if (ring.sq_tail_local - head + n > ring.sq_entries) {
+    uring_flush();
+    head = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+  }
+  return ring.sq_tail_local - head + n > ring.sq_entries ? -1 : 0;
+}
+
+// 取下一个 SQE，调用前先 uring_reserve
+static struct io_uring_sqe *uring_next_sqe(UringOp *op, int step) {
+  unsigned index = ring.sq_tail_local & *ring.sq_mask;
+  struct io_uring_sqe *sqe = &ring.sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = (uint64_t)(uintptr_t)op | step;
+  ring.sq_array[index] = index;
+  ring.sq_tail_local++;
+  ring.to_submit++;
+  op->pending++;
+  return sqe;
+}
+
+static void uring_update_ref(void) {
+  if (ring.inflight)
+    uv_ref((uv_handle_t *)&ring.poll);
+  else
+    uv_unref((uv_handle_t *)&ring.poll);
+}
+
+// 缓冲区完全落在某个注册的区域内时返回它的下标
+static int uring_find_buffer(const uint8_t *p, size_t len) {
+  for (int i = 0; i < URING_BUFFERS; i++) {
+    UringBuffer *b = &ring.buffers[i];
+    if (b->base && p >= b->base && p + len <= b->base + b->len)
+      return i;
+  }
+  return -1;
+}
+
+static UringOp *uring_op_new(JSContext *ctx, JSValue resolving_funcs[2]) {
+  UringOp *op = calloc(1, sizeof(UringOp));
+  if (!op)
+    return NULL;
+  op->ctx = ctx;
+  op->resolving_funcs[0] = resolving_funcs[0];
+  op->resolving_funcs[1] = resolving_funcs[1];
+  op->file_slot = -1;
+  op->buffer = -1;
+  return op;
+}
+
+static void uring_buffer_release(int i) {
+  UringBuffer *b = &ring.buffers[i];
+  if (--b->refs == 0 && !b->base) {
+    free(b->shadow);
+    b->shadow = NULL;
+  }
+}
+
+static void uring_prep_rw(struct io_uring_sqe *sqe, int opcode, int fd,
+                          uint8_t *data, size_t size, int64_t position) {
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)data;
+  sqe->len = (uint32_t)size;
+  sqe->off = position < 0 ? (uint64_t)-1 : (uint64_t)position;
+}
+
+static void uring_submit_fs(JSContext *ctx, JSValue resolving_funcs[2],
+                            FsRequest *request) {
+  UringOp *op = uring_op_new(ctx, resolving_funcs);
+  FsRequest *r = op ? &op->u.fs : NULL;
+  int slot = -1;
+  if (op && request->op == FS_WRITE_FILE) {
+    for (slot = 0; slot < URING_FILES && ring.file_used[slot]; slot++)
+      ;
+    if (slot == URING_FILES)
+      slot = -1;
+  }
+  if (!op || uring_reserve(3) < 0 ||
+      (request->op == FS_WRITE_FILE && slot < 0)) {
+    // SQ 满或固定文件槽用完，退回线程池
+    free(op);
+    FsWork *w = calloc(1, sizeof(FsWork));
+    if (!w || fs_request_bounce(request, NULL) < 0) {
+      free(w);
+      fs_request_free(ctx, request);
+      io_settle(ctx, resolving_funcs, JS_ThrowOutOfMemory(ctx));
+      return;
+    }
+    w->resolving_funcs[0] = resolving_funcs[0];
+    w->resolving_funcs[1] = resolving_funcs[1];
+    w->request = *request;
+    fs_queue_work(ctx, w);
+    return;
+  }
+  // 落在注册缓冲区内的 read/write 使用它的副本，其余的复制到新分配的内存
+  UringBuffer *b = NULL;
+  if (request->op == FS_READ || request->op == FS_WRITE) {
+    op->buffer = uring_find_buffer(request->data, request->size);
+    if (op->buffer >= 0)
+      b = &ring.buffers[op->buffer];
+  }
+  if (fs_request_bounce(request,
+                        b ? b->shadow + (request->data - b->base) : NULL) < 0) {
+    free(op);
+    fs_request_free(ctx, request);
+    io_settle(ctx, resolving_funcs, JS_ThrowOutOfMemory(ctx));
+    return;
+  }
+  if (b)
+    b->refs++;
+  *r = *request;
+
+  struct io_uring_sqe *sqe;
+  switch (r->op) {
+  case FS_WRITE_FILE:
+    op->file_slot = slot;
+    ring.file_used[slot] = 1;
+    sqe = uring_next_sqe(op, URING_STEP_OPEN);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)r->path;
+    sqe->len = 0666;
+    // 固定文件不在 fd 表里，内核不接受 O_CLOEXEC
+    sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+    sqe->file_index = slot + 1;
+    sqe->flags = IOSQE_IO_LINK;
+    // 打开失败时后两步以 ECANCELED 结束；写入失败也要关闭，用 HARDLINK
+    sqe = uring_next_sqe(op, URING_STEP_WRITE);
+    uring_prep_rw(sqe, IORING_OP_WRITE, slot, r->data, r->size, 0);
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+    sqe = uring_next_sqe(op, URING_STEP_CLOSE);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = slot + 1;
+    break;
+  case FS_OPEN:
+    sqe = uring_next_sqe(op, URING_STEP_MAIN);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)r->path;
+    sqe->len = 0666;
+    sqe->open_flags = r->flags | O_CLOEXEC;
+    break;
+  case FS_CLOSE:
+    sqe = uring_next_sqe(op, URING_STEP_MAIN);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = r->fd;
+    break;
+  case FS_READ:
+  case FS_WRITE:
+    sqe = uring_next_sqe(op, URING_STEP_MAIN);
+    if (op->buffer >= 0) {
+      uring_prep_rw(sqe,
+                    r->op == FS_READ ? IORING_OP_READ_FIXED
+                                     : IORING_OP_WRITE_FIXED,
+                    r->fd, r->data, r->size, r->position);
+      sqe->buf_index = op->buffer;
+    } else {
+      uring_prep_rw(sqe, r->op == FS_READ ? IORING_OP_READ : IORING_OP_WRITE,
+                    r->fd, r->data, r->size, r->position);
+    }
+    break;
+  case FS_STAT:
+    sqe = uring_next_sqe(op, URING_STEP_MAIN);
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)r->path;
+    sqe->len = STATX_BASIC_STATS;
+    sqe->off = (uint64_t)(uintptr_t)&op->stx;
+    break;
+  default:
+    break;
+  }
+  ring.inflight++;
+  uring_update_ref();
+}
+
+static void uring_submit_net(JSContext *ctx, JSValue resolving_funcs[2],
+                             NetRequest *request) {
+  UringOp *op = uring_op_new(ctx, resolving_funcs);
+  int reserved = op && uring_reserve(2) == 0;
+  if (!reserved || net_request_bounce(request) < 0) {
+    free(op);
+    if (request->op == NET_CONNECT)
+      close(request->fd);
+    request->err = op && !reserved ? EBUSY : ENOMEM;
+    request->syscall = net_op_names[request->op];
+    io_settle(ctx, resolving_funcs, net_request_result(ctx, request));
+    net_request_free(ctx, request);
+    return;
+  }
+  op->is_net = 1;
+  NetRequest *r = &op->u.net;
+  *r = *request;
+  r->syscall = net_op_names[r->op];
+
+  struct io_uring_sqe *sqe;
+  switch (r->op) {
+  case NET_ACCEPT:
+    sqe = uring_next_sqe(op, URING_STEP_MAIN);
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = r->fd;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    break;
+  case NET_CONNECT:
+    sqe = uring_next_sqe(op, URING_STEP_MAIN);
+    sqe->opcode = IORING_OP_CONNECT;
+    sqe->fd = r->fd;
+    sqe->addr = (uint64_t)(uintptr_t)&r->addr;
+    sqe->off = sizeof(r->addr);
+    break;
+  case NET_SEND:
+  case NET_RECV:
+    sqe = uring_next_sqe(op, URING_STEP_MAIN);
+    uring_prep_rw(sqe, r->op == NET_SEND ? IORING_OP_SEND : IORING_OP_RECV,
+                  r->fd, r->data, r->size, 0);
+    sqe->msg_flags = r->op == NET_SEND ? MSG_NOSIGNAL : 0;
+    break;
+  case NET_CLOSE:
+    // 先取消这个 fd 上所有等待中的请求，不论结果都继续关闭
+    sqe = uring_next_sqe(op, URING_STEP_CANCEL);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = r->fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->flags = IOSQE_IO_HARDLINK;
+    sqe = uring_next_sqe(op, URING_STEP_MAIN);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = r->fd;
+    break;
+  }
+  ring.inflight++;
+  uring_update_ref();
+}
+
+static const char *uring_fs_syscall(FsRequest *r, int step) {
+  static const char *const names[] = {"open", "close", "read", "write",
+                                      "stat"};
+  switch (step) {
+  case URING_STEP_OPEN:
+    return "open";
+  case URING_STEP_WRITE:
+    return "write";
+  case URING_STEP_CLOSE:
+    return "close";
+  default:
+    return names[r->op - FS_OPEN];
+  }
+}
+
+// 处理一个 CQE，请求的所有 CQE 都到齐后兑现 Promise
+static void uring_complete(UringOp *op, int step, int res) {
+  if (op->is_net) {
+    NetRequest *r = &op->u.net;
+    if (step == URING_STEP_CANCEL) {
+      // 取消的结果不影响 close
+    } else if (res < 0) {
+      r->err = -res;
+      if (r->op == NET_CONNECT)
+        close(r->fd);
+    } else if (r->op == NET_CONNECT) {
+      r->result = r->fd;
+    } else {
+      if (r->op == NET_ACCEPT)
+        net_set_nodelay(res);
+      r->result = res;
+    }
+  } else {
+    FsRequest *r = &op->u.fs;
+    if (res < 0) {
+      // 链上只记录第一个错误，后面的是 ECANCELED
+      if (!r->err) {
+        r->err = -res;
+        r->syscall = uring_fs_syscall(r, step);
+      }
+    } else if (r->op == FS_STAT) {
+      r->st.st_size = op->stx.stx_size;
+      r->st.st_mode = op->stx.stx_mode;
+      r->st.st_mtim.tv_sec = op->stx.stx_mtime.tv_sec;
+      r->st.st_mtim.tv_nsec = op->stx.stx_mtime.tv_nsec;
+    } else if (step == URING_STEP_WRITE && (size_t)res < r->size && !r->err) {
+      // 普通文件只有磁盘满等情况才会写不完
+      r->err = EIO;
+      r->syscall = "write";
+    } else if (step == URING_STEP_MAIN || step == URING_STEP_WRITE) {
+      r->result = res;
+    }
+  }
+  if (--op->pending > 0)
+    return;
+
+  JSContext *ctx = op->ctx;
+  JSValue value;
+  if (op->is_net) {
+    value = net_request_result(ctx, &op->u.net);
+    net_request_free(ctx, &op->u.net);
+  } else {
+    // read 的结果从 shadow 复制出来之后才能放开缓冲区
+    value = fs_request_result(ctx, &op->u.fs);
+    fs_request_free(ctx, &op->u.fs);
+    if (op->buffer >= 0)
+      uring_buffer_release(op->buffer);
+  }
+  io_settle(ctx, op->resolving_funcs, value);
+  if (op->file_slot >= 0)
+    ring.file_used[op->file_slot] = 0;
+  free(op);
+  ring.inflight--;
+}
+
+static void uring_prepare_cb(uv_prepare_t *handle) { uring_flush(); }
+
+// 环可读：取出所有 CQE，兑现之后统一执行微任务
+static void uring_poll_cb(uv_poll_t *handle, int status, int events) {
+  JSContext *ctx = NULL;
+  int reaped = 0;
+  uint64_t trace_start = trace_begin();
+  for (;;) {
+    unsigned head = *ring.cq_head;
+    unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+      struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+      UringOp *op = (UringOp *)(uintptr_t)(cqe->user_data & ~(uint64_t)7);
+      int step = (int)(cqe->user_data & 7);
+      int res = cqe->res;
+      __atomic_store_n(ring.cq_head, head + 1, __ATOMIC_RELEASE);
+      ctx = op->ctx;
+      uring_complete(op, step, res);
+      reaped++;
+    }
+    // CQ 溢出时内核把结果暂存起来，需要 GETEVENTS 才会写回 CQ
+    if (!(__atomic_load_n(ring.sq_flags, __ATOMIC_ACQUIRE) &
+          IORING_SQ_CQ_OVERFLOW))
+      break;
+    uring_enter(0, 0, IORING_ENTER_GETEVENTS);
+  }
+  uring_update_ref();
+  if (ctx) {
+    trace_end_id("loop", "uring", trace_start, reaped, NULL);
+    execute_microtask_timer(ctx);
+  }
+}
+
+// registerBuffer(buf) / unregisterBuffer(buf)
+static JSValue js_uring_register_buffer(JSContext *ctx, JSValueConst this_val,
+                                        int argc, JSValueConst *argv,
+                                        int magic) {
+  size_t len;
+  uint8_t *base = js_encoding_get_bytes(ctx, argv[0], &len);
+  if (!base)
+    return JS_EXCEPTION;
+  if (!ring.buffers_enabled || len == 0)
+    return JS_FALSE;
+
+  int i;
+  if (magic) {
+    for (i = 0; i < URING_BUFFERS &&
+                (ring.buffers[i].base || ring.buffers[i].shadow);
+         i++)
+      ;
+  } else {
+    for (i = 0; i < URING_BUFFERS; i++) {
+      if (ring.buffers[i].base == base && ring.buffers[i].len == len)
+        break;
+    }
+  }
+  if (i == URING_BUFFERS)
+    return JS_FALSE;
+
+  UringBuffer *b = &ring.buffers[i];
+  uint8_t *shadow = NULL;
+  if (magic) {
+    shadow = malloc(len);
+    if (!shadow)
+      return JS_ThrowOutOfMemory(ctx);
+  }
+  // 注销时写入空的 iovec，已提交的请求仍然持有原来的映射
+  struct iovec iov = {shadow, magic ? len : 0};
+  struct io_uring_rsrc_update2 update = {
+      .offset = i, .data = (uint64_t)(uintptr_t)&iov, .nr = 1};
+  if (uring_register(IORING_REGISTER_BUFFERS_UPDATE, &update,
+                     sizeof(update)) < 0) {
+    free(shadow);
+    return JS_FALSE;
+  }
+
+  if (magic) {
+    b->base = base;
+    b->len = len;
+    b->shadow = shadow;
+    b->ctx = ctx;
+    b->hold = JS_DupValue(ctx, argv[0]);
+  } else {
+    JS_FreeValue(b->ctx, b->hold);
+    b->base = NULL;
+    b->len = 0;
+    b->hold = JS_UNDEFINED;
+    if (b->refs == 0) {
+      free(b->shadow);
+      b->shadow = NULL;
+    }
+  }
+  return JS_TRUE;
+}
+
+/*
+ * 检查内核是否支持用到的全部操作，缺少时返回 -1 并打印原因。
+ * 固定文件槽上的 OPENAT/CLOSE 需要 5.15，ASYNC_CANCEL 的 FD/ALL 标志
+ * 需要 5.19，这两项没有单独的探测方式：旧内核会忽略 file_index 或对
+ * 取消返回 EINVAL，所以用 5.19 引入的 IORING_OP_SOCKET 判断内核版本
+ */
+static int uring_probe(void) {
+  static const struct {
+    int op;
+    const char *name;
+  } required[] = {
+      {IORING_OP_OPENAT, "OPENAT"},
+      {IORING_OP_CLOSE, "CLOSE"},
+      {IORING_OP_READ, "READ"},
+      {IORING_OP_WRITE, "WRITE"},
+      {IORING_OP_READ_FIXED, "READ_FIXED"},
+      {IORING_OP_WRITE_FIXED, "WRITE_FIXED"},
+      {IORING_OP_STATX, "STATX"},
+      {IORING_OP_ACCEPT, "ACCEPT"},
+      {IORING_OP_CONNECT, "CONNECT"},
+      {IORING_OP_SEND, "SEND"},
+      {IORING_OP_RECV, "RECV"},
+      {IORING_OP_ASYNC_CANCEL, "ASYNC_CANCEL"},
+      {IORING_OP_SOCKET, "SOCKET (Linux 5.19, fixed-slot open/close and "
+                         "cancel by fd)"},
+  };
+  size_t size = sizeof(struct io_uring_probe) +
+                256 * sizeof(struct io_uring_probe_op);
+  struct io_uring_probe *probe = calloc(1, size);
+  if (!probe)
+    return -1;
+  int ret = 0;
+  if (uring_register(IORING_REGISTER_PROBE, probe, 256) < 0) {
+    fprintf(stderr, "io_uring: IORING_REGISTER_PROBE failed (%s), "
+                    "Linux 5.19 or later is required\n",
+            strerror(errno));
+    ret = -1;
+  }
+  for (size_t i = 0; ret == 0 && i < sizeof(required) / sizeof(required[0]);
+       i++) {
+    int op = required[i].op;
+    if (op > probe->last_op ||
+        !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+      fprintf(stderr, "io_uring: kernel does not support IORING_OP_%s\n",
+              required[i].name);
+      ret = -1;
+    }
+  }
+  free(probe);
+  return ret;
+}
+
+// 在 init_loop 之后调用，失败时返回 -errno；内核缺少所需的操作时
+// 返回 -ENOSYS，不会在半支持的内核上静默出错
+static int uring_init(void) {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  p.flags = IORING_SETUP_CQSIZE;
+  p.cq_entries = URING_CQ_ENTRIES;
+  ring.fd = uring_setup(URING_ENTRIES, &p);
+  if (ring.fd < 0)
+    return -errno;
+  if (uring_probe() < 0) {
+    close(ring.fd);
+    ring.fd = -1;
+    return -ENOSYS;
+  }
+
+  ring.sq_entries = p.sq_entries;
+  ring.sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  ring.cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  // 新内核上 SQ 和 CQ 共用一次映射
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (ring.cq_size > ring.sq_size)
+      ring.sq_size = ring.cq_size;
+    ring.cq_size = ring.sq_size;
+  }
+  ring.sq_ptr = mmap(NULL, ring.sq_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+  ring.cq_ptr = ring.sq_ptr;
+  if (ring.sq_ptr != MAP_FAILED && !(p.features & IORING_FEAT_SINGLE_MMAP))
+    ring.cq_ptr = mmap(NULL, ring.cq_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+  ring.sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  ring.sqes = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+  if (ring.sq_ptr == MAP_FAILED || ring.cq_ptr == MAP_FAILED ||
+      ring.sqes == MAP_FAILED) {
+    int err = errno;
+    close(ring.fd);
+    ring.fd = -1;
+    return -err;
+  }
+
+  char *sq = ring.sq_ptr, *cq = ring.cq_ptr;
+  ring.sq_head = (unsigned *)(sq + p.sq_off.head);
+  ring.sq_tail = (unsigned *)(sq + p.sq_off.tail);
+  ring.sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+  ring.sq_flags = (unsigned *)(sq + p.sq_off.flags);
+  ring.sq_array = (unsigned *)(sq + p.sq_off.array);
+  ring.cq_head = (unsigned *)(cq + p.cq_off.head);
+  ring.cq_tail = (unsigned *)(cq + p.cq_off.tail);
+  ring.cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+  ring.cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+  ring.sq_tail_local = *ring.sq_tail;
+
+  // writeFile 链用的固定文件表，初始全空
+  int files[URING_FILES];
+  for (int i = 0; i < URING_FILES; i++)
+    files[i] = -1;
+  if (uring_register(IORING_REGISTER_FILES, files, URING_FILES) < 0) {
+    int err = errno;
+    close(ring.fd);
+    ring.fd = -1;
+    return -err;
+  }
+  // 空的缓冲区表，registerBuffer 逐个填入；失败（如旧内核）时不使用
+  struct io_uring_rsrc_register reg = {.nr = URING_BUFFERS,
+                                       .flags = IORING_RSRC_REGISTER_SPARSE};
+  ring.buffers_enabled =
+      uring_register(IORING_REGISTER_BUFFERS2, &reg, sizeof(reg)) == 0;
+
+  uv_poll_init(loop, &ring.poll, ring.fd);
+  uv_poll_start(&ring.poll, UV_READABLE, uring_poll_cb);
+  uv_unref((uv_handle_t *)&ring.poll);
+  uv_prepare_init(loop, &ring.prepare);
+  uv_prepare_start(&ring.prepare, uring_prepare_cb);
+  uv_unref((uv_handle_t *)&ring.prepare);
+  io_uring_enabled = 1;
+  return 0;
+}
+
+// 在释放 JSContext 之前调用，放开注册的缓冲区
+static void uring_cleanup(void) {
+  if (ring.fd < 0)
+    return;
+  for (int i = 0; i < URING_BUFFERS; i++) {
+    if (ring.buffers[i].base)
+      JS_FreeValue(ring.buffers[i].ctx, ring.buffers[i].hold);
+  }
+  uv_close((uv_handle_t *)&ring.poll, NULL);
+  uv_close((uv_handle_t *)&ring.prepare, NULL);
+  uv_run(loop, UV_RUN_NOWAIT);
+  munmap(ring.sqes, ring.sqes_size);
+  if (ring.cq_ptr != ring.sq_ptr)
+    munmap(ring.cq_ptr, ring.cq_size);
+  munmap(ring.sq_ptr, ring.sq_size);
+  close(ring.fd);
+  ring.fd = -1;
+  for (int i = 0; i < URING_BUFFERS; i++) {
+    free(ring.buffers[i].shadow);
+    ring.buffers[i].shadow = NULL;
+  }
+  io_uring_enabled = 0;
+}
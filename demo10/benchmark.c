@@ -6,6 +6,72 @@
 #include "../helpers/exception.c"
 #include "../quickjs/quickjs.h"
 #include "../helpers/console.c"
+#include "../helpers/callhandle.c"
+#include "../helpers/profiler.c"
+
+// validBenchmarkFunc 每次迭代都要读取的属性名，按运行时驻留一次
+enum {
+  ATOM_BENCHMARK_RESULT,
+  ATOM_COMBINED_RESULT,
+  ATOM_TOTAL_TIME_MS,
+  BENCHMARK_ATOM_COUNT,
+};
+
+static const char *const benchmark_atom_names[BENCHMARK_ATOM_COUNT] = {
+    "benchmarkResult",
+    "combinedResult",
+    "totalTimeMs",
+};
+
+// --profile 时对两种执行方式的运行时采样，为 NULL 时不采样
+static Profiler *profiler = NULL;
+static ProfilerThread profiler_thread;
+
+#ifdef JS_INSTRUMENT
+// 插桩构建（make instrument）：统计每个 JS 函数的调用次数、耗时和分配量，
+// 两种执行方式结束后各打印一张表
+#include "../helpers/instrument.c"
+
+static Instrument instrument;
+
+static JSRuntime *benchmark_new_runtime(void)
+{
+  return instrument_new_runtime(&instrument);
+}
+
+static const char *benchmark_source(const char *js_code)
+{
+  return instrument_source(&instrument, js_code, strlen(js_code));
+}
+
+static void benchmark_init_context(JSContext *ctx)
+{
+  instrument_install(ctx);
+}
+
+static void benchmark_report(const char *title)
+{
+  instrument_report(&instrument, title);
+}
+#else
+static JSRuntime *benchmark_new_runtime(void)
+{
+  return JS_NewRuntime();
+}
+
+static const char *benchmark_source(const char *js_code)
+{
+  return js_code;
+}
+
+static void benchmark_init_context(JSContext *ctx)
+{
+}
+
+static void benchmark_report(const char *title)
+{
+}
+#endif
 
 // 获取当前进程的内存使用量（以字节为单位）
 size_t get_memory_usage() {
@@ -50,11 +116,17 @@ uint8_t *compile_js_to_bytecode(const char *js_code, size_t *out_buf_len)
   return out_buf;
 }
 
-int validBenchmarkFunc(JSContext *ctx)
+int validBenchmarkFunc(JSContext *ctx, JSAtom *atoms)
 {
+  // 同一运行时的第一次调用时驻留属性名
+  if (atoms[0] == JS_ATOM_NULL)
+  {
+    js_intern_atoms(ctx, atoms, benchmark_atom_names, BENCHMARK_ATOM_COUNT);
+  }
+
   // Test the benchmark results
   JSValue global_obj = JS_GetGlobalObject(ctx);
-  JSValue benchmark_result = JS_GetPropertyStr(ctx, global_obj, "benchmarkResult");
+  JSValue benchmark_result = JS_GetProperty(ctx, global_obj, atoms[ATOM_BENCHMARK_RESULT]);
 
   // Check if benchmarkResult exists
   if (JS_IsUndefined(benchmark_result) || JS_IsNull(benchmark_result))
@@ -66,7 +138,7 @@ int validBenchmarkFunc(JSContext *ctx)
   }
 
   // Check if combinedResult property exists and is a number
-  JSValue combined_result = JS_GetPropertyStr(ctx, benchmark_result, "combinedResult");
+  JSValue combined_result = JS_GetProperty(ctx, benchmark_result, atoms[ATOM_COMBINED_RESULT]);
   if (!JS_IsNumber(combined_result))
   {
     fprintf(stderr, "Error: benchmarkResult.combinedResult is not a number\n");
@@ -81,7 +153,7 @@ int validBenchmarkFunc(JSContext *ctx)
   JS_ToFloat64(ctx, &result_value, combined_result);
 
   // Get totalTimeMs value for logging
-  JSValue total_time = JS_GetPropertyStr(ctx, benchmark_result, "totalTimeMs");
+  JSValue total_time = JS_GetProperty(ctx, benchmark_result, atoms[ATOM_TOTAL_TIME_MS]);
   double time_value = 0;
   JS_ToFloat64(ctx, &time_value, total_time);
 
@@ -100,14 +172,16 @@ int validBenchmarkFunc(JSContext *ctx)
 /**
  * Executes compiled bytecode and tests the loaded JavaScript functions
  *
+ * @param atoms Interned property names for rt, see validBenchmarkFunc
  * @param bytecode Pointer to the compiled bytecode
  * @param bytecode_len Length of the bytecode
  * @return 0 on success, 1 on error
  */
-int execute_bytecode(JSRuntime *rt, uint8_t *bytecode, size_t bytecode_len)
+int execute_bytecode(JSRuntime *rt, JSAtom *atoms, uint8_t *bytecode, size_t bytecode_len)
 {
   JSContext *ctx = JS_NewContext(rt);
   // js_std_init_console(ctx);
+  benchmark_init_context(ctx);
 
   // Load bytecode
   JSValue loadedVal = JS_ReadObject(ctx, bytecode, bytecode_len, JS_READ_OBJ_BYTECODE);
@@ -125,7 +199,7 @@ int execute_bytecode(JSRuntime *rt, uint8_t *bytecode, size_t bytecode_len)
     return 1;
   }
 
-  int v = validBenchmarkFunc(ctx);
+  int v = validBenchmarkFunc(ctx, atoms);
 
   JS_FreeValue(ctx, ret);
   JS_FreeContext(ctx);
@@ -133,10 +207,11 @@ int execute_bytecode(JSRuntime *rt, uint8_t *bytecode, size_t bytecode_len)
   return v;
 }
 
-int execute_js(JSRuntime *rt, const char *js_code)
+int execute_js(JSRuntime *rt, JSAtom *atoms, const char *js_code)
 {
   JSContext *ctx = JS_NewContext(rt);
   // js_std_init_console(ctx);
+  benchmark_init_context(ctx);
 
   JSValue val =
       JS_Eval(ctx, js_code, strlen(js_code), "<input>", JS_EVAL_TYPE_GLOBAL);
@@ -147,7 +222,7 @@ int execute_js(JSRuntime *rt, const char *js_code)
     return 1;
   }
 
-  int v = validBenchmarkFunc(ctx);
+  int v = validBenchmarkFunc(ctx, atoms);
 
   JS_FreeValue(ctx, val);
   JS_FreeContext(ctx);
@@ -158,8 +233,11 @@ int execute_js(JSRuntime *rt, const char *js_code)
 // Execute JavaScript code that uses the C function
 int benchmark_js(int iterations ) {
   printf("\nTesting execute_js performance...\n");
-  const char *js_code = read_file_to_string("./benchmark.js");
-  JSRuntime *rt = JS_NewRuntime();
+  const char *js_code = benchmark_source(read_file_to_string("./benchmark.js"));
+  JSRuntime *rt = benchmark_new_runtime();
+  JSAtom atoms[BENCHMARK_ATOM_COUNT] = {JS_ATOM_NULL};
+  if (profiler && profiler_attach(profiler, &profiler_thread, rt) < 0)
+    fprintf(stderr, "Failed to start profiling, running without it\n");
 
    // Variables for timing
   clock_t start, end;
@@ -175,10 +253,12 @@ int benchmark_js(int iterations ) {
 
   for (int i = 0; i < iterations; i++)
   {
-    int ret = execute_js(rt, js_code);
+    int ret = execute_js(rt, atoms, js_code);
     if (ret == 1)
     {
       printf("Failed to execute JS\n");
+      js_free_atoms(rt, atoms, BENCHMARK_ATOM_COUNT);
+      profiler_detach(&profiler_thread);
       JS_FreeRuntime(rt);
       return 1;
     }
@@ -193,7 +273,10 @@ int benchmark_js(int iterations ) {
   printf("execute_js: %f milliseconds (average per iteration)\n", cpu_time_used_ms / iterations);
   printf("execute_js: %zu bytes memory used\n", mem_used);
   printf("execute_js: %.2f KB memory used\n", mem_used / 1024.0);
+  benchmark_report("execute_js");
 
+  js_free_atoms(rt, atoms, BENCHMARK_ATOM_COUNT);
+  profiler_detach(&profiler_thread);
   JS_FreeRuntime(rt);
 
   return 0;
@@ -202,7 +285,7 @@ int benchmark_js(int iterations ) {
 // Test execute_bytecode performance
 int benchmark_bytecode(int iterations) {
   printf("\nTesting execute_bytecode performance...\n");
-  const char *js_code = read_file_to_string("./benchmark.js");
+  const char *js_code = benchmark_source(read_file_to_string("./benchmark.js"));
   JSRuntime *rt = JS_NewRuntime();
 
   uint8_t *bytecode;
@@ -223,17 +306,22 @@ int benchmark_bytecode(int iterations) {
 
   mem_before = get_memory_usage();
 
-  rt = JS_NewRuntime();
+  rt = benchmark_new_runtime();
+  JSAtom atoms[BENCHMARK_ATOM_COUNT] = {JS_ATOM_NULL};
+  if (profiler && profiler_attach(profiler, &profiler_thread, rt) < 0)
+    fprintf(stderr, "Failed to start profiling, running without it\n");
 
   start = clock();
   // mem_before = get_memory_usage();
 
   for (int i = 0; i < iterations; i++)
   {
-    int ret = execute_bytecode(rt, bytecode, bytecode_len);
+    int ret = execute_bytecode(rt, atoms, bytecode, bytecode_len);
     if (ret == 1)
     {
       printf("Failed to execute bytecode\n");
+      js_free_atoms(rt, atoms, BENCHMARK_ATOM_COUNT);
+      profiler_detach(&profiler_thread);
       JS_FreeRuntime(rt);
       return 1;
     }
@@ -249,20 +337,40 @@ int benchmark_bytecode(int iterations) {
   printf("execute_bytecode: %f milliseconds (average per iteration)\n", cpu_time_used_ms / iterations);
   printf("execute_bytecode: %zu bytes memory used\n", mem_used);
   printf("execute_bytecode: %.2f KB memory used\n", mem_used / 1024.0);
+  benchmark_report("execute_bytecode");
 
   // Clean up
   free(bytecode);
+  js_free_atoms(rt, atoms, BENCHMARK_ATOM_COUNT);
+  profiler_detach(&profiler_thread);
   JS_FreeRuntime(rt);
 
   return 0;
 }
 
-int main()
+int main(int argc, char **argv)
 {
   // Number of iterations for more reliable measurements
   const int iterations = 1000;
   int ret = 0;
 
+  // --profile [hz]：采样 JS 调用栈，结束时输出热点函数、折叠栈和 pprof 文件
+  Profiler profile;
+  if (argc > 1 && strcmp(argv[1], "--profile") == 0)
+  {
+#ifdef JS_INSTRUMENT
+    // 插桩和采样都要占用运行时的中断处理函数
+    fprintf(stderr, "--profile is not available in the instrumented build\n");
+    return 1;
+#endif
+    if (profiler_init(&profile, argc > 2 ? atoi(argv[2]) : PROFILER_DEFAULT_HZ) < 0)
+    {
+      fprintf(stderr, "Failed to install the SIGPROF handler\n");
+      return 1;
+    }
+    profiler = &profile;
+  }
+
   ret = benchmark_js(iterations);
   if (ret == 1) {
     return 1;
@@ -273,5 +381,16 @@ int main()
     return 1;
   }
 
+  if (profiler)
+  {
+    printf("\n");
+    profiler_print_top(profiler, 20);
+    if (profiler_write_folded(profiler, "benchmark.folded") == 0)
+      printf("Folded stacks written to benchmark.folded\n");
+    if (profiler_write_pprof(profiler, "benchmark.pb") == 0)
+      printf("pprof profile written to benchmark.pb\n");
+    profiler_free(profiler);
+  }
+
   return 0;
 }
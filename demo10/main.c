@@ -3,6 +3,7 @@
 #include "../helpers/exception.c"
 #include "../quickjs/quickjs.h"
 #include "../helpers/console.c"
+#include "../helpers/callhandle.c"
 
 /**
  * Compiles JavaScript code to bytecode
@@ -66,11 +67,20 @@ int execute_bytecode(JSRuntime *rt, uint8_t *bytecode, size_t bytecode_len)
 
   // Test the loaded add function
   JSValue global_obj = JS_GetGlobalObject(ctx);
-  JSValue add_func = JS_GetPropertyStr(ctx, global_obj, "add");
+  JSCallHandle add_func;
+  if (js_call_handle_init(ctx, &add_func, global_obj, "add") < 0)
+  {
+    check_and_print_exception(ctx);
+    JS_FreeValue(ctx, global_obj);
+    JS_FreeValue(ctx, ret);
+    JS_FreeContext(ctx);
+    return 1;
+  }
+
   JSValue args[2];
   args[0] = JS_NewInt32(ctx, 3);
   args[1] = JS_NewInt32(ctx, 4);
-  JSValue result = JS_Call(ctx, add_func, global_obj, 2, args);
+  JSValue result = js_call_handle_call(&add_func, 2, args);
 
   if (!JS_IsException(result))
   {
@@ -87,7 +97,7 @@ int execute_bytecode(JSRuntime *rt, uint8_t *bytecode, size_t bytecode_len)
   JS_FreeValue(ctx, args[0]);
   JS_FreeValue(ctx, args[1]);
   JS_FreeValue(ctx, result);
-  JS_FreeValue(ctx, add_func);
+  js_call_handle_free(&add_func);
   JS_FreeValue(ctx, global_obj);
   JS_FreeValue(ctx, ret);
   JS_FreeContext(ctx);
@@ -0,0 +1,33 @@
+// 每个工作线程各加载一次，handle(request) 在该线程的运行时上调用
+const decoder = new TextDecoder();
+let served = 0;
+
+function handle(request) {
+  served++;
+  const path = request.url.split("?")[0];
+  if (path === "/") {
+    return "Hello from QuickJS\n";
+  }
+  if (path === "/json") {
+    return {
+      headers: { "Content-Type": "application/json" },
+      body: JSON.stringify({ method: request.method, served }),
+    };
+  }
+  if (path === "/echo" && request.method === "POST") {
+    return {
+      headers: { "Content-Type": request.headers["content-type"] || "text/plain" },
+      body: request.body || "",
+    };
+  }
+  if (path === "/async") {
+    return Promise.resolve().then(() => "settled in a microtask\n");
+  }
+  if (path === "/headers") {
+    return JSON.stringify(request.headers) + "\n";
+  }
+  if (path === "/text" && request.method === "POST") {
+    return request.body ? decoder.decode(request.body) : "";
+  }
+  return { status: 404, body: "Not Found\n" };
+}
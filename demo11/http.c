@@ -0,0 +1,289 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * HTTP/1.1 报文头的解析，不复制也不分配：方法、路径、头部名和值都是指向
+ * 读缓冲区的切片，只有交给 JS 时才转换成字符串。服务器解析请求，压测
+ * 客户端解析响应。消息体只支持 Content-Length，不支持分块编码。
+ */
+
+#define HTTP_MAX_HEADERS 64
+#define HTTP_MAX_HEAD 8192 // 请求行加头部的上限
+
+typedef struct {
+  const char *p;
+  size_t len;
+} HttpSlice;
+
+typedef struct {
+  HttpSlice method; // 请求
+  HttpSlice target;
+  int status;       // 响应
+  int minor;        // HTTP/1.x 的 x
+  HttpSlice names[HTTP_MAX_HEADERS];
+  HttpSlice values[HTTP_MAX_HEADERS];
+  int num_headers;
+  size_t content_length;
+  int keep_alive;
+  int chunked;
+} HttpMessage;
+
+typedef enum {
+  HTTP_INCOMPLETE = 0,
+  HTTP_BAD_REQUEST = -1,
+  HTTP_TOO_LARGE = -2, // 头部超过 HTTP_MAX_HEAD 或 HTTP_MAX_HEADERS
+} HttpParseError;
+
+// 不区分大小写地比较切片与小写的 s
+static int http_slice_eq(HttpSlice a, const char *s) {
+  size_t n = strlen(s);
+  if (a.len != n)
+    return 0;
+  for (size_t i = 0; i < n; i++) {
+    char c = a.p[i];
+    if (c >= 'A' && c <= 'Z')
+      c += 'a' - 'A';
+    if (c != s[i])
+      return 0;
+  }
+  return 1;
+}
+
+// 逗号分隔的值中是否有 token（Connection: keep-alive, Upgrade）
+static int http_has_token(HttpSlice v, const char *token) {
+  const char *p = v.p, *end = v.p + v.len;
+  while (p < end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == ','))
+      p++;
+    const char *start = p;
+    while (p < end && *p != ',')
+      p++;
+    const char *stop = p;
+    while (stop > start && (stop[-1] == ' ' || stop[-1] == '\t'))
+      stop--;
+    if (http_slice_eq((HttpSlice){start, stop - start}, token))
+      return 1;
+  }
+  return 0;
+}
+
+// 取一行，不含行尾的 CRLF（也接受单独的 LF），没有完整的行时返回 NULL
+static const char *http_next_line(const char *p, const char *end,
+                                  HttpSlice *line) {
+  const char *nl = memchr(p, '\n', end - p);
+  if (!nl)
+    return NULL;
+  line->p = p;
+  line->len = nl - p;
+  if (line->len > 0 && nl[-1] == '\r')
+    line->len--;
+  return nl + 1;
+}
+
+static int http_parse_version(HttpSlice v, int *minor) {
+  if (v.len != 8 || memcmp(v.p, "HTTP/1.", 7) != 0 || v.p[7] < '0' ||
+      v.p[7] > '9')
+    return -1;
+  *minor = v.p[7] - '0';
+  return 0;
+}
+
+// 请求行 "GET /path HTTP/1.1"
+static int http_parse_request_line(HttpSlice line, HttpMessage *m) {
+  const char *p = line.p, *end = line.p + line.len;
+  const char *sp1 = memchr(p, ' ', end - p);
+  if (!sp1 || sp1 == p)
+    return -1;
+  const char *sp2 = memchr(sp1 + 1, ' ', end - sp1 - 1);
+  if (!sp2 || sp2 == sp1 + 1)
+    return -1;
+  m->method = (HttpSlice){p, sp1 - p};
+  m->target = (HttpSlice){sp1 + 1, sp2 - sp1 - 1};
+  return http_parse_version((HttpSlice){sp2 + 1, end - sp2 - 1}, &m->minor);
+}
+
+// 状态行 "HTTP/1.1 200 OK"
+static int http_parse_status_line(HttpSlice line, HttpMessage *m) {
+  if (line.len < 12 || line.p[8] != ' ' ||
+      http_parse_version((HttpSlice){line.p, 8}, &m->minor) < 0)
+    return -1;
+  m->status = 0;
+  for (int i = 9; i < 12; i++) {
+    if (line.p[i] < '0' || line.p[i] > '9')
+      return -1;
+    m->status = m->status * 10 + line.p[i] - '0';
+  }
+  return 0;
+}
+
+/*
+ * 解析 buf 开头的报文头，成功时返回头部的字节数（含结尾的空行），
+ * 消息体紧随其后，长度为 m->content_length。数据还不完整时返回
+ * HTTP_INCOMPLETE，调用方收到更多数据后从头重新解析。
+ */
+static int http_parse(const char *buf, size_t len, int is_response,
+                      HttpMessage *m) {
+  const char *p = buf, *end = buf + (len < HTTP_MAX_HEAD ? len : HTTP_MAX_HEAD);
+  HttpSlice line;
+
+  // 请求之间允许多余的空行
+  while (p < end && (*p == '\r' || *p == '\n'))
+    p++;
+  const char *next = http_next_line(p, end, &line);
+  if (!next)
+    return len >= HTTP_MAX_HEAD ? HTTP_TOO_LARGE : HTTP_INCOMPLETE;
+  m->num_headers = 0;
+  m->content_length = 0;
+  m->chunked = 0;
+  if ((is_response ? http_parse_status_line(line, m)
+                   : http_parse_request_line(line, m)) < 0)
+    return HTTP_BAD_REQUEST;
+  // HTTP/1.1 默认保持连接，1.0 默认关闭
+  m->keep_alive = m->minor >= 1;
+
+  int have_length = 0;
+  for (;;) {
+    p = next;
+    next = http_next_line(p, end, &line);
+    if (!next)
+      return len >= HTTP_MAX_HEAD ? HTTP_TOO_LARGE : HTTP_INCOMPLETE;
+    if (line.len == 0)
+      break;
+    if (m->num_headers == HTTP_MAX_HEADERS)
+      return HTTP_TOO_LARGE;
+
+    const char *colon = memchr(line.p, ':', line.len);
+    // 名字不能为空，也不能含空白（防止请求走私）
+    if (!colon || colon == line.p)
+      return HTTP_BAD_REQUEST;
+    HttpSlice name = {line.p, colon - line.p};
+    for (size_t i = 0; i < name.len; i++) {
+      if (name.p[i] == ' ' || name.p[i] == '\t')
+        return HTTP_BAD_REQUEST;
+    }
+    const char *v = colon + 1, *vend = line.p + line.len;
+    while (v < vend && (*v == ' ' || *v == '\t'))
+      v++;
+    while (vend > v && (vend[-1] == ' ' || vend[-1] == '\t'))
+      vend--;
+    HttpSlice value = {v, vend - v};
+    m->names[m->num_headers] = name;
+    m->values[m->num_headers] = value;
+    m->num_headers++;
+
+    if (http_slice_eq(name, "content-length")) {
+      size_t n = 0;
+      if (value.len == 0 || value.len > 15)
+        return HTTP_BAD_REQUEST;
+      for (size_t i = 0; i < value.len; i++) {
+        if (value.p[i] < '0' || value.p[i] > '9')
+          return HTTP_BAD_REQUEST;
+        n = n * 10 + (value.p[i] - '0');
+      }
+      if (have_length && n != m->content_length)
+        return HTTP_BAD_REQUEST;
+      m->content_length = n;
+      have_length = 1;
+    } else if (http_slice_eq(name, "connection")) {
+      if (http_has_token(value, "close"))
+        m->keep_alive = 0;
+      else if (http_has_token(value, "keep-alive"))
+        m->keep_alive = 1;
+    } else if (http_slice_eq(name, "transfer-encoding")) {
+      m->chunked = 1;
+    }
+  }
+  // 同时带 Content-Length 和 Transfer-Encoding 的请求按走私处理
+  if (m->chunked && have_length)
+    return HTTP_BAD_REQUEST;
+  return (int)(next - buf);
+}
+
+static const char *http_status_text(int status) {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 201:
+    return "Created";
+  case 204:
+    return "No Content";
+  case 301:
+    return "Moved Permanently";
+  case 302:
+    return "Found";
+  case 304:
+    return "Not Modified";
+  case 400:
+    return "Bad Request";
+  case 401:
+    return "Unauthorized";
+  case 403:
+    return "Forbidden";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 413:
+    return "Content Too Large";
+  case 431:
+    return "Request Header Fields Too Large";
+  case 500:
+    return "Internal Server Error";
+  case 501:
+    return "Not Implemented";
+  case 503:
+    return "Service Unavailable";
+  default:
+    return "Unknown";
+  }
+}
+
+// 可增长的输出缓冲区，一次读到的所有请求的响应拼在一起一次写出
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+} HttpBuffer;
+
+static int http_buffer_reserve(HttpBuffer *b, size_t n) {
+  if (b->len + n <= b->cap)
+    return 0;
+  size_t cap = b->cap ? b->cap : 4096;
+  while (cap < b->len + n)
+    cap *= 2;
+  char *data = realloc(b->data, cap);
+  if (!data)
+    return -1;
+  b->data = data;
+  b->cap = cap;
+  return 0;
+}
+
+static int http_buffer_append(HttpBuffer *b, const void *p, size_t n) {
+  if (http_buffer_reserve(b, n) < 0)
+    return -1;
+  memcpy(b->data + b->len, p, n);
+  b->len += n;
+  return 0;
+}
+
+static int http_buffer_printf(HttpBuffer *b, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static int http_buffer_printf(HttpBuffer *b, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  if (n < 0 || http_buffer_reserve(b, n + 1) < 0)
+    return -1;
+  va_start(ap, fmt);
+  vsnprintf(b->data + b->len, n + 1, fmt, ap);
+  va_end(ap);
+  b->len += n;
+  return 0;
+}
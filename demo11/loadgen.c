@@ -0,0 +1,322 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <uv.h>
+
+#include "../helpers/clock.c"
+
+/*
+ * 回环压测客户端：每个客户端线程一个 libuv 事件循环，负责一部分连接。
+ * 每个连接一次发出 pipeline 个请求，收齐响应后再发下一批，记录每个
+ * 请求从发出到收到完整响应的时间。到时间后不再发新请求，等已发出的
+ * 请求完成后关闭连接。响应用 http.c 解析，需要在 server.c 之后包含。
+ */
+
+#define LOAD_PIPELINE_MAX 256 // 每个连接一批最多发出的请求数
+
+typedef struct LoadClient LoadClient;
+
+typedef struct {
+  uv_tcp_t handle;
+  uv_connect_t connect;
+  LoadClient *client;
+  char *in;
+  size_t in_len;
+  size_t in_cap;
+  int outstanding; // 已发出、还没有收到响应的请求数
+  double sent_ms;  // 这一批请求的发出时间
+} LoadConnection;
+
+struct LoadClient {
+  pthread_t thread;
+  uv_loop_t loop;
+  uv_timer_t timer;
+  int port;
+  int connections;
+  int pipeline;
+  double duration_ms;
+  uv_buf_t batch; // pipeline 个请求拼在一起，所有连接共用
+  int stopping;
+  double *latencies; // 毫秒
+  size_t count;
+  size_t cap;
+  uint64_t errors; // 非 2xx 响应、连接失败或被服务器关闭
+};
+
+static void load_close_cb(uv_handle_t *handle) {
+  LoadConnection *c = (LoadConnection *)handle->data;
+  free(c->in);
+  free(c);
+}
+
+static void load_close(LoadConnection *c) {
+  if (!uv_is_closing((uv_handle_t *)&c->handle))
+    uv_close((uv_handle_t *)&c->handle, load_close_cb);
+}
+
+static void load_record(LoadClient *client, double ms) {
+  if (client->count == client->cap) {
+    size_t cap = client->cap ? client->cap * 2 : 1 << 16;
+    double *grown = realloc(client->latencies, cap * sizeof(double));
+    if (!grown)
+      return;
+    client->latencies = grown;
+    client->cap = cap;
+  }
+  client->latencies[client->count++] = ms;
+}
+
+static void load_write_cb(uv_write_t *req, int status) {
+  LoadConnection *c = (LoadConnection *)req->data;
+  free(req);
+  if (status < 0) {
+    c->client->errors++;
+    load_close(c);
+  }
+}
+
+// 发出下一批请求，到时间后关闭连接
+static void load_send(LoadConnection *c) {
+  LoadClient *client = c->client;
+  if (client->stopping) {
+    load_close(c);
+    return;
+  }
+  uv_write_t *req = malloc(sizeof(uv_write_t));
+  if (!req) {
+    client->errors++;
+    load_close(c);
+    return;
+  }
+  req->data = c;
+  c->outstanding = client->pipeline;
+  c->sent_ms = get_time_ms();
+  if (uv_write(req, (uv_stream_t *)&c->handle, &client->batch, 1,
+               load_write_cb) < 0) {
+    free(req);
+    c->outstanding = 0;
+    client->errors++;
+    load_close(c);
+  }
+}
+
+static void load_alloc_cb(uv_handle_t *handle, size_t suggested_size,
+                          uv_buf_t *buf) {
+  LoadConnection *c = (LoadConnection *)handle->data;
+  if (c->in_cap - c->in_len < 16384) {
+    size_t cap = c->in_cap ? c->in_cap * 2 : 65536;
+    char *in = realloc(c->in, cap);
+    if (!in) {
+      *buf = uv_buf_init(NULL, 0);
+      return;
+    }
+    c->in = in;
+    c->in_cap = cap;
+  }
+  *buf = uv_buf_init(c->in + c->in_len, c->in_cap - c->in_len);
+}
+
+static void load_read_cb(uv_stream_t *stream, ssize_t nread,
+                         const uv_buf_t *buf) {
+  LoadConnection *c = (LoadConnection *)stream->data;
+  LoadClient *client = c->client;
+  if (nread < 0) {
+    if (c->outstanding > 0)
+      client->errors++;
+    load_close(c);
+    return;
+  }
+  c->in_len += nread;
+
+  size_t off = 0;
+  double now = get_time_ms();
+  while (c->outstanding > 0) {
+    HttpMessage m;
+    int head = http_parse(c->in + off, c->in_len - off, 1, &m);
+    if (head == HTTP_INCOMPLETE ||
+        (head > 0 && c->in_len - off < head + m.content_length))
+      break;
+    if (head < 0 || m.chunked) {
+      client->errors++;
+      load_close(c);
+      return;
+    }
+    off += head + m.content_length;
+    c->outstanding--;
+    if (m.status < 200 || m.status > 299)
+      client->errors++;
+    // 到时间之后完成的请求不计入
+    if (!client->stopping)
+      load_record(client, now - c->sent_ms);
+    if (!m.keep_alive) {
+      client->errors++;
+      load_close(c);
+      return;
+    }
+  }
+  memmove(c->in, c->in + off, c->in_len - off);
+  c->in_len -= off;
+  if (c->outstanding == 0)
+    load_send(c);
+}
+
+static void load_connect_cb(uv_connect_t *req, int status) {
+  LoadConnection *c = (LoadConnection *)req->data;
+  if (status < 0) {
+    fprintf(stderr, "connect: %s\n", uv_strerror(status));
+    c->client->errors++;
+    load_close(c);
+    return;
+  }
+  uv_tcp_nodelay(&c->handle, 1);
+  uv_read_start((uv_stream_t *)&c->handle, load_alloc_cb, load_read_cb);
+  load_send(c);
+}
+
+static void load_timer_cb(uv_timer_t *timer) {
+  LoadClient *client = (LoadClient *)timer->data;
+  client->stopping = 1;
+  uv_close((uv_handle_t *)timer, NULL);
+}
+
+static void *load_client_main(void *arg) {
+  LoadClient *client = (LoadClient *)arg;
+  struct sockaddr_in addr;
+  uv_ip4_addr("127.0.0.1", client->port, &addr);
+  if (uv_loop_init(&client->loop) < 0) {
+    client->errors += client->connections;
+    return NULL;
+  }
+  uv_timer_init(&client->loop, &client->timer);
+  client->timer.data = client;
+  uv_timer_start(&client->timer, load_timer_cb, client->duration_ms, 0);
+
+  // 建立不了的连接计为错误
+  for (int i = 0; i < client->connections; i++) {
+    LoadConnection *c = calloc(1, sizeof(LoadConnection));
+    if (!c || uv_tcp_init(&client->loop, &c->handle) < 0) {
+      free(c);
+      client->errors++;
+      continue;
+    }
+    c->client = client;
+    c->handle.data = c;
+    c->connect.data = c;
+    if (uv_tcp_connect(&c->connect, &c->handle, (struct sockaddr *)&addr,
+                       load_connect_cb) < 0) {
+      client->errors++;
+      load_close(c);
+    }
+  }
+  uv_run(&client->loop, UV_RUN_DEFAULT);
+  uv_loop_close(&client->loop);
+  return NULL;
+}
+
+typedef struct {
+  int port;
+  int connections;
+  int pipeline;
+  int threads;
+  double seconds;
+  const char *path;
+} LoadConfig;
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+// 已排序数组的百分位数（最近秩）
+static double percentile(const double *sorted, size_t n, double p) {
+  if (n == 0)
+    return 0;
+  size_t rank = (size_t)(p * n + 0.999999);
+  if (rank < 1)
+    rank = 1;
+  if (rank > n)
+    rank = n;
+  return sorted[rank - 1];
+}
+
+// 运行压测并打印吞吐量和延迟分布，失败时返回 -1
+static int load_run(const LoadConfig *config) {
+  char request[1024];
+  int n = snprintf(request, sizeof(request),
+                   "GET %s HTTP/1.1\r\nHost: 127.0.0.1:%d\r\n\r\n",
+                   config->path, config->port);
+  if (n >= (int)sizeof(request))
+    return -1;
+  int threads = config->threads;
+  char *batch = malloc((size_t)n * config->pipeline);
+  LoadClient *clients = calloc(threads, sizeof(LoadClient));
+  if (!batch || !clients) {
+    fprintf(stderr, "Out of memory\n");
+    free(batch);
+    free(clients);
+    return -1;
+  }
+  for (int i = 0; i < config->pipeline; i++)
+    memcpy(batch + (size_t)i * n, request, n);
+
+  int started = 0;
+  for (int i = 0; i < threads; i++) {
+    LoadClient *client = &clients[i];
+    client->port = config->port;
+    // 连接平均分给各个线程
+    client->connections = config->connections / threads +
+                          (i < config->connections % threads);
+    client->pipeline = config->pipeline;
+    client->duration_ms = config->seconds * 1000;
+    client->batch = uv_buf_init(batch, (unsigned)n * config->pipeline);
+    if (pthread_create(&client->thread, NULL, load_client_main, client) != 0) {
+      fprintf(stderr, "Failed to start client thread %d\n", i);
+      break;
+    }
+    started++;
+  }
+
+  size_t total = 0;
+  uint64_t errors = 0;
+  for (int i = 0; i < started; i++) {
+    pthread_join(clients[i].thread, NULL);
+    total += clients[i].count;
+    errors += clients[i].errors;
+  }
+  double *all = started == threads
+                    ? malloc((total ? total : 1) * sizeof(double))
+                    : NULL;
+  size_t k = 0;
+  for (int i = 0; i < started; i++) {
+    if (all)
+      memcpy(all + k, clients[i].latencies,
+             clients[i].count * sizeof(double));
+    k += clients[i].count;
+    free(clients[i].latencies);
+  }
+  if (!all) {
+    if (started == threads)
+      fprintf(stderr, "Out of memory\n");
+    free(clients);
+    free(batch);
+    return -1;
+  }
+  qsort(all, total, sizeof(double), compare_double);
+
+  printf("Load: %d connections, pipeline %d, %d client threads, %.1f s, "
+         "GET %s\n",
+         config->connections, config->pipeline, threads, config->seconds,
+         config->path);
+  printf("Requests: %zu (%llu errors)\n", total, (unsigned long long)errors);
+  printf("Throughput: %.0f req/s\n", total / config->seconds);
+  printf("Latency (ms): p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+         percentile(all, total, 0.50), percentile(all, total, 0.90),
+         percentile(all, total, 0.99), percentile(all, total, 0.999),
+         total ? all[total - 1] : 0);
+
+  free(all);
+  free(clients);
+  free(batch);
+  return total > 0 ? 0 : -1;
+}
@@ -0,0 +1,130 @@
+// pthread_setaffinity_np / CPU_SET 需要
+#define _GNU_SOURCE
+#include "../helpers/file.c"
+#include "../quickjs/quickjs.h"
+#include "./server.c"
+#include "./loadgen.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void print_usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [--port N] [--threads N] [--pin] [--bench] "
+          "[--connections N] [--duration S] [--pipeline N] [--clients N] "
+          "[--path PATH] <handler.js>\n"
+          "  <handler.js> defines a global function handle(request)\n"
+          "  --threads N runs N workers, each with its own event loop and "
+          "runtime (default: online CPUs)\n"
+          "  --bench runs a loopback load test against the server and "
+          "exits\n"
+          "  --connections N, --duration S, --pipeline N, --clients N and "
+          "--path PATH configure the load test (64, 10, 1, 4, /)\n",
+          prog);
+}
+
+int main(int argc, char **argv) {
+  int port = 8080;
+  int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  int pin = 0;
+  int bench = 0;
+  LoadConfig load = {
+      .connections = 64,
+      .pipeline = 1,
+      .threads = 4,
+      .seconds = 10,
+      .path = "/",
+  };
+
+  int argi = 1;
+  while (argi < argc && strncmp(argv[argi], "--", 2) == 0) {
+    if (strcmp(argv[argi], "--port") == 0 && argi + 1 < argc) {
+      port = atoi(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--threads") == 0 && argi + 1 < argc) {
+      threads = atoi(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--pin") == 0) {
+      pin = 1;
+      argi++;
+    } else if (strcmp(argv[argi], "--bench") == 0) {
+      bench = 1;
+      argi++;
+    } else if (strcmp(argv[argi], "--connections") == 0 && argi + 1 < argc) {
+      load.connections = atoi(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--duration") == 0 && argi + 1 < argc) {
+      load.seconds = atof(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--pipeline") == 0 && argi + 1 < argc) {
+      load.pipeline = atoi(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--clients") == 0 && argi + 1 < argc) {
+      load.threads = atoi(argv[argi + 1]);
+      argi += 2;
+    } else if (strcmp(argv[argi], "--path") == 0 && argi + 1 < argc &&
+               argv[argi + 1][0] == '/') {
+      load.path = argv[argi + 1];
+      argi += 2;
+    } else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+  if (argi + 1 != argc || port <= 0 || port > 65535 || threads <= 0 ||
+      load.connections <= 0 || load.seconds <= 0 || load.pipeline <= 0 ||
+      load.pipeline > LOAD_PIPELINE_MAX || load.threads <= 0) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  // 客户端线程不多于连接数，否则有的线程没有连接
+  if (load.threads > load.connections)
+    load.threads = load.connections;
+  load.port = port;
+
+  const char *filename = argv[argi];
+  char *source = read_file_to_string(filename);
+  if (!source)
+    return 1;
+
+  Worker *workers = calloc(threads, sizeof(Worker));
+  for (int i = 0; i < threads; i++) {
+    workers[i].filename = filename;
+    workers[i].source = source;
+    workers[i].port = port;
+    workers[i].pin = pin;
+  }
+  ServerStartup startup;
+  int ret = 0;
+  if (server_start(workers, threads, &startup) < 0) {
+    ret = 1;
+  } else if (bench) {
+    if (load_run(&load) < 0)
+      ret = 1;
+  } else {
+    printf("Listening on http://0.0.0.0:%d with %d workers\n", port, threads);
+    fflush(stdout);
+    // 一直运行，直到进程被终止
+    for (;;)
+      pause();
+  }
+  server_stop(workers, threads);
+
+  // 工作线程结束之后再读计数
+  if (bench) {
+    printf("Workers:");
+    for (int i = 0; i < threads; i++)
+      printf(" %llu", (unsigned long long)workers[i].requests);
+    printf(" requests\n");
+  }
+
+  uint64_t errors = 0;
+  for (int i = 0; i < threads; i++)
+    errors += workers[i].errors;
+  if (errors)
+    fprintf(stderr, "%llu handler errors\n", (unsigned long long)errors);
+  free(workers);
+  free(source);
+  return ret;
+}
@@ -0,0 +1,618 @@
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <uv.h>
+
+#include "../helpers/console.c"
+#include "../helpers/crypto.c"
+#include "../helpers/encoding.c"
+#include "../quickjs/quickjs.h"
+#include "./http.c"
+
+/*
+ * 每个核心一个工作线程，各自有 libuv 事件循环、JSRuntime 和监听套接字。
+ * 所有监听套接字用 SO_REUSEPORT 绑定同一个端口，由内核把新连接分给
+ * 各个线程，请求从读到写都在同一个线程上完成，不需要跨线程传递。
+ *
+ * 处理函数是脚本中的全局函数 handle(request)，request 为
+ * { method, url, headers, body }，headers 的名字为小写，body 为
+ * ArrayBuffer（没有消息体时不设置）。返回值可以是字符串、ArrayBuffer、
+ * TypedArray，或 { status, headers, body }。async 函数只要在微任务中
+ * 完成也可以，处理函数中不能等待定时器或 I/O。
+ *
+ * 一次读到的所有请求（流水线）依次处理，响应拼在一起一次写出。
+ */
+
+#define HTTP_MAX_BODY (1 << 20)
+#define HTTP_READ_SIZE 16384
+#define HTTP_WRITE_HIGH_WATER (1 << 20) // 待写数据超过时暂停读
+
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int started; // 已经开始监听或失败的工作线程数
+  int failed;
+} ServerStartup;
+
+typedef struct {
+  int id;
+  pthread_t thread;
+  uv_loop_t loop;
+  uv_tcp_t server;
+  uv_async_t stop;
+  JSRuntime *rt;
+  JSContext *ctx;
+  JSValue handler;
+  const char *filename;
+  const char *source;
+  int port;
+  int pin;
+  ServerStartup *startup;
+  uint64_t requests;
+  uint64_t errors; // 处理函数抛出异常或返回无效的响应
+} Worker;
+
+typedef struct {
+  uv_tcp_t handle;
+  Worker *worker;
+  char *in; // 读缓冲区，未处理完的请求留在开头
+  size_t in_len;
+  size_t in_cap;
+  HttpBuffer out;
+  int reading;
+  int closing; // 写完已有的响应后关闭
+} HttpConnection;
+
+typedef struct {
+  uv_write_t req;
+  char *data; // 写完后释放
+} HttpWrite;
+
+static void http_conn_close_cb(uv_handle_t *handle) {
+  HttpConnection *c = (HttpConnection *)handle->data;
+  free(c->in);
+  free(c->out.data);
+  free(c);
+}
+
+static void http_conn_close(HttpConnection *c) {
+  if (uv_is_closing((uv_handle_t *)&c->handle))
+    return;
+  uv_close((uv_handle_t *)&c->handle, http_conn_close_cb);
+}
+
+static void http_print_exception(JSContext *ctx) {
+  JSValue exc = JS_GetException(ctx);
+  const char *str = JS_ToCString(ctx, exc);
+  fprintf(stderr, "handle: %s\n", str ? str : "exception");
+  JS_FreeCString(ctx, str);
+  JS_FreeValue(ctx, exc);
+}
+
+// 请求转成 JS 对象，只在这里把切片复制成字符串
+static JSValue http_request_to_js(JSContext *ctx, const HttpMessage *m,
+                                  const char *body) {
+  JSValue req = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, req, "method",
+                    JS_NewStringLen(ctx, m->method.p, m->method.len));
+  JS_SetPropertyStr(ctx, req, "url",
+                    JS_NewStringLen(ctx, m->target.p, m->target.len));
+  JSValue headers = JS_NewObject(ctx);
+  char name[HTTP_MAX_HEAD];
+  for (int i = 0; i < m->num_headers; i++) {
+    HttpSlice n = m->names[i], v = m->values[i];
+    for (size_t k = 0; k < n.len; k++)
+      name[k] = n.p[k] >= 'A' && n.p[k] <= 'Z' ? n.p[k] + ('a' - 'A') : n.p[k];
+    JSAtom atom = JS_NewAtomLen(ctx, name, n.len);
+    JSValue value = JS_NewStringLen(ctx, v.p, v.len);
+    // 重复的头部按逗号合并
+    JSValue prev = JS_GetProperty(ctx, headers, atom);
+    if (JS_IsString(prev)) {
+      size_t plen;
+      const char *p = JS_ToCStringLen(ctx, &plen, prev);
+      char *joined = p ? malloc(plen + 2 + v.len) : NULL;
+      if (joined) {
+        memcpy(joined, p, plen);
+        memcpy(joined + plen, ", ", 2);
+        memcpy(joined + plen + 2, v.p, v.len);
+        JS_FreeValue(ctx, value);
+        value = JS_NewStringLen(ctx, joined, plen + 2 + v.len);
+        free(joined);
+      }
+      JS_FreeCString(ctx, p);
+    }
+    JS_FreeValue(ctx, prev);
+    JS_SetProperty(ctx, headers, atom, value);
+    JS_FreeAtom(ctx, atom);
+  }
+  JS_SetPropertyStr(ctx, req, "headers", headers);
+  if (m->content_length > 0)
+    JS_SetPropertyStr(ctx, req, "body",
+                      JS_NewArrayBufferCopy(ctx, (const uint8_t *)body,
+                                            m->content_length));
+  return req;
+}
+
+// 响应头的名字和值不能含 CR/LF，防止注入
+static int http_header_safe(const char *s, size_t len) {
+  return memchr(s, '\r', len) == NULL && memchr(s, '\n', len) == NULL;
+}
+
+// 写出用户设置的头部，返回是否设置了 Content-Type，失败时返回 -1
+static int http_write_user_headers(JSContext *ctx, HttpBuffer *out,
+                                   JSValueConst headers) {
+  JSPropertyEnum *tab;
+  uint32_t len;
+  int has_type = 0, ret = 0;
+  if (JS_GetOwnPropertyNames(ctx, &tab, &len, headers,
+                             JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) < 0)
+    return -1;
+  for (uint32_t i = 0; i < len; i++) {
+    const char *name = JS_AtomToCString(ctx, tab[i].atom);
+    JSValue v = JS_GetProperty(ctx, headers, tab[i].atom);
+    size_t vlen;
+    const char *value = JS_IsException(v) ? NULL : JS_ToCStringLen(ctx, &vlen, v);
+    JS_FreeValue(ctx, v);
+    if (!name || !value) {
+      ret = -1;
+    } else if (!http_header_safe(name, strlen(name)) ||
+               !http_header_safe(value, vlen)) {
+      JS_ThrowTypeError(ctx, "invalid header %s", name);
+      ret = -1;
+    } else if (strcasecmp(name, "content-length") != 0 &&
+               strcasecmp(name, "transfer-encoding") != 0 &&
+               strcasecmp(name, "connection") != 0) {
+      // 消息体的长度和连接状态由服务器设置，不能同时出现两种分帧头
+      has_type |= strcasecmp(name, "content-type") == 0;
+      http_buffer_printf(out, "%s: %.*s\r\n", name, (int)vlen, value);
+    }
+    JS_FreeCString(ctx, name);
+    JS_FreeCString(ctx, value);
+    if (ret < 0)
+      break;
+  }
+  for (uint32_t i = 0; i < len; i++)
+    JS_FreeAtom(ctx, tab[i].atom);
+  js_free(ctx, tab);
+  return ret < 0 ? -1 : has_type;
+}
+
+// 响应的 Connection 头，m 为 NULL 时关闭连接。HTTP/1.1 默认保持连接，
+// HTTP/1.0 默认关闭，保持连接时必须明确写出 keep-alive
+static const char *http_connection_header(const HttpMessage *m) {
+  if (!m || !m->keep_alive)
+    return "Connection: close\r\n";
+  return m->minor == 0 ? "Connection: keep-alive\r\n" : "";
+}
+
+/*
+ * 把处理函数对请求 m 的返回值写成响应，失败时抛出异常并返回 -1，
+ * out 保持不变。HEAD 请求只写头部。
+ */
+static int http_write_response(JSContext *ctx, HttpBuffer *out,
+                               JSValueConst ret, const HttpMessage *m) {
+  int32_t status = 200;
+  JSValue headers = JS_UNDEFINED, body = JS_UNDEFINED;
+  size_t start = out->len;
+  int result = -1;
+
+  if (JS_IsObject(ret) && !JS_IsFunction(ctx, ret)) {
+    JSAtom keys[3] = {JS_NewAtom(ctx, "status"), JS_NewAtom(ctx, "headers"),
+                      JS_NewAtom(ctx, "body")};
+    int is_response = JS_HasProperty(ctx, ret, keys[0]) > 0 ||
+                      JS_HasProperty(ctx, ret, keys[1]) > 0 ||
+                      JS_HasProperty(ctx, ret, keys[2]) > 0;
+    if (is_response) {
+      JSValue s = JS_GetProperty(ctx, ret, keys[0]);
+      headers = JS_GetProperty(ctx, ret, keys[1]);
+      body = JS_GetProperty(ctx, ret, keys[2]);
+      if (!JS_IsUndefined(s) && JS_ToInt32(ctx, &status, s) < 0)
+        status = -1;
+      JS_FreeValue(ctx, s);
+    } else {
+      body = JS_DupValue(ctx, ret);
+    }
+    for (int i = 0; i < 3; i++)
+      JS_FreeAtom(ctx, keys[i]);
+  } else {
+    body = JS_DupValue(ctx, ret);
+  }
+  if (status < 100 || status > 999) {
+    if (status != -1)
+      JS_ThrowRangeError(ctx, "invalid status %d", status);
+    goto done;
+  }
+
+  // 消息体：字符串按 UTF-8，其余按二进制数据原地读取
+  const char *str = NULL;
+  const uint8_t *data = NULL;
+  size_t len = 0;
+  const char *type = NULL;
+  int binary = 0;
+  if (JS_IsString(body)) {
+    str = JS_ToCStringLen(ctx, &len, body);
+    if (!str)
+      goto done;
+    data = (const uint8_t *)str;
+    type = "text/plain; charset=utf-8";
+  } else if (!JS_IsUndefined(body) && !JS_IsNull(body)) {
+    binary = 1;
+    type = "application/octet-stream";
+  }
+  // 1xx、204 和 304 没有消息体
+  int no_body = status < 200 || status == 204 || status == 304;
+
+  http_buffer_printf(out, "HTTP/1.1 %d %s\r\n", status,
+                     http_status_text(status));
+  if (JS_IsObject(headers)) {
+    int has_type = http_write_user_headers(ctx, out, headers);
+    if (has_type < 0) {
+      JS_FreeCString(ctx, str);
+      goto done;
+    }
+    if (has_type)
+      type = NULL;
+  }
+  // headers 的 getter 和 toString 可能转移 body 的缓冲区，写完头部再取数据
+  if (binary) {
+    data = js_encoding_get_bytes(ctx, body, &len);
+    if (!data)
+      goto done;
+  }
+  if (!no_body) {
+    if (type && len > 0)
+      http_buffer_printf(out, "Content-Type: %s\r\n", type);
+    http_buffer_printf(out, "Content-Length: %zu\r\n", len);
+  }
+  http_buffer_printf(out, "%s\r\n", http_connection_header(m));
+  if (!no_body && !http_slice_eq(m->method, "head"))
+    http_buffer_append(out, data, len);
+  JS_FreeCString(ctx, str);
+  result = 0;
+
+done:
+  if (result < 0)
+    out->len = start;
+  JS_FreeValue(ctx, headers);
+  JS_FreeValue(ctx, body);
+  return result;
+}
+
+// m 为 NULL 时（请求无法解析）响应后关闭连接
+static void http_write_error(HttpConnection *c, int status,
+                             const HttpMessage *m) {
+  const char *text = http_status_text(status);
+  http_buffer_printf(&c->out,
+                     "HTTP/1.1 %d %s\r\nContent-Type: text/plain; "
+                     "charset=utf-8\r\nContent-Length: %zu\r\n%s\r\n%s\n",
+                     status, text, strlen(text) + 1,
+                     http_connection_header(m), text);
+}
+
+// 在工作线程的运行时上调用处理函数
+static void http_handle_request(HttpConnection *c, const HttpMessage *m,
+                                const char *body) {
+  Worker *w = c->worker;
+  JSContext *ctx = w->ctx;
+  JSValue req = http_request_to_js(ctx, m, body);
+  JSValue ret = JS_Call(ctx, w->handler, JS_UNDEFINED, 1, &req);
+  JS_FreeValue(ctx, req);
+
+  // 执行处理函数排入的微任务，async 处理函数在这里完成。某个任务抛出
+  // 异常时打印并清掉，继续执行后面的任务，不留给下一个请求
+  JSContext *job_ctx;
+  int job;
+  while ((job = JS_ExecutePendingJob(w->rt, &job_ctx)) != 0) {
+    if (job < 0) {
+      http_print_exception(job_ctx);
+      w->errors++;
+    }
+  }
+  if (!JS_IsException(ret) && JS_IsObject(ret) &&
+      (int)JS_PromiseState(ctx, ret) >= 0) {
+    JSPromiseStateEnum state = JS_PromiseState(ctx, ret);
+    JSValue result = JS_PromiseResult(ctx, ret);
+    JS_FreeValue(ctx, ret);
+    if (state == JS_PROMISE_FULFILLED) {
+      ret = result;
+    } else {
+      if (state == JS_PROMISE_REJECTED)
+        JS_Throw(ctx, result);
+      else {
+        JS_FreeValue(ctx, result);
+        JS_ThrowInternalError(ctx, "handler did not settle in microtasks");
+      }
+      ret = JS_EXCEPTION;
+    }
+  }
+
+  if (JS_IsException(ret) || http_write_response(ctx, &c->out, ret, m) < 0) {
+    http_print_exception(ctx);
+    http_write_error(c, 500, m);
+    w->errors++;
+  }
+  JS_FreeValue(ctx, ret);
+  w->requests++;
+}
+
+static void http_on_read(uv_stream_t *stream, ssize_t nread,
+                         const uv_buf_t *buf);
+
+static void http_alloc_cb(uv_handle_t *handle, size_t suggested_size,
+                          uv_buf_t *buf) {
+  HttpConnection *c = (HttpConnection *)handle->data;
+  if (c->in_cap - c->in_len < HTTP_READ_SIZE) {
+    size_t cap = c->in_cap ? c->in_cap * 2 : HTTP_READ_SIZE;
+    while (cap - c->in_len < HTTP_READ_SIZE)
+      cap *= 2;
+    char *in = realloc(c->in, cap);
+    if (!in) {
+      *buf = uv_buf_init(NULL, 0);
+      return;
+    }
+    c->in = in;
+    c->in_cap = cap;
+  }
+  *buf = uv_buf_init(c->in + c->in_len, c->in_cap - c->in_len);
+}
+
+static void http_set_reading(HttpConnection *c, int reading) {
+  if (reading == c->reading)
+    return;
+  c->reading = reading;
+  if (reading)
+    uv_read_start((uv_stream_t *)&c->handle, http_alloc_cb, http_on_read);
+  else
+    uv_read_stop((uv_stream_t *)&c->handle);
+}
+
+static void http_write_cb(uv_write_t *req, int status) {
+  HttpWrite *wr = (HttpWrite *)req;
+  HttpConnection *c = (HttpConnection *)req->handle->data;
+  free(wr->data);
+  free(wr);
+  if (status < 0) {
+    http_conn_close(c);
+    return;
+  }
+  if (c->handle.write_queue_size > 0)
+    return;
+  if (c->closing)
+    http_conn_close(c);
+  else
+    http_set_reading(c, 1);
+}
+
+// 写出 out 中的响应：先直接写，写不完的部分交给 uv_write
+static void http_flush(HttpConnection *c) {
+  uv_stream_t *stream = (uv_stream_t *)&c->handle;
+  size_t done = 0;
+  if (c->out.len > 0 && stream->write_queue_size == 0) {
+    uv_buf_t b = uv_buf_init(c->out.data, c->out.len);
+    int n = uv_try_write(stream, &b, 1);
+    if (n > 0)
+      done = n;
+    else if (n < 0 && n != UV_EAGAIN) {
+      http_conn_close(c);
+      return;
+    }
+  }
+  if (done < c->out.len) {
+    // 剩余部分连同缓冲区一起交给写请求
+    HttpWrite *wr = malloc(sizeof(HttpWrite));
+    if (!wr) {
+      http_conn_close(c);
+      return;
+    }
+    wr->data = c->out.data;
+    uv_buf_t b = uv_buf_init(c->out.data + done, c->out.len - done);
+    c->out = (HttpBuffer){0};
+    if (uv_write(&wr->req, stream, &b, 1, http_write_cb) < 0) {
+      free(wr->data);
+      free(wr);
+      http_conn_close(c);
+      return;
+    }
+  } else {
+    c->out.len = 0;
+  }
+
+  if (stream->write_queue_size == 0 && c->closing)
+    http_conn_close(c);
+  else if (c->closing || stream->write_queue_size > HTTP_WRITE_HIGH_WATER)
+    http_set_reading(c, 0);
+}
+
+// 依次处理读缓冲区中完整的请求
+static void http_process(HttpConnection *c) {
+  size_t off = 0;
+  while (!c->closing && off < c->in_len) {
+    HttpMessage m;
+    int head = http_parse(c->in + off, c->in_len - off, 0, &m);
+    if (head == HTTP_INCOMPLETE)
+      break;
+    if (head < 0 || m.chunked || m.content_length > HTTP_MAX_BODY) {
+      http_write_error(c,
+                       head == HTTP_TOO_LARGE ? 431
+                       : head < 0             ? 400
+                       : m.chunked            ? 501
+                                              : 413,
+                       NULL);
+      c->closing = 1;
+      break;
+    }
+    if (c->in_len - off < head + m.content_length)
+      break;
+    http_handle_request(c, &m, c->in + off + head);
+    off += head + m.content_length;
+    if (!m.keep_alive)
+      c->closing = 1;
+  }
+  memmove(c->in, c->in + off, c->in_len - off);
+  c->in_len -= off;
+  http_flush(c);
+}
+
+static void http_on_read(uv_stream_t *stream, ssize_t nread,
+                         const uv_buf_t *buf) {
+  HttpConnection *c = (HttpConnection *)stream->data;
+  if (nread < 0) {
+    // 对端关闭或出错，未写完的响应随之丢弃
+    http_conn_close(c);
+    return;
+  }
+  c->in_len += nread;
+  if (nread > 0)
+    http_process(c);
+}
+
+static void http_on_connection(uv_stream_t *server, int status) {
+  Worker *w = (Worker *)server->data;
+  if (status < 0)
+    return;
+  HttpConnection *c = calloc(1, sizeof(HttpConnection));
+  if (!c)
+    return;
+  c->worker = w;
+  c->handle.data = c;
+  uv_tcp_init(&w->loop, &c->handle);
+  if (uv_accept(server, (uv_stream_t *)&c->handle) < 0) {
+    http_conn_close(c);
+    return;
+  }
+  uv_tcp_nodelay(&c->handle, 1);
+  http_set_reading(c, 1);
+}
+
+static void worker_close_walk(uv_handle_t *handle, void *arg) {
+  if (uv_is_closing(handle))
+    return;
+  if (handle->type == UV_TCP && handle->data != arg)
+    http_conn_close((HttpConnection *)handle->data);
+  else
+    uv_close(handle, NULL);
+}
+
+// 关闭监听套接字和所有连接，uv_run 随之返回
+static void worker_on_stop(uv_async_t *handle) {
+  Worker *w = (Worker *)handle->data;
+  uv_walk(&w->loop, worker_close_walk, w);
+}
+
+static void worker_started(Worker *w, int ok) {
+  pthread_mutex_lock(&w->startup->mutex);
+  w->startup->started++;
+  if (!ok)
+    w->startup->failed++;
+  pthread_cond_signal(&w->startup->cond);
+  pthread_mutex_unlock(&w->startup->mutex);
+}
+
+// 创建运行时并加载脚本，取得全局的 handle 函数
+static int worker_init_js(Worker *w) {
+  w->rt = JS_NewRuntime();
+  w->ctx = JS_NewContext(w->rt);
+  w->handler = JS_UNDEFINED;
+  js_std_init_console(w->ctx);
+  js_std_init_encoding(w->ctx);
+  js_std_init_crypto(w->ctx);
+
+  JSValue val = JS_Eval(w->ctx, w->source, strlen(w->source), w->filename,
+                        JS_EVAL_TYPE_GLOBAL);
+  if (JS_IsException(val)) {
+    http_print_exception(w->ctx);
+    return -1;
+  }
+  JS_FreeValue(w->ctx, val);
+  JSValue global = JS_GetGlobalObject(w->ctx);
+  w->handler = JS_GetPropertyStr(w->ctx, global, "handle");
+  JS_FreeValue(w->ctx, global);
+  if (!JS_IsFunction(w->ctx, w->handler)) {
+    fprintf(stderr, "%s does not define a global function handle(request)\n",
+            w->filename);
+    return -1;
+  }
+  return 0;
+}
+
+static int worker_listen(Worker *w) {
+  struct sockaddr_in addr;
+  uv_ip4_addr("0.0.0.0", w->port, &addr);
+  uv_os_fd_t fd;
+  int one = 1, err;
+  if ((err = uv_tcp_init_ex(&w->loop, &w->server, AF_INET)) < 0)
+    goto fail;
+  w->server.data = w;
+  if ((err = uv_fileno((uv_handle_t *)&w->server, &fd)) < 0)
+    goto fail;
+  // 每个线程一个监听套接字，内核按连接的四元组分配
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+    fprintf(stderr, "worker %d: SO_REUSEPORT: %s\n", w->id, strerror(errno));
+    return -1;
+  }
+  if ((err = uv_tcp_bind(&w->server, (struct sockaddr *)&addr, 0)) < 0 ||
+      (err = uv_listen((uv_stream_t *)&w->server, 1024, http_on_connection)) <
+          0) {
+    fprintf(stderr, "worker %d: listen on port %d: %s\n", w->id, w->port,
+            uv_strerror(err));
+    return -1;
+  }
+  return 0;
+
+fail:
+  fprintf(stderr, "worker %d: %s\n", w->id, uv_strerror(err));
+  return -1;
+}
+
+static void *worker_main(void *arg) {
+  Worker *w = (Worker *)arg;
+  if (w->pin) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(w->id % sysconf(_SC_NPROCESSORS_ONLN), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+  uv_loop_init(&w->loop);
+  uv_async_init(&w->loop, &w->stop, worker_on_stop);
+  w->stop.data = w;
+
+  worker_started(w, worker_init_js(w) == 0 && worker_listen(w) == 0);
+  // 启动失败时同样等到 server_stop，stop 句柄保持事件循环运行
+  uv_run(&w->loop, UV_RUN_DEFAULT);
+  uv_loop_close(&w->loop);
+
+  JS_FreeValue(w->ctx, w->handler);
+  JS_FreeContext(w->ctx);
+  JS_FreeRuntime(w->rt);
+  return NULL;
+}
+
+// 启动 n 个工作线程并等待全部开始监听，任一失败时返回 -1
+static int server_start(Worker *workers, int n, ServerStartup *startup) {
+  pthread_mutex_init(&startup->mutex, NULL);
+  pthread_cond_init(&startup->cond, NULL);
+  startup->started = startup->failed = 0;
+  for (int i = 0; i < n; i++) {
+    workers[i].id = i;
+    workers[i].startup = startup;
+    pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+  }
+  pthread_mutex_lock(&startup->mutex);
+  while (startup->started < n)
+    pthread_cond_wait(&startup->cond, &startup->mutex);
+  pthread_mutex_unlock(&startup->mutex);
+  return startup->failed ? -1 : 0;
+}
+
+static void server_stop(Worker *workers, int n) {
+  for (int i = 0; i < n; i++)
+    uv_async_send(&workers[i].stop);
+  for (int i = 0; i < n; i++)
+    pthread_join(workers[i].thread, NULL);
+}
@@ -0,0 +1,117 @@
+#ifndef HELPERS_ALLOC_C
+#define HELPERS_ALLOC_C
+
+#include "../quickjs/quickjs.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+// 与 quickjs 默认分配器保持一致的每次分配额外开销
+#define JS_ALLOC_OVERHEAD 8
+
+// 运行时分配统计，由自定义分配器维护
+typedef struct {
+  size_t allocated_bytes; // 累计分配的字节数（只增不减）
+  size_t freed_bytes;     // 累计释放的字节数
+  size_t live_bytes;      // 当前仍在使用的字节数
+  size_t peak_live_bytes; // live_bytes 的峰值
+  size_t alloc_count;     // 累计分配次数
+} JSAllocStats;
+
+static size_t js_tracked_usable_size(const void *ptr) {
+#if defined(__APPLE__)
+  return malloc_size(ptr);
+#else
+  return malloc_usable_size((void *)ptr);
+#endif
+}
+
+static void js_tracked_account(JSAllocStats *stats, size_t old_size,
+                               size_t new_size) {
+  if (new_size > old_size) {
+    stats->allocated_bytes += new_size - old_size;
+  } else {
+    stats->freed_bytes += old_size - new_size;
+  }
+  stats->live_bytes = stats->live_bytes + new_size - old_size;
+  if (stats->live_bytes > stats->peak_live_bytes)
+    stats->peak_live_bytes = stats->live_bytes;
+}
+
+static void *js_tracked_malloc(JSMallocState *s, size_t size) {
+  void *ptr;
+
+  if (s->malloc_size + size > s->malloc_limit)
+    return NULL;
+
+  ptr = malloc(size);
+  if (!ptr)
+    return NULL;
+
+  size_t usable = js_tracked_usable_size(ptr) + JS_ALLOC_OVERHEAD;
+  s->malloc_count++;
+  s->malloc_size += usable;
+
+  JSAllocStats *stats = s->opaque;
+  stats->alloc_count++;
+  js_tracked_account(stats, 0, usable);
+  return ptr;
+}
+
+static void js_tracked_free(JSMallocState *s, void *ptr) {
+  if (!ptr)
+    return;
+
+  size_t usable = js_tracked_usable_size(ptr) + JS_ALLOC_OVERHEAD;
+  s->malloc_count--;
+  s->malloc_size -= usable;
+  js_tracked_account(s->opaque, usable, 0);
+  free(ptr);
+}
+
+static void *js_tracked_realloc(JSMallocState *s, void *ptr, size_t size) {
+  size_t old_size;
+
+  if (!ptr) {
+    if (size == 0)
+      return NULL;
+    return js_tracked_malloc(s, size);
+  }
+
+  old_size = js_tracked_usable_size(ptr) + JS_ALLOC_OVERHEAD;
+  if (size == 0) {
+    js_tracked_free(s, ptr);
+    return NULL;
+  }
+
+  if (s->malloc_size + size - (old_size - JS_ALLOC_OVERHEAD) > s->malloc_limit)
+    return NULL;
+
+  ptr = realloc(ptr, size);
+  if (!ptr)
+    return NULL;
+
+  size_t new_size = js_tracked_usable_size(ptr) + JS_ALLOC_OVERHEAD;
+  s->malloc_size += new_size - old_size;
+  js_tracked_account(s->opaque, old_size, new_size);
+  return ptr;
+}
+
+static const JSMallocFunctions js_tracked_malloc_funcs = {
+    js_tracked_malloc,
+    js_tracked_free,
+    js_tracked_realloc,
+    js_tracked_usable_size,
+};
+
+// 创建一个带分配统计的 JSRuntime，stats 的生命周期需覆盖该运行时
+static JSRuntime *js_new_tracked_runtime(JSAllocStats *stats) {
+  memset(stats, 0, sizeof(*stats));
+  return JS_NewRuntime2(&js_tracked_malloc_funcs, stats);
+}
+
+#endif
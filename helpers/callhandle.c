@@ -0,0 +1,105 @@
+#ifndef HELPERS_CALLHANDLE_C
+#define HELPERS_CALLHANDLE_C
+
+#include "../quickjs/quickjs.h"
+
+// 把属性名一次性驻留为 JSAtom。原子属于运行时，可在同一运行时的
+// 所有上下文中复用，运行时释放前需调用 js_free_atoms
+static void js_intern_atoms(JSContext *ctx, JSAtom *atoms,
+                            const char *const *names, int count) {
+  for (int i = 0; i < count; i++) {
+    atoms[i] = JS_NewAtom(ctx, names[i]);
+  }
+}
+
+static void js_free_atoms(JSRuntime *rt, JSAtom *atoms, int count) {
+  for (int i = 0; i < count; i++) {
+    if (atoms[i] != JS_ATOM_NULL) {
+      JS_FreeAtomRT(rt, atoms[i]);
+      atoms[i] = JS_ATOM_NULL;
+    }
+  }
+}
+
+// 调用句柄：缓存某个上下文中 obj[name] 解析出的函数，
+// 重复从 C 调用同一个 JS 函数时不再按字符串查找属性
+typedef struct {
+  JSContext *ctx;
+  JSAtom atom;
+  JSValue this_obj;
+  JSValue func;
+} JSCallHandle;
+
+// 重新解析函数，脚本给该属性重新赋值后调用
+static int js_call_handle_refresh(JSCallHandle *h) {
+  JSValue func = JS_GetProperty(h->ctx, h->this_obj, h->atom);
+  if (JS_IsException(func))
+    return -1;
+
+  if (!JS_IsFunction(h->ctx, func)) {
+    const char *name = JS_AtomToCString(h->ctx, h->atom);
+    JS_ThrowTypeError(h->ctx, "%s is not a function", name ? name : "?");
+    JS_FreeCString(h->ctx, name);
+    JS_FreeValue(h->ctx, func);
+    return -1;
+  }
+
+  JS_FreeValue(h->ctx, h->func);
+  h->func = func;
+  return 0;
+}
+
+// 解析 obj[name] 并缓存，失败时返回 -1 并在 ctx 中留下异常
+static int js_call_handle_init(JSContext *ctx, JSCallHandle *h,
+                               JSValueConst obj, const char *name) {
+  h->ctx = ctx;
+  h->atom = JS_NewAtom(ctx, name);
+  h->this_obj = JS_DupValue(ctx, obj);
+  h->func = JS_UNDEFINED;
+
+  if (h->atom == JS_ATOM_NULL || js_call_handle_refresh(h) < 0) {
+    JS_FreeAtom(ctx, h->atom);
+    JS_FreeValue(ctx, h->this_obj);
+    h->atom = JS_ATOM_NULL;
+    h->this_obj = JS_UNDEFINED;
+    return -1;
+  }
+  return 0;
+}
+
+static void js_call_handle_free(JSCallHandle *h) {
+  JS_FreeValue(h->ctx, h->func);
+  JS_FreeValue(h->ctx, h->this_obj);
+  JS_FreeAtom(h->ctx, h->atom);
+  h->func = JS_UNDEFINED;
+  h->this_obj = JS_UNDEFINED;
+  h->atom = JS_ATOM_NULL;
+}
+
+// 以 obj 为 this 调用缓存的函数
+static JSValue js_call_handle_call(JSCallHandle *h, int argc,
+                                   JSValueConst *argv) {
+  return JS_Call(h->ctx, h->func, h->this_obj, argc, argv);
+}
+
+// 连续调用 n 次，第 i 次的参数为 args_batch[i * argc .. i * argc + argc)。
+// results 不为 NULL 时保存每次的返回值（由调用方释放），否则直接丢弃。
+// 返回成功的调用次数；遇到异常时停止，异常留在 ctx 中
+static int js_call_n(JSCallHandle *h, int n, int argc,
+                     JSValueConst *args_batch, JSValue *results) {
+  for (int i = 0; i < n; i++) {
+    JSValue ret = JS_Call(h->ctx, h->func, h->this_obj, argc,
+                          args_batch + (size_t)i * argc);
+    if (JS_IsException(ret))
+      return i;
+
+    if (results) {
+      results[i] = ret;
+    } else {
+      JS_FreeValue(h->ctx, ret);
+    }
+  }
+  return n;
+}
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef HELPERS_CLOCK_C
+#define HELPERS_CLOCK_C
+
+#include <time.h>
+
+// 单调时钟，返回毫秒。clock() 统计的是整个进程的 CPU 时间，
+// 多线程下无法用来度量单次停顿或等待时长
+static double get_time_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+#endif
@@ -0,0 +1,291 @@
+#ifndef HELPERS_COMPILE_CACHE_C
+#define HELPERS_COMPILE_CACHE_C
+
+#include "../quickjs/quickjs.h"
+#include "./sha256.c"
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * 磁盘上的编译缓存：以 SHA-256(引擎版本, 缓存格式, 编译标志, 模块名, 源码)
+ * 为键保存 JS_WriteObject 输出的字节码，进程重启后未改动的脚本无需重新解析。
+ *
+ * 模块名参与计算是因为字节码中记录了它，模块的导入按它解析。
+ * 引擎版本来自编译时的 -DCONFIG_VERSION（取自 quickjs/VERSION），
+ * 升级 QuickJS 后旧条目自然失效；即使未定义，JS_ReadObject 也会拒绝
+ * 版本不符的字节码，此时按未命中处理并删除该条目。
+ *
+ * 写入先落到同目录的临时文件再 rename，读者只会看到完整的条目。
+ * 总大小超过上限时按修改时间删除最旧的条目，命中时会刷新修改时间。
+ */
+
+#ifdef CONFIG_VERSION
+#define COMPILE_CACHE_ENGINE CONFIG_VERSION
+#else
+#define COMPILE_CACHE_ENGINE "unknown"
+#endif
+
+// 条目格式变化时递增，旧条目随之失效
+#define COMPILE_CACHE_FORMAT 1
+#define COMPILE_CACHE_SUFFIX ".qbc"
+// 淘汰时删到上限的这个比例以下，避免每次写入都扫描目录
+#define COMPILE_CACHE_LOW_WATER 0.9
+
+typedef struct {
+  char dir[512];
+  size_t max_bytes;
+  // 目录中条目的大致总大小，其他进程的写入不计入，淘汰扫描时校正
+  atomic_size_t total_bytes;
+  atomic_int hits;
+  atomic_int misses;
+  atomic_int writes;
+  atomic_int evictions;
+  pthread_mutex_t evict_mutex;
+} CompileCache;
+
+typedef struct {
+  char path[1024];
+  size_t size;
+  time_t mtime;
+} CompileCacheEntry;
+
+static int compile_cache_compare_mtime(const void *a, const void *b) {
+  const CompileCacheEntry *x = a, *y = b;
+  return x->mtime < y->mtime ? -1 : x->mtime > y->mtime;
+}
+
+// 列出目录中的缓存条目，返回条目数，*total 为总大小
+static int compile_cache_scan(CompileCache *c, CompileCacheEntry **entries,
+                              size_t *total) {
+  DIR *dir = opendir(c->dir);
+  int count = 0, capacity = 0;
+  *entries = NULL;
+  *total = 0;
+  if (!dir)
+    return 0;
+
+  struct dirent *de;
+  size_t suffix_len = strlen(COMPILE_CACHE_SUFFIX);
+  while ((de = readdir(dir)) != NULL) {
+    size_t name_len = strlen(de->d_name);
+    if (name_len <= suffix_len ||
+        strcmp(de->d_name + name_len - suffix_len, COMPILE_CACHE_SUFFIX) != 0)
+      continue;
+
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 256;
+      *entries = realloc(*entries, capacity * sizeof(CompileCacheEntry));
+    }
+    CompileCacheEntry *e = &(*entries)[count];
+    snprintf(e->path, sizeof(e->path), "%s/%s", c->dir, de->d_name);
+    struct stat st;
+    if (stat(e->path, &st) != 0)
+      continue;
+    e->size = st.st_size;
+    e->mtime = st.st_mtime;
+    *total += e->size;
+    count++;
+  }
+  closedir(dir);
+  return count;
+}
+
+// 创建缓存目录并统计已有条目。max_bytes 为 0 表示不限制大小
+static int compile_cache_init(CompileCache *c, const char *dir,
+                              size_t max_bytes) {
+  memset(c, 0, sizeof(*c));
+  snprintf(c->dir, sizeof(c->dir), "%s", dir);
+  c->max_bytes = max_bytes;
+  pthread_mutex_init(&c->evict_mutex, NULL);
+
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "Failed to create compile cache %s: %s\n", dir,
+            strerror(errno));
+    return -1;
+  }
+
+  CompileCacheEntry *entries;
+  size_t total;
+  compile_cache_scan(c, &entries, &total);
+  free(entries);
+  atomic_init(&c->total_bytes, total);
+  return 0;
+}
+
+static void compile_cache_free(CompileCache *c) {
+  pthread_mutex_destroy(&c->evict_mutex);
+}
+
+// 计算缓存键
+static void compile_cache_key(const char *name, const char *source,
+                              size_t len, int eval_flags, uint8_t key[32]) {
+  Sha256 s;
+  char header[128];
+  int header_len =
+      snprintf(header, sizeof(header), "%s|%d|%d|%d", COMPILE_CACHE_ENGINE,
+               COMPILE_CACHE_FORMAT, eval_flags, (int)sizeof(void *));
+
+  sha256_init(&s);
+  sha256_update(&s, header, header_len + 1);
+  sha256_update(&s, name, strlen(name) + 1);
+  sha256_update(&s, source, len);
+  sha256_final(&s, key);
+}
+
+static void compile_cache_path(CompileCache *c, const uint8_t key[32],
+                               char *path, size_t size) {
+  char hex[65];
+  sha256_hex(key, hex);
+  snprintf(path, size, "%s/%s" COMPILE_CACHE_SUFFIX, c->dir, hex);
+}
+
+// 读取条目，未命中时返回 NULL。返回的缓冲区由调用方 free
+static uint8_t *compile_cache_get(CompileCache *c, const uint8_t key[32],
+                                  size_t *len) {
+  char path[1024];
+  compile_cache_path(c, key, path, sizeof(path));
+
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    atomic_fetch_add(&c->misses, 1);
+    return NULL;
+  }
+
+  struct stat st;
+  uint8_t *buf = NULL;
+  if (fstat(fileno(f), &st) == 0 && st.st_size > 0) {
+    buf = malloc(st.st_size);
+    if (fread(buf, 1, st.st_size, f) != (size_t)st.st_size) {
+      free(buf);
+      buf = NULL;
+    }
+  }
+  fclose(f);
+
+  if (!buf) {
+    atomic_fetch_add(&c->misses, 1);
+    return NULL;
+  }
+  // 刷新修改时间，淘汰时按最近使用排序。一分钟内刷新过的不再重复，
+  // 频繁命中的条目不必每次都多一次系统调用
+  if (st.st_mtime < time(NULL) - 60)
+    utimes(path, NULL);
+  atomic_fetch_add(&c->hits, 1);
+  *len = st.st_size;
+  return buf;
+}
+
+// 删除读取失败的条目（例如引擎版本不符）
+static void compile_cache_remove(CompileCache *c, const uint8_t key[32]) {
+  char path[1024];
+  struct stat st;
+  compile_cache_path(c, key, path, sizeof(path));
+  if (stat(path, &st) == 0 && unlink(path) == 0)
+    atomic_fetch_sub(&c->total_bytes, st.st_size);
+}
+
+// 超过上限时删除最久未使用的条目，直到低于低水位
+static void compile_cache_evict(CompileCache *c) {
+  // 同一时间只需要一个线程扫描
+  if (pthread_mutex_trylock(&c->evict_mutex) != 0)
+    return;
+
+  CompileCacheEntry *entries;
+  size_t total;
+  int count = compile_cache_scan(c, &entries, &total);
+  qsort(entries, count, sizeof(CompileCacheEntry),
+        compile_cache_compare_mtime);
+
+  size_t target = (size_t)(c->max_bytes * COMPILE_CACHE_LOW_WATER);
+  for (int i = 0; i < count && total > target; i++) {
+    if (unlink(entries[i].path) == 0) {
+      total -= entries[i].size;
+      atomic_fetch_add(&c->evictions, 1);
+    }
+  }
+  atomic_store(&c->total_bytes, total);
+  free(entries);
+  pthread_mutex_unlock(&c->evict_mutex);
+}
+
+// 写入条目：先写临时文件再原子地 rename 到最终路径
+static void compile_cache_put(CompileCache *c, const uint8_t key[32],
+                              const uint8_t *data, size_t len) {
+  static atomic_int tmp_counter = 0;
+  char path[1024], tmp[1100];
+  compile_cache_path(c, key, path, sizeof(path));
+  snprintf(tmp, sizeof(tmp), "%s.%d.%d.tmp", path, (int)getpid(),
+           atomic_fetch_add(&tmp_counter, 1));
+
+  FILE *f = fopen(tmp, "wb");
+  if (!f)
+    return;
+  int ok = fwrite(data, 1, len, f) == len;
+  ok &= fclose(f) == 0;
+  if (!ok || rename(tmp, path) != 0) {
+    unlink(tmp);
+    return;
+  }
+
+  atomic_fetch_add(&c->writes, 1);
+  size_t total = atomic_fetch_add(&c->total_bytes, len) + len;
+  if (c->max_bytes > 0 && total > c->max_bytes)
+    compile_cache_evict(c);
+}
+
+// 编译源码但不执行，返回与 JS_Eval(..., eval_flags | COMPILE_ONLY) 相同
+// 的函数或模块。c 为 NULL 时直接编译
+static JSValue compile_cache_compile(JSContext *ctx, CompileCache *c,
+                                     const char *source, size_t len,
+                                     const char *name, int eval_flags) {
+  if (!c)
+    return JS_Eval(ctx, source, len, name,
+                   eval_flags | JS_EVAL_FLAG_COMPILE_ONLY);
+
+  uint8_t key[32];
+  size_t bytecode_len;
+  compile_cache_key(name, source, len, eval_flags, key);
+  uint8_t *bytecode = compile_cache_get(c, key, &bytecode_len);
+  if (bytecode) {
+    JSValue obj =
+        JS_ReadObject(ctx, bytecode, bytecode_len, JS_READ_OBJ_BYTECODE);
+    free(bytecode);
+    if (!JS_IsException(obj))
+      return obj;
+    // 条目损坏或来自不兼容的引擎，丢弃后重新编译
+    JS_FreeValue(ctx, JS_GetException(ctx));
+    compile_cache_remove(c, key);
+  }
+
+  JSValue obj =
+      JS_Eval(ctx, source, len, name, eval_flags | JS_EVAL_FLAG_COMPILE_ONLY);
+  if (JS_IsException(obj))
+    return obj;
+
+  uint8_t *buf = JS_WriteObject(ctx, &bytecode_len, obj, JS_WRITE_OBJ_BYTECODE);
+  if (buf) {
+    compile_cache_put(c, key, buf, bytecode_len);
+    js_free(ctx, buf);
+  }
+  return obj;
+}
+
+static void compile_cache_print_stats(CompileCache *c) {
+  printf("Compile cache %s: %d hits, %d misses, %d writes, %d evictions, "
+         "%.1f KB\n",
+         c->dir, atomic_load(&c->hits), atomic_load(&c->misses),
+         atomic_load(&c->writes), atomic_load(&c->evictions),
+         atomic_load(&c->total_bytes) / 1024.0);
+}
+
+#endif
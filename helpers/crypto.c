@@ -0,0 +1,275 @@
+#ifndef HELPERS_CRYPTO_C
+#define HELPERS_CRYPTO_C
+
+#include "../quickjs/quickjs.h"
+#include "./encoding.c"
+#include "./hash.c"
+#include "./sha256.c"
+#include <string.h>
+#include <strings.h>
+
+/*
+ * 脚本用的哈希模块，和 demo05 的 point 一样以 C 模块注册：
+ *
+ *   import { digest, createHash } from "crypto";
+ *   digest("sha256", buffer)          // ArrayBuffer
+ *   digest("xxh64", buffer, "hex")    // 十六进制字符串
+ *   createHash("crc32").update(a).update(b).digest("hex")
+ *
+ * 算法有 sha256、xxh64、crc32 和 crc32c。输入可以是 ArrayBuffer、
+ * TypedArray、DataView（直接读取底层内存，不复制）或字符串（按 UTF-8）。
+ * xxh64 和 crc 的结果按大端输出，与 xxhsum、zlib 的十六进制写法一致。
+ *
+ * 以全局脚本运行的宿主（如 demo08 的任务）用 js_std_init_crypto 把同样
+ * 的函数挂到全局的 crypto 对象上。
+ */
+
+typedef enum {
+  CRYPTO_SHA256,
+  CRYPTO_XXH64,
+  CRYPTO_CRC32,
+  CRYPTO_CRC32C,
+} CryptoAlgorithm;
+
+static const struct {
+  const char *name;
+  CryptoAlgorithm algorithm;
+  size_t digest_len;
+} crypto_algorithms[] = {
+    {"sha256", CRYPTO_SHA256, 32}, {"sha-256", CRYPTO_SHA256, 32},
+    {"xxh64", CRYPTO_XXH64, 8},    {"crc32", CRYPTO_CRC32, 4},
+    {"crc32c", CRYPTO_CRC32C, 4},
+};
+
+typedef struct {
+  CryptoAlgorithm algorithm;
+  size_t digest_len;
+  int finished; // digest() 之后不能再使用
+  union {
+    Sha256 sha256;
+    Xxh64 xxh64;
+    uint32_t crc;
+  } u;
+} CryptoHash;
+
+static JSClassID js_crypto_hash_class_id;
+
+// 按名字（不区分大小写）初始化，未知算法时抛出 TypeError
+static int crypto_hash_init(JSContext *ctx, CryptoHash *h, JSValueConst name) {
+  const char *str = JS_ToCString(ctx, name);
+  if (!str)
+    return -1;
+  for (size_t i = 0; i < sizeof(crypto_algorithms) / sizeof(crypto_algorithms[0]);
+       i++) {
+    if (strcasecmp(str, crypto_algorithms[i].name) == 0) {
+      h->algorithm = crypto_algorithms[i].algorithm;
+      h->digest_len = crypto_algorithms[i].digest_len;
+      h->finished = 0;
+      if (h->algorithm == CRYPTO_SHA256)
+        sha256_init(&h->u.sha256);
+      else if (h->algorithm == CRYPTO_XXH64)
+        xxh64_init(&h->u.xxh64, 0);
+      else
+        h->u.crc = 0;
+      JS_FreeCString(ctx, str);
+      return 0;
+    }
+  }
+  JS_ThrowTypeError(ctx, "unsupported digest algorithm: %s", str);
+  JS_FreeCString(ctx, str);
+  return -1;
+}
+
+static void crypto_hash_update(CryptoHash *h, const uint8_t *p, size_t len) {
+  switch (h->algorithm) {
+  case CRYPTO_SHA256:
+    sha256_update(&h->u.sha256, p, len);
+    break;
+  case CRYPTO_XXH64:
+    xxh64_update(&h->u.xxh64, p, len);
+    break;
+  case CRYPTO_CRC32:
+    h->u.crc = crc32_update(h->u.crc, p, len);
+    break;
+  case CRYPTO_CRC32C:
+    h->u.crc = crc32c_update(h->u.crc, p, len);
+    break;
+  }
+}
+
+static void crypto_hash_final(CryptoHash *h, uint8_t *out) {
+  uint64_t v = 0;
+  switch (h->algorithm) {
+  case CRYPTO_SHA256:
+    sha256_final(&h->u.sha256, out);
+    return;
+  case CRYPTO_XXH64:
+    v = xxh64_digest(&h->u.xxh64);
+    break;
+  case CRYPTO_CRC32:
+  case CRYPTO_CRC32C:
+    v = h->u.crc;
+    break;
+  }
+  for (size_t i = 0; i < h->digest_len; i++)
+    out[i] = (uint8_t)(v >> (8 * (h->digest_len - 1 - i)));
+}
+
+// 把 data 送入哈希，字符串按 UTF-8，其余按二进制数据原地读取
+static int crypto_hash_feed(JSContext *ctx, CryptoHash *h, JSValueConst data) {
+  if (JS_IsString(data)) {
+    size_t len;
+    const char *str = JS_ToCStringLen(ctx, &len, data);
+    if (!str)
+      return -1;
+    crypto_hash_update(h, (const uint8_t *)str, len);
+    JS_FreeCString(ctx, str);
+    return 0;
+  }
+  size_t len;
+  const uint8_t *p = js_encoding_get_bytes(ctx, data, &len);
+  if (!p)
+    return -1;
+  crypto_hash_update(h, p, len);
+  return 0;
+}
+
+// 结束计算，encoding 为 "hex" 时返回字符串，否则返回 ArrayBuffer
+static JSValue crypto_hash_result(JSContext *ctx, CryptoHash *h,
+                                  JSValueConst encoding) {
+  uint8_t digest[32];
+  crypto_hash_final(h, digest);
+  h->finished = 1;
+  if (JS_IsUndefined(encoding))
+    return JS_NewArrayBufferCopy(ctx, digest, h->digest_len);
+
+  const char *str = JS_ToCString(ctx, encoding);
+  if (!str)
+    return JS_EXCEPTION;
+  int hex = strcmp(str, "hex") == 0;
+  JS_FreeCString(ctx, str);
+  if (!hex)
+    return JS_ThrowTypeError(ctx, "unsupported digest encoding");
+  char out[64];
+  enc_hex_encode(out, digest, h->digest_len);
+  return JS_NewStringLen(ctx, out, 2 * h->digest_len);
+}
+
+// digest(algorithm, data[, encoding])
+static JSValue js_crypto_digest(JSContext *ctx, JSValueConst this_val,
+                                int argc, JSValueConst *argv) {
+  CryptoHash h;
+  if (crypto_hash_init(ctx, &h, argv[0]) < 0 ||
+      crypto_hash_feed(ctx, &h, argv[1]) < 0)
+    return JS_EXCEPTION;
+  return crypto_hash_result(ctx, &h, argc > 2 ? argv[2] : JS_UNDEFINED);
+}
+
+// createHash(algorithm)
+static JSValue js_crypto_create_hash(JSContext *ctx, JSValueConst this_val,
+                                     int argc, JSValueConst *argv) {
+  CryptoHash *h = js_mallocz(ctx, sizeof(*h));
+  if (!h)
+    return JS_EXCEPTION;
+  if (crypto_hash_init(ctx, h, argv[0]) < 0) {
+    js_free(ctx, h);
+    return JS_EXCEPTION;
+  }
+  JSValue obj = JS_NewObjectClass(ctx, js_crypto_hash_class_id);
+  if (JS_IsException(obj)) {
+    js_free(ctx, h);
+    return JS_EXCEPTION;
+  }
+  JS_SetOpaque(obj, h);
+  return obj;
+}
+
+static CryptoHash *js_crypto_hash_get(JSContext *ctx, JSValueConst this_val) {
+  CryptoHash *h = JS_GetOpaque2(ctx, this_val, js_crypto_hash_class_id);
+  if (h && h->finished) {
+    JS_ThrowTypeError(ctx, "digest already called");
+    return NULL;
+  }
+  return h;
+}
+
+// hash.update(data)，返回 hash 本身以便链式调用
+static JSValue js_crypto_hash_update(JSContext *ctx, JSValueConst this_val,
+                                     int argc, JSValueConst *argv) {
+  CryptoHash *h = js_crypto_hash_get(ctx, this_val);
+  if (!h || crypto_hash_feed(ctx, h, argv[0]) < 0)
+    return JS_EXCEPTION;
+  return JS_DupValue(ctx, this_val);
+}
+
+// hash.digest([encoding])
+static JSValue js_crypto_hash_digest(JSContext *ctx, JSValueConst this_val,
+                                     int argc, JSValueConst *argv) {
+  CryptoHash *h = js_crypto_hash_get(ctx, this_val);
+  if (!h)
+    return JS_EXCEPTION;
+  return crypto_hash_result(ctx, h, argc > 0 ? argv[0] : JS_UNDEFINED);
+}
+
+static void js_crypto_hash_finalizer(JSRuntime *rt, JSValue val) {
+  js_free_rt(rt, JS_GetOpaque(val, js_crypto_hash_class_id));
+}
+
+static JSClassDef js_crypto_hash_class = {
+    "Hash",
+    .finalizer = js_crypto_hash_finalizer,
+};
+
+static const JSCFunctionListEntry js_crypto_hash_proto_funcs[] = {
+    JS_CFUNC_DEF("update", 1, js_crypto_hash_update),
+    JS_CFUNC_DEF("digest", 0, js_crypto_hash_digest),
+};
+
+static const JSCFunctionListEntry js_crypto_funcs[] = {
+    JS_CFUNC_DEF("digest", 2, js_crypto_digest),
+    JS_CFUNC_DEF("createHash", 1, js_crypto_create_hash),
+};
+
+// Hash 类按运行时注册，类 ID 全进程共享
+static void js_crypto_init_class(JSContext *ctx) {
+  JSRuntime *rt = JS_GetRuntime(ctx);
+  if (js_crypto_hash_class_id == 0)
+    JS_NewClassID(&js_crypto_hash_class_id);
+  if (!JS_IsRegisteredClass(rt, js_crypto_hash_class_id))
+    JS_NewClass(rt, js_crypto_hash_class_id, &js_crypto_hash_class);
+
+  JSValue proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, proto, js_crypto_hash_proto_funcs,
+                             sizeof(js_crypto_hash_proto_funcs) /
+                                 sizeof(js_crypto_hash_proto_funcs[0]));
+  JS_SetClassProto(ctx, js_crypto_hash_class_id, proto);
+}
+
+static int js_crypto_init(JSContext *ctx, JSModuleDef *m) {
+  js_crypto_init_class(ctx);
+  return JS_SetModuleExportList(ctx, m, js_crypto_funcs,
+                                sizeof(js_crypto_funcs) /
+                                    sizeof(js_crypto_funcs[0]));
+}
+
+JSModuleDef *js_init_crypto_module(JSContext *ctx, const char *module_name) {
+  JSModuleDef *m = JS_NewCModule(ctx, module_name, js_crypto_init);
+  if (!m)
+    return NULL;
+  JS_AddModuleExportList(ctx, m, js_crypto_funcs,
+                         sizeof(js_crypto_funcs) / sizeof(js_crypto_funcs[0]));
+  return m;
+}
+
+void js_std_init_crypto(JSContext *ctx) {
+  js_crypto_init_class(ctx);
+  JSValue global_obj = JS_GetGlobalObject(ctx);
+  JSValue crypto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, crypto, js_crypto_funcs,
+                             sizeof(js_crypto_funcs) /
+                                 sizeof(js_crypto_funcs[0]));
+  JS_SetPropertyStr(ctx, global_obj, "crypto", crypto);
+  JS_FreeValue(ctx, global_obj);
+}
+
+#endif
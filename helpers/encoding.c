@@ -0,0 +1,735 @@
+#ifndef HELPERS_ENCODING_C
+#define HELPERS_ENCODING_C
+
+#include "../quickjs/quickjs.h"
+#include "./encoding_kernels.c"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/*
+ * TextEncoder、TextDecoder（只支持 UTF-8）、atob/btoa，以及
+ * Uint8Array.prototype.toBase64/toHex 和 Uint8Array.fromBase64/fromHex。
+ * 用 js_std_init_encoding(ctx) 注册到全局对象，转换由
+ * encoding_kernels.c 中的 SIMD 内核完成。
+ *
+ * 引擎的字符串和 UTF-8 之间的转换仍由 JS_ToCStringLen/JS_NewStringLen
+ * 完成，这里负责校验、替换非法序列和二进制编码，避免在 JS 中逐字节循环。
+ */
+
+static JSClassID js_text_encoder_class_id;
+static JSClassID js_text_decoder_class_id;
+
+typedef struct {
+  int fatal;
+  int ignore_bom;
+  int bom_seen; // 流开头的 BOM 已处理
+  size_t pending_len;
+  uint8_t pending[4]; // stream 模式下留到下一次的不完整序列
+} JSTextDecoder;
+
+static void js_encoding_buffer_free(JSRuntime *rt, void *opaque, void *ptr) {
+  js_free_rt(rt, ptr);
+}
+
+// 接管 js_malloc 分配的 data，返回 new Uint8Array(buffer)
+static JSValue js_encoding_new_uint8_array(JSContext *ctx, uint8_t *data,
+                                           size_t len) {
+  JSValue buffer =
+      JS_NewArrayBuffer(ctx, data, len, js_encoding_buffer_free, NULL, 0);
+  if (JS_IsException(buffer)) {
+    js_free(ctx, data);
+    return JS_EXCEPTION;
+  }
+  JSValue global_obj = JS_GetGlobalObject(ctx);
+  JSValue ctor = JS_GetPropertyStr(ctx, global_obj, "Uint8Array");
+  JS_FreeValue(ctx, global_obj);
+  JSValue ret = JS_CallConstructor(ctx, ctor, 1, &buffer);
+  JS_FreeValue(ctx, ctor);
+  JS_FreeValue(ctx, buffer);
+  return ret;
+}
+
+// 以 val 为 this 读取 DataView.prototype 上的访问器，访问器会检查 val
+// 确实是 DataView，伪造的 { buffer, byteOffset, byteLength } 在这里抛出
+static JSValue js_encoding_data_view_get(JSContext *ctx, JSValueConst proto,
+                                         JSValueConst val, const char *name) {
+  JSAtom atom = JS_NewAtom(ctx, name);
+  JSValue ret = JS_GetPropertyInternal(ctx, proto, atom, val, 0);
+  JS_FreeAtom(ctx, atom);
+  return ret;
+}
+
+// 取 ArrayBuffer、TypedArray 或 DataView 的数据，失败时抛出 TypeError。
+// 返回的范围总是落在底层 ArrayBuffer 之内
+static uint8_t *js_encoding_get_bytes(JSContext *ctx, JSValueConst val,
+                                      size_t *len) {
+  size_t byte_offset, byte_length, size;
+  uint8_t *data;
+  JSValue buffer = JS_GetTypedArrayBuffer(ctx, val, &byte_offset,
+                                          &byte_length, NULL);
+  if (!JS_IsException(buffer)) {
+    data = JS_GetArrayBuffer(ctx, &size, buffer);
+    JS_FreeValue(ctx, buffer);
+    if (data && byte_offset <= size && byte_length <= size - byte_offset) {
+      *len = byte_length;
+      return data + byte_offset;
+    }
+    JS_FreeValue(ctx, JS_GetException(ctx));
+    JS_ThrowTypeError(ctx, "TypedArray is detached or out of bounds");
+    return NULL;
+  }
+  JS_FreeValue(ctx, JS_GetException(ctx));
+
+  data = JS_GetArrayBuffer(ctx, &size, val);
+  if (data) {
+    *len = size;
+    return data;
+  }
+  JS_FreeValue(ctx, JS_GetException(ctx));
+
+  // DataView 没有 C API，用原型上的访问器读取
+  int64_t offset = -1, length = -1;
+  JSValue global_obj = JS_GetGlobalObject(ctx);
+  JSValue ctor = JS_GetPropertyStr(ctx, global_obj, "DataView");
+  JSValue proto = JS_GetPropertyStr(ctx, ctor, "prototype");
+  JS_FreeValue(ctx, ctor);
+  JS_FreeValue(ctx, global_obj);
+  buffer = JS_IsObject(val) && JS_IsObject(proto)
+               ? js_encoding_data_view_get(ctx, proto, val, "buffer")
+               : JS_UNDEFINED;
+  if (JS_IsObject(buffer)) {
+    JSValue v_offset = js_encoding_data_view_get(ctx, proto, val, "byteOffset");
+    JSValue v_length = js_encoding_data_view_get(ctx, proto, val, "byteLength");
+    if (!JS_ToInt64(ctx, &offset, v_offset) &&
+        !JS_ToInt64(ctx, &length, v_length))
+      data = JS_GetArrayBuffer(ctx, &size, buffer);
+    JS_FreeValue(ctx, v_offset);
+    JS_FreeValue(ctx, v_length);
+  }
+  JS_FreeValue(ctx, buffer);
+  JS_FreeValue(ctx, proto);
+  if (!data || offset < 0 || length < 0 || (uint64_t)offset > size ||
+      (uint64_t)length > size - offset) {
+    JS_FreeValue(ctx, JS_GetException(ctx));
+    JS_ThrowTypeError(ctx, "expected an ArrayBuffer or ArrayBufferView");
+    return NULL;
+  }
+  *len = length;
+  return data + offset;
+}
+
+// val 不是 Uint8Array 时抛出 TypeError（Int8Array、Uint8ClampedArray 也不行）
+static int js_encoding_check_uint8_array(JSContext *ctx, JSValueConst val) {
+  if (JS_GetTypedArrayType(val) != JS_TYPED_ARRAY_UINT8) {
+    JS_ThrowTypeError(ctx, "not a Uint8Array");
+    return -1;
+  }
+  return 0;
+}
+
+// Uint8Array 的数据，this_val 不是 Uint8Array 时抛出 TypeError。
+// 返回的指针在下一次调用可能执行 JS 的函数之前有效
+static uint8_t *js_encoding_get_uint8_array(JSContext *ctx,
+                                            JSValueConst this_val,
+                                            size_t *len) {
+  size_t byte_offset, byte_length, size;
+  if (js_encoding_check_uint8_array(ctx, this_val) < 0)
+    return NULL;
+  JSValue buffer = JS_GetTypedArrayBuffer(ctx, this_val, &byte_offset,
+                                          &byte_length, NULL);
+  if (JS_IsException(buffer))
+    return NULL;
+  uint8_t *data = JS_GetArrayBuffer(ctx, &size, buffer);
+  JS_FreeValue(ctx, buffer);
+  if (!data)
+    return NULL;
+  if (byte_offset > size || byte_length > size - byte_offset) {
+    JS_ThrowTypeError(ctx, "Uint8Array is out of bounds");
+    return NULL;
+  }
+  *len = byte_length;
+  return data + byte_offset;
+}
+
+// options 对象的布尔属性，options 为 undefined 时取 false，异常时返回 -1
+static int js_encoding_option_bool(JSContext *ctx, JSValueConst options,
+                                   const char *name) {
+  if (!JS_IsObject(options))
+    return 0;
+  JSValue val = JS_GetPropertyStr(ctx, options, name);
+  int ret = JS_ToBool(ctx, val);
+  JS_FreeValue(ctx, val);
+  return ret;
+}
+
+// options 对象的字符串属性：等于 value 时 *is_value 为 1，
+// 未设置或等于 other 时为 0，其他取值抛出 TypeError
+static int js_encoding_option_is(JSContext *ctx, JSValueConst options,
+                                 const char *name, const char *value,
+                                 const char *other, int *is_value) {
+  *is_value = 0;
+  if (!JS_IsObject(options))
+    return 0;
+  JSValue val = JS_GetPropertyStr(ctx, options, name);
+  if (JS_IsUndefined(val))
+    return 0;
+  const char *str = JS_ToCString(ctx, val);
+  JS_FreeValue(ctx, val);
+  if (!str)
+    return -1;
+  int ret = 0;
+  if (strcmp(str, value) == 0)
+    *is_value = 1;
+  else if (strcmp(str, other) != 0)
+    ret = -1;
+  JS_FreeCString(ctx, str);
+  if (ret < 0)
+    JS_ThrowTypeError(ctx, "invalid %s option", name);
+  return ret;
+}
+
+// DOMException 不可用，抛出 name 为 InvalidCharacterError 的 Error
+static JSValue js_encoding_throw_invalid_char(JSContext *ctx,
+                                              const char *message) {
+  JSValue err = JS_NewError(ctx);
+  JS_SetPropertyStr(ctx, err, "name",
+                    JS_NewString(ctx, "InvalidCharacterError"));
+  JS_SetPropertyStr(ctx, err, "message", JS_NewString(ctx, message));
+  return JS_Throw(ctx, err);
+}
+
+/* TextEncoder */
+
+static JSValue js_text_encoder_ctor(JSContext *ctx, JSValueConst new_target,
+                                    int argc, JSValueConst *argv) {
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if (JS_IsException(proto))
+    return JS_EXCEPTION;
+  JSValue obj =
+      JS_NewObjectProtoClass(ctx, proto, js_text_encoder_class_id);
+  JS_FreeValue(ctx, proto);
+  return obj;
+}
+
+static JSValue js_encoding_get_utf8(JSContext *ctx, JSValueConst this_val) {
+  return JS_NewString(ctx, "utf-8");
+}
+
+// QuickJS 把孤立的代理项编码成 ED A0..BF xx，按标准替换成 U+FFFD，
+// 两者都是 3 字节
+static void js_encoding_fix_surrogates(uint8_t *p, size_t n) {
+  uint8_t *end = p + n;
+  while ((p = memchr(p, 0xED, end - p)) != NULL) {
+    if (end - p >= 3 && (p[1] & 0xE0) == 0xA0) {
+      p[0] = 0xEF;
+      p[1] = 0xBF;
+      p[2] = 0xBD;
+    }
+    p++;
+  }
+}
+
+static JSValue js_text_encoder_encode(JSContext *ctx, JSValueConst this_val,
+                                      int argc, JSValueConst *argv) {
+  size_t len = 0;
+  const char *str = NULL;
+  if (argc > 0 && !JS_IsUndefined(argv[0])) {
+    str = JS_ToCStringLen(ctx, &len, argv[0]);
+    if (!str)
+      return JS_EXCEPTION;
+  }
+  uint8_t *data = js_malloc(ctx, len + 1);
+  if (!data) {
+    JS_FreeCString(ctx, str);
+    return JS_EXCEPTION;
+  }
+  if (len) {
+    memcpy(data, str, len);
+    js_encoding_fix_surrogates(data, len);
+  }
+  JS_FreeCString(ctx, str);
+  return js_encoding_new_uint8_array(ctx, data, len);
+}
+
+// encodeInto(string, uint8Array)：只写入完整的字符，
+// 返回 { read: UTF-16 码元数, written: 字节数 }
+static JSValue js_text_encoder_encode_into(JSContext *ctx,
+                                           JSValueConst this_val, int argc,
+                                           JSValueConst *argv) {
+  size_t dest_len, len;
+  // 先转换字符串：toString 可能转移或缩小 dest 的 ArrayBuffer
+  const char *str = JS_ToCStringLen(ctx, &len, argv[0]);
+  if (!str)
+    return JS_EXCEPTION;
+  uint8_t *dest = js_encoding_get_uint8_array(ctx, argv[1], &dest_len);
+  if (!dest) {
+    JS_FreeCString(ctx, str);
+    return JS_EXCEPTION;
+  }
+  const uint8_t *src = (const uint8_t *)str;
+
+  // ASCII 前缀每个字节对应一个码元
+  size_t written = enc_ascii_prefix(src, len < dest_len ? len : dest_len);
+  memcpy(dest, src, written);
+  size_t read = written;
+  while (written < len) {
+    uint8_t c = src[written];
+    size_t n = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+    if (written + n > dest_len)
+      break;
+    memcpy(dest + written, src + written, n);
+    if (n == 3)
+      js_encoding_fix_surrogates(dest + written, 3);
+    written += n;
+    read += n == 4 ? 2 : 1;
+  }
+  JS_FreeCString(ctx, str);
+
+  JSValue ret = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, ret, "read", JS_NewInt64(ctx, read));
+  JS_SetPropertyStr(ctx, ret, "written", JS_NewInt64(ctx, written));
+  return ret;
+}
+
+static const JSCFunctionListEntry js_text_encoder_proto_funcs[] = {
+    JS_CGETSET_DEF("encoding", js_encoding_get_utf8, NULL),
+    JS_CFUNC_DEF("encode", 0, js_text_encoder_encode),
+    JS_CFUNC_DEF("encodeInto", 2, js_text_encoder_encode_into),
+};
+
+static JSClassDef js_text_encoder_class = {
+    "TextEncoder",
+};
+
+/* TextDecoder */
+
+static void js_text_decoder_finalizer(JSRuntime *rt, JSValue val) {
+  js_free_rt(rt, JS_GetOpaque(val, js_text_decoder_class_id));
+}
+
+// WHATWG Encoding 标准中 UTF-8 的标签
+static int js_text_decoder_is_utf8_label(const char *label) {
+  static const char *const labels[] = {
+      "utf-8",         "utf8",          "unicode-1-1-utf-8",
+      "unicode11utf8", "unicode20utf8", "x-unicode20utf8",
+  };
+  // 去掉首尾 ASCII 空白，不区分大小写
+  while (enc_is_ascii_space(*label))
+    label++;
+  size_t len = strlen(label);
+  while (len > 0 && enc_is_ascii_space(label[len - 1]))
+    len--;
+  for (size_t i = 0; i < sizeof(labels) / sizeof(labels[0]); i++) {
+    if (strlen(labels[i]) == len && strncasecmp(label, labels[i], len) == 0)
+      return 1;
+  }
+  return 0;
+}
+
+static JSValue js_text_decoder_ctor(JSContext *ctx, JSValueConst new_target,
+                                    int argc, JSValueConst *argv) {
+  if (argc > 0 && !JS_IsUndefined(argv[0])) {
+    const char *label = JS_ToCString(ctx, argv[0]);
+    if (!label)
+      return JS_EXCEPTION;
+    int ok = js_text_decoder_is_utf8_label(label);
+    JS_FreeCString(ctx, label);
+    if (!ok)
+      return JS_ThrowRangeError(ctx, "only utf-8 is supported");
+  }
+  JSValueConst options = argc > 1 ? argv[1] : JS_UNDEFINED;
+
+  int fatal = js_encoding_option_bool(ctx, options, "fatal");
+  if (fatal < 0)
+    return JS_EXCEPTION;
+  int ignore_bom = js_encoding_option_bool(ctx, options, "ignoreBOM");
+  if (ignore_bom < 0)
+    return JS_EXCEPTION;
+
+  JSTextDecoder *s = js_mallocz(ctx, sizeof(*s));
+  if (!s)
+    return JS_EXCEPTION;
+  s->fatal = fatal;
+  s->ignore_bom = ignore_bom;
+
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if (JS_IsException(proto)) {
+    js_free(ctx, s);
+    return JS_EXCEPTION;
+  }
+  JSValue obj =
+      JS_NewObjectProtoClass(ctx, proto, js_text_decoder_class_id);
+  JS_FreeValue(ctx, proto);
+  if (JS_IsException(obj)) {
+    js_free(ctx, s);
+    return JS_EXCEPTION;
+  }
+  JS_SetOpaque(obj, s);
+  return obj;
+}
+
+static JSValue js_text_decoder_get_flag(JSContext *ctx, JSValueConst this_val,
+                                        int magic) {
+  JSTextDecoder *s = JS_GetOpaque2(ctx, this_val, js_text_decoder_class_id);
+  if (!s)
+    return JS_EXCEPTION;
+  return JS_NewBool(ctx, magic ? s->ignore_bom : s->fatal);
+}
+
+// 合法的 UTF-8 直接交给 JS_NewStringLen，否则先把非法序列替换成 U+FFFD
+static JSValue js_encoding_new_string(JSContext *ctx, const uint8_t *p,
+                                      size_t len, int fatal) {
+  if (enc_utf8_valid(p, len))
+    return JS_NewStringLen(ctx, (const char *)p, len);
+  if (fatal)
+    return JS_ThrowTypeError(ctx, "The encoded data was not valid utf-8");
+  uint8_t *fixed = js_malloc(ctx, 3 * len);
+  if (!fixed)
+    return JS_EXCEPTION;
+  size_t fixed_len = enc_utf8_replace(fixed, p, len);
+  JSValue ret = JS_NewStringLen(ctx, (const char *)fixed, fixed_len);
+  js_free(ctx, fixed);
+  return ret;
+}
+
+// decode(input, { stream })
+static JSValue js_text_decoder_decode(JSContext *ctx, JSValueConst this_val,
+                                      int argc, JSValueConst *argv) {
+  JSTextDecoder *s = JS_GetOpaque2(ctx, this_val, js_text_decoder_class_id);
+  if (!s)
+    return JS_EXCEPTION;
+  // 先读 options：getter 可能转移 input 的 ArrayBuffer
+  int stream = js_encoding_option_bool(ctx, argc > 1 ? argv[1] : JS_UNDEFINED,
+                                       "stream");
+  if (stream < 0)
+    return JS_EXCEPTION;
+  const uint8_t *p = NULL;
+  size_t len = 0;
+  if (argc > 0 && !JS_IsUndefined(argv[0])) {
+    p = js_encoding_get_bytes(ctx, argv[0], &len);
+    if (!p)
+      return JS_EXCEPTION;
+  }
+
+  // 接上一次留下的不完整序列
+  uint8_t *joined = NULL;
+  if (s->pending_len) {
+    joined = js_malloc(ctx, s->pending_len + len + 1);
+    if (!joined)
+      return JS_EXCEPTION;
+    memcpy(joined, s->pending, s->pending_len);
+    if (len)
+      memcpy(joined + s->pending_len, p, len);
+    p = joined;
+    len += s->pending_len;
+    s->pending_len = 0;
+  }
+
+  if (stream) {
+    s->pending_len = enc_utf8_incomplete_tail(p, len);
+    len -= s->pending_len;
+    memcpy(s->pending, p + len, s->pending_len);
+  }
+  if (!s->ignore_bom && !s->bom_seen && len >= 3 && p[0] == 0xEF &&
+      p[1] == 0xBB && p[2] == 0xBF) {
+    p += 3;
+    len -= 3;
+    s->bom_seen = 1;
+  }
+  if (len)
+    s->bom_seen = 1;
+
+  JSValue ret = js_encoding_new_string(ctx, p, len, s->fatal);
+  js_free(ctx, joined);
+  // 流结束或出错后回到初始状态
+  if (!stream || JS_IsException(ret)) {
+    s->pending_len = 0;
+    s->bom_seen = 0;
+  }
+  return ret;
+}
+
+static const JSCFunctionListEntry js_text_decoder_proto_funcs[] = {
+    JS_CGETSET_DEF("encoding", js_encoding_get_utf8, NULL),
+    JS_CGETSET_MAGIC_DEF("fatal", js_text_decoder_get_flag, NULL, 0),
+    JS_CGETSET_MAGIC_DEF("ignoreBOM", js_text_decoder_get_flag, NULL, 1),
+    JS_CFUNC_DEF("decode", 0, js_text_decoder_decode),
+};
+
+static JSClassDef js_text_decoder_class = {
+    "TextDecoder",
+    .finalizer = js_text_decoder_finalizer,
+};
+
+/* atob / btoa */
+
+// btoa(data)：data 的每个字符必须在 U+0000..U+00FF 之间
+static JSValue js_encoding_btoa(JSContext *ctx, JSValueConst this_val,
+                                int argc, JSValueConst *argv) {
+  size_t len;
+  const char *str = JS_ToCStringLen(ctx, &len, argv[0]);
+  if (!str)
+    return JS_EXCEPTION;
+  const uint8_t *src = (const uint8_t *)str;
+
+  // 非 ASCII 时把 UTF-8 还原成 Latin-1 字节
+  uint8_t *latin1 = NULL;
+  size_t ascii = enc_ascii_prefix(src, len);
+  if (ascii < len) {
+    latin1 = js_malloc(ctx, len);
+    if (!latin1)
+      goto fail;
+    memcpy(latin1, src, ascii);
+    size_t o = ascii;
+    for (size_t i = ascii; i < len; i++) {
+      if (src[i] < 0x80) {
+        latin1[o++] = src[i];
+      } else if ((src[i] == 0xC2 || src[i] == 0xC3) && i + 1 < len) {
+        latin1[o++] = (src[i] & 0x03) << 6 | (src[i + 1] & 0x3F);
+        i++;
+      } else {
+        js_encoding_throw_invalid_char(
+            ctx, "btoa: the string contains characters outside of Latin1");
+        goto fail;
+      }
+    }
+    src = latin1;
+    len = o;
+  }
+
+  size_t out_len = enc_base64_encoded_len(len, 1);
+  char *out = js_malloc(ctx, out_len + 1);
+  if (!out)
+    goto fail;
+  enc_base64_encode(out, src, len, 0, 1);
+  JSValue ret = JS_NewStringLen(ctx, out, out_len);
+  js_free(ctx, out);
+  js_free(ctx, latin1);
+  JS_FreeCString(ctx, str);
+  return ret;
+fail:
+  js_free(ctx, latin1);
+  JS_FreeCString(ctx, str);
+  return JS_EXCEPTION;
+}
+
+// atob(data)：结果的每个字符对应一个字节
+static JSValue js_encoding_atob(JSContext *ctx, JSValueConst this_val,
+                                int argc, JSValueConst *argv) {
+  size_t len;
+  const char *str = JS_ToCStringLen(ctx, &len, argv[0]);
+  if (!str)
+    return JS_EXCEPTION;
+  // 解码结果之后留出 Latin-1 转成 UTF-8 的空间
+  size_t cap = len / 4 * 3 + 32;
+  uint8_t *bytes = js_malloc(ctx, 3 * cap);
+  if (!bytes) {
+    JS_FreeCString(ctx, str);
+    return JS_EXCEPTION;
+  }
+  ptrdiff_t n = enc_base64_decode(bytes, str, len, 0, 0);
+  JS_FreeCString(ctx, str);
+  if (n < 0) {
+    js_free(ctx, bytes);
+    return js_encoding_throw_invalid_char(
+        ctx, "atob: the string to be decoded is not correctly encoded");
+  }
+
+  JSValue ret;
+  if (enc_ascii_prefix(bytes, n) == (size_t)n) {
+    ret = JS_NewStringLen(ctx, (const char *)bytes, n);
+  } else {
+    uint8_t *utf8 = bytes + cap;
+    size_t o = 0;
+    for (ptrdiff_t i = 0; i < n; i++) {
+      if (bytes[i] < 0x80) {
+        utf8[o++] = bytes[i];
+      } else {
+        utf8[o++] = 0xC0 | bytes[i] >> 6;
+        utf8[o++] = 0x80 | (bytes[i] & 0x3F);
+      }
+    }
+    ret = JS_NewStringLen(ctx, (const char *)utf8, o);
+  }
+  js_free(ctx, bytes);
+  return ret;
+}
+
+/* Uint8Array 的 base64/hex 方法（TC39 Uint8Array to/from base64 提案） */
+
+// toBase64({ alphabet: "base64" | "base64url", omitPadding })
+static JSValue js_uint8_array_to_base64(JSContext *ctx, JSValueConst this_val,
+                                        int argc, JSValueConst *argv) {
+  if (js_encoding_check_uint8_array(ctx, this_val) < 0)
+    return JS_EXCEPTION;
+  // 按提案的顺序先读 options，getter 执行完之后再取数据
+  JSValueConst options = argc > 0 ? argv[0] : JS_UNDEFINED;
+  int url;
+  if (js_encoding_option_is(ctx, options, "alphabet", "base64url", "base64",
+                            &url) < 0)
+    return JS_EXCEPTION;
+  int omit = js_encoding_option_bool(ctx, options, "omitPadding");
+  if (omit < 0)
+    return JS_EXCEPTION;
+  int pad = !omit;
+  size_t len;
+  const uint8_t *data = js_encoding_get_uint8_array(ctx, this_val, &len);
+  if (!data)
+    return JS_EXCEPTION;
+
+  size_t out_len = enc_base64_encoded_len(len, pad);
+  char *out = js_malloc(ctx, out_len + 1);
+  if (!out)
+    return JS_EXCEPTION;
+  enc_base64_encode(out, data, len, url, pad);
+  JSValue ret = JS_NewStringLen(ctx, out, out_len);
+  js_free(ctx, out);
+  return ret;
+}
+
+// Uint8Array.fromBase64(string, { alphabet, lastChunkHandling })，
+// lastChunkHandling 支持 "loose"（默认）和 "strict"
+static JSValue js_uint8_array_from_base64(JSContext *ctx,
+                                          JSValueConst this_val, int argc,
+                                          JSValueConst *argv) {
+  if (!JS_IsString(argv[0]))
+    return JS_ThrowTypeError(ctx, "fromBase64: expected a string");
+  JSValueConst options = argc > 1 ? argv[1] : JS_UNDEFINED;
+  int url, strict;
+  if (js_encoding_option_is(ctx, options, "alphabet", "base64url", "base64",
+                            &url) < 0 ||
+      js_encoding_option_is(ctx, options, "lastChunkHandling", "strict",
+                            "loose", &strict) < 0)
+    return JS_EXCEPTION;
+
+  size_t len;
+  const char *str = JS_ToCStringLen(ctx, &len, argv[0]);
+  if (!str)
+    return JS_EXCEPTION;
+  uint8_t *data = js_malloc(ctx, len / 4 * 3 + 32);
+  if (!data) {
+    JS_FreeCString(ctx, str);
+    return JS_EXCEPTION;
+  }
+  ptrdiff_t n = enc_base64_decode(data, str, len, url, strict);
+  JS_FreeCString(ctx, str);
+  if (n < 0) {
+    js_free(ctx, data);
+    return JS_ThrowSyntaxError(ctx, "fromBase64: invalid base64 string");
+  }
+  return js_encoding_new_uint8_array(ctx, data, n);
+}
+
+static JSValue js_uint8_array_to_hex(JSContext *ctx, JSValueConst this_val,
+                                     int argc, JSValueConst *argv) {
+  size_t len;
+  const uint8_t *data = js_encoding_get_uint8_array(ctx, this_val, &len);
+  if (!data)
+    return JS_EXCEPTION;
+  char *out = js_malloc(ctx, 2 * len + 1);
+  if (!out)
+    return JS_EXCEPTION;
+  enc_hex_encode(out, data, len);
+  JSValue ret = JS_NewStringLen(ctx, out, 2 * len);
+  js_free(ctx, out);
+  return ret;
+}
+
+static JSValue js_uint8_array_from_hex(JSContext *ctx, JSValueConst this_val,
+                                       int argc, JSValueConst *argv) {
+  if (!JS_IsString(argv[0]))
+    return JS_ThrowTypeError(ctx, "fromHex: expected a string");
+  size_t len;
+  const char *str = JS_ToCStringLen(ctx, &len, argv[0]);
+  if (!str)
+    return JS_EXCEPTION;
+  uint8_t *data = js_malloc(ctx, len / 2 + 1);
+  if (!data) {
+    JS_FreeCString(ctx, str);
+    return JS_EXCEPTION;
+  }
+  ptrdiff_t n = enc_hex_decode(data, str, len);
+  JS_FreeCString(ctx, str);
+  if (n < 0) {
+    js_free(ctx, data);
+    return JS_ThrowSyntaxError(ctx, "fromHex: invalid hex string");
+  }
+  return js_encoding_new_uint8_array(ctx, data, n);
+}
+
+static const JSCFunctionListEntry js_uint8_array_proto_funcs[] = {
+    JS_CFUNC_DEF("toBase64", 0, js_uint8_array_to_base64),
+    JS_CFUNC_DEF("toHex", 0, js_uint8_array_to_hex),
+};
+
+static const JSCFunctionListEntry js_uint8_array_funcs[] = {
+    JS_CFUNC_DEF("fromBase64", 1, js_uint8_array_from_base64),
+    JS_CFUNC_DEF("fromHex", 1, js_uint8_array_from_hex),
+};
+
+static const JSCFunctionListEntry js_encoding_global_funcs[] = {
+    JS_CFUNC_DEF("atob", 1, js_encoding_atob),
+    JS_CFUNC_DEF("btoa", 1, js_encoding_btoa),
+};
+
+static JSValue js_encoding_init_class(JSContext *ctx, JSClassID *class_id,
+                                      JSClassDef *def, JSCFunction *ctor_func,
+                                      const JSCFunctionListEntry *funcs,
+                                      int n_funcs) {
+  JSRuntime *rt = JS_GetRuntime(ctx);
+  // 类 ID 全进程共享，类按运行时注册
+  if (*class_id == 0)
+    JS_NewClassID(class_id);
+  if (!JS_IsRegisteredClass(rt, *class_id))
+    JS_NewClass(rt, *class_id, def);
+
+  JSValue proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, proto, funcs, n_funcs);
+  JSValue ctor = JS_NewCFunction2(ctx, ctor_func, def->class_name, 0,
+                                  JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, ctor, proto);
+  JS_SetClassProto(ctx, *class_id, proto);
+  return ctor;
+}
+
+void js_std_init_encoding(JSContext *ctx) {
+  JSValue global_obj = JS_GetGlobalObject(ctx);
+
+  JS_SetPropertyStr(
+      ctx, global_obj, "TextEncoder",
+      js_encoding_init_class(ctx, &js_text_encoder_class_id,
+                             &js_text_encoder_class, js_text_encoder_ctor,
+                             js_text_encoder_proto_funcs,
+                             sizeof(js_text_encoder_proto_funcs) /
+                                 sizeof(js_text_encoder_proto_funcs[0])));
+  JS_SetPropertyStr(
+      ctx, global_obj, "TextDecoder",
+      js_encoding_init_class(ctx, &js_text_decoder_class_id,
+                             &js_text_decoder_class, js_text_decoder_ctor,
+                             js_text_decoder_proto_funcs,
+                             sizeof(js_text_decoder_proto_funcs) /
+                                 sizeof(js_text_decoder_proto_funcs[0])));
+  JS_SetPropertyFunctionList(ctx, global_obj, js_encoding_global_funcs,
+                             sizeof(js_encoding_global_funcs) /
+                                 sizeof(js_encoding_global_funcs[0]));
+
+  // 引擎已经实现了这些方法时保留引擎的版本
+  JSValue uint8_array = JS_GetPropertyStr(ctx, global_obj, "Uint8Array");
+  JSValue proto = JS_GetPropertyStr(ctx, uint8_array, "prototype");
+  JSAtom to_base64 = JS_NewAtom(ctx, "toBase64");
+  if (!JS_HasProperty(ctx, proto, to_base64)) {
+    JS_SetPropertyFunctionList(ctx, proto, js_uint8_array_proto_funcs,
+                               sizeof(js_uint8_array_proto_funcs) /
+                                   sizeof(js_uint8_array_proto_funcs[0]));
+    JS_SetPropertyFunctionList(ctx, uint8_array, js_uint8_array_funcs,
+                               sizeof(js_uint8_array_funcs) /
+                                   sizeof(js_uint8_array_funcs[0]));
+  }
+  JS_FreeAtom(ctx, to_base64);
+  JS_FreeValue(ctx, proto);
+  JS_FreeValue(ctx, uint8_array);
+  JS_FreeValue(ctx, global_obj);
+}
+
+#endif
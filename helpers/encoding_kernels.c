@@ -0,0 +1,669 @@
+#ifndef HELPERS_ENCODING_KERNELS_C
+#define HELPERS_ENCODING_KERNELS_C
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ENC_KERNELS_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define ENC_KERNELS_NEON 1
+#endif
+
+/*
+ * 文本与二进制转换的内核：ASCII 检测、UTF-8 校验、base64 和 hex 编解码。
+ * 每个内核都有标量版本；x86 上运行时检测到 AVX2 时使用 AVX2 版本
+ * （ASCII 检测另有 SSE2 版本，x86_64 上总是可用），aarch64 上 ASCII 检测
+ * 使用 NEON。SIMD 版本只处理整块数据，剩余部分交给标量版本。
+ */
+
+static const char enc_base64_chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char enc_base64url_chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+static const char enc_hex_chars[] = "0123456789abcdef";
+
+/* 标量版本 */
+
+static size_t enc_ascii_prefix_scalar(const uint8_t *p, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t v;
+    memcpy(&v, p + i, 8);
+    if (v & 0x8080808080808080ull)
+      break;
+  }
+  while (i < n && p[i] < 0x80)
+    i++;
+  return i;
+}
+
+// 检查 p 开始的一个字符。合法时返回 1，*len 为字符长度；非法时返回 0，
+// 数据在序列完整之前结束时返回 -1。后两种情况 *len 为最长合法前缀的
+// 长度（至少为 1），即替换成一个 U+FFFD 的字节数
+static int enc_utf8_check(const uint8_t *p, size_t n, size_t *len) {
+  uint8_t c = p[0];
+  uint8_t lo = 0x80, hi = 0xBF;
+  size_t need;
+  if (c < 0x80) {
+    *len = 1;
+    return 1;
+  }
+  if (c >= 0xC2 && c <= 0xDF) {
+    need = 1;
+  } else if (c >= 0xE0 && c <= 0xEF) {
+    need = 2;
+    if (c == 0xE0)
+      lo = 0xA0; // 过长编码
+    else if (c == 0xED)
+      hi = 0x9F; // 代理项
+  } else if (c >= 0xF0 && c <= 0xF4) {
+    need = 3;
+    if (c == 0xF0)
+      lo = 0x90; // 过长编码
+    else if (c == 0xF4)
+      hi = 0x8F; // 超过 U+10FFFF
+  } else {
+    *len = 1;
+    return 0;
+  }
+  for (size_t i = 1; i <= need; i++) {
+    if (i >= n) {
+      *len = i;
+      return -1;
+    }
+    if (p[i] < lo || p[i] > hi) {
+      *len = i;
+      return 0;
+    }
+    lo = 0x80;
+    hi = 0xBF;
+  }
+  *len = need + 1;
+  return 1;
+}
+
+static int enc_utf8_valid_scalar(const uint8_t *p, size_t n) {
+  size_t i = 0;
+  while (i < n) {
+    i += enc_ascii_prefix_scalar(p + i, n - i);
+    if (i >= n)
+      break;
+    size_t len;
+    if (enc_utf8_check(p + i, n - i, &len) != 1)
+      return 0;
+    i += len;
+  }
+  return 1;
+}
+
+static size_t enc_base64_encode_scalar(char *out, const uint8_t *in, size_t n,
+                                       const char *chars) {
+  size_t o = 0;
+  for (size_t i = 0; i + 3 <= n; i += 3) {
+    uint32_t v = (uint32_t)in[i] << 16 | (uint32_t)in[i + 1] << 8 | in[i + 2];
+    out[o++] = chars[v >> 18];
+    out[o++] = chars[(v >> 12) & 63];
+    out[o++] = chars[(v >> 6) & 63];
+    out[o++] = chars[v & 63];
+  }
+  return o;
+}
+
+static int enc_base64_value(uint8_t c, int url) {
+  if (c >= 'A' && c <= 'Z')
+    return c - 'A';
+  if (c >= 'a' && c <= 'z')
+    return c - 'a' + 26;
+  if (c >= '0' && c <= '9')
+    return c - '0' + 52;
+  if (c == (url ? '-' : '+'))
+    return 62;
+  if (c == (url ? '_' : '/'))
+    return 63;
+  return -1;
+}
+
+static void enc_hex_encode_scalar(char *out, const uint8_t *in, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[2 * i] = enc_hex_chars[in[i] >> 4];
+    out[2 * i + 1] = enc_hex_chars[in[i] & 15];
+  }
+}
+
+static int enc_hex_value(uint8_t c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+static size_t enc_hex_decode_scalar(uint8_t *out, const char *in, size_t n) {
+  for (size_t i = 0; i < n / 2; i++) {
+    int hi = enc_hex_value(in[2 * i]);
+    int lo = enc_hex_value(in[2 * i + 1]);
+    if (hi < 0 || lo < 0)
+      return i;
+    out[i] = hi << 4 | lo;
+  }
+  return n / 2;
+}
+
+#if defined(ENC_KERNELS_X86)
+
+static int enc_has_avx2(void) {
+  static int has_avx2 = -1;
+  if (has_avx2 < 0) {
+    __builtin_cpu_init();
+    has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+  }
+  return has_avx2;
+}
+
+static size_t enc_ascii_prefix_sse2(const uint8_t *p, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(p + i))))
+      break;
+  }
+  return i + enc_ascii_prefix_scalar(p + i, n - i);
+}
+
+__attribute__((target("avx2"))) static size_t
+enc_ascii_prefix_avx2(const uint8_t *p, size_t n) {
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(p + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(p + i + 32));
+    if (_mm256_movemask_epi8(_mm256_or_si256(a, b)))
+      break;
+  }
+  return i + enc_ascii_prefix_sse2(p + i, n - i);
+}
+
+/* UTF-8 校验：simdjson 的查表算法（Keiser & Lemire,
+   "Validating UTF-8 In Less Than One Instruction Per Byte"）。用前一字节
+   的高、低半字节和当前字节的高半字节查三张表，三者按位与后非零即为
+   两字节之间的错误；第三、四个字节是否必须是续字节单独判断。 */
+
+#define ENC_TOO_SHORT (1 << 0)
+#define ENC_TOO_LONG (1 << 1)
+#define ENC_OVERLONG_3 (1 << 2)
+#define ENC_TOO_LARGE (1 << 3)
+#define ENC_SURROGATE (1 << 4)
+#define ENC_OVERLONG_2 (1 << 5)
+#define ENC_TOO_LARGE_1000 (1 << 6)
+#define ENC_OVERLONG_4 (1 << 6)
+#define ENC_TWO_CONTS (1 << 7)
+#define ENC_CARRY (ENC_TOO_SHORT | ENC_TOO_LONG | ENC_TWO_CONTS)
+
+#define ENC_BOTH_LANES(...) __VA_ARGS__, __VA_ARGS__
+
+__attribute__((target("avx2"))) static int
+enc_utf8_valid_avx2(const uint8_t *p, size_t n) {
+  const __m256i byte_1_high = _mm256_setr_epi8(ENC_BOTH_LANES(
+      // 0_______：ASCII
+      ENC_TOO_LONG, ENC_TOO_LONG, ENC_TOO_LONG, ENC_TOO_LONG, ENC_TOO_LONG,
+      ENC_TOO_LONG, ENC_TOO_LONG, ENC_TOO_LONG,
+      // 10______：续字节
+      ENC_TWO_CONTS, ENC_TWO_CONTS, ENC_TWO_CONTS, ENC_TWO_CONTS,
+      // 1100____、1101____：两字节序列开头
+      ENC_TOO_SHORT | ENC_OVERLONG_2, ENC_TOO_SHORT,
+      // 1110____：三字节序列开头
+      ENC_TOO_SHORT | ENC_OVERLONG_3 | ENC_SURROGATE,
+      // 1111____：四字节序列开头
+      ENC_TOO_SHORT | ENC_TOO_LARGE | ENC_TOO_LARGE_1000 | ENC_OVERLONG_4));
+  const __m256i byte_1_low = _mm256_setr_epi8(ENC_BOTH_LANES(
+      // ____0000
+      ENC_CARRY | ENC_OVERLONG_3 | ENC_OVERLONG_2 | ENC_OVERLONG_4,
+      // ____0001
+      ENC_CARRY | ENC_OVERLONG_2,
+      // ____001_
+      ENC_CARRY, ENC_CARRY,
+      // ____0100
+      ENC_CARRY | ENC_TOO_LARGE,
+      // ____0101 到 ____1100
+      ENC_CARRY | ENC_TOO_LARGE | ENC_TOO_LARGE_1000,
+      ENC_CARRY | ENC_TOO_LARGE | ENC_TOO_LARGE_1000,
+      ENC_CARRY | ENC_TOO_LARGE | ENC_TOO_LARGE_1000,
+      ENC_CARRY | ENC_TOO_LARGE | ENC_TOO_LARGE_1000,
+      ENC_CARRY | ENC_TOO_LARGE | ENC_TOO_LARGE_1000,
+      ENC_CARRY | ENC_TOO_LARGE | ENC_TOO_LARGE_1000,
+      ENC_CARRY | ENC_TOO_LARGE | ENC_TOO_LARGE_1000,
+      ENC_CARRY | ENC_TOO_LARGE | ENC_TOO_LARGE_1000,
+      // ____1101
+      ENC_CARRY | ENC_TOO_LARGE | ENC_TOO_LARGE_1000 | ENC_SURROGATE,
+      // ____111_
+      ENC_CARRY | ENC_TOO_LARGE | ENC_TOO_LARGE_1000,
+      ENC_CARRY | ENC_TOO_LARGE | ENC_TOO_LARGE_1000));
+  const __m256i byte_2_high = _mm256_setr_epi8(ENC_BOTH_LANES(
+      // 0_______：ASCII
+      ENC_TOO_SHORT, ENC_TOO_SHORT, ENC_TOO_SHORT, ENC_TOO_SHORT,
+      ENC_TOO_SHORT, ENC_TOO_SHORT, ENC_TOO_SHORT, ENC_TOO_SHORT,
+      // 1000____
+      ENC_TOO_LONG | ENC_OVERLONG_2 | ENC_TWO_CONTS | ENC_OVERLONG_3 |
+          ENC_TOO_LARGE_1000 | ENC_OVERLONG_4,
+      // 1001____
+      ENC_TOO_LONG | ENC_OVERLONG_2 | ENC_TWO_CONTS | ENC_OVERLONG_3 |
+          ENC_TOO_LARGE,
+      // 101_____
+      ENC_TOO_LONG | ENC_OVERLONG_2 | ENC_TWO_CONTS | ENC_SURROGATE |
+          ENC_TOO_LARGE,
+      ENC_TOO_LONG | ENC_OVERLONG_2 | ENC_TWO_CONTS | ENC_SURROGATE |
+          ENC_TOO_LARGE,
+      // 11______：序列开头
+      ENC_TOO_SHORT, ENC_TOO_SHORT, ENC_TOO_SHORT, ENC_TOO_SHORT));
+  // 块的最后三个字节分别大于这些值时，序列在块内不完整
+  const __m256i max_value = _mm256_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xF0 - 1),
+      (char)(0xE0 - 1), (char)(0xC0 - 1));
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+  __m256i prev_input = _mm256_setzero_si256();
+  __m256i prev_incomplete = _mm256_setzero_si256();
+  __m256i error = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i input = _mm256_loadu_si256((const __m256i *)(p + i));
+    if (!_mm256_movemask_epi8(input)) {
+      // ASCII 块只需检查上一块是否以不完整的序列结尾
+      error = _mm256_or_si256(error, prev_incomplete);
+      prev_incomplete = _mm256_setzero_si256();
+    } else {
+      __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+      __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+      __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+      __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+      __m256i special = _mm256_and_si256(
+          _mm256_and_si256(
+              _mm256_shuffle_epi8(
+                  byte_1_high,
+                  _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+              _mm256_shuffle_epi8(byte_1_low,
+                                  _mm256_and_si256(prev1, nibble))),
+          _mm256_shuffle_epi8(
+              byte_2_high,
+              _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+      // 前两个字节是三/四字节序列开头、或前三个字节是四字节序列开头时，
+      // 当前字节必须是续字节，此时 special 恰好只有 TWO_CONTS 位
+      __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80));
+      __m256i fourth =
+          _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+      __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth),
+                                        _mm256_set1_epi8((char)0x80));
+      error = _mm256_or_si256(error, _mm256_xor_si256(must23, special));
+      prev_incomplete = _mm256_subs_epu8(input, max_value);
+    }
+    prev_input = input;
+  }
+  if (!_mm256_testz_si256(error, error))
+    return 0;
+
+  // 跨过最后一块结尾的序列从它的开头字节起用标量版本检查
+  size_t start = i;
+  for (size_t back = 1; back <= 3 && back <= i; back++) {
+    uint8_t c = p[i - back];
+    if (c < 0x80)
+      break;
+    if (c >= 0xC0) {
+      start = i - back;
+      break;
+    }
+  }
+  return enc_utf8_valid_scalar(p + start, n - start);
+}
+
+/* base64：Muła & Lemire, "Faster Base64 Encoding and Decoding Using AVX2
+   Instructions"。编码每次把 24 字节拆成 32 个 6 位值再查表映射到字符；
+   解码按字符的高低半字节查表，同时完成校验和到 6 位值的转换。 */
+
+__attribute__((target("avx2"))) static size_t
+enc_base64_encode_avx2(char *out, const uint8_t *in, size_t n, int url) {
+  // 把每 3 个字节排成一个 32 位字 [b1, b0, b2, b1]
+  const __m256i shuffle = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5,
+      4, 7, 6, 8, 7, 10, 9, 11, 10);
+  // 按 6 位值所在区间 A-Z、a-z、0-9、62、63 取出的字符偏移
+  const __m256i offsets = _mm256_setr_epi8(ENC_BOTH_LANES(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, (url ? '-' : '+') - 62,
+      (url ? '_' : '/') - 63, 'A', 0, 0));
+  size_t i = 0, o = 0;
+  // 高半块从 in + 12 读 16 字节，只用其中 12 个
+  for (; i + 28 <= n; i += 24, o += 32) {
+    __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + i))),
+        _mm_loadu_si128((const __m128i *)(in + i + 12)), 1);
+    v = _mm256_shuffle_epi8(v, shuffle);
+    __m256i t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00));
+    __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    __m256i t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0));
+    __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    __m256i indices = _mm256_or_si256(t1, t3);
+
+    __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    range = _mm256_or_si256(range,
+                            _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+    __m256i chars =
+        _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices);
+    _mm256_storeu_si256((__m256i *)(out + o), chars);
+  }
+  return o + enc_base64_encode_scalar(out + o, in + i, n - i - (n - i) % 3,
+                                      url ? enc_base64url_chars
+                                          : enc_base64_chars);
+}
+
+// 解码不含空白和填充的整块（32 个字符），返回消耗的字符数。
+// 每块写出 32 字节，其中有效的是前 24 个
+__attribute__((target("avx2"))) static size_t
+enc_base64_decode_avx2(uint8_t *out, const char *in, size_t n, int url) {
+  const __m256i lut_lo = _mm256_setr_epi8(ENC_BOTH_LANES(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A,
+      0x1B, 0x1B, 0x1B, 0x1A));
+  const __m256i lut_hi = _mm256_setr_epi8(ENC_BOTH_LANES(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x10, 0x10));
+  const __m256i lut_roll = _mm256_setr_epi8(
+      ENC_BOTH_LANES(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0));
+  const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+  const __m256i pack = _mm256_setr_epi8(ENC_BOTH_LANES(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  size_t i = 0, o = 0;
+  for (; i + 32 <= n; i += 32, o += 24) {
+    __m256i str = _mm256_loadu_si256((const __m256i *)(in + i));
+    if (url) {
+      // '-'、'_' 换成 '+'、'/'；原本的 '+'、'/' 不属于 url 字母表
+      __m256i plus = _mm256_cmpeq_epi8(str, _mm256_set1_epi8('+'));
+      __m256i slash = _mm256_cmpeq_epi8(str, mask_2f);
+      if (!_mm256_testz_si256(_mm256_or_si256(plus, slash),
+                              _mm256_or_si256(plus, slash)))
+        break;
+      __m256i minus = _mm256_cmpeq_epi8(str, _mm256_set1_epi8('-'));
+      __m256i under = _mm256_cmpeq_epi8(str, _mm256_set1_epi8('_'));
+      str = _mm256_blendv_epi8(str, _mm256_set1_epi8('+'), minus);
+      str = _mm256_blendv_epi8(str, mask_2f, under);
+    }
+    __m256i hi_nibbles =
+        _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+    __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+    __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    // 空白、'=' 和其他非法字符交给标量版本处理
+    if (!_mm256_testz_si256(lo, hi))
+      break;
+    __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+    __m256i roll =
+        _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    str = _mm256_add_epi8(str, roll);
+
+    // 4 个 6 位值合成 3 个字节
+    __m256i merged =
+        _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+    merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    merged = _mm256_shuffle_epi8(merged, pack);
+    merged = _mm256_permutevar8x32_epi32(
+        merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1));
+    _mm256_storeu_si256((__m256i *)(out + o), merged);
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) static size_t
+enc_hex_encode_avx2(char *out, const uint8_t *in, size_t n) {
+  const __m256i lut = _mm256_setr_epi8(ENC_BOTH_LANES(
+      '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e',
+      'f'));
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    // 每个字节扩成 16 位：低字节放高半字节，高字节放低半字节
+    __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(in + i)));
+    __m256i nibbles = _mm256_or_si256(
+        _mm256_srli_epi16(v, 4),
+        _mm256_slli_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0x0F)), 8));
+    _mm256_storeu_si256((__m256i *)(out + 2 * i),
+                        _mm256_shuffle_epi8(lut, nibbles));
+  }
+  return i;
+}
+
+// 解码整块（32 个字符），遇到非十六进制字符时停在该块之前。
+// 返回写出的字节数
+__attribute__((target("avx2"))) static size_t
+enc_hex_decode_avx2(uint8_t *out, const char *in, size_t n) {
+  size_t o = 0;
+  for (; 2 * o + 32 <= n; o += 16) {
+    __m256i c = _mm256_loadu_si256((const __m256i *)(in + 2 * o));
+    __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+    // 大于等于 0x80 的字节按有符号比较为负数，两类都不匹配
+    __m256i digit =
+        _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+    __m256i alpha =
+        _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                         _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+    if (_mm256_movemask_epi8(_mm256_or_si256(digit, alpha)) != -1)
+      break;
+    __m256i value = _mm256_blendv_epi8(
+        _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10)),
+        _mm256_sub_epi8(c, _mm256_set1_epi8('0')), digit);
+    // 相邻两个半字节合成一个字节：hi * 16 + lo
+    __m256i words = _mm256_maddubs_epi16(value, _mm256_set1_epi16(0x0110));
+    __m256i bytes = _mm256_packus_epi16(words, words);
+    bytes = _mm256_permute4x64_epi64(bytes, 0x08);
+    _mm_storeu_si128((__m128i *)(out + o), _mm256_castsi256_si128(bytes));
+  }
+  return o;
+}
+
+#elif defined(ENC_KERNELS_NEON)
+
+static size_t enc_ascii_prefix_neon(const uint8_t *p, size_t n) {
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    uint8x16_t v = vorrq_u8(vld1q_u8(p + i), vld1q_u8(p + i + 16));
+    if (vmaxvq_u8(v) >= 0x80)
+      break;
+  }
+  return i + enc_ascii_prefix_scalar(p + i, n - i);
+}
+
+#endif
+
+/* 分派 */
+
+// 开头连续的 ASCII 字节数
+static size_t enc_ascii_prefix(const uint8_t *p, size_t n) {
+#if defined(ENC_KERNELS_X86)
+  if (enc_has_avx2())
+    return enc_ascii_prefix_avx2(p, n);
+  return enc_ascii_prefix_sse2(p, n);
+#elif defined(ENC_KERNELS_NEON)
+  return enc_ascii_prefix_neon(p, n);
+#else
+  return enc_ascii_prefix_scalar(p, n);
+#endif
+}
+
+// 是否为合法的 UTF-8（不允许代理项、过长编码和超过 U+10FFFF 的码点）
+static int enc_utf8_valid(const uint8_t *p, size_t n) {
+#if defined(ENC_KERNELS_X86)
+  if (enc_has_avx2())
+    return enc_utf8_valid_avx2(p, n);
+#endif
+  return enc_utf8_valid_scalar(p, n);
+}
+
+// 结尾处不完整但尚未出错的序列的字节数，流式解码时留到下一块
+static size_t enc_utf8_incomplete_tail(const uint8_t *p, size_t n) {
+  for (size_t back = 1; back <= 3 && back <= n; back++) {
+    uint8_t c = p[n - back];
+    if (c < 0x80)
+      return 0;
+    if (c >= 0xC0) {
+      size_t len;
+      return enc_utf8_check(p + n - back, back, &len) == -1 ? back : 0;
+    }
+  }
+  return 0;
+}
+
+// 把每段非法序列替换成 U+FFFD，out 至少 3 * n 字节，返回写出的长度
+static size_t enc_utf8_replace(uint8_t *out, const uint8_t *in, size_t n) {
+  size_t i = 0, o = 0;
+  while (i < n) {
+    size_t ascii = enc_ascii_prefix(in + i, n - i);
+    memcpy(out + o, in + i, ascii);
+    i += ascii;
+    o += ascii;
+    if (i >= n)
+      break;
+    size_t len;
+    if (enc_utf8_check(in + i, n - i, &len) == 1) {
+      memcpy(out + o, in + i, len);
+      o += len;
+    } else {
+      out[o++] = 0xEF;
+      out[o++] = 0xBF;
+      out[o++] = 0xBD;
+    }
+    i += len;
+  }
+  return o;
+}
+
+static size_t enc_base64_encoded_len(size_t n, int pad) {
+  return pad ? (n + 2) / 3 * 4 : n / 3 * 4 + (n % 3 ? n % 3 + 1 : 0);
+}
+
+// base64 编码，out 至少 enc_base64_encoded_len(n, pad) 字节，返回写出的长度
+static size_t enc_base64_encode(char *out, const uint8_t *in, size_t n,
+                                int url, int pad) {
+  const char *chars = url ? enc_base64url_chars : enc_base64_chars;
+  size_t o;
+#if defined(ENC_KERNELS_X86)
+  if (enc_has_avx2())
+    o = enc_base64_encode_avx2(out, in, n, url);
+  else
+#endif
+    o = enc_base64_encode_scalar(out, in, n, chars);
+
+  size_t i = n - n % 3;
+  if (n % 3 == 1) {
+    out[o++] = chars[in[i] >> 2];
+    out[o++] = chars[(in[i] & 3) << 4];
+    if (pad) {
+      out[o++] = '=';
+      out[o++] = '=';
+    }
+  } else if (n % 3 == 2) {
+    out[o++] = chars[in[i] >> 2];
+    out[o++] = chars[(in[i] & 3) << 4 | in[i + 1] >> 4];
+    out[o++] = chars[(in[i + 1] & 15) << 2];
+    if (pad)
+      out[o++] = '=';
+  }
+  return o;
+}
+
+static int enc_is_ascii_space(uint8_t c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\f' || c == '\r';
+}
+
+// base64 解码，跳过 ASCII 空白，填充可以省略。strict 时要求填充完整且
+// 最后一组多余的位为 0。out 至少 n / 4 * 3 + 32 字节，返回写出的长度，
+// 输入非法时返回 -1
+static ptrdiff_t enc_base64_decode(uint8_t *out, const char *in, size_t n,
+                                   int url, int strict) {
+  size_t i = 0, o = 0;
+  uint32_t acc = 0;
+  int k = 0; // 当前一组已有的 6 位值个数
+  while (i < n) {
+#if defined(ENC_KERNELS_X86)
+    // 只在组的边界上走 SIMD，遇到空白或填充时退回标量处理一组
+    if (k == 0 && n - i >= 32 && enc_has_avx2()) {
+      size_t used = enc_base64_decode_avx2(out + o, in + i, n - i, url);
+      i += used;
+      o += used / 4 * 3;
+      if (i >= n)
+        break;
+    }
+#endif
+    uint8_t c = in[i];
+    if (enc_is_ascii_space(c)) {
+      i++;
+      continue;
+    }
+    if (c == '=')
+      break;
+    int v = enc_base64_value(c, url);
+    if (v < 0)
+      return -1;
+    acc = acc << 6 | v;
+    i++;
+    if (++k == 4) {
+      out[o++] = acc >> 16;
+      out[o++] = acc >> 8;
+      out[o++] = acc;
+      acc = 0;
+      k = 0;
+    }
+  }
+
+  if (i < n) {
+    // 填充之后只能有空白
+    int pads = 0;
+    for (; i < n; i++) {
+      if (in[i] == '=')
+        pads++;
+      else if (!enc_is_ascii_space(in[i]))
+        return -1;
+    }
+    if (k < 2 || k + pads != 4)
+      return -1;
+  } else if (k == 1 || (strict && k != 0)) {
+    return -1;
+  }
+  if (k == 2) {
+    if (strict && (acc & 15))
+      return -1;
+    out[o++] = acc >> 4;
+  } else if (k == 3) {
+    if (strict && (acc & 3))
+      return -1;
+    out[o++] = acc >> 10;
+    out[o++] = acc >> 2;
+  }
+  return o;
+}
+
+// 输出小写十六进制，out 至少 2 * n 字节
+static void enc_hex_encode(char *out, const uint8_t *in, size_t n) {
+  size_t i = 0;
+#if defined(ENC_KERNELS_X86)
+  if (enc_has_avx2())
+    i = enc_hex_encode_avx2(out, in, n);
+#endif
+  enc_hex_encode_scalar(out + 2 * i, in + i, n - i);
+}
+
+// 十六进制解码，大小写均可。长度为奇数或有非法字符时返回 -1
+static ptrdiff_t enc_hex_decode(uint8_t *out, const char *in, size_t n) {
+  if (n % 2)
+    return -1;
+  size_t o = 0;
+#if defined(ENC_KERNELS_X86)
+  if (enc_has_avx2())
+    o = enc_hex_decode_avx2(out, in, n);
+#endif
+  o += enc_hex_decode_scalar(out + o, in + 2 * o, n - 2 * o);
+  return o == n / 2 ? (ptrdiff_t)o : -1;
+}
+
+#endif
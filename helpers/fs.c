@@ -0,0 +1,542 @@
+#ifndef HELPERS_FS_C
+#define HELPERS_FS_C
+
+#include "../quickjs/quickjs.h"
+#include "./encoding.c"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * 脚本用的文件 I/O 模块，数据以 ArrayBuffer 交换，不经过 JS 字符串：
+ *
+ *   import * as fs from "fs";
+ *   const buf = fs.readFile("data.bin");            // mmap 的 ArrayBuffer
+ *   const part = fs.readFile("big.bin", { offset: 1 << 30, length: 1 << 30 });
+ *   const fd = fs.open("big.bin", "r");
+ *   const chunk = new Uint8Array(4 << 20);          // 预先分配，反复使用
+ *   while ((n = fs.read(fd, chunk)) > 0) { ... }
+ *   fs.close(fd);
+ *
+ * readFile 直接把文件映射进进程，ArrayBuffer 被回收时在释放回调中
+ * munmap，整个过程没有复制；映射是私有的，脚本写入不会改动文件。
+ * 映射期间文件被其他进程截断时访问会触发 SIGBUS。QuickJS 的 ArrayBuffer
+ * 最长 2 GB，更大的文件用 offset/length 分段映射或用 read 流式读取。
+ * 管道等不能映射的文件退回到 read 读入 malloc 的缓冲区。
+ *
+ * read/write 的参数同 Node：(fd, buffer, offset, length, position)，
+ * 同步版本由内核直接读写 buffer 的内存，position 为 null 时使用并推进
+ * 文件偏移。
+ *
+ * 每个调用先在 JS 线程上解析成 FsRequest，再由 fs_request_run 执行阻塞
+ * 的系统调用，最后回到 JS 线程生成结果。同步版本依次执行三步；demo09 的
+ * fs/promises 把中间一步放到 libuv 的线程池上。请求执行期间脚本还在运行，
+ * 可能转移或缩小缓冲区，所以异步请求先用 fs_request_bounce 换成宿主内存。
+ */
+
+typedef enum {
+  FS_READ_FILE,
+  FS_WRITE_FILE,
+  FS_OPEN,
+  FS_CLOSE,
+  FS_READ,
+  FS_WRITE,
+  FS_STAT,
+} FsOp;
+
+typedef struct {
+  FsOp op;
+  const char *path;
+  int fd;
+  int flags;
+  int64_t offset; // readFile 的起始偏移
+  int64_t length; // readFile 的长度，-1 表示到文件末尾
+  int64_t position; // read/write 的文件位置，-1 表示当前偏移
+  uint8_t *data;    // read/write 的缓冲区，writeFile 的数据
+  size_t size;
+  int populate; // readFile 在线程池上执行时预先读入所有页
+  JSValue hold;         // 在请求完成之前保持缓冲区存活
+  int64_t hold_offset;  // read/write 的范围在 hold 中的起始位置
+  const char *str_data; // writeFile 的字符串数据
+  uint8_t *bounce;      // fs_request_bounce 分配的宿主缓冲区
+  int bounced;          // data 指向宿主内存，read 完成时复制回 hold
+
+  // 执行结果
+  int err; // errno，0 表示成功
+  const char *syscall;
+  int64_t result;
+  uint8_t *buf; // readFile 的数据
+  int mapped;   // buf 是否来自 mmap
+  struct stat st;
+} FsRequest;
+
+static void js_fs_unmap(JSRuntime *rt, void *opaque, void *ptr) {
+  // ptr 可能不在页边界上，映射从所在页开始
+  uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+  uintptr_t base = (uintptr_t)ptr & ~(page - 1);
+  munmap((void *)base, (size_t)(uintptr_t)opaque + ((uintptr_t)ptr - base));
+}
+
+static void js_fs_free(JSRuntime *rt, void *opaque, void *ptr) { free(ptr); }
+
+static int fs_parse_flags(const char *str) {
+  static const struct {
+    const char *name;
+    int flags;
+  } modes[] = {
+      {"r", O_RDONLY},
+      {"r+", O_RDWR},
+      {"w", O_WRONLY | O_CREAT | O_TRUNC},
+      {"w+", O_RDWR | O_CREAT | O_TRUNC},
+      {"a", O_WRONLY | O_CREAT | O_APPEND},
+      {"a+", O_RDWR | O_CREAT | O_APPEND},
+  };
+  for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+    if (strcmp(str, modes[i].name) == 0)
+      return modes[i].flags;
+  }
+  return -1;
+}
+
+// 可选的整数参数，undefined 和 null 时取 dflt
+static int fs_get_int64(JSContext *ctx, int64_t *v, int argc,
+                        JSValueConst *argv, int i, int64_t dflt) {
+  if (i >= argc || JS_IsUndefined(argv[i]) || JS_IsNull(argv[i])) {
+    *v = dflt;
+    return 0;
+  }
+  if (JS_ToInt64(ctx, v, argv[i]))
+    return -1;
+  if (*v < 0) {
+    JS_ThrowRangeError(ctx, "argument %d must not be negative", i + 1);
+    return -1;
+  }
+  return 0;
+}
+
+// (fd, buffer, offset, length, position)，buffer 为 ArrayBuffer 或视图
+static int fs_parse_io(JSContext *ctx, FsRequest *r, int argc,
+                       JSValueConst *argv) {
+  int64_t offset, length;
+  size_t size;
+  // 先转换整数参数，valueOf 可能转移或缩小缓冲区；length 省略时为 -1
+  if (JS_ToInt32(ctx, &r->fd, argv[0]) ||
+      fs_get_int64(ctx, &offset, argc, argv, 2, 0) ||
+      fs_get_int64(ctx, &length, argc, argv, 3, -1) ||
+      fs_get_int64(ctx, &r->position, argc, argv, 4, -1))
+    return -1;
+  uint8_t *data = js_encoding_get_bytes(ctx, argv[1], &size);
+  if (!data)
+    return -1;
+  if (length < 0)
+    length = offset <= (int64_t)size ? (int64_t)size - offset : 0;
+  if (offset > (int64_t)size || length > (int64_t)size - offset) {
+    JS_ThrowRangeError(ctx, "offset and length exceed the buffer");
+    return -1;
+  }
+  r->data = data + offset;
+  r->size = length;
+  r->hold = JS_DupValue(ctx, argv[1]);
+  r->hold_offset = offset;
+  return 0;
+}
+
+// 在 JS 线程上解析参数，失败时抛出异常并返回 -1
+static int fs_request_parse(JSContext *ctx, FsRequest *r, FsOp op, int argc,
+                            JSValueConst *argv) {
+  memset(r, 0, sizeof(*r));
+  r->op = op;
+  r->fd = -1;
+  r->hold = JS_UNDEFINED;
+
+  switch (op) {
+  case FS_CLOSE:
+    return JS_ToInt32(ctx, &r->fd, argv[0]);
+  case FS_READ:
+  case FS_WRITE:
+    return fs_parse_io(ctx, r, argc, argv);
+  default:
+    break;
+  }
+
+  r->path = JS_ToCString(ctx, argv[0]);
+  if (!r->path)
+    return -1;
+  switch (op) {
+  case FS_READ_FILE: {
+    JSValueConst options = argc > 1 ? argv[1] : JS_UNDEFINED;
+    r->length = -1;
+    if (JS_IsObject(options)) {
+      JSValue v[2] = {JS_GetPropertyStr(ctx, options, "offset"),
+                      JS_GetPropertyStr(ctx, options, "length")};
+      int ret = fs_get_int64(ctx, &r->offset, 2, v, 0, 0) ||
+                fs_get_int64(ctx, &r->length, 2, v, 1, -1);
+      JS_FreeValue(ctx, v[0]);
+      JS_FreeValue(ctx, v[1]);
+      if (ret)
+        return -1;
+    }
+    return 0;
+  }
+  case FS_WRITE_FILE: {
+    if (JS_IsString(argv[1])) {
+      r->str_data = JS_ToCStringLen(ctx, &r->size, argv[1]);
+      if (!r->str_data)
+        return -1;
+      r->data = (uint8_t *)r->str_data;
+      return 0;
+    }
+    r->data = js_encoding_get_bytes(ctx, argv[1], &r->size);
+    if (!r->data)
+      return -1;
+    r->hold = JS_DupValue(ctx, argv[1]);
+    return 0;
+  }
+  case FS_OPEN: {
+    if (argc < 2 || JS_IsUndefined(argv[1])) {
+      r->flags = O_RDONLY;
+      return 0;
+    }
+    const char *flags = JS_ToCString(ctx, argv[1]);
+    if (!flags)
+      return -1;
+    r->flags = fs_parse_flags(flags);
+    JS_FreeCString(ctx, flags);
+    if (r->flags < 0) {
+      JS_ThrowTypeError(ctx, "invalid open flags");
+      return -1;
+    }
+    return 0;
+  }
+  default:
+    return 0;
+  }
+}
+
+// 异步请求执行期间 JS 继续运行，read/write/writeFile 改用宿主内存 host：
+// 要写入的数据先复制过去，读到的数据由 fs_request_result 复制回 hold。
+// host 为 NULL 时分配，失败时返回 -1
+static int fs_request_bounce(FsRequest *r, uint8_t *host) {
+  if (JS_IsUndefined(r->hold) || r->bounced)
+    return 0;
+  if (!host) {
+    host = r->bounce = malloc(r->size ? r->size : 1);
+    if (!host)
+      return -1;
+  }
+  if (r->op != FS_READ)
+    memcpy(host, r->data, r->size);
+  r->data = host;
+  r->bounced = 1;
+  return 0;
+}
+
+// 把异步读到的 n 字节复制到 hold 的 offset 处；请求期间缓冲区被转移
+// 或缩小时抛出 TypeError
+static int fs_copy_to_hold(JSContext *ctx, JSValueConst hold, int64_t offset,
+                           const uint8_t *src, size_t n) {
+  size_t size;
+  if (n == 0)
+    return 0;
+  uint8_t *dst = js_encoding_get_bytes(ctx, hold, &size);
+  if (!dst)
+    return -1;
+  if (offset > (int64_t)size || n > size - offset) {
+    JS_ThrowTypeError(ctx, "buffer was detached or resized during the request");
+    return -1;
+  }
+  memcpy(dst + offset, src, n);
+  return 0;
+}
+
+// 不能映射的文件（管道、终端等）读到 malloc 的缓冲区
+static void fs_read_all(FsRequest *r, int fd) {
+  size_t cap = 1 << 16, len = 0;
+  uint8_t *buf = malloc(cap);
+  r->syscall = "read";
+  if (!buf) {
+    r->err = ENOMEM;
+    return;
+  }
+  for (;;) {
+    if (len == cap) {
+      uint8_t *grown = cap < INT32_MAX ? realloc(buf, cap * 2) : NULL;
+      if (!grown) {
+        free(buf);
+        r->err = cap < INT32_MAX ? ENOMEM : EFBIG;
+        return;
+      }
+      buf = grown;
+      cap *= 2;
+    }
+    ssize_t n = read(fd, buf + len, cap - len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0) {
+      r->err = errno;
+      free(buf);
+      return;
+    }
+    if (n == 0)
+      break;
+    len += n;
+  }
+  r->buf = buf;
+  r->result = len;
+}
+
+static void fs_run_read_file(FsRequest *r) {
+  int fd = open(r->path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    r->err = errno;
+    r->syscall = "open";
+    return;
+  }
+  if (fstat(fd, &r->st) < 0) {
+    r->err = errno;
+    r->syscall = "fstat";
+  } else if (!S_ISREG(r->st.st_mode) || r->st.st_size == 0) {
+    // /proc 等文件的大小显示为 0，同样按流读取
+    fs_read_all(r, fd);
+    if (r->buf) {
+      int64_t offset = r->offset < r->result ? r->offset : r->result;
+      int64_t length = r->result - offset;
+      if (r->length >= 0 && r->length < length)
+        length = r->length;
+      memmove(r->buf, r->buf + offset, length);
+      r->result = length;
+    }
+  } else {
+    int64_t size = r->st.st_size;
+    int64_t offset = r->offset < size ? r->offset : size;
+    int64_t length = size - offset;
+    if (r->length >= 0 && r->length < length)
+      length = r->length;
+    if (length > INT32_MAX) {
+      r->err = EFBIG;
+    } else if (length > 0) {
+      // 映射从 offset 所在的页开始
+      int64_t base = offset & ~((int64_t)sysconf(_SC_PAGESIZE) - 1);
+      size_t map_len = length + (offset - base);
+      int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+      if (r->populate)
+        flags |= MAP_POPULATE;
+#endif
+      void *map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, flags, fd, base);
+      if (map == MAP_FAILED) {
+        r->err = errno;
+        r->syscall = "mmap";
+      } else {
+        madvise(map, map_len, MADV_SEQUENTIAL);
+        r->buf = (uint8_t *)map + (offset - base);
+        r->mapped = 1;
+      }
+    }
+    r->result = length;
+  }
+  close(fd);
+}
+
+static int64_t fs_run_write_all(FsRequest *r, int fd) {
+  size_t done = 0;
+  while (done < r->size) {
+    ssize_t n = write(fd, r->data + done, r->size - done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0) {
+      r->err = errno;
+      r->syscall = "write";
+      return -1;
+    }
+    done += n;
+  }
+  return done;
+}
+
+// 执行系统调用，不访问任何 JS 对象，可以在任意线程上运行
+static void fs_request_run(FsRequest *r) {
+  ssize_t n;
+  switch (r->op) {
+  case FS_READ_FILE:
+    fs_run_read_file(r);
+    break;
+  case FS_WRITE_FILE: {
+    int fd = open(r->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+      r->err = errno;
+      r->syscall = "open";
+      break;
+    }
+    r->result = fs_run_write_all(r, fd);
+    if (close(fd) < 0 && !r->err) {
+      r->err = errno;
+      r->syscall = "close";
+    }
+    break;
+  }
+  case FS_OPEN:
+    r->result = open(r->path, r->flags | O_CLOEXEC, 0666);
+    if (r->result < 0) {
+      r->err = errno;
+      r->syscall = "open";
+    }
+    break;
+  case FS_CLOSE:
+    if (close(r->fd) < 0) {
+      r->err = errno;
+      r->syscall = "close";
+    }
+    break;
+  case FS_READ:
+  case FS_WRITE:
+    do {
+      if (r->op == FS_READ)
+        n = r->position < 0 ? read(r->fd, r->data, r->size)
+                            : pread(r->fd, r->data, r->size, r->position);
+      else
+        n = r->position < 0 ? write(r->fd, r->data, r->size)
+                            : pwrite(r->fd, r->data, r->size, r->position);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+      r->err = errno;
+      r->syscall = r->op == FS_READ ? "read" : "write";
+    }
+    r->result = n;
+    break;
+  case FS_STAT:
+    if (stat(r->path, &r->st) < 0) {
+      r->err = errno;
+      r->syscall = "stat";
+    }
+    break;
+  }
+}
+
+static JSValue fs_throw_errno(JSContext *ctx, const FsRequest *r) {
+  if (r->err == EFBIG && r->op == FS_READ_FILE)
+    return JS_ThrowRangeError(
+        ctx, "readFile '%s': more than 2 GB, pass offset and length",
+        r->path);
+  JSValue err = JS_NewError(ctx);
+  char message[512];
+  if (r->path)
+    snprintf(message, sizeof(message), "%s '%.400s': %s", r->syscall,
+             r->path, strerror(r->err));
+  else
+    snprintf(message, sizeof(message), "%s: %s", r->syscall,
+             strerror(r->err));
+  JS_SetPropertyStr(ctx, err, "message", JS_NewString(ctx, message));
+  JS_SetPropertyStr(ctx, err, "errno", JS_NewInt32(ctx, r->err));
+  return JS_Throw(ctx, err);
+}
+
+// 在 JS 线程上把结果转换成 JS 值，readFile 的缓冲区交给 ArrayBuffer
+static JSValue fs_request_result(JSContext *ctx, FsRequest *r) {
+  if (r->err)
+    return fs_throw_errno(ctx, r);
+  switch (r->op) {
+  case FS_READ_FILE: {
+    if (!r->buf)
+      return JS_NewArrayBufferCopy(ctx, NULL, 0);
+    JSValue ret = JS_NewArrayBuffer(ctx, r->buf, r->result,
+                                    r->mapped ? js_fs_unmap : js_fs_free,
+                                    (void *)(uintptr_t)r->result, 0);
+    // 失败时不会调用释放回调，缓冲区留给 fs_request_free 释放
+    if (!JS_IsException(ret))
+      r->buf = NULL;
+    return ret;
+  }
+  case FS_STAT: {
+    JSValue obj = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, obj, "size", JS_NewInt64(ctx, r->st.st_size));
+    JS_SetPropertyStr(ctx, obj, "mtimeMs",
+                      JS_NewFloat64(ctx, r->st.st_mtim.tv_sec * 1e3 +
+                                             r->st.st_mtim.tv_nsec / 1e6));
+    JS_SetPropertyStr(ctx, obj, "isFile",
+                      JS_NewBool(ctx, S_ISREG(r->st.st_mode)));
+    JS_SetPropertyStr(ctx, obj, "isDirectory",
+                      JS_NewBool(ctx, S_ISDIR(r->st.st_mode)));
+    return obj;
+  }
+  case FS_CLOSE:
+    return JS_UNDEFINED;
+  case FS_READ:
+    if (r->bounced &&
+        fs_copy_to_hold(ctx, r->hold, r->hold_offset, r->data, r->result) < 0)
+      return JS_EXCEPTION;
+    return JS_NewInt64(ctx, r->result);
+  default:
+    return JS_NewInt64(ctx, r->result);
+  }
+}
+
+static void fs_request_free(JSContext *ctx, FsRequest *r) {
+  if (r->buf) {
+    if (r->mapped)
+      js_fs_unmap(NULL, (void *)(uintptr_t)r->result, r->buf);
+    else
+      free(r->buf);
+  }
+  free(r->bounce);
+  JS_FreeCString(ctx, r->path);
+  JS_FreeCString(ctx, r->str_data);
+  JS_FreeValue(ctx, r->hold);
+}
+
+// 同步版本，magic 为 FsOp
+static JSValue js_fs_sync(JSContext *ctx, JSValueConst this_val, int argc,
+                          JSValueConst *argv, int magic) {
+  FsRequest r;
+  JSValue ret;
+  if (fs_request_parse(ctx, &r, magic, argc, argv) < 0) {
+    ret = JS_EXCEPTION;
+  } else {
+    fs_request_run(&r);
+    ret = fs_request_result(ctx, &r);
+  }
+  fs_request_free(ctx, &r);
+  return ret;
+}
+
+static const JSCFunctionListEntry js_fs_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("readFile", 1, js_fs_sync, FS_READ_FILE),
+    JS_CFUNC_MAGIC_DEF("writeFile", 2, js_fs_sync, FS_WRITE_FILE),
+    JS_CFUNC_MAGIC_DEF("open", 1, js_fs_sync, FS_OPEN),
+    JS_CFUNC_MAGIC_DEF("close", 1, js_fs_sync, FS_CLOSE),
+    JS_CFUNC_MAGIC_DEF("read", 2, js_fs_sync, FS_READ),
+    JS_CFUNC_MAGIC_DEF("write", 2, js_fs_sync, FS_WRITE),
+    JS_CFUNC_MAGIC_DEF("stat", 1, js_fs_sync, FS_STAT),
+};
+
+static int js_fs_init(JSContext *ctx, JSModuleDef *m) {
+  return JS_SetModuleExportList(ctx, m, js_fs_funcs,
+                                sizeof(js_fs_funcs) / sizeof(js_fs_funcs[0]));
+}
+
+JSModuleDef *js_init_fs_module(JSContext *ctx, const char *module_name) {
+  JSModuleDef *m = JS_NewCModule(ctx, module_name, js_fs_init);
+  if (!m)
+    return NULL;
+  JS_AddModuleExportList(ctx, m, js_fs_funcs,
+                         sizeof(js_fs_funcs) / sizeof(js_fs_funcs[0]));
+  return m;
+}
+
+// 以全局脚本运行的宿主用全局的 fs 对象
+void js_std_init_fs(JSContext *ctx) {
+  JSValue global_obj = JS_GetGlobalObject(ctx);
+  JSValue fs = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, fs, js_fs_funcs,
+                             sizeof(js_fs_funcs) / sizeof(js_fs_funcs[0]));
+  JS_SetPropertyStr(ctx, global_obj, "fs", fs);
+  JS_FreeValue(ctx, global_obj);
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef HELPERS_GC_C
+#define HELPERS_GC_C
+
+#include "../quickjs/quickjs.h"
+#include "./alloc.c"
+#include "./clock.c"
+
+// 自上次 GC 以来累计分配超过该值时触发回收
+#define GC_DEFAULT_ALLOC_TRIGGER (8 * 1024 * 1024)
+// 当前堆大小超过上次 GC 后存活大小的该倍数时触发回收
+#define GC_DEFAULT_GROWTH_TRIGGER 2.0
+// 工作线程空闲超过该时长（毫秒）时进行机会性回收
+#define GC_DEFAULT_IDLE_MS 5
+
+// GC 调度策略：按分配量、堆增长和空闲时间决定何时执行 JS_RunGC，
+// 代替每个任务结束后无条件的全量循环回收
+typedef struct {
+  size_t alloc_trigger;
+  double growth_trigger;
+  int idle_ms;
+
+  JSAllocStats alloc;
+  size_t allocated_at_last_gc;
+  size_t live_after_last_gc;
+
+  int gc_count;
+  int idle_gc_count;
+  double gc_total_ms;
+  double gc_max_ms;
+} GCPolicy;
+
+static void gc_policy_init(GCPolicy *policy) {
+  memset(policy, 0, sizeof(*policy));
+  policy->alloc_trigger = GC_DEFAULT_ALLOC_TRIGGER;
+  policy->growth_trigger = GC_DEFAULT_GROWTH_TRIGGER;
+  policy->idle_ms = GC_DEFAULT_IDLE_MS;
+}
+
+// 创建受该策略管理的运行时，分配统计写入 policy->alloc
+static JSRuntime *gc_policy_new_runtime(GCPolicy *policy) {
+  JSRuntime *rt = js_new_tracked_runtime(&policy->alloc);
+  if (rt) {
+    policy->allocated_at_last_gc = policy->alloc.allocated_bytes;
+    policy->live_after_last_gc = policy->alloc.live_bytes;
+  }
+  return rt;
+}
+
+// 自上次 GC 以来的分配量
+static size_t gc_policy_allocated_since_gc(const GCPolicy *policy) {
+  return policy->alloc.allocated_bytes - policy->allocated_at_last_gc;
+}
+
+static int gc_policy_should_collect(const GCPolicy *policy) {
+  if (gc_policy_allocated_since_gc(policy) >= policy->alloc_trigger)
+    return 1;
+
+  return policy->live_after_last_gc > 0 &&
+         policy->alloc.live_bytes >
+             policy->live_after_last_gc * policy->growth_trigger;
+}
+
+// 执行一次回收并记录停顿时长，返回停顿毫秒数
+static double gc_policy_collect(GCPolicy *policy, JSRuntime *rt) {
+  double start = get_time_ms();
+  JS_RunGC(rt);
+  double pause = get_time_ms() - start;
+
+  policy->allocated_at_last_gc = policy->alloc.allocated_bytes;
+  policy->live_after_last_gc = policy->alloc.live_bytes;
+  policy->gc_count++;
+  policy->gc_total_ms += pause;
+  if (pause > policy->gc_max_ms)
+    policy->gc_max_ms = pause;
+
+  return pause;
+}
+
+// 任务结束后调用：只有满足触发条件时才回收，未回收时返回 0
+static double gc_policy_maybe_collect(GCPolicy *policy, JSRuntime *rt) {
+  if (!gc_policy_should_collect(policy))
+    return 0;
+  return gc_policy_collect(policy, rt);
+}
+
+// 线程空闲时调用：自上次 GC 后有过分配就顺手回收，
+// 把停顿挪到没有任务等待的时间段里
+static double gc_policy_idle(GCPolicy *policy, JSRuntime *rt) {
+  if (gc_policy_allocated_since_gc(policy) == 0)
+    return 0;
+  policy->idle_gc_count++;
+  return gc_policy_collect(policy, rt);
+}
+
+#endif
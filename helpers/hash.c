@@ -0,0 +1,373 @@
+#ifndef HELPERS_HASH_C
+#define HELPERS_HASH_C
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HASH_X86 1
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#endif
+#define HASH_ARM64 1
+#endif
+
+/*
+ * 非加密哈希：xxHash64 和 CRC32（IEEE，同 zlib）、CRC32C（Castagnoli）。
+ * 都支持分块更新，结果与一次性计算相同。
+ *
+ * CRC32 在 x86 上用 PCLMULQDQ 折叠，CRC32C 用 SSE4.2 的 crc32 指令，
+ * ARMv8 上两者都有 crc32 指令；其他情况用 slicing-by-8 查表。
+ */
+
+/* xxHash64 */
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ull
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define XXH_PRIME64_3 0x165667B19E3779F9ull
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ull
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ull
+
+typedef struct {
+  uint64_t total_len;
+  uint64_t v[4];
+  uint8_t mem[32]; // 不足 32 字节的剩余输入
+  size_t mem_len;
+  uint64_t seed;
+} Xxh64;
+
+static inline uint64_t hash_rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// 按小端读取
+static inline uint64_t hash_read64(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+static inline uint32_t hash_read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap32(v);
+#endif
+  return v;
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+  acc += input * XXH_PRIME64_2;
+  acc = hash_rotl64(acc, 31);
+  return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge(uint64_t acc, uint64_t val) {
+  acc ^= xxh64_round(0, val);
+  return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static void xxh64_init(Xxh64 *s, uint64_t seed) {
+  s->total_len = 0;
+  s->v[0] = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+  s->v[1] = seed + XXH_PRIME64_2;
+  s->v[2] = seed;
+  s->v[3] = seed - XXH_PRIME64_1;
+  s->mem_len = 0;
+  s->seed = seed;
+}
+
+// 处理整 32 字节的条带，返回处理的字节数
+static size_t xxh64_stripes(uint64_t v[4], const uint8_t *p, size_t len) {
+  uint64_t v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    v0 = xxh64_round(v0, hash_read64(p + i));
+    v1 = xxh64_round(v1, hash_read64(p + i + 8));
+    v2 = xxh64_round(v2, hash_read64(p + i + 16));
+    v3 = xxh64_round(v3, hash_read64(p + i + 24));
+  }
+  v[0] = v0;
+  v[1] = v1;
+  v[2] = v2;
+  v[3] = v3;
+  return i;
+}
+
+static void xxh64_update(Xxh64 *s, const void *data, size_t len) {
+  const uint8_t *p = data;
+  s->total_len += len;
+
+  if (s->mem_len > 0) {
+    size_t n = 32 - s->mem_len < len ? 32 - s->mem_len : len;
+    memcpy(s->mem + s->mem_len, p, n);
+    s->mem_len += n;
+    p += n;
+    len -= n;
+    if (s->mem_len < 32)
+      return;
+    xxh64_stripes(s->v, s->mem, 32);
+    s->mem_len = 0;
+  }
+
+  size_t done = xxh64_stripes(s->v, p, len);
+  memcpy(s->mem, p + done, len - done);
+  s->mem_len = len - done;
+}
+
+static uint64_t xxh64_digest(const Xxh64 *s) {
+  uint64_t h;
+  if (s->total_len >= 32) {
+    h = hash_rotl64(s->v[0], 1) + hash_rotl64(s->v[1], 7) +
+        hash_rotl64(s->v[2], 12) + hash_rotl64(s->v[3], 18);
+    for (int i = 0; i < 4; i++)
+      h = xxh64_merge(h, s->v[i]);
+  } else {
+    h = s->seed + XXH_PRIME64_5;
+  }
+  h += s->total_len;
+
+  const uint8_t *p = s->mem;
+  size_t len = s->mem_len;
+  for (; len >= 8; p += 8, len -= 8) {
+    h ^= xxh64_round(0, hash_read64(p));
+    h = hash_rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+  }
+  if (len >= 4) {
+    h ^= (uint64_t)hash_read32(p) * XXH_PRIME64_1;
+    h = hash_rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+    p += 4;
+    len -= 4;
+  }
+  for (; len > 0; p++, len--) {
+    h ^= *p * XXH_PRIME64_5;
+    h = hash_rotl64(h, 11) * XXH_PRIME64_1;
+  }
+
+  h ^= h >> 33;
+  h *= XXH_PRIME64_2;
+  h ^= h >> 29;
+  h *= XXH_PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+static uint64_t xxh64(const void *data, size_t len, uint64_t seed) {
+  Xxh64 s;
+  xxh64_init(&s, seed);
+  xxh64_update(&s, data, len);
+  return xxh64_digest(&s);
+}
+
+/* CRC32 / CRC32C */
+
+// 反射多项式
+#define CRC32_POLY 0xEDB88320u
+#define CRC32C_POLY 0x82F63B78u
+
+static uint32_t crc32_table[8][256];
+static uint32_t crc32c_table[8][256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+static void crc_make_table(uint32_t table[8][256], uint32_t poly) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++)
+      c = c & 1 ? (c >> 1) ^ poly : c >> 1;
+    table[0][i] = c;
+  }
+  for (uint32_t i = 0; i < 256; i++) {
+    for (int t = 1; t < 8; t++)
+      table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xFF];
+  }
+}
+
+static void crc_init_tables(void) {
+  crc_make_table(crc32_table, CRC32_POLY);
+  crc_make_table(crc32c_table, CRC32C_POLY);
+}
+
+// slicing-by-8，crc 为取反后的中间状态
+static uint32_t crc_update_table(uint32_t table[8][256], uint32_t crc,
+                                 const uint8_t *p, size_t len) {
+  for (; len >= 8; p += 8, len -= 8) {
+    uint32_t lo = hash_read32(p) ^ crc;
+    uint32_t hi = hash_read32(p + 4);
+    crc = table[7][lo & 0xFF] ^ table[6][(lo >> 8) & 0xFF] ^
+          table[5][(lo >> 16) & 0xFF] ^ table[4][lo >> 24] ^
+          table[3][hi & 0xFF] ^ table[2][(hi >> 8) & 0xFF] ^
+          table[1][(hi >> 16) & 0xFF] ^ table[0][hi >> 24];
+  }
+  for (; len > 0; p++, len--)
+    crc = (crc >> 8) ^ table[0][(crc ^ *p) & 0xFF];
+  return crc;
+}
+
+#if defined(HASH_X86)
+
+static int hash_has_pclmul(void) {
+  static int has_pclmul = -1;
+  if (has_pclmul < 0) {
+    __builtin_cpu_init();
+    has_pclmul = __builtin_cpu_supports("pclmul") &&
+                         __builtin_cpu_supports("sse4.1")
+                     ? 1
+                     : 0;
+  }
+  return has_pclmul;
+}
+
+static int hash_has_sse42(void) {
+  static int has_sse42 = -1;
+  if (has_sse42 < 0) {
+    __builtin_cpu_init();
+    has_sse42 = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+  }
+  return has_sse42;
+}
+
+// Intel 白皮书 "Fast CRC Computation for Generic Polynomials Using
+// PCLMULQDQ Instruction" 的反射域折叠：4 路并行折叠 64 字节，再归约到
+// 128 位、64 位，最后 Barrett 归约到 32 位。len 至少 64 且是 16 的倍数
+__attribute__((target("pclmul,sse4.1"))) static uint32_t
+crc32_pclmul(uint32_t crc, const uint8_t *p, size_t len) {
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+  const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+  const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+  __m128i x1 = _mm_loadu_si128((const __m128i *)p);
+  __m128i x2 = _mm_loadu_si128((const __m128i *)(p + 16));
+  __m128i x3 = _mm_loadu_si128((const __m128i *)(p + 32));
+  __m128i x4 = _mm_loadu_si128((const __m128i *)(p + 48));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+  p += 64;
+  len -= 64;
+
+#define CRC32_FOLD(x, k, y)                                                    \
+  x = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),            \
+                                  _mm_clmulepi64_si128(x, k, 0x11)),           \
+                    y)
+  for (; len >= 64; p += 64, len -= 64) {
+    CRC32_FOLD(x1, k1k2, _mm_loadu_si128((const __m128i *)p));
+    CRC32_FOLD(x2, k1k2, _mm_loadu_si128((const __m128i *)(p + 16)));
+    CRC32_FOLD(x3, k1k2, _mm_loadu_si128((const __m128i *)(p + 32)));
+    CRC32_FOLD(x4, k1k2, _mm_loadu_si128((const __m128i *)(p + 48)));
+  }
+
+  // 4 路合并成 1 路，再逐个折叠剩余的 16 字节
+  CRC32_FOLD(x1, k3k4, x2);
+  CRC32_FOLD(x1, k3k4, x3);
+  CRC32_FOLD(x1, k3k4, x4);
+  for (; len >= 16; p += 16, len -= 16)
+    CRC32_FOLD(x1, k3k4, _mm_loadu_si128((const __m128i *)p));
+#undef CRC32_FOLD
+
+  // 128 位折叠到 64 位
+  x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, mask32);
+  x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5k0, 0x00), x2);
+
+  // Barrett 归约
+  x2 = _mm_and_si128(x1, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+  x2 = _mm_and_si128(x2, mask32);
+  x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+  return _mm_extract_epi32(x1, 1);
+}
+
+__attribute__((target("sse4.2"))) static uint32_t
+crc32c_sse42(uint32_t crc, const uint8_t *p, size_t len) {
+#if defined(__x86_64__)
+  uint64_t c = crc;
+  for (; len >= 8; p += 8, len -= 8)
+    c = _mm_crc32_u64(c, hash_read64(p));
+  crc = (uint32_t)c;
+#endif
+  for (; len >= 4; p += 4, len -= 4)
+    crc = _mm_crc32_u32(crc, hash_read32(p));
+  for (; len > 0; p++, len--)
+    crc = _mm_crc32_u8(crc, *p);
+  return crc;
+}
+
+#elif defined(HASH_ARM64)
+
+static int hash_has_crc32(void) {
+#if defined(__linux__)
+  static int has_crc32 = -1;
+  if (has_crc32 < 0)
+    has_crc32 = getauxval(AT_HWCAP) & HWCAP_CRC32 ? 1 : 0;
+  return has_crc32;
+#elif defined(__ARM_FEATURE_CRC32) || defined(__APPLE__)
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+// c 为 0 时是 CRC32，为 1 时是 CRC32C
+__attribute__((target("+crc"))) static uint32_t
+crc32_arm64(uint32_t crc, const uint8_t *p, size_t len, int c) {
+  if (c) {
+    for (; len >= 8; p += 8, len -= 8)
+      crc = __crc32cd(crc, hash_read64(p));
+    for (; len > 0; p++, len--)
+      crc = __crc32cb(crc, *p);
+  } else {
+    for (; len >= 8; p += 8, len -= 8)
+      crc = __crc32d(crc, hash_read64(p));
+    for (; len > 0; p++, len--)
+      crc = __crc32b(crc, *p);
+  }
+  return crc;
+}
+
+#endif
+
+// 在 crc 的基础上继续计算，初始值为 0，用法同 zlib 的 crc32()
+static uint32_t crc32_update(uint32_t crc, const void *data, size_t len) {
+  const uint8_t *p = data;
+  crc = ~crc;
+#if defined(HASH_X86)
+  if (len >= 64 && hash_has_pclmul()) {
+    size_t n = len & ~(size_t)15;
+    crc = crc32_pclmul(crc, p, n);
+    p += n;
+    len -= n;
+  }
+#elif defined(HASH_ARM64)
+  if (hash_has_crc32())
+    return ~crc32_arm64(crc, p, len, 0);
+#endif
+  pthread_once(&crc_table_once, crc_init_tables);
+  return ~crc_update_table(crc32_table, crc, p, len);
+}
+
+static uint32_t crc32c_update(uint32_t crc, const void *data, size_t len) {
+  const uint8_t *p = data;
+  crc = ~crc;
+#if defined(HASH_X86)
+  if (hash_has_sse42())
+    return ~crc32c_sse42(crc, p, len);
+#elif defined(HASH_ARM64)
+  if (hash_has_crc32())
+    return ~crc32_arm64(crc, p, len, 1);
+#endif
+  pthread_once(&crc_table_once, crc_init_tables);
+  return ~crc_update_table(crc32c_table, crc, p, len);
+}
+
+#endif
@@ -0,0 +1,439 @@
+#ifndef HELPERS_INSTRUMENT_C
+#define HELPERS_INSTRUMENT_C
+
+#include "../quickjs/quickjs.h"
+#include "./alloc.c"
+#include "./clock.c"
+#include "./jsscan.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * 插桩：执行前改写源码，给每个普通函数体加上进出钩子
+ *
+ *   function f(a) { body }
+ *   => function f(a) {__instrument_enter(3);try{ body }finally{__instrument_leave()}}
+ *
+ * 钩子维护一个影子调用栈，统计每个函数的调用次数、自身和包含子调用的
+ * 耗时。运行时使用带统计的分配器，每次分配记到影子栈顶的函数上，于是
+ * 能看出哪个函数在分配内存。插入的文本不含换行，错误信息中的行号不变。
+ *
+ * 生成器和 async 函数会在中途挂起，不插桩；箭头函数和方法也不插桩。
+ * 它们的耗时和分配记到外层已插桩的函数上，顶层代码（包括解析）记到
+ * "(top level)"。
+ *
+ * QuickJS 没有逐条字节码的钩子，执行量用中断轮询近似：解释器大约每
+ * 一万次调用和跳转轮询一次中断处理函数，轮询次数记到栈顶函数上。
+ *
+ * 钩子本身有开销，耗时只适合在函数之间相对比较。插桩占用运行时的
+ * opaque 和中断处理函数。
+ */
+
+#define INSTRUMENT_FUNC_MAX 1024
+// 超过该深度的调用只计次数，不计耗时
+#define INSTRUMENT_MAX_DEPTH 1024
+#define INSTRUMENT_TOP_LEVEL "(top level)"
+
+typedef struct {
+  char *name; // "函数名:行号"
+  long calls;
+  long polls; // 栈顶为该函数时的中断轮询次数
+  int active; // 当前在影子栈中的层数，递归时只在最外层累计包含耗时
+  double self_ms;
+  double total_ms;
+  size_t self_bytes;  // 栈顶为该函数时分配的字节数
+  size_t total_bytes; // 包括子调用在内分配的字节数
+  size_t allocs;      // 栈顶为该函数时的分配次数
+} InstrumentFunc;
+
+typedef struct {
+  int func;
+  double start_ms;
+  double child_ms;
+  size_t alloc_at_enter;
+} InstrumentFrame;
+
+typedef struct {
+  // 必须是第一个成员：js_tracked_* 把分配器的 opaque 当作 JSAllocStats
+  JSAllocStats stats;
+  // 下标 0 为顶层代码，函数从 1 开始编号
+  InstrumentFunc funcs[INSTRUMENT_FUNC_MAX];
+  int func_count;
+  InstrumentFrame stack[INSTRUMENT_MAX_DEPTH];
+  int depth;
+  long overflow; // 超过最大深度的调用数
+} Instrument;
+
+// 当前栈顶函数的下标
+static int instrument_current(Instrument *in) {
+  if (in->depth == 0)
+    return 0;
+  int top = in->depth < INSTRUMENT_MAX_DEPTH ? in->depth : INSTRUMENT_MAX_DEPTH;
+  return in->stack[top - 1].func;
+}
+
+// 清零计数，保留函数名
+static void instrument_reset_counters(Instrument *in) {
+  for (int i = 0; i < INSTRUMENT_FUNC_MAX; i++) {
+    char *name = in->funcs[i].name;
+    memset(&in->funcs[i], 0, sizeof(InstrumentFunc));
+    in->funcs[i].name = name;
+  }
+  if (in->func_count < 1)
+    in->func_count = 1;
+  in->depth = 0;
+  in->overflow = 0;
+}
+
+static void instrument_free(Instrument *in) {
+  for (int i = 0; i < in->func_count; i++) {
+    free(in->funcs[i].name);
+    in->funcs[i].name = NULL;
+  }
+  in->func_count = 0;
+}
+
+/* 分配归属 */
+
+static void instrument_account(Instrument *in, size_t bytes_before,
+                               size_t count_before) {
+  InstrumentFunc *f = &in->funcs[instrument_current(in)];
+  f->self_bytes += in->stats.allocated_bytes - bytes_before;
+  f->allocs += in->stats.alloc_count - count_before;
+}
+
+static void *instrument_malloc(JSMallocState *s, size_t size) {
+  Instrument *in = s->opaque;
+  size_t bytes = in->stats.allocated_bytes, count = in->stats.alloc_count;
+  void *ptr = js_tracked_malloc(s, size);
+  instrument_account(in, bytes, count);
+  return ptr;
+}
+
+static void *instrument_realloc(JSMallocState *s, void *ptr, size_t size) {
+  Instrument *in = s->opaque;
+  size_t bytes = in->stats.allocated_bytes, count = in->stats.alloc_count;
+  ptr = js_tracked_realloc(s, ptr, size);
+  instrument_account(in, bytes, count);
+  return ptr;
+}
+
+static const JSMallocFunctions instrument_malloc_funcs = {
+    instrument_malloc,
+    js_tracked_free,
+    instrument_realloc,
+    js_tracked_usable_size,
+};
+
+/* 运行时钩子 */
+
+static JSValue instrument_enter(JSContext *ctx, JSValueConst this_val,
+                                int argc, JSValueConst *argv) {
+  Instrument *in = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
+  int32_t id;
+  if (argc < 1 || JS_ToInt32(ctx, &id, argv[0]) < 0 || id <= 0 ||
+      id >= in->func_count)
+    id = 0;
+
+  InstrumentFunc *f = &in->funcs[id];
+  f->calls++;
+  if (in->depth < INSTRUMENT_MAX_DEPTH) {
+    InstrumentFrame *frame = &in->stack[in->depth];
+    frame->func = id;
+    frame->child_ms = 0;
+    frame->alloc_at_enter = in->stats.allocated_bytes;
+    frame->start_ms = get_time_ms();
+    f->active++;
+  } else {
+    in->overflow++;
+  }
+  in->depth++;
+  return JS_UNDEFINED;
+}
+
+static JSValue instrument_leave(JSContext *ctx, JSValueConst this_val,
+                                int argc, JSValueConst *argv) {
+  Instrument *in = JS_GetRuntimeOpaque(JS_GetRuntime(ctx));
+  if (in->depth == 0)
+    return JS_UNDEFINED;
+  if (--in->depth >= INSTRUMENT_MAX_DEPTH)
+    return JS_UNDEFINED;
+
+  InstrumentFrame *frame = &in->stack[in->depth];
+  InstrumentFunc *f = &in->funcs[frame->func];
+  double elapsed = get_time_ms() - frame->start_ms;
+  f->self_ms += elapsed - frame->child_ms;
+  if (in->depth > 0)
+    in->stack[in->depth - 1].child_ms += elapsed;
+  if (--f->active == 0) {
+    f->total_ms += elapsed;
+    f->total_bytes += in->stats.allocated_bytes - frame->alloc_at_enter;
+  }
+  return JS_UNDEFINED;
+}
+
+static int instrument_interrupt(JSRuntime *rt, void *opaque) {
+  Instrument *in = opaque;
+  in->funcs[instrument_current(in)].polls++;
+  return 0;
+}
+
+// 创建插桩运行时：清零计数，保留 instrument_source 登记的函数名。
+// in 的生命周期需覆盖该运行时
+static JSRuntime *instrument_new_runtime(Instrument *in) {
+  memset(&in->stats, 0, sizeof(in->stats));
+  instrument_reset_counters(in);
+  JSRuntime *rt = JS_NewRuntime2(&instrument_malloc_funcs, in);
+  if (!rt)
+    return NULL;
+  JS_SetRuntimeOpaque(rt, in);
+  JS_SetInterruptHandler(rt, instrument_interrupt, in);
+  return rt;
+}
+
+// 在上下文中定义钩子函数，执行插桩后的源码前调用
+static void instrument_install(JSContext *ctx) {
+  JSValue global_obj = JS_GetGlobalObject(ctx);
+  JS_SetPropertyStr(ctx, global_obj, "__instrument_enter",
+                    JS_NewCFunction(ctx, instrument_enter,
+                                    "__instrument_enter", 1));
+  JS_SetPropertyStr(ctx, global_obj, "__instrument_leave",
+                    JS_NewCFunction(ctx, instrument_leave,
+                                    "__instrument_leave", 0));
+  JS_FreeValue(ctx, global_obj);
+}
+
+/* 源码改写 */
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t capacity;
+} InstrumentBuf;
+
+static void instrument_put(InstrumentBuf *b, const char *data, size_t len) {
+  if (b->len + len + 1 > b->capacity) {
+    b->capacity = (b->len + len + 1) * 2;
+    b->data = realloc(b->data, b->capacity);
+  }
+  memcpy(b->data + b->len, data, len);
+  b->len += len;
+  b->data[b->len] = '\0';
+}
+
+// 登记一个函数，表满时返回 -1
+static int instrument_register(Instrument *in, const char *name,
+                               size_t name_len, int line) {
+  if (in->func_count >= INSTRUMENT_FUNC_MAX)
+    return -1;
+  char buf[256];
+  if (name_len == 0)
+    snprintf(buf, sizeof(buf), "anonymous:%d", line);
+  else
+    snprintf(buf, sizeof(buf), "%.*s:%d", (int)name_len, name, line);
+  in->funcs[in->func_count].name = strdup(buf);
+  return in->func_count++;
+}
+
+// 跳过一对配平的括号，括号内的字符串、注释和正则照常跳过
+static void instrument_skip_parens(JSScanner *s) {
+  int nesting = 0;
+  while (s->p < s->end) {
+    js_scan_skip_space(s);
+    if (s->p >= s->end)
+      break;
+    char c = *s->p;
+    if (c == '"' || c == '\'' || c == '`') {
+      js_scan_skip_quoted(s, c);
+    } else if (c == '/') {
+      js_scan_skip_slash(s);
+    } else if (js_scan_ident_char(c)) {
+      js_scan_skip_ident(s);
+    } else {
+      s->last = c;
+      s->p++;
+      if (c == '(' || c == '[' || c == '{')
+        nesting++;
+      else if ((c == ')' || c == ']' || c == '}') && --nesting == 0)
+        break;
+    }
+  }
+}
+
+// 函数体开头的 "use strict" 指令必须留在 try 之外，返回指令之后的位置
+static const char *instrument_skip_directive(JSScanner *s) {
+  JSScanner t = *s;
+  js_scan_skip_space(&t);
+  if (t.end - t.p >= 12 && (*t.p == '"' || *t.p == '\'') &&
+      strncmp(t.p + 1, "use strict", 10) == 0 && t.p[11] == *t.p) {
+    t.p += 12;
+    while (t.p < t.end && (*t.p == ' ' || *t.p == '\t'))
+      t.p++;
+    if (t.p < t.end && *t.p == ';')
+      t.p++;
+    return t.p;
+  }
+  return s->p;
+}
+
+// 改写源码，给普通函数体加上进出钩子，并重新登记函数名。
+// 返回的字符串由调用方 free
+static char *instrument_source(Instrument *in, const char *source,
+                               size_t len) {
+  instrument_free(in);
+  in->func_count = 1;
+
+  JSScanner s = {source, source + len, ';'};
+  InstrumentBuf out = {NULL, 0, 0};
+  const char *copied = source;
+  // 每层花括号对应的函数下标，-1 表示不是插桩的函数体
+  int *braces = NULL;
+  int depth = 0, braces_capacity = 0;
+  int line = 1;
+  const char *line_pos = source;
+  int after_async = 0;
+
+  while (s.p < s.end) {
+    js_scan_skip_space(&s);
+    if (s.p >= s.end)
+      break;
+
+    char c = *s.p;
+    int is_async = after_async;
+    after_async = 0;
+
+    if (c == '"' || c == '\'' || c == '`') {
+      js_scan_skip_quoted(&s, c);
+    } else if (c == '/') {
+      js_scan_skip_slash(&s);
+    } else if (js_scan_ident_char(c)) {
+      if (s.last == '.' || !js_scan_keyword(&s, "function")) {
+        const char *ident = js_scan_skip_ident(&s);
+        after_async = s.p - ident == 5 && strncmp(ident, "async", 5) == 0;
+        continue;
+      }
+
+      for (; line_pos < s.p; line_pos++) {
+        line += *line_pos == '\n';
+      }
+      s.p += 8;
+      js_scan_skip_space(&s);
+      int generator = s.p < s.end && *s.p == '*';
+      if (generator) {
+        s.p++;
+        js_scan_skip_space(&s);
+      }
+      const char *name = s.p;
+      size_t name_len = 0;
+      if (s.p < s.end && js_scan_ident_char(*s.p)) {
+        js_scan_skip_ident(&s);
+        name_len = s.p - name;
+        js_scan_skip_space(&s);
+      }
+      s.last = 'a';
+      if (s.p >= s.end || *s.p != '(')
+        continue;
+      instrument_skip_parens(&s);
+      js_scan_skip_space(&s);
+      if (s.p >= s.end || *s.p != '{')
+        continue;
+
+      int id = generator || is_async
+                   ? -1
+                   : instrument_register(in, name, name_len, line);
+      if (depth == braces_capacity) {
+        braces_capacity = braces_capacity ? braces_capacity * 2 : 64;
+        braces = realloc(braces, braces_capacity * sizeof(int));
+      }
+      braces[depth++] = id;
+      s.p++;
+      s.last = '{';
+      if (id < 0)
+        continue;
+
+      s.p = instrument_skip_directive(&s);
+      char hook[64];
+      int hook_len =
+          snprintf(hook, sizeof(hook), "__instrument_enter(%d);try{", id);
+      instrument_put(&out, copied, s.p - copied);
+      instrument_put(&out, hook, hook_len);
+      copied = s.p;
+    } else if (c == '{') {
+      if (depth == braces_capacity) {
+        braces_capacity = braces_capacity ? braces_capacity * 2 : 64;
+        braces = realloc(braces, braces_capacity * sizeof(int));
+      }
+      braces[depth++] = -1;
+      s.last = c;
+      s.p++;
+    } else if (c == '}') {
+      if (depth > 0 && braces[--depth] >= 0) {
+        static const char hook[] = "}finally{__instrument_leave()}";
+        instrument_put(&out, copied, s.p - copied);
+        instrument_put(&out, hook, sizeof(hook) - 1);
+        copied = s.p;
+      }
+      s.last = c;
+      s.p++;
+    } else {
+      s.last = c;
+      s.p++;
+    }
+  }
+
+  instrument_put(&out, copied, source + len - copied);
+  free(braces);
+  return out.data;
+}
+
+/* 报告 */
+
+static int instrument_compare_self(const void *a, const void *b) {
+  const InstrumentFunc *x = *(InstrumentFunc *const *)a;
+  const InstrumentFunc *y = *(InstrumentFunc *const *)b;
+  return x->self_ms < y->self_ms ? 1 : x->self_ms > y->self_ms ? -1 : 0;
+}
+
+// 按自身耗时从高到低打印各函数的统计，然后清零计数
+static void instrument_report(Instrument *in, const char *title) {
+  InstrumentFunc *sorted[INSTRUMENT_FUNC_MAX];
+  int n = 0;
+  long calls = 0;
+  for (int i = 1; i < in->func_count; i++) {
+    InstrumentFunc *f = &in->funcs[i];
+    calls += f->calls;
+    if (f->calls > 0 || f->self_bytes > 0)
+      sorted[n++] = f;
+  }
+  qsort(sorted, n, sizeof(InstrumentFunc *), instrument_compare_self);
+
+  InstrumentFunc *top = &in->funcs[0];
+  printf("\n%s: %ld instrumented calls, %.1f KB allocated in %zu "
+         "allocations\n",
+         title, calls, in->stats.allocated_bytes / 1024.0,
+         in->stats.alloc_count);
+  printf("%-28s %10s %10s %10s %8s %10s %10s %9s %8s\n", "function", "calls",
+         "self ms", "total ms", "polls", "self KB", "total KB", "allocs",
+         "B/call");
+  for (int i = 0; i < n; i++) {
+    InstrumentFunc *f = sorted[i];
+    printf("%-28s %10ld %10.2f %10.2f %8ld %10.1f %10.1f %9zu %8.0f\n",
+           f->name, f->calls, f->self_ms, f->total_ms, f->polls,
+           f->self_bytes / 1024.0, f->total_bytes / 1024.0, f->allocs,
+           f->calls ? (double)f->total_bytes / f->calls : 0);
+  }
+  // 顶层代码没有进出钩子，只有分配和轮询
+  printf("%-28s %10s %10s %10s %8ld %10.1f %10s %9zu %8s\n",
+         INSTRUMENT_TOP_LEVEL, "-", "-", "-", top->polls,
+         top->self_bytes / 1024.0, "-", top->allocs, "-");
+  if (in->overflow > 0)
+    printf("%ld calls deeper than %d frames were counted but not timed\n",
+           in->overflow, INSTRUMENT_MAX_DEPTH);
+
+  instrument_reset_counters(in);
+  in->stats.allocated_bytes = 0;
+  in->stats.alloc_count = 0;
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef HELPERS_JSARG_H
+#define HELPERS_JSARG_H
+
+#include "../quickjs/quickjs.h"
+#include <stdint.h>
+#include <string.h>
+
+// 参数转换的快速路径：值的标签已经是目标类型时直接取出，
+// 否则才调用会触发 valueOf/toString 的通用转换。返回 0 成功，-1 异常
+
+static inline int js_arg_int32(JSContext *ctx, int32_t *pres,
+                               JSValueConst val) {
+  if (JS_VALUE_GET_TAG(val) == JS_TAG_INT) {
+    *pres = JS_VALUE_GET_INT(val);
+    return 0;
+  }
+  return JS_ToInt32(ctx, pres, val);
+}
+
+static inline int js_arg_float64(JSContext *ctx, double *pres,
+                                 JSValueConst val) {
+  int tag = JS_VALUE_GET_TAG(val);
+  if (tag == JS_TAG_INT) {
+    *pres = JS_VALUE_GET_INT(val);
+    return 0;
+  }
+  if (JS_TAG_IS_FLOAT64(tag)) {
+    *pres = JS_VALUE_GET_FLOAT64(val);
+    return 0;
+  }
+  return JS_ToFloat64(ctx, pres, val);
+}
+
+static inline int js_arg_bool(JSContext *ctx, int *pres, JSValueConst val) {
+  if (JS_VALUE_GET_TAG(val) == JS_TAG_BOOL) {
+    *pres = JS_VALUE_GET_BOOL(val);
+    return 0;
+  }
+  int ret = JS_ToBool(ctx, val);
+  if (ret < 0)
+    return -1;
+  *pres = ret;
+  return 0;
+}
+
+// 字符串参数复制到运行时分配的内存中，由调用方用 js_free/js_free_rt 释放
+static inline int js_arg_string(JSContext *ctx, char **pres, JSValueConst val) {
+  size_t len;
+  const char *str = JS_ToCStringLen(ctx, &len, val);
+  if (!str)
+    return -1;
+  char *copy = js_strndup(ctx, str, len);
+  JS_FreeCString(ctx, str);
+  if (!copy)
+    return -1;
+  *pres = copy;
+  return 0;
+}
+
+// C 值转换为 JSValue
+static inline JSValue js_ret_int32(JSContext *ctx, int32_t v) {
+  return JS_NewInt32(ctx, v);
+}
+
+static inline JSValue js_ret_float64(JSContext *ctx, double v) {
+  return JS_NewFloat64(ctx, v);
+}
+
+static inline JSValue js_ret_bool(JSContext *ctx, int v) {
+  return JS_NewBool(ctx, v);
+}
+
+static inline JSValue js_ret_string(JSContext *ctx, const char *v) {
+  return v ? JS_NewString(ctx, v) : JS_NULL;
+}
+
+// 类型名到 C 类型的映射，供代码生成宏使用
+#define JS_CTYPE_int32 int32_t
+#define JS_CTYPE_float64 double
+#define JS_CTYPE_bool int
+#define JS_CTYPE_string char *
+
+#endif
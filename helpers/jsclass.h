@@ -0,0 +1,135 @@
+#ifndef HELPERS_JSCLASS_H
+#define HELPERS_JSCLASS_H
+
+#include "../quickjs/quickjs.h"
+#include "./jsarg.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 原生类绑定代码生成的公共部分，实际的类由 jsclass_template.h 展开
+
+// 字段释放：只有字符串字段持有内存
+#define js_field_free_int32(rt, v) ((void)0)
+#define js_field_free_float64(rt, v) ((void)0)
+#define js_field_free_bool(rt, v) ((void)0)
+#define js_field_free_string(rt, v) js_free_rt(rt, v)
+
+#define JS_CLASS_CAT_(a, b) a##b
+#define JS_CLASS_CAT(a, b) JS_CLASS_CAT_(a, b)
+
+/*
+ * 对象池：每个运行时的每个类一个。析构时结构体放回空闲链表，构造时
+ * 优先取用，内存都来自运行时的分配器。池由注册了这个类的上下文和
+ * 存活的对象共同持有，最后一个放开时归还全部内存，所以上下文和运行时
+ * 的释放顺序不影响它。每个块前面有一个头部，记录所属的池。
+ */
+#define JS_CLASS_POOL_MAX 256 // 空闲链表的最大长度
+
+typedef struct JSClassPool {
+  JSRuntime *rt;
+  JSClassID class_id;
+  size_t size; // 结构体大小，不含头部
+  void *free_list;
+  int free_count;
+  int refs;
+  struct JSClassPool *next;
+} JSClassPool;
+
+typedef union {
+  JSClassPool *pool; // 使用中：所属的池
+  void *next;        // 空闲：链表中的下一个块
+  max_align_t align;
+} JSClassBlock;
+
+// 所有运行时的池，只在取得和释放池时加锁
+static JSClassPool *js_class_pools;
+static pthread_mutex_t js_class_pools_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// 取得 rt 上 class_id 的池并增加引用，失败时返回 NULL
+static JSClassPool *js_class_pool_acquire(JSRuntime *rt, JSClassID class_id,
+                                          size_t size) {
+  pthread_mutex_lock(&js_class_pools_lock);
+  JSClassPool *pool = js_class_pools;
+  while (pool && (pool->rt != rt || pool->class_id != class_id))
+    pool = pool->next;
+  if (!pool) {
+    pool = js_mallocz_rt(rt, sizeof(*pool));
+    if (pool) {
+      pool->rt = rt;
+      pool->class_id = class_id;
+      pool->size = size;
+      pool->next = js_class_pools;
+      js_class_pools = pool;
+    }
+  }
+  if (pool)
+    pool->refs++;
+  pthread_mutex_unlock(&js_class_pools_lock);
+  return pool;
+}
+
+static void js_class_pool_release(JSClassPool *pool) {
+  if (--pool->refs > 0)
+    return;
+  pthread_mutex_lock(&js_class_pools_lock);
+  JSClassPool **p = &js_class_pools;
+  while (*p != pool)
+    p = &(*p)->next;
+  *p = pool->next;
+  pthread_mutex_unlock(&js_class_pools_lock);
+  while (pool->free_list) {
+    JSClassBlock *b = pool->free_list;
+    pool->free_list = b->next;
+    js_free_rt(pool->rt, b);
+  }
+  js_free_rt(pool->rt, pool);
+}
+
+// 清零的结构体，对象持有池的一个引用；失败时抛出异常并返回 NULL
+static void *js_class_pool_alloc(JSContext *ctx, JSClassPool *pool) {
+  JSClassBlock *b = pool->free_list;
+  if (b) {
+    pool->free_list = b->next;
+    pool->free_count--;
+  } else {
+    b = js_malloc(ctx, sizeof(*b) + pool->size);
+    if (!b)
+      return NULL;
+  }
+  b->pool = pool;
+  pool->refs++;
+  memset(b + 1, 0, pool->size);
+  return b + 1;
+}
+
+// 结构体放回所属的池，池已满或即将释放时直接归还
+static void js_class_pool_free(JSRuntime *rt, void *s) {
+  JSClassBlock *b = (JSClassBlock *)s - 1;
+  JSClassPool *pool = b->pool;
+  if (pool->refs > 1 && pool->free_count < JS_CLASS_POOL_MAX) {
+    b->next = pool->free_list;
+    pool->free_list = b;
+    pool->free_count++;
+  } else {
+    js_free_rt(rt, b);
+  }
+  js_class_pool_release(pool);
+}
+
+// 每个上下文的类状态，由一个隐藏对象持有，上下文释放时随之释放
+typedef struct {
+  JSClassPool *pool;
+  JSValue ctor;         // new_target 是它时直接用 JS_GetClassProto
+  JSAtom prototype_atom;
+} JSClassContext;
+
+static void js_class_context_free(JSRuntime *rt, JSClassContext *cc) {
+  JS_FreeValueRT(rt, cc->ctor);
+  JS_FreeAtomRT(rt, cc->prototype_atom);
+  js_class_pool_release(cc->pool);
+  js_free_rt(rt, cc);
+}
+
+#endif
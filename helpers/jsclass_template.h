@@ -0,0 +1,237 @@
+/*
+ * 原生类绑定模板。包含前定义以下宏，每包含一次生成一个类：
+ *
+ *   #define JS_CLASS_PREFIX point              // 生成符号的前缀 js_point_*
+ *   #define JS_CLASS_NAME "Point"              // JS 中的类名
+ *   #define JS_CLASS_STRUCT JSPointData        // 生成的 C 结构体类型
+ *   #define JS_CLASS_FIELDS(F) F(int32, x) F(int32, y)
+ *   #define JS_CLASS_ON_FINALIZE(s) ...         // 可选，析构时调用
+ *   #include "../helpers/jsclass_template.h"
+ *
+ * 字段类型: int32, float64, bool, string。构造函数按字段顺序接收参数，
+ * 每个字段生成一个 getter/setter。生成的符号：
+ *
+ *   JS_CLASS_STRUCT                    字段结构体
+ *   js_<prefix>_class_id               类 ID
+ *   js_<prefix>_ctor / _finalizer      构造与析构
+ *   js_<prefix>_get_<f> / _set_<f>     字段访问器
+ *   js_<prefix>_init_class(ctx, methods, n_methods)
+ *       注册类并返回构造函数，methods 为额外的原型方法
+ *
+ * 与手写绑定相比：new_target 就是这个构造函数时直接取类原型
+ * （JS_GetClassProto），子类才按预先驻留的 "prototype" 原子查找；参数
+ * 已是目标类型时跳过通用转换；结构体来自运行时的对象池（见 jsclass.h），
+ * 析构时放回池中，下一次构造不再分配。
+ */
+#include "./jsclass.h"
+
+#if !defined(JS_CLASS_PREFIX) || !defined(JS_CLASS_NAME) ||                    \
+    !defined(JS_CLASS_STRUCT) || !defined(JS_CLASS_FIELDS)
+#error "JS_CLASS_PREFIX, JS_CLASS_NAME, JS_CLASS_STRUCT and JS_CLASS_FIELDS must be defined"
+#endif
+
+#define JS_CLASS_SYM(suffix) JS_CLASS_CAT(JS_CLASS_CAT(js_, JS_CLASS_PREFIX), suffix)
+#define JS_CLASS_FIELD_SYM(what, name)                                         \
+  JS_CLASS_CAT(JS_CLASS_SYM(what), name)
+
+/* 结构体 */
+#define JS_CLASS_GEN_MEMBER(type, name) JS_CTYPE_##type name;
+typedef struct {
+  JS_CLASS_FIELDS(JS_CLASS_GEN_MEMBER)
+} JS_CLASS_STRUCT;
+#undef JS_CLASS_GEN_MEMBER
+
+/* 字段序号，用于按顺序取构造参数 */
+#define JS_CLASS_GEN_INDEX(type, name) JS_CLASS_FIELD_SYM(_field_, name),
+enum { JS_CLASS_FIELDS(JS_CLASS_GEN_INDEX) JS_CLASS_SYM(_field_count) };
+#undef JS_CLASS_GEN_INDEX
+
+static JSClassID JS_CLASS_SYM(_class_id);
+/* 持有每个上下文的 JSClassContext 的隐藏类，实例存放在它的类原型槽里 */
+static JSClassID JS_CLASS_SYM(_context_class_id);
+
+static void JS_CLASS_SYM(_context_finalizer)(JSRuntime *rt, JSValue val) {
+  JSClassContext *cc = JS_GetOpaque(val, JS_CLASS_SYM(_context_class_id));
+  if (cc)
+    js_class_context_free(rt, cc);
+}
+
+static void JS_CLASS_SYM(_context_mark)(JSRuntime *rt, JSValueConst val,
+                                        JS_MarkFunc *mark_func) {
+  JSClassContext *cc = JS_GetOpaque(val, JS_CLASS_SYM(_context_class_id));
+  if (cc)
+    JS_MarkValue(rt, cc->ctor, mark_func);
+}
+
+static JSClassDef JS_CLASS_SYM(_context_class) = {
+    JS_CLASS_NAME "Context",
+    .finalizer = JS_CLASS_SYM(_context_finalizer),
+    .gc_mark = JS_CLASS_SYM(_context_mark),
+};
+
+static JSClassContext *JS_CLASS_SYM(_context)(JSContext *ctx) {
+  JSValue holder = JS_GetClassProto(ctx, JS_CLASS_SYM(_context_class_id));
+  JSClassContext *cc = JS_GetOpaque(holder, JS_CLASS_SYM(_context_class_id));
+  JS_FreeValue(ctx, holder);
+  return cc;
+}
+
+static void JS_CLASS_SYM(_finalizer)(JSRuntime *rt, JSValue val) {
+  JS_CLASS_STRUCT *s = JS_GetOpaque(val, JS_CLASS_SYM(_class_id));
+  /* Note: 's' can be NULL in case JS_SetOpaque() was not called */
+  if (!s)
+    return;
+#ifdef JS_CLASS_ON_FINALIZE
+  JS_CLASS_ON_FINALIZE(s);
+#endif
+#define JS_CLASS_GEN_FREE(type, name) js_field_free_##type(rt, s->name);
+  JS_CLASS_FIELDS(JS_CLASS_GEN_FREE)
+#undef JS_CLASS_GEN_FREE
+  js_class_pool_free(rt, s);
+}
+
+static JSValue JS_CLASS_SYM(_ctor)(JSContext *ctx, JSValueConst new_target,
+                                   int argc, JSValueConst *argv) {
+  JS_CLASS_STRUCT *s;
+  JSValue obj = JS_UNDEFINED;
+  JSValue proto;
+  JSClassContext *cc = JS_CLASS_SYM(_context)(ctx);
+
+  /* the constructor was passed to a context that did not register it */
+  if (!cc)
+    return JS_ThrowTypeError(ctx, "%s is not registered in this context",
+                             JS_CLASS_NAME);
+  s = js_class_pool_alloc(ctx, cc->pool);
+  if (!s)
+    return JS_EXCEPTION;
+  /* argv holds at least one value per field: the constructor length is the
+     field count, so missing arguments are undefined */
+#define JS_CLASS_GEN_ARG(type, name)                                           \
+  if (js_arg_##type(ctx, &s->name, argv[JS_CLASS_FIELD_SYM(_field_, name)]))   \
+    goto fail;
+  JS_CLASS_FIELDS(JS_CLASS_GEN_ARG)
+#undef JS_CLASS_GEN_ARG
+  /* using new_target to get the prototype is necessary when the
+     class is extended. The constructor's own prototype property is
+     read-only, so it is always the class prototype. */
+  if (JS_VALUE_GET_PTR(new_target) == JS_VALUE_GET_PTR(cc->ctor))
+    proto = JS_GetClassProto(ctx, JS_CLASS_SYM(_class_id));
+  else
+    proto = JS_GetProperty(ctx, new_target, cc->prototype_atom);
+  if (JS_IsException(proto))
+    goto fail;
+  obj = JS_NewObjectProtoClass(ctx, proto, JS_CLASS_SYM(_class_id));
+  JS_FreeValue(ctx, proto);
+  if (JS_IsException(obj))
+    goto fail;
+  JS_SetOpaque(obj, s);
+  return obj;
+fail:
+#define JS_CLASS_GEN_FREE(type, name)                                          \
+  js_field_free_##type(JS_GetRuntime(ctx), s->name);
+  JS_CLASS_FIELDS(JS_CLASS_GEN_FREE)
+#undef JS_CLASS_GEN_FREE
+  js_class_pool_free(JS_GetRuntime(ctx), s);
+  JS_FreeValue(ctx, obj);
+  return JS_EXCEPTION;
+}
+
+/* 字段 getter/setter */
+#define JS_CLASS_GEN_GETSET(type, name)                                        \
+  static JSValue JS_CLASS_FIELD_SYM(_get_, name)(JSContext * ctx,              \
+                                                 JSValueConst this_val) {      \
+    JS_CLASS_STRUCT *s = JS_GetOpaque2(ctx, this_val, JS_CLASS_SYM(_class_id)); \
+    if (!s)                                                                    \
+      return JS_EXCEPTION;                                                     \
+    return js_ret_##type(ctx, s->name);                                        \
+  }                                                                            \
+  static JSValue JS_CLASS_FIELD_SYM(_set_, name)(                              \
+      JSContext * ctx, JSValueConst this_val, JSValueConst val) {              \
+    JS_CLASS_STRUCT *s = JS_GetOpaque2(ctx, this_val, JS_CLASS_SYM(_class_id)); \
+    JS_CTYPE_##type v;                                                         \
+    if (!s)                                                                    \
+      return JS_EXCEPTION;                                                     \
+    if (js_arg_##type(ctx, &v, val))                                           \
+      return JS_EXCEPTION;                                                     \
+    js_field_free_##type(JS_GetRuntime(ctx), s->name);                         \
+    s->name = v;                                                               \
+    return JS_UNDEFINED;                                                       \
+  }
+JS_CLASS_FIELDS(JS_CLASS_GEN_GETSET)
+#undef JS_CLASS_GEN_GETSET
+
+static const JSCFunctionListEntry JS_CLASS_SYM(_field_funcs)[] = {
+#define JS_CLASS_GEN_ENTRY(type, name)                                         \
+  JS_CGETSET_DEF(#name, JS_CLASS_FIELD_SYM(_get_, name),                       \
+                 JS_CLASS_FIELD_SYM(_set_, name)),
+    JS_CLASS_FIELDS(JS_CLASS_GEN_ENTRY)
+#undef JS_CLASS_GEN_ENTRY
+};
+
+static JSClassDef JS_CLASS_SYM(_class) = {
+    JS_CLASS_NAME,
+    .finalizer = JS_CLASS_SYM(_finalizer),
+};
+
+/* 注册类，返回构造函数（由调用方导出或挂到全局对象上），失败时返回
+   JS_EXCEPTION */
+static JSValue JS_CLASS_SYM(_init_class)(JSContext *ctx,
+                                         const JSCFunctionListEntry *methods,
+                                         int n_methods) {
+  JSRuntime *rt = JS_GetRuntime(ctx);
+  JSValue proto, ctor, holder;
+  JSClassContext *cc;
+
+  /* class IDs are process wide, classes are registered per runtime */
+  if (JS_CLASS_SYM(_class_id) == 0) {
+    JS_NewClassID(&JS_CLASS_SYM(_class_id));
+    JS_NewClassID(&JS_CLASS_SYM(_context_class_id));
+  }
+  if (!JS_IsRegisteredClass(rt, JS_CLASS_SYM(_class_id))) {
+    JS_NewClass(rt, JS_CLASS_SYM(_class_id), &JS_CLASS_SYM(_class));
+    JS_NewClass(rt, JS_CLASS_SYM(_context_class_id),
+                &JS_CLASS_SYM(_context_class));
+  }
+
+  cc = js_mallocz(ctx, sizeof(*cc));
+  if (!cc)
+    return JS_EXCEPTION;
+  cc->ctor = JS_UNDEFINED;
+  cc->prototype_atom = JS_NewAtom(ctx, "prototype");
+  cc->pool = js_class_pool_acquire(rt, JS_CLASS_SYM(_class_id),
+                                   sizeof(JS_CLASS_STRUCT));
+  if (!cc->pool) {
+    JS_FreeAtom(ctx, cc->prototype_atom);
+    js_free(ctx, cc);
+    return JS_ThrowOutOfMemory(ctx);
+  }
+  holder = JS_NewObjectClass(ctx, JS_CLASS_SYM(_context_class_id));
+  if (JS_IsException(holder)) {
+    js_class_context_free(rt, cc);
+    return JS_EXCEPTION;
+  }
+  JS_SetOpaque(holder, cc);
+
+  proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, proto, JS_CLASS_SYM(_field_funcs),
+                             JS_CLASS_SYM(_field_count));
+  if (methods)
+    JS_SetPropertyFunctionList(ctx, proto, methods, n_methods);
+
+  ctor = JS_NewCFunction2(ctx, JS_CLASS_SYM(_ctor), JS_CLASS_NAME,
+                          JS_CLASS_SYM(_field_count), JS_CFUNC_constructor, 0);
+  /* set proto.constructor and ctor.prototype */
+  JS_SetConstructor(ctx, ctor, proto);
+  JS_SetClassProto(ctx, JS_CLASS_SYM(_class_id), proto);
+  cc->ctor = JS_DupValue(ctx, ctor);
+  JS_SetClassProto(ctx, JS_CLASS_SYM(_context_class_id), holder);
+  return ctor;
+}
+
+#undef JS_CLASS_SYM
+#undef JS_CLASS_FIELD_SYM
+#undef JS_CLASS_PREFIX
+#undef JS_CLASS_NAME
+#undef JS_CLASS_STRUCT
+#undef JS_CLASS_FIELDS
+#undef JS_CLASS_ON_FINALIZE
@@ -0,0 +1,207 @@
+#ifndef HELPERS_JSFUNC_H
+#define HELPERS_JSFUNC_H
+
+/*
+ * 按声明的签名生成原生函数包装，例如
+ *
+ *   static int32_t add(int32_t a, int32_t b) { ... }
+ *   JS_TYPED_FUNC2(add, int32, int32, int32)
+ *   ...
+ *   JS_TYPED_FUNC_SET(ctx, global_obj, "add", add, 2);
+ *
+ * 生成的 js_typed_add 在参数已经是 int/float64 时直接取值，不走通用转换；
+ * 函数对象上还挂有 batch 方法，一次调用处理整个数组：
+ *
+ *   add.batch(xs, ys[, out])
+ *
+ * 每个参数可以是对应元素类型的 TypedArray（int32 -> Int32Array，
+ * float64 -> Float64Array），也可以是一个数字（对所有元素复用）。
+ * 结果写入 out 或新建的 TypedArray。batch 只支持数值类型的签名。
+ *
+ * 作用于原生类实例的方法用 JS_TYPED_METHOD0，C 函数接收 opaque 指针：
+ *
+ *   static double point_norm(JSPointData *s) { ... }
+ *   JS_TYPED_METHOD0(point_norm, JSPointData, js_point_class_id, float64)
+ */
+
+#include "../quickjs/quickjs.h"
+#include "./jsarg.h"
+#include <stdint.h>
+
+// TypedArray 元素类型
+#define JS_TARRAY_NAME_int32 "Int32Array"
+#define JS_TARRAY_NAME_float64 "Float64Array"
+#define JS_TARRAY_TYPE_int32 JS_TYPED_ARRAY_INT32
+#define JS_TARRAY_TYPE_float64 JS_TYPED_ARRAY_FLOAT64
+
+// batch 的一个参数：指向 TypedArray 数据或广播的单个值
+typedef struct {
+  const void *data; // NULL 表示广播 scalar
+  union {
+    int32_t i32;
+    double f64;
+  } scalar;
+} JSBatchArg;
+
+// new <ctor_name>(length)
+static JSValue js_batch_new_typed_array(JSContext *ctx, const char *ctor_name,
+                                        uint32_t length) {
+  JSValue global_obj = JS_GetGlobalObject(ctx);
+  JSValue ctor = JS_GetPropertyStr(ctx, global_obj, ctor_name);
+  JS_FreeValue(ctx, global_obj);
+  if (JS_IsException(ctor))
+    return JS_EXCEPTION;
+  JSValue len = JS_NewUint32(ctx, length);
+  JSValue ret = JS_CallConstructor(ctx, ctor, 1, &len);
+  JS_FreeValue(ctx, ctor);
+  return ret;
+}
+
+// 取 TypedArray 的数据指针和元素个数，类型不是 array_type 时抛出 TypeError。
+// 只比较元素大小会把 Float32Array 当成 Int32Array、BigInt64Array 当成
+// Float64Array
+static void *js_batch_array_data(JSContext *ctx, JSValueConst obj,
+                                 int array_type, uint32_t *plength) {
+  size_t byte_offset, byte_length, bytes_per_element, size;
+  if (JS_GetTypedArrayType(obj) != array_type) {
+    JS_ThrowTypeError(ctx, "batch: unexpected typed array element type");
+    return NULL;
+  }
+  JSValue buffer = JS_GetTypedArrayBuffer(ctx, obj, &byte_offset,
+                                          &byte_length, &bytes_per_element);
+  if (JS_IsException(buffer))
+    return NULL;
+  uint8_t *data = JS_GetArrayBuffer(ctx, &size, buffer);
+  JS_FreeValue(ctx, buffer);
+  if (!data)
+    return NULL;
+  *plength = byte_length / bytes_per_element;
+  return data + byte_offset;
+}
+
+// 解析 batch 参数：对象按 TypedArray 处理，其余按标量广播。
+// *plength 为所有数组参数的最小长度，尚无数组时为 UINT32_MAX
+static int js_batch_arg(JSContext *ctx, JSBatchArg *arg, JSValueConst val,
+                        int array_type, uint32_t *plength) {
+  if (JS_IsObject(val)) {
+    uint32_t len;
+    arg->data = js_batch_array_data(ctx, val, array_type, &len);
+    if (!arg->data)
+      return -1;
+    if (len < *plength)
+      *plength = len;
+    return 0;
+  }
+  arg->data = NULL;
+  if (array_type == JS_TYPED_ARRAY_INT32)
+    return js_arg_int32(ctx, &arg->scalar.i32, val);
+  return js_arg_float64(ctx, &arg->scalar.f64, val);
+}
+
+// 读取第 i 个元素
+#define JS_BATCH_GET_int32(arg, i)                                             \
+  ((arg).data ? ((const int32_t *)(arg).data)[i] : (arg).scalar.i32)
+#define JS_BATCH_GET_float64(arg, i)                                           \
+  ((arg).data ? ((const double *)(arg).data)[i] : (arg).scalar.f64)
+
+// 参数解析完成后再创建/校验输出数组：创建 TypedArray 可能执行 JS 代码，
+// 所以之后要重新解析数组参数以取得有效的数据指针
+#define JS_BATCH_PREPARE_OUT(R, out_val, length, out, out_obj, reparse)        \
+  do {                                                                         \
+    uint32_t out_len;                                                          \
+    if (length == UINT32_MAX)                                                  \
+      return JS_ThrowTypeError(ctx, "batch: at least one array expected");     \
+    if (JS_IsUndefined(out_val)) {                                             \
+      out_obj = js_batch_new_typed_array(ctx, JS_TARRAY_NAME_##R, length);     \
+    } else {                                                                   \
+      out_obj = JS_DupValue(ctx, out_val);                                     \
+    }                                                                          \
+    if (JS_IsException(out_obj))                                               \
+      return JS_EXCEPTION;                                                     \
+    out = js_batch_array_data(ctx, out_obj, JS_TARRAY_TYPE_##R, &out_len);     \
+    if (!out || reparse) {                                                     \
+      JS_FreeValue(ctx, out_obj);                                              \
+      return JS_EXCEPTION;                                                     \
+    }                                                                          \
+    if (out_len < length)                                                      \
+      length = out_len;                                                        \
+  } while (0)
+
+static void js_typed_func_set(JSContext *ctx, JSValueConst obj,
+                              const char *name, JSCFunction *func,
+                              JSCFunction *batch, int length) {
+  JSValue f = JS_NewCFunction(ctx, func, name, length);
+  if (batch) {
+    JS_SetPropertyStr(ctx, f, "batch",
+                      JS_NewCFunction(ctx, batch, "batch", length));
+  }
+  JS_SetPropertyStr(ctx, obj, name, f);
+}
+
+// 把 js_typed_<fn> 和它的 batch 方法以 name 挂到 obj 上
+#define JS_TYPED_FUNC_SET(ctx, obj, name, fn, length)                          \
+  js_typed_func_set(ctx, obj, name, js_typed_##fn, js_typed_batch_##fn, length)
+
+#define JS_TYPED_FUNC1(fn, R, A)                                               \
+  static JSValue js_typed_##fn(JSContext *ctx, JSValueConst this_val,          \
+                               int argc, JSValueConst *argv) {                 \
+    JS_CTYPE_##A a;                                                            \
+    if (js_arg_##A(ctx, &a, argv[0]))                                          \
+      return JS_EXCEPTION;                                                     \
+    return js_ret_##R(ctx, fn(a));                                             \
+  }                                                                            \
+  static JSValue js_typed_batch_##fn(JSContext *ctx, JSValueConst this_val,    \
+                                     int argc, JSValueConst *argv) {           \
+    JSBatchArg a;                                                              \
+    uint32_t length = UINT32_MAX;                                              \
+    JS_CTYPE_##R *out;                                                         \
+    JSValue out_obj;                                                           \
+    if (js_batch_arg(ctx, &a, argv[0], JS_TARRAY_TYPE_##A, &length))           \
+      return JS_EXCEPTION;                                                     \
+    JS_BATCH_PREPARE_OUT(                                                      \
+        R, argc > 1 ? argv[1] : JS_UNDEFINED, length, out, out_obj,            \
+        js_batch_arg(ctx, &a, argv[0], JS_TARRAY_TYPE_##A, &length));          \
+    for (uint32_t i = 0; i < length; i++)                                      \
+      out[i] = fn(JS_BATCH_GET_##A(a, i));                                     \
+    return out_obj;                                                            \
+  }
+
+#define JS_TYPED_FUNC2(fn, R, A, B)                                            \
+  static JSValue js_typed_##fn(JSContext *ctx, JSValueConst this_val,          \
+                               int argc, JSValueConst *argv) {                 \
+    JS_CTYPE_##A a;                                                            \
+    JS_CTYPE_##B b;                                                            \
+    if (js_arg_##A(ctx, &a, argv[0]))                                          \
+      return JS_EXCEPTION;                                                     \
+    if (js_arg_##B(ctx, &b, argv[1]))                                          \
+      return JS_EXCEPTION;                                                     \
+    return js_ret_##R(ctx, fn(a, b));                                          \
+  }                                                                            \
+  static JSValue js_typed_batch_##fn(JSContext *ctx, JSValueConst this_val,    \
+                                     int argc, JSValueConst *argv) {           \
+    JSBatchArg a, b;                                                           \
+    uint32_t length = UINT32_MAX;                                              \
+    JS_CTYPE_##R *out;                                                         \
+    JSValue out_obj;                                                           \
+    if (js_batch_arg(ctx, &a, argv[0], JS_TARRAY_TYPE_##A, &length) ||         \
+        js_batch_arg(ctx, &b, argv[1], JS_TARRAY_TYPE_##B, &length))           \
+      return JS_EXCEPTION;                                                     \
+    JS_BATCH_PREPARE_OUT(                                                      \
+        R, argc > 2 ? argv[2] : JS_UNDEFINED, length, out, out_obj,            \
+        js_batch_arg(ctx, &a, argv[0], JS_TARRAY_TYPE_##A, &length) ||         \
+            js_batch_arg(ctx, &b, argv[1], JS_TARRAY_TYPE_##B, &length));      \
+    for (uint32_t i = 0; i < length; i++)                                      \
+      out[i] = fn(JS_BATCH_GET_##A(a, i), JS_BATCH_GET_##B(b, i));             \
+    return out_obj;                                                            \
+  }
+
+#define JS_TYPED_METHOD0(fn, S, class_id, R)                                   \
+  static JSValue js_typed_##fn(JSContext *ctx, JSValueConst this_val,          \
+                               int argc, JSValueConst *argv) {                 \
+    S *s = JS_GetOpaque2(ctx, this_val, class_id);                             \
+    if (!s)                                                                    \
+      return JS_EXCEPTION;                                                     \
+    return js_ret_##R(ctx, fn(s));                                             \
+  }
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef HELPERS_JSSCAN_C
+#define HELPERS_JSSCAN_C
+
+#include <ctype.h>
+#include <string.h>
+
+/*
+ * JS 源码的轻量词法扫描：跳过空白、注释、字符串、模板和正则字面量，
+ * 识别标识符，不做语法分析。模板中 ${} 里再嵌套的模板不在处理范围内。
+ */
+
+typedef struct {
+  const char *p;
+  const char *end;
+  // 上一个有效字符，用于区分除号与正则字面量
+  char last;
+} JSScanner;
+
+static int js_scan_ident_char(char c) {
+  return isalnum((unsigned char)c) || c == '_' || c == '$';
+}
+
+// 跳过空白和注释
+static void js_scan_skip_space(JSScanner *s) {
+  while (s->p < s->end) {
+    if (isspace((unsigned char)*s->p)) {
+      s->p++;
+    } else if (s->p[0] == '/' && s->p + 1 < s->end && s->p[1] == '/') {
+      while (s->p < s->end && *s->p != '\n')
+        s->p++;
+    } else if (s->p[0] == '/' && s->p + 1 < s->end && s->p[1] == '*') {
+      const char *close = strstr(s->p + 2, "*/");
+      s->p = close ? close + 2 : s->end;
+    } else {
+      break;
+    }
+  }
+}
+
+// 跳过以 quote 结尾的字符串、模板或正则字面量，返回内容的起始位置
+static const char *js_scan_skip_quoted(JSScanner *s, char quote) {
+  const char *start = ++s->p;
+  int in_class = 0;
+  while (s->p < s->end) {
+    char c = *s->p++;
+    if (c == '\\' && s->p < s->end) {
+      s->p++;
+    } else if (quote == '/' && c == '[') {
+      in_class = 1;
+    } else if (quote == '/' && c == ']') {
+      in_class = 0;
+    } else if (c == quote && !in_class) {
+      break;
+    } else if (c == '\n' && quote != '`') {
+      break;
+    }
+  }
+  s->last = quote;
+  return start;
+}
+
+// 当前位置是否为关键字 kw（后面不紧跟标识符字符）
+static int js_scan_keyword(JSScanner *s, const char *kw) {
+  size_t n = strlen(kw);
+  return (size_t)(s->end - s->p) >= n && strncmp(s->p, kw, n) == 0 &&
+         (s->p + n == s->end || !js_scan_ident_char(s->p[n]));
+}
+
+// 跳过一个标识符或关键字，返回它的起始位置
+static const char *js_scan_skip_ident(JSScanner *s) {
+  const char *ident = s->p;
+  while (s->p < s->end && js_scan_ident_char(*s->p))
+    s->p++;
+  // 这些关键字之后的 '/' 开始一个正则字面量
+  static const char *const regex_keywords[] = {
+      "return", "typeof", "case", "do",    "else",  "in",
+      "of",     "void",   "yield", "await", "delete", "throw"};
+  s->last = 'a';
+  for (size_t k = 0; k < sizeof(regex_keywords) / sizeof(regex_keywords[0]);
+       k++) {
+    if ((size_t)(s->p - ident) == strlen(regex_keywords[k]) &&
+        strncmp(ident, regex_keywords[k], s->p - ident) == 0)
+      s->last = '=';
+  }
+  return ident;
+}
+
+// 当前字符为 '/'：前一个有效字符是运算符或标点时为正则字面量，否则为除号
+static void js_scan_skip_slash(JSScanner *s) {
+  if (strchr("(,=:[!&|?{};+-*%<>~^", s->last)) {
+    js_scan_skip_quoted(s, '/');
+  } else {
+    s->p++;
+    s->last = '/';
+  }
+}
+
+#endif
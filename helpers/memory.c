@@ -0,0 +1,34 @@
+#ifndef HELPERS_MEMORY_C
+#define HELPERS_MEMORY_C
+
+#include <stddef.h>
+#include <stdio.h>
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+// 当前进程的常驻内存（RSS），单位字节，获取失败时返回 0
+static size_t get_rss_bytes(void) {
+#if defined(__APPLE__)
+  struct mach_task_basic_info info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info,
+                &count) != KERN_SUCCESS) {
+    return 0;
+  }
+  return info.resident_size;
+#else
+  FILE *f = fopen("/proc/self/statm", "r");
+  long resident = 0;
+  if (!f)
+    return 0;
+  if (fscanf(f, "%*s %ld", &resident) != 1)
+    resident = 0;
+  fclose(f);
+  return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+#endif
@@ -0,0 +1,498 @@
+#ifndef HELPERS_METRICS_C
+#define HELPERS_METRICS_C
+
+#include "../quickjs/quickjs.h"
+#include "./clock.c"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+ * 指标登记表，按 Prometheus 文本格式导出。
+ *
+ * 每个线程挂接一个自己的分片（metrics_thread_attach），计数器、仪表和
+ * 直方图的桶都存在分片里。分片只有所属线程写入，记录一次就是对本线程
+ * 缓存行的一次 relaxed 读加写，没有锁也没有原子读改写；分片按缓存行
+ * 对齐，线程之间没有伪共享。导出时把所有分片相加，仪表导出的也是各
+ * 线程值之和。没有挂接分片的线程记录时什么也不做。
+ *
+ * 需要在导出时才读取的值（队列深度、RSS）用回调登记。
+ *
+ * 导出器线程按间隔把指标写入文件（先写临时文件再 rename），并在本地
+ * Unix 套接字上按需输出：每个连接拿到一份当时的快照。连接上先收到
+ * HTTP 请求时回复 HTTP 响应，于是 curl --unix-socket 和 socat 都能读取。
+ */
+
+#define METRICS_MAX 128
+// 每个分片的槽位数，直方图占 桶数 + 1 个槽位
+#define METRICS_SLOT_MAX 1024
+#define METRICS_SHARD_MAX 256
+#define METRICS_BUCKET_MAX 16
+// JS 堆统计要遍历整个堆，同一线程两次采集的最小间隔
+#define METRICS_HEAP_INTERVAL_MS 1000
+
+typedef enum {
+  METRIC_COUNTER,
+  METRIC_GAUGE,
+  METRIC_HISTOGRAM,
+} MetricType;
+
+static const char *const metric_type_names[] = {"counter", "gauge",
+                                                "histogram"};
+
+typedef double MetricFunc(void *opaque);
+
+typedef struct {
+  const char *name;
+  const char *help;
+  char *labels; // 例如 status="ok"，可以为 NULL
+  MetricType type;
+  int slot; // 在分片中的第一个槽位，回调指标为 -1
+  int bucket_count;
+  double bounds[METRICS_BUCKET_MAX]; // 桶的上界，最后一个桶为 +Inf
+  MetricFunc *func;
+  void *opaque;
+} Metric;
+
+// 一个线程的全部槽位。直方图的和按 double 的位模式存放
+typedef struct {
+  _Alignas(64) _Atomic uint64_t slots[METRICS_SLOT_MAX];
+} MetricsShard;
+
+// 登记表只追加：条目先填好再递增计数，读者无需加锁
+static Metric metrics[METRICS_MAX];
+static atomic_int metric_count = 0;
+static int metric_slots = 0;
+static MetricsShard *_Atomic metrics_shards[METRICS_SHARD_MAX];
+static atomic_int metrics_shard_count = 0;
+static pthread_mutex_t metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local MetricsShard *metrics_local = NULL;
+
+// 登记一个指标，失败时返回 -1。记录函数对 -1 什么也不做
+static int metrics_register(MetricType type, const char *name,
+                            const char *help, const char *labels,
+                            const double *bounds, int bound_count,
+                            MetricFunc *func, void *opaque) {
+  pthread_mutex_lock(&metrics_mutex);
+  int id = atomic_load(&metric_count);
+  int slots = func                       ? 0
+              : type == METRIC_HISTOGRAM ? bound_count + 2
+                                         : 1;
+  if (id >= METRICS_MAX || bound_count >= METRICS_BUCKET_MAX ||
+      metric_slots + slots > METRICS_SLOT_MAX) {
+    pthread_mutex_unlock(&metrics_mutex);
+    fprintf(stderr, "Too many metrics, %s is not recorded\n", name);
+    return -1;
+  }
+
+  Metric *m = &metrics[id];
+  memset(m, 0, sizeof(*m));
+  m->name = name;
+  m->help = help;
+  m->labels = labels ? strdup(labels) : NULL;
+  m->type = type;
+  m->slot = func ? -1 : metric_slots;
+  m->func = func;
+  m->opaque = opaque;
+  if (type == METRIC_HISTOGRAM) {
+    memcpy(m->bounds, bounds, bound_count * sizeof(double));
+    m->bucket_count = bound_count + 1;
+  }
+  metric_slots += slots;
+  atomic_store(&metric_count, id + 1);
+  pthread_mutex_unlock(&metrics_mutex);
+  return id;
+}
+
+static int metrics_counter(const char *name, const char *help,
+                           const char *labels) {
+  return metrics_register(METRIC_COUNTER, name, help, labels, NULL, 0, NULL,
+                          NULL);
+}
+
+static int metrics_gauge(const char *name, const char *help,
+                         const char *labels) {
+  return metrics_register(METRIC_GAUGE, name, help, labels, NULL, 0, NULL,
+                          NULL);
+}
+
+// bounds 为升序的桶上界，不含 +Inf
+static int metrics_histogram(const char *name, const char *help,
+                             const char *labels, const double *bounds,
+                             int bound_count) {
+  return metrics_register(METRIC_HISTOGRAM, name, help, labels, bounds,
+                          bound_count, NULL, NULL);
+}
+
+// 导出时调用 func 取值
+static int metrics_func(MetricType type, const char *name, const char *help,
+                        const char *labels, MetricFunc *func, void *opaque) {
+  return metrics_register(type, name, help, labels, NULL, 0, func, opaque);
+}
+
+// 为当前线程分配一个分片，之后本线程的记录写入该分片
+static int metrics_thread_attach(void) {
+  if (metrics_local)
+    return 0;
+  MetricsShard *shard = aligned_alloc(64, sizeof(MetricsShard));
+  if (!shard)
+    return -1;
+  memset(shard, 0, sizeof(*shard));
+
+  pthread_mutex_lock(&metrics_mutex);
+  int index = atomic_load(&metrics_shard_count);
+  if (index >= METRICS_SHARD_MAX) {
+    pthread_mutex_unlock(&metrics_mutex);
+    free(shard);
+    return -1;
+  }
+  atomic_store(&metrics_shards[index], shard);
+  atomic_store(&metrics_shard_count, index + 1);
+  pthread_mutex_unlock(&metrics_mutex);
+  metrics_local = shard;
+  return 0;
+}
+
+// 线程退出后它的分片仍然保留，累计的计数继续计入导出结果
+static void metrics_thread_detach(void) { metrics_local = NULL; }
+
+/* 记录，只由分片所属线程调用 */
+
+static inline _Atomic uint64_t *metrics_slot(int id, int offset) {
+  MetricsShard *shard = metrics_local;
+  if (!shard || id < 0)
+    return NULL;
+  return &shard->slots[metrics[id].slot + offset];
+}
+
+static inline void metrics_slot_add(_Atomic uint64_t *slot, uint64_t n) {
+  atomic_store_explicit(
+      slot, atomic_load_explicit(slot, memory_order_relaxed) + n,
+      memory_order_relaxed);
+}
+
+static inline void metrics_add(int id, uint64_t n) {
+  _Atomic uint64_t *slot = metrics_slot(id, 0);
+  if (slot)
+    metrics_slot_add(slot, n);
+}
+
+static inline void metrics_inc(int id) { metrics_add(id, 1); }
+
+// 仪表按补码存放，增减都用无符号加法
+static inline void metrics_gauge_add(int id, int64_t delta) {
+  metrics_add(id, (uint64_t)delta);
+}
+
+// 设置本线程的仪表值，导出的是所有线程之和
+static inline void metrics_gauge_set(int id, int64_t value) {
+  _Atomic uint64_t *slot = metrics_slot(id, 0);
+  if (slot)
+    atomic_store_explicit(slot, (uint64_t)value, memory_order_relaxed);
+}
+
+static inline void metrics_observe(int id, double value) {
+  _Atomic uint64_t *slot = metrics_slot(id, 0);
+  if (!slot)
+    return;
+  const Metric *m = &metrics[id];
+  int bucket = 0;
+  while (bucket < m->bucket_count - 1 && value > m->bounds[bucket])
+    bucket++;
+  metrics_slot_add(&slot[bucket], 1);
+
+  _Atomic uint64_t *sum = &slot[m->bucket_count];
+  uint64_t bits = atomic_load_explicit(sum, memory_order_relaxed);
+  double total;
+  memcpy(&total, &bits, sizeof(double));
+  total += value;
+  memcpy(&bits, &total, sizeof(double));
+  atomic_store_explicit(sum, bits, memory_order_relaxed);
+}
+
+/* JS 堆 */
+
+typedef struct {
+  int malloc_bytes;
+  int used_bytes;
+  int objects;
+  double last_ms; // 本线程上次采集的时间
+} MetricsHeap;
+
+static void metrics_heap_register(MetricsHeap *heap) {
+  heap->malloc_bytes =
+      metrics_gauge("quickjs_heap_malloc_bytes",
+                    "Bytes allocated by QuickJS runtimes", NULL);
+  heap->used_bytes = metrics_gauge(
+      "quickjs_heap_used_bytes",
+      "Bytes in use by QuickJS runtimes, including allocator overhead", NULL);
+  heap->objects = metrics_gauge("quickjs_heap_objects",
+                                "Live objects in QuickJS runtimes", NULL);
+  heap->last_ms = 0;
+}
+
+// 在运行 rt 的线程上调用，每个线程持有自己的 heap 副本。
+// JS_ComputeMemoryUsage 要遍历整个堆，force 为 0 时距上次不足
+// METRICS_HEAP_INTERVAL_MS 直接返回
+static void metrics_heap_record(MetricsHeap *heap, JSRuntime *rt,
+                                int force) {
+  double now = get_time_ms();
+  if (!metrics_local ||
+      (!force && now - heap->last_ms < METRICS_HEAP_INTERVAL_MS))
+    return;
+  heap->last_ms = now;
+
+  JSMemoryUsage usage;
+  JS_ComputeMemoryUsage(rt, &usage);
+  metrics_gauge_set(heap->malloc_bytes, usage.malloc_size);
+  metrics_gauge_set(heap->used_bytes, usage.memory_used_size);
+  metrics_gauge_set(heap->objects, usage.obj_count);
+}
+
+// 运行时释放后清零本线程的堆仪表
+static void metrics_heap_clear(MetricsHeap *heap) {
+  metrics_gauge_set(heap->malloc_bytes, 0);
+  metrics_gauge_set(heap->used_bytes, 0);
+  metrics_gauge_set(heap->objects, 0);
+}
+
+/* 导出 */
+
+static uint64_t metrics_sum(const Metric *m, int offset) {
+  uint64_t total = 0;
+  int shards = atomic_load(&metrics_shard_count);
+  for (int i = 0; i < shards; i++) {
+    MetricsShard *shard = atomic_load(&metrics_shards[i]);
+    total += atomic_load_explicit(&shard->slots[m->slot + offset],
+                                  memory_order_relaxed);
+  }
+  return total;
+}
+
+static double metrics_sum_double(const Metric *m, int offset) {
+  double total = 0;
+  int shards = atomic_load(&metrics_shard_count);
+  for (int i = 0; i < shards; i++) {
+    MetricsShard *shard = atomic_load(&metrics_shards[i]);
+    uint64_t bits = atomic_load_explicit(&shard->slots[m->slot + offset],
+                                         memory_order_relaxed);
+    double value;
+    memcpy(&value, &bits, sizeof(double));
+    total += value;
+  }
+  return total;
+}
+
+// 写出 name{labels,extra}
+static void metrics_write_series(FILE *f, const char *name,
+                                 const char *suffix, const char *labels,
+                                 const char *extra) {
+  fprintf(f, "%s%s", name, suffix);
+  if (labels || extra) {
+    fprintf(f, "{%s%s%s}", labels ? labels : "", labels && extra ? "," : "",
+            extra ? extra : "");
+  }
+  fputc(' ', f);
+}
+
+// 按 Prometheus 文本格式写出所有指标。同名的指标应连续登记，
+// HELP 和 TYPE 只在第一个之前写出
+static void metrics_render(FILE *f) {
+  int count = atomic_load(&metric_count);
+  for (int i = 0; i < count; i++) {
+    const Metric *m = &metrics[i];
+    if (i == 0 || strcmp(m->name, metrics[i - 1].name) != 0) {
+      fprintf(f, "# HELP %s %s\n", m->name, m->help);
+      fprintf(f, "# TYPE %s %s\n", m->name, metric_type_names[m->type]);
+    }
+
+    if (m->func) {
+      metrics_write_series(f, m->name, "", m->labels, NULL);
+      fprintf(f, "%.17g\n", m->func(m->opaque));
+    } else if (m->type == METRIC_COUNTER) {
+      metrics_write_series(f, m->name, "", m->labels, NULL);
+      fprintf(f, "%llu\n", (unsigned long long)metrics_sum(m, 0));
+    } else if (m->type == METRIC_GAUGE) {
+      metrics_write_series(f, m->name, "", m->labels, NULL);
+      fprintf(f, "%lld\n", (long long)(int64_t)metrics_sum(m, 0));
+    } else {
+      // 桶在分片中各自计数，导出时累加成 Prometheus 的累计桶
+      uint64_t cumulative = 0;
+      char le[64];
+      for (int b = 0; b < m->bucket_count; b++) {
+        cumulative += metrics_sum(m, b);
+        if (b < m->bucket_count - 1)
+          snprintf(le, sizeof(le), "le=\"%g\"", m->bounds[b]);
+        else
+          snprintf(le, sizeof(le), "le=\"+Inf\"");
+        metrics_write_series(f, m->name, "_bucket", m->labels, le);
+        fprintf(f, "%llu\n", (unsigned long long)cumulative);
+      }
+      metrics_write_series(f, m->name, "_sum", m->labels, NULL);
+      fprintf(f, "%.17g\n", metrics_sum_double(m, m->bucket_count));
+      metrics_write_series(f, m->name, "_count", m->labels, NULL);
+      fprintf(f, "%llu\n", (unsigned long long)cumulative);
+    }
+  }
+}
+
+// 写入文件：先写临时文件再 rename，读者只会看到完整的快照
+static int metrics_write_file(const char *path) {
+  char tmp[1024];
+  snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid());
+  FILE *f = fopen(tmp, "w");
+  if (!f)
+    return -1;
+  metrics_render(f);
+  if (fclose(f) != 0 || rename(tmp, path) != 0) {
+    unlink(tmp);
+    return -1;
+  }
+  return 0;
+}
+
+typedef struct {
+  const char *file;   // 为 NULL 时不写文件
+  const char *socket; // 为 NULL 时不监听
+  int interval_ms;
+  int listen_fd;
+  int wake[2]; // 写入一个字节让导出线程退出
+  pthread_t thread;
+} MetricsExporter;
+
+// 向一个连接输出快照。客户端在 100 毫秒内发来 HTTP 请求时回复 HTTP 响应
+static void metrics_serve_connection(int fd) {
+  struct pollfd pfd = {fd, POLLIN, 0};
+  char request[1024];
+  ssize_t n = 0;
+  if (poll(&pfd, 1, 100) > 0)
+    n = read(fd, request, sizeof(request));
+
+  FILE *f = fdopen(fd, "w");
+  if (!f) {
+    close(fd);
+    return;
+  }
+  if (n >= 4 && strncmp(request, "GET ", 4) == 0) {
+    fprintf(f, "HTTP/1.0 200 OK\r\n"
+               "Content-Type: text/plain; version=0.0.4\r\n"
+               "Connection: close\r\n\r\n");
+  }
+  metrics_render(f);
+  fclose(f);
+}
+
+static void *metrics_exporter_thread(void *arg) {
+  MetricsExporter *e = arg;
+  struct pollfd fds[2] = {{e->wake[0], POLLIN, 0}, {e->listen_fd, POLLIN, 0}};
+  int nfds = e->listen_fd >= 0 ? 2 : 1;
+  double next_write = get_time_ms();
+
+  while (1) {
+    int timeout = -1;
+    if (e->file) {
+      double now = get_time_ms();
+      if (now >= next_write) {
+        metrics_write_file(e->file);
+        next_write = now + e->interval_ms;
+      }
+      timeout = (int)(next_write - now) + 1;
+    }
+
+    if (poll(fds, nfds, timeout) < 0 && errno != EINTR)
+      break;
+    if (fds[0].revents)
+      break;
+    if (nfds > 1 && (fds[1].revents & POLLIN)) {
+      int fd = accept(e->listen_fd, NULL, NULL);
+      if (fd >= 0)
+        metrics_serve_connection(fd);
+    }
+  }
+  return NULL;
+}
+
+// 启动导出线程。file 每 interval_ms 毫秒重写一次，socket 为 Unix 套接字路径
+static int metrics_exporter_start(MetricsExporter *e, const char *file,
+                                  const char *socket_path, int interval_ms) {
+  memset(e, 0, sizeof(*e));
+  e->file = file;
+  e->socket = socket_path;
+  e->interval_ms = interval_ms > 0 ? interval_ms : 1000;
+  e->listen_fd = -1;
+
+  if (socket_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+      fprintf(stderr, "Metrics socket path too long: %s\n", socket_path);
+      return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+    // 上次运行留下的套接字文件
+    unlink(socket_path);
+    e->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (e->listen_fd < 0 ||
+        bind(e->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(e->listen_fd, 16) != 0) {
+      fprintf(stderr, "Failed to listen on metrics socket %s: %s\n",
+              socket_path, strerror(errno));
+      if (e->listen_fd >= 0)
+        close(e->listen_fd);
+      return -1;
+    }
+  }
+
+  if (pipe(e->wake) != 0 ||
+      pthread_create(&e->thread, NULL, metrics_exporter_thread, e) != 0) {
+    fprintf(stderr, "Failed to start metrics exporter\n");
+    if (e->listen_fd >= 0) {
+      close(e->listen_fd);
+      unlink(socket_path);
+    }
+    return -1;
+  }
+  return 0;
+}
+
+// 停止导出线程，最后写一次文件，删除套接字
+static void metrics_exporter_stop(MetricsExporter *e) {
+  if (write(e->wake[1], "", 1) < 0)
+    perror("metrics exporter");
+  pthread_join(e->thread, NULL);
+  close(e->wake[0]);
+  close(e->wake[1]);
+  if (e->listen_fd >= 0) {
+    close(e->listen_fd);
+    unlink(e->socket);
+  }
+  if (e->file && metrics_write_file(e->file) != 0)
+    fprintf(stderr, "Failed to write metrics to %s\n", e->file);
+}
+
+// 释放登记表和所有分片，调用时不应再有线程记录或导出
+static void metrics_free(void) {
+  int count = atomic_load(&metric_count);
+  for (int i = 0; i < count; i++) {
+    free(metrics[i].labels);
+  }
+  int shards = atomic_load(&metrics_shard_count);
+  for (int i = 0; i < shards; i++) {
+    free(atomic_load(&metrics_shards[i]));
+  }
+  atomic_store(&metric_count, 0);
+  atomic_store(&metrics_shard_count, 0);
+  metric_slots = 0;
+  metrics_local = NULL;
+}
+
+#endif
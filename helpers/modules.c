@@ -0,0 +1,637 @@
+#ifndef HELPERS_MODULES_C
+#define HELPERS_MODULES_C
+
+#include "../quickjs/quickjs.h"
+#include "./clock.c"
+#include "./compile_cache.c"
+#include "./jsscan.c"
+#include <ctype.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * 模块加载器：从文件系统或 bundle 读取 JS 模块。
+ *
+ * bundle 是一个文本文件，每个模块以单独一行 "// @module <name>" 开头，
+ * 直到下一个标记行为止都是该模块的源码，name 为规范化后的模块名。
+ *
+ * 顺序加载时由 QuickJS 在链接入口模块时逐个回调 module_loader_load。
+ * module_graph_load 则提前解析整个导入图：多个线程各自用独立的运行时
+ * 读取、扫描 import 并编译成字节码，JS 线程只需 module_graph_link
+ * 读入字节码并链接。设置了 cache 时两条路径都先查磁盘上的编译缓存。
+ */
+
+#define MODULE_BUNDLE_MARKER "// @module "
+
+typedef struct {
+  char *data; // 整个 bundle 文件
+  int count;
+  char **names;
+  const char **sources;
+  size_t *lengths;
+} ModuleBundle;
+
+typedef struct {
+  ModuleBundle bundle; // count 为 0 时只从文件系统加载
+  CompileCache *cache; // 为 NULL 时每次都解析源码
+} ModuleLoader;
+
+// 读取整个文件，不存在时静默返回 NULL（按多个候选路径探测）
+static char *module_read_file(const char *path, size_t *len) {
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return NULL;
+
+  long size = -1;
+  if (fseek(f, 0, SEEK_END) == 0)
+    size = ftell(f);
+  char *buf = size < 0 ? NULL : malloc(size + 1);
+  if (!buf) {
+    // 目录、管道等无法取得大小的路径按读取失败处理
+    fclose(f);
+    return NULL;
+  }
+  rewind(f);
+  *len = fread(buf, 1, size, f);
+  buf[*len] = '\0';
+  fclose(f);
+  return buf;
+}
+
+// 与 QuickJS 默认规则相同：只有以 '.' 开头的名称相对于 base 所在目录解析，
+// 并折叠开头的 "./" 与 "../"。返回 malloc 分配的字符串
+static char *module_normalize_name(const char *base, const char *name) {
+  if (name[0] != '.')
+    return strdup(name);
+
+  const char *slash = strrchr(base, '/');
+  size_t dir_len = slash ? (size_t)(slash - base) : 0;
+  char *filename = malloc(dir_len + strlen(name) + 2);
+  if (!filename)
+    return NULL;
+  memcpy(filename, base, dir_len);
+  filename[dir_len] = '\0';
+
+  const char *r = name;
+  for (;;) {
+    if (r[0] == '.' && r[1] == '/') {
+      r += 2;
+    } else if (r[0] == '.' && r[1] == '.' && r[2] == '/') {
+      if (filename[0] == '\0')
+        break;
+      char *p = strrchr(filename, '/');
+      p = p ? p + 1 : filename;
+      if (strcmp(p, "..") == 0)
+        break;
+      if (p > filename)
+        p--;
+      *p = '\0';
+      r += 3;
+    } else {
+      break;
+    }
+  }
+  if (filename[0] != '\0')
+    strcat(filename, "/");
+  strcat(filename, r);
+  return filename;
+}
+
+// JSModuleNormalizeFunc，返回的字符串由 QuickJS 用 js_free 释放
+static char *module_loader_normalize(JSContext *ctx, const char *base,
+                                     const char *name, void *opaque) {
+  char *normalized = module_normalize_name(base, name);
+  if (!normalized) {
+    JS_ThrowOutOfMemory(ctx);
+    return NULL;
+  }
+  size_t len = strlen(normalized) + 1;
+  char *ret = js_malloc(ctx, len);
+  if (ret)
+    memcpy(ret, normalized, len);
+  free(normalized);
+  return ret;
+}
+
+// 把 bundle 切分成模块，失败时返回 -1
+static int module_bundle_open(ModuleBundle *bundle, const char *path) {
+  size_t len;
+  memset(bundle, 0, sizeof(*bundle));
+  bundle->data = module_read_file(path, &len);
+  if (!bundle->data)
+    return -1;
+
+  int capacity = 0;
+  size_t marker_len = strlen(MODULE_BUNDLE_MARKER);
+  char *p = bundle->data;
+  while (p && *p) {
+    char *line_end = strchr(p, '\n');
+    if (strncmp(p, MODULE_BUNDLE_MARKER, marker_len) == 0 && line_end) {
+      // 上一个模块在标记行之前结束
+      if (bundle->count > 0) {
+        bundle->lengths[bundle->count - 1] =
+            p - bundle->sources[bundle->count - 1];
+      }
+      if (bundle->count == capacity) {
+        capacity = capacity ? capacity * 2 : 64;
+        bundle->names = realloc(bundle->names, capacity * sizeof(char *));
+        bundle->sources =
+            realloc(bundle->sources, capacity * sizeof(const char *));
+        bundle->lengths = realloc(bundle->lengths, capacity * sizeof(size_t));
+      }
+      *line_end = '\0';
+      bundle->names[bundle->count] = p + marker_len;
+      bundle->sources[bundle->count] = line_end + 1;
+      bundle->count++;
+    }
+    p = line_end ? line_end + 1 : NULL;
+  }
+  if (bundle->count > 0) {
+    bundle->lengths[bundle->count - 1] =
+        bundle->data + len - bundle->sources[bundle->count - 1];
+  }
+  return 0;
+}
+
+static void module_bundle_close(ModuleBundle *bundle) {
+  free(bundle->data);
+  free(bundle->names);
+  free(bundle->sources);
+  free(bundle->lengths);
+  memset(bundle, 0, sizeof(*bundle));
+}
+
+// bundle_path 为 NULL 时只使用文件系统
+static int module_loader_init(ModuleLoader *loader, const char *bundle_path) {
+  memset(loader, 0, sizeof(*loader));
+  if (bundle_path && module_bundle_open(&loader->bundle, bundle_path) < 0) {
+    fprintf(stderr, "Failed to open module bundle %s\n", bundle_path);
+    return -1;
+  }
+  return 0;
+}
+
+static void module_loader_free(ModuleLoader *loader) {
+  module_bundle_close(&loader->bundle);
+}
+
+// 读取模块源码：有 bundle 时只查 bundle，否则把 name 当作文件路径。
+// 与 QuickJS 一样不补全扩展名，因此 "./point" 这样的名称仍会落到
+// 同名的 C 模块上。返回 malloc 分配、以 '\0' 结尾的副本，找不到时返回 NULL
+static char *module_loader_read(const ModuleLoader *loader, const char *name,
+                                size_t *len) {
+  const ModuleBundle *bundle = &loader->bundle;
+  for (int i = 0; i < bundle->count; i++) {
+    if (strcmp(bundle->names[i], name) == 0) {
+      char *copy = malloc(bundle->lengths[i] + 1);
+      memcpy(copy, bundle->sources[i], bundle->lengths[i]);
+      copy[bundle->lengths[i]] = '\0';
+      *len = bundle->lengths[i];
+      return copy;
+    }
+  }
+  if (bundle->count > 0)
+    return NULL;
+  return module_read_file(name, len);
+}
+
+// 读取并编译模块，不执行。返回 JS_TAG_MODULE 的值，模块同时登记在 ctx 中
+static JSValue module_loader_compile(JSContext *ctx, ModuleLoader *loader,
+                                     const char *name) {
+  size_t len;
+  char *source = module_loader_read(loader, name, &len);
+  if (!source)
+    return JS_ThrowReferenceError(ctx, "could not load module '%s'", name);
+
+  JSValue val = compile_cache_compile(ctx, loader->cache, source, len, name,
+                                      JS_EVAL_TYPE_MODULE);
+  free(source);
+  return val;
+}
+
+// JSModuleLoaderFunc：链接时遇到尚未加载的模块才会调用
+static JSModuleDef *module_loader_load(JSContext *ctx, const char *name,
+                                       void *opaque) {
+  JSValue val = module_loader_compile(ctx, opaque, name);
+  if (JS_IsException(val))
+    return NULL;
+  // 模块已由 ctx 引用，这里释放返回值的引用即可
+  JSModuleDef *m = JS_VALUE_GET_PTR(val);
+  JS_FreeValue(ctx, val);
+  return m;
+}
+
+static void module_loader_install(JSRuntime *rt, ModuleLoader *loader) {
+  JS_SetModuleLoaderFunc(rt, module_loader_normalize, module_loader_load,
+                         loader);
+}
+
+/* 导入扫描 */
+
+// 读取下一个字符串字面量，失败时返回 0
+static int module_scan_string(JSScanner *s, const char **str, size_t *len) {
+  js_scan_skip_space(s);
+  if (s->p >= s->end || (*s->p != '"' && *s->p != '\''))
+    return 0;
+  *str = js_scan_skip_quoted(s, *s->p);
+  *len = s->p - *str - 1;
+  return 1;
+}
+
+// 跳过 import/export 子句直到 from 之后，遇到语句结束时返回 0
+static int module_scan_until_from(JSScanner *s) {
+  while (s->p < s->end) {
+    js_scan_skip_space(s);
+    if (s->p >= s->end || *s->p == ';' || *s->p == '"' || *s->p == '\'' ||
+        *s->p == '(')
+      return 0;
+    if (js_scan_keyword(s, "from")) {
+      s->p += 4;
+      return 1;
+    }
+    if (js_scan_ident_char(*s->p)) {
+      while (s->p < s->end && js_scan_ident_char(*s->p))
+        s->p++;
+    } else {
+      s->p++;
+    }
+  }
+  return 0;
+}
+
+typedef void ModuleScanFunc(const char *spec, size_t len, void *opaque);
+
+// 词法扫描源码中的静态 import/export ... from 以及 import("...")，
+// 对每个模块说明符调用 func。跳过注释、字符串、模板和正则字面量，
+// 不做完整的语法分析
+static void module_scan_imports(const char *source, size_t len,
+                                ModuleScanFunc *func, void *opaque) {
+  JSScanner s = {source, source + len, ';'};
+  const char *spec;
+  size_t spec_len;
+
+  while (s.p < s.end) {
+    js_scan_skip_space(&s);
+    if (s.p >= s.end)
+      break;
+
+    char c = *s.p;
+    if (c == '"' || c == '\'' || c == '`') {
+      js_scan_skip_quoted(&s, c);
+    } else if (c == '/') {
+      js_scan_skip_slash(&s);
+    } else if (js_scan_ident_char(c)) {
+      // 属性访问 a.import 不是关键字
+      int is_member = s.last == '.';
+      if (!is_member && js_scan_keyword(&s, "import")) {
+        s.p += 6;
+        js_scan_skip_space(&s);
+        if (s.p < s.end && *s.p == '(') {
+          s.p++;
+          if (module_scan_string(&s, &spec, &spec_len))
+            func(spec, spec_len, opaque);
+        } else if (s.p < s.end && *s.p != '.') {
+          if (module_scan_string(&s, &spec, &spec_len) ||
+              (module_scan_until_from(&s) &&
+               module_scan_string(&s, &spec, &spec_len)))
+            func(spec, spec_len, opaque);
+        }
+        s.last = ';';
+      } else if (!is_member && js_scan_keyword(&s, "export")) {
+        s.p += 6;
+        js_scan_skip_space(&s);
+        // 只有 export {...} from 和 export * from 会引入依赖
+        if (s.p < s.end && (*s.p == '{' || *s.p == '*') &&
+            module_scan_until_from(&s) &&
+            module_scan_string(&s, &spec, &spec_len))
+          func(spec, spec_len, opaque);
+        s.last = ';';
+      } else {
+        js_scan_skip_ident(&s);
+      }
+    } else {
+      s.last = c;
+      s.p++;
+    }
+  }
+}
+
+/* 并行加载导入图 */
+
+typedef struct {
+  char *name;
+  uint8_t *bytecode; // NULL 表示不在 bundle/文件系统中（如 C 模块）
+  size_t bytecode_len;
+  size_t source_len;
+} ModuleGraphNode;
+
+typedef struct {
+  ModuleLoader *loader;
+  ModuleGraphNode *nodes; // nodes[0] 为入口模块
+  int count;
+  int capacity;
+  // 名称到 nodes 下标 + 1 的开放寻址哈希表，0 表示空位
+  int *index;
+  int index_size;
+  int next;      // 下一个待处理的节点
+  int in_flight; // 正在读取/编译的节点数
+  int error;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  double compile_ms; // 所有线程编译耗时之和
+} ModuleGraph;
+
+static uint32_t module_graph_hash(const char *name) {
+  uint32_t h = 2166136261u;
+  for (; *name; name++) {
+    h = (h ^ (unsigned char)*name) * 16777619u;
+  }
+  return h;
+}
+
+// 加入尚未出现过的模块，接管 name，需持有 mutex。内存不足时置 error
+static void module_graph_add(ModuleGraph *g, char *name) {
+  if (!name) {
+    g->error = 1;
+    return;
+  }
+  uint32_t mask = g->index_size - 1;
+  uint32_t slot = module_graph_hash(name) & mask;
+  while (g->index[slot]) {
+    if (strcmp(g->nodes[g->index[slot] - 1].name, name) == 0) {
+      free(name);
+      return;
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  if (g->count == g->capacity) {
+    ModuleGraphNode *nodes =
+        realloc(g->nodes, g->capacity * 2 * sizeof(ModuleGraphNode));
+    if (!nodes) {
+      free(name);
+      g->error = 1;
+      return;
+    }
+    g->nodes = nodes;
+    g->capacity *= 2;
+  }
+  memset(&g->nodes[g->count], 0, sizeof(ModuleGraphNode));
+  g->nodes[g->count].name = name;
+  g->index[slot] = ++g->count;
+
+  // 装载因子超过 1/2 时扩容重建
+  if (g->count * 2 > g->index_size) {
+    int *index = calloc(g->index_size * 2, sizeof(int));
+    if (!index) {
+      g->error = 1;
+      return;
+    }
+    free(g->index);
+    g->index = index;
+    g->index_size *= 2;
+    mask = g->index_size - 1;
+    for (int i = 0; i < g->count; i++) {
+      slot = module_graph_hash(g->nodes[i].name) & mask;
+      while (g->index[slot])
+        slot = (slot + 1) & mask;
+      g->index[slot] = i + 1;
+    }
+  }
+}
+
+// 扫描出的依赖，规范化后暂存，编译完成后再统一加入图中
+typedef struct {
+  const char *base;
+  char **names;
+  int count;
+  int capacity;
+  int error; // 内存不足，丢失了依赖
+} ModuleDeps;
+
+static void module_deps_add(const char *spec, size_t len, void *opaque) {
+  ModuleDeps *deps = opaque;
+  if (deps->count == deps->capacity) {
+    int capacity = deps->capacity ? deps->capacity * 2 : 8;
+    char **names = realloc(deps->names, capacity * sizeof(char *));
+    if (!names) {
+      deps->error = 1;
+      return;
+    }
+    deps->names = names;
+    deps->capacity = capacity;
+  }
+  char *raw = strndup(spec, len);
+  char *name = raw ? module_normalize_name(deps->base, raw) : NULL;
+  free(raw);
+  if (!name) {
+    deps->error = 1;
+    return;
+  }
+  deps->names[deps->count++] = name;
+}
+
+// 编译用的最小上下文：只需要解析器，不需要完整的标准库
+static JSContext *module_graph_new_context(JSRuntime *rt) {
+  JSContext *ctx = JS_NewContextRaw(rt);
+  if (!ctx)
+    return NULL;
+  JS_AddIntrinsicBaseObjects(ctx);
+  JS_AddIntrinsicEval(ctx);
+  JS_AddIntrinsicRegExpCompiler(ctx);
+  return ctx;
+}
+
+static void *module_graph_worker(void *arg) {
+  ModuleGraph *g = arg;
+  JSRuntime *rt = JS_NewRuntime();
+  JSContext *ctx = rt ? module_graph_new_context(rt) : NULL;
+
+  pthread_mutex_lock(&g->mutex);
+  if (!ctx) {
+    // 少一个线程也能完成，但这通常意味着内存不足，直接让整次加载失败
+    fprintf(stderr, "Failed to create module compile runtime\n");
+    g->error = 1;
+  }
+  for (;;) {
+    // 没有待处理的节点但仍有线程在编译时，等待它们发现新的依赖
+    while (g->next == g->count && g->in_flight > 0 && !g->error)
+      pthread_cond_wait(&g->cond, &g->mutex);
+    if (g->next == g->count || g->error)
+      break;
+
+    int i = g->next++;
+    char *name = g->nodes[i].name;
+    g->in_flight++;
+    pthread_mutex_unlock(&g->mutex);
+
+    size_t source_len = 0;
+    char *source = module_loader_read(g->loader, name, &source_len);
+    uint8_t *bytecode = NULL;
+    size_t bytecode_len = 0;
+    ModuleDeps deps = {name, NULL, 0, 0, 0};
+    double compile_ms = 0;
+    int failed = 0;
+
+    uint8_t key[32];
+    if (source && g->loader->cache) {
+      // 命中时直接使用缓存的字节码，完全跳过解析
+      compile_cache_key(name, source, source_len, JS_EVAL_TYPE_MODULE, key);
+      bytecode = compile_cache_get(g->loader->cache, key, &bytecode_len);
+    }
+
+    if (source) {
+      module_scan_imports(source, source_len, module_deps_add, &deps);
+    }
+
+    if (source && !bytecode) {
+      double start = get_time_ms();
+      JSValue val =
+          JS_Eval(ctx, source, source_len, name,
+                  JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+      if (JS_IsException(val)) {
+        check_and_print_exception(ctx);
+        failed = 1;
+      } else {
+        uint8_t *buf =
+            JS_WriteObject(ctx, &bytecode_len, val, JS_WRITE_OBJ_BYTECODE);
+        JS_FreeValue(ctx, val);
+        if (buf) {
+          bytecode = malloc(bytecode_len);
+          if (bytecode) {
+            memcpy(bytecode, buf, bytecode_len);
+            if (g->loader->cache)
+              compile_cache_put(g->loader->cache, key, bytecode,
+                                bytecode_len);
+          } else {
+            fprintf(stderr, "Out of memory compiling %s\n", name);
+            failed = 1;
+          }
+          js_free(ctx, buf);
+        } else {
+          check_and_print_exception(ctx);
+          failed = 1;
+        }
+      }
+      compile_ms = get_time_ms() - start;
+    }
+    free(source);
+    if (deps.error) {
+      fprintf(stderr, "Out of memory scanning imports of %s\n", name);
+      failed = 1;
+    }
+
+    pthread_mutex_lock(&g->mutex);
+    g->nodes[i].bytecode = bytecode;
+    g->nodes[i].bytecode_len = bytecode_len;
+    g->nodes[i].source_len = source_len;
+    g->compile_ms += compile_ms;
+    g->error |= failed;
+    for (int j = 0; j < deps.count; j++) {
+      module_graph_add(g, deps.names[j]);
+    }
+    free(deps.names);
+    g->in_flight--;
+    pthread_cond_broadcast(&g->cond);
+  }
+  pthread_cond_broadcast(&g->cond);
+  pthread_mutex_unlock(&g->mutex);
+
+  if (ctx)
+    JS_FreeContext(ctx);
+  if (rt)
+    JS_FreeRuntime(rt);
+  return NULL;
+}
+
+// 从 entry 出发，用 jobs 个线程读取并编译整个导入图。
+// 任一模块编译失败时返回 -1
+static int module_graph_load(ModuleGraph *g, ModuleLoader *loader,
+                             const char *entry, int jobs) {
+  memset(g, 0, sizeof(*g));
+  g->loader = loader;
+  g->capacity = 64;
+  g->nodes = malloc(g->capacity * sizeof(ModuleGraphNode));
+  g->index_size = 128;
+  g->index = calloc(g->index_size, sizeof(int));
+  pthread_mutex_init(&g->mutex, NULL);
+  pthread_cond_init(&g->cond, NULL);
+  if (!g->nodes || !g->index) {
+    fprintf(stderr, "Out of memory loading %s\n", entry);
+    g->error = 1;
+    return -1;
+  }
+  module_graph_add(g, strdup(entry));
+  if (g->error) {
+    fprintf(stderr, "Out of memory loading %s\n", entry);
+    return -1;
+  }
+
+  // 只等待创建成功的线程；一个都没有创建时在当前线程完成全部编译
+  pthread_t *threads = malloc(jobs * sizeof(pthread_t));
+  int started = 0;
+  for (int i = 0; threads && i < jobs; i++) {
+    if (pthread_create(&threads[started], NULL, module_graph_worker, g) == 0)
+      started++;
+  }
+  if (started == 0)
+    module_graph_worker(g);
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  free(threads);
+
+  if (!g->nodes[0].bytecode && !g->error) {
+    fprintf(stderr, "Failed to read module %s\n", entry);
+    g->error = 1;
+  }
+  return g->error ? -1 : 0;
+}
+
+// 在 JS 线程中读入所有字节码并链接，返回入口模块（交给 JS_EvalFunction）。
+// 不在图中的依赖（如 C 模块）在链接时按名称查找或交给模块加载器
+static JSValue module_graph_link(JSContext *ctx, ModuleGraph *g) {
+  JSValue entry = JS_UNDEFINED;
+  for (int i = 0; i < g->count; i++) {
+    if (!g->nodes[i].bytecode)
+      continue;
+    JSValue val = JS_ReadObject(ctx, g->nodes[i].bytecode,
+                                g->nodes[i].bytecode_len,
+                                JS_READ_OBJ_BYTECODE);
+    if (JS_IsException(val) && g->loader->cache) {
+      // 缓存条目与当前引擎不兼容，在本线程重新编译（同时替换该条目）
+      JS_FreeValue(ctx, JS_GetException(ctx));
+      val = module_loader_compile(ctx, g->loader, g->nodes[i].name);
+    }
+    if (JS_IsException(val)) {
+      JS_FreeValue(ctx, entry);
+      return JS_EXCEPTION;
+    }
+    if (i == 0)
+      entry = val;
+    else
+      JS_FreeValue(ctx, val);
+  }
+
+  if (JS_ResolveModule(ctx, entry) < 0) {
+    JS_FreeValue(ctx, entry);
+    return JS_EXCEPTION;
+  }
+  return entry;
+}
+
+static void module_graph_free(ModuleGraph *g) {
+  for (int i = 0; i < g->count; i++) {
+    free(g->nodes[i].name);
+    free(g->nodes[i].bytecode);
+  }
+  free(g->nodes);
+  free(g->index);
+  pthread_mutex_destroy(&g->mutex);
+  pthread_cond_destroy(&g->cond);
+}
+
+#endif
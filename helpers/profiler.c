@@ -0,0 +1,620 @@
+#ifndef HELPERS_PROFILER_C
+#define HELPERS_PROFILER_C
+
+#include "../quickjs/quickjs.h"
+#include "./clock.c"
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+ * 采样分析器：定时器按 CPU 时间发出 SIGPROF，信号处理函数只给对应的
+ * 运行时记一个滴答。解释器下一次轮询中断时，中断处理函数在运行时自己的
+ * 线程上构造一个 Error，从它的 stack 属性取得当前 JS 调用栈（QuickJS
+ * 没有公开的栈遍历 API，Error 的回溯来自同一条帧链），按栈聚合计数。
+ * 信号处理函数里不碰运行时，取样只发生在解释器的安全点上。
+ *
+ * Linux 上每个运行时一个线程 CPU 时间定时器（timer_create +
+ * SIGEV_THREAD_ID），只有在跑的线程会被采样。两次轮询之间累计了多个
+ * 滴答说明这段时间花在解释器之外（解析、GC、宿主 C 代码），多出的滴答
+ * 记到 "(host)" 上。其他平台退化为进程级的 ITIMER_PROF，每个滴答给
+ * 所有挂接的运行时各记一次，对单线程的基准是准确的。
+ *
+ * 分析器占用运行时的中断处理函数。
+ */
+
+#define PROFILER_DEFAULT_HZ 1000
+// 超过该深度的栈只保留靠近叶子的部分
+#define PROFILER_MAX_DEPTH 128
+#define PROFILER_HOST_FRAME "(host)"
+// 非 Linux 平台上最多挂接的运行时数
+#define PROFILER_THREAD_MAX 256
+
+// 哈希表条目：按折叠栈或函数名聚合的计数
+typedef struct {
+  char *key;
+  uint32_t hash;
+  long count; // 样本数；函数表中为自身样本数
+  long total; // 函数表中为包含该函数的样本数
+  int id;     // 函数表中为 pprof 的函数 id
+} ProfileEntry;
+
+// 开放寻址哈希表
+typedef struct {
+  ProfileEntry *entries;
+  int capacity;
+  int count;
+} ProfileTable;
+
+typedef struct {
+  int hz;
+  pthread_mutex_t mutex;
+  ProfileTable stacks; // 折叠栈（根在前，帧之间用 ';' 分隔）到样本数
+  long samples;
+  long host_samples;
+  double sample_ms; // 取样本身花掉的时间，各线程解除挂接时累加
+  double start_ms;
+} Profiler;
+
+// 一个运行时的采样状态，由运行该运行时的线程持有
+typedef struct {
+  Profiler *profiler;
+  JSRuntime *rt;
+  JSContext *ctx; // 构造 Error 用的最小上下文
+  JSValue error_ctor;
+  atomic_int ticks; // 信号处理函数累加，中断处理函数清零
+  int sampling;     // 正在取样，防止重入
+  double sample_ms;
+#if defined(__linux__)
+  timer_t timer;
+#endif
+} ProfilerThread;
+
+#if !defined(__linux__)
+static ProfilerThread *_Atomic profiler_threads[PROFILER_THREAD_MAX];
+#endif
+
+static uint32_t profile_hash(const char *s) {
+  uint32_t h = 2166136261u;
+  for (; *s; s++) {
+    h = (h ^ (uint8_t)*s) * 16777619u;
+  }
+  return h;
+}
+
+// 查找 key，create 为 1 时不存在则插入
+static ProfileEntry *profile_table_find(ProfileTable *t, const char *key,
+                                        int create) {
+  if (create && (t->count + 1) * 2 > t->capacity) {
+    int capacity = t->capacity ? t->capacity * 2 : 256;
+    ProfileEntry *entries = calloc(capacity, sizeof(ProfileEntry));
+    for (int i = 0; i < t->capacity; i++) {
+      if (!t->entries[i].key)
+        continue;
+      int j = t->entries[i].hash & (capacity - 1);
+      while (entries[j].key)
+        j = (j + 1) & (capacity - 1);
+      entries[j] = t->entries[i];
+    }
+    free(t->entries);
+    t->entries = entries;
+    t->capacity = capacity;
+  }
+  if (t->capacity == 0)
+    return NULL;
+
+  uint32_t hash = profile_hash(key);
+  int i = hash & (t->capacity - 1);
+  for (; t->entries[i].key; i = (i + 1) & (t->capacity - 1)) {
+    if (t->entries[i].hash == hash && strcmp(t->entries[i].key, key) == 0)
+      return &t->entries[i];
+  }
+  if (!create)
+    return NULL;
+
+  ProfileEntry *e = &t->entries[i];
+  e->key = strdup(key);
+  e->hash = hash;
+  t->count++;
+  return e;
+}
+
+static void profile_table_free(ProfileTable *t) {
+  for (int i = 0; i < t->capacity; i++) {
+    free(t->entries[i].key);
+  }
+  free(t->entries);
+  memset(t, 0, sizeof(*t));
+}
+
+// 把 Error.stack（叶子在前，每行 "    at name (file:line)"）折叠成
+// "root;...;leaf"。去掉行号，同一函数内不同位置的样本合并到一起
+static void profiler_fold(const char *stack, char *out, size_t size) {
+  char frames[PROFILER_MAX_DEPTH][256];
+  int depth = 0;
+
+  const char *p = stack;
+  while (*p && depth < PROFILER_MAX_DEPTH) {
+    const char *end = strchr(p, '\n');
+    if (!end)
+      end = p + strlen(p);
+    const char *s = p;
+    while (s < end && *s == ' ')
+      s++;
+    if (end - s > 3 && strncmp(s, "at ", 3) == 0) {
+      s += 3;
+      const char *e = end;
+      int strip = 0;
+      if (e - s > 2 && e[-1] == ')') {
+        const char *q = e - 2;
+        while (q > s && *q >= '0' && *q <= '9')
+          q--;
+        if (q < e - 2 && *q == ':') {
+          strip = 1;
+          e = q;
+        }
+      }
+      int len = e - s < 250 ? (int)(e - s) : 250;
+      char *frame = frames[depth++];
+      memcpy(frame, s, len);
+      if (strip)
+        frame[len++] = ')';
+      frame[len] = '\0';
+      // ';' 是折叠格式的分隔符
+      for (char *c = frame; *c; c++) {
+        if (*c == ';')
+          *c = ':';
+      }
+    }
+    p = *end ? end + 1 : end;
+  }
+
+  size_t n = 0;
+  out[0] = '\0';
+  for (int i = depth - 1; i >= 0; i--) {
+    int written = snprintf(out + n, size - n, "%s%s", n ? ";" : "", frames[i]);
+    if (written < 0 || (size_t)written >= size - n)
+      break;
+    n += written;
+  }
+}
+
+static void profiler_add(Profiler *p, const char *stack, long count) {
+  ProfileEntry *e = profile_table_find(&p->stacks, stack, 1);
+  e->count += count;
+  p->samples += count;
+}
+
+// 在解释器的安全点上取一次样
+static void profiler_sample(ProfilerThread *t, int ticks) {
+  double start = get_time_ms();
+  JSContext *ctx = t->ctx;
+  char folded[8192];
+  folded[0] = '\0';
+
+  JSValue err = JS_CallConstructor(ctx, t->error_ctor, 0, NULL);
+  if (JS_IsException(err)) {
+    JS_FreeValue(ctx, JS_GetException(ctx));
+  } else {
+    JSValue stack = JS_GetPropertyStr(ctx, err, "stack");
+    const char *str = JS_ToCString(ctx, stack);
+    if (str) {
+      profiler_fold(str, folded, sizeof(folded));
+      JS_FreeCString(ctx, str);
+    }
+    JS_FreeValue(ctx, stack);
+  }
+  JS_FreeValue(ctx, err);
+
+  Profiler *p = t->profiler;
+  pthread_mutex_lock(&p->mutex);
+  profiler_add(p, folded[0] ? folded : PROFILER_HOST_FRAME, 1);
+  if (ticks > 1) {
+    profiler_add(p, PROFILER_HOST_FRAME, ticks - 1);
+    p->host_samples += ticks - 1;
+  }
+  pthread_mutex_unlock(&p->mutex);
+  t->sample_ms += get_time_ms() - start;
+}
+
+static int profiler_interrupt(JSRuntime *rt, void *opaque) {
+  ProfilerThread *t = opaque;
+  int ticks = atomic_exchange(&t->ticks, 0);
+#if !defined(__linux__)
+  // 进程级定时器不区分线程，累计的滴答不代表本线程在解释器外的时间
+  if (ticks > 1)
+    ticks = 1;
+#endif
+  if (ticks > 0 && !t->sampling) {
+    t->sampling = 1;
+    profiler_sample(t, ticks);
+    t->sampling = 0;
+  }
+  return 0;
+}
+
+// 只做原子累加，异步信号安全
+static void profiler_signal(int sig, siginfo_t *info, void *ucontext) {
+#if defined(__linux__)
+  if (info->si_code == SI_TIMER && info->si_value.sival_ptr) {
+    ProfilerThread *t = info->si_value.sival_ptr;
+    atomic_fetch_add(&t->ticks, 1);
+  }
+#else
+  for (int i = 0; i < PROFILER_THREAD_MAX; i++) {
+    ProfilerThread *t = atomic_load(&profiler_threads[i]);
+    if (t)
+      atomic_fetch_add(&t->ticks, 1);
+  }
+#endif
+}
+
+static struct timeval profiler_period(int hz) {
+  struct timeval tv;
+  long us = 1000000L / hz;
+  tv.tv_sec = us / 1000000;
+  tv.tv_usec = us % 1000000;
+  return tv;
+}
+
+// 安装 SIGPROF 处理函数，hz 为每秒 CPU 时间的采样次数
+static int profiler_init(Profiler *p, int hz) {
+  memset(p, 0, sizeof(*p));
+  p->hz = hz > 0 ? hz : PROFILER_DEFAULT_HZ;
+  pthread_mutex_init(&p->mutex, NULL);
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = profiler_signal;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(SIGPROF, &sa, NULL) != 0)
+    return -1;
+
+#if !defined(__linux__)
+  struct itimerval timer;
+  timer.it_interval = profiler_period(p->hz);
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, NULL) != 0)
+    return -1;
+#endif
+  p->start_ms = get_time_ms();
+  return 0;
+}
+
+// 在运行 rt 的线程上调用，开始对 rt 采样。失败时撤销已做的设置，
+// 之后调用 profiler_detach 什么也不做
+static int profiler_attach(Profiler *p, ProfilerThread *t, JSRuntime *rt) {
+  memset(t, 0, sizeof(*t));
+  t->rt = rt;
+  atomic_init(&t->ticks, 0);
+
+  // 取样时只需要 Error 构造函数
+  t->ctx = JS_NewContextRaw(rt);
+  if (!t->ctx)
+    return -1;
+  JS_AddIntrinsicBaseObjects(t->ctx);
+  JSValue global = JS_GetGlobalObject(t->ctx);
+  t->error_ctor = JS_GetPropertyStr(t->ctx, global, "Error");
+  JS_FreeValue(t->ctx, global);
+
+#if defined(__linux__)
+  struct sigevent sev;
+  memset(&sev, 0, sizeof(sev));
+  sev.sigev_notify = SIGEV_THREAD_ID;
+  sev.sigev_signo = SIGPROF;
+  sev.sigev_value.sival_ptr = t;
+#ifdef sigev_notify_thread_id
+  sev.sigev_notify_thread_id = syscall(SYS_gettid);
+#else
+  sev._sigev_un._tid = syscall(SYS_gettid);
+#endif
+  if (timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &t->timer) != 0)
+    goto fail;
+
+  struct timeval period = profiler_period(p->hz);
+  struct itimerspec its;
+  its.it_interval.tv_sec = period.tv_sec;
+  its.it_interval.tv_nsec = period.tv_usec * 1000L;
+  its.it_value = its.it_interval;
+  if (timer_settime(t->timer, 0, &its, NULL) != 0) {
+    timer_delete(t->timer);
+    goto fail;
+  }
+#else
+  for (int i = 0; i < PROFILER_THREAD_MAX; i++) {
+    ProfilerThread *expected = NULL;
+    if (atomic_compare_exchange_strong(&profiler_threads[i], &expected, t))
+      break;
+  }
+#endif
+  // 计时器就绪后才挂上中断处理函数，此前到达的 tick 只是累加计数
+  t->profiler = p;
+  JS_SetInterruptHandler(rt, profiler_interrupt, t);
+  return 0;
+
+fail:
+  JS_FreeValue(t->ctx, t->error_ctor);
+  JS_FreeContext(t->ctx);
+  t->ctx = NULL;
+  return -1;
+}
+
+// 在 JS_FreeRuntime 之前、由同一线程调用
+static void profiler_detach(ProfilerThread *t) {
+  if (!t->profiler)
+    return;
+#if defined(__linux__)
+  timer_delete(t->timer);
+#else
+  for (int i = 0; i < PROFILER_THREAD_MAX; i++) {
+    ProfilerThread *expected = t;
+    if (atomic_compare_exchange_strong(&profiler_threads[i], &expected, NULL))
+      break;
+  }
+#endif
+  JS_SetInterruptHandler(t->rt, NULL, NULL);
+
+  pthread_mutex_lock(&t->profiler->mutex);
+  t->profiler->sample_ms += t->sample_ms;
+  pthread_mutex_unlock(&t->profiler->mutex);
+
+  JS_FreeValue(t->ctx, t->error_ctor);
+  JS_FreeContext(t->ctx);
+  t->profiler = NULL;
+}
+
+// 所有线程解除挂接之后调用
+static void profiler_free(Profiler *p) {
+#if !defined(__linux__)
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+#endif
+  // 可能还有已发出未处理的 SIGPROF，恢复默认动作会终止进程，改为忽略
+  signal(SIGPROF, SIG_IGN);
+  profile_table_free(&p->stacks);
+  pthread_mutex_destroy(&p->mutex);
+}
+
+// 按函数汇总：自身样本数（位于栈顶）和总样本数（出现在栈中，递归只计一次）
+static void profiler_functions(Profiler *p, ProfileTable *funcs) {
+  memset(funcs, 0, sizeof(*funcs));
+  int next_id = 1;
+  for (int i = 0; i < p->stacks.capacity; i++) {
+    ProfileEntry *e = &p->stacks.entries[i];
+    if (!e->key)
+      continue;
+
+    char *copy = strdup(e->key);
+    ProfileEntry *seen[PROFILER_MAX_DEPTH];
+    int depth = 0;
+    ProfileEntry *leaf = NULL;
+    char *save = NULL;
+    for (char *frame = strtok_r(copy, ";", &save); frame;
+         frame = strtok_r(NULL, ";", &save)) {
+      ProfileEntry *f = profile_table_find(funcs, frame, 1);
+      if (f->id == 0)
+        f->id = next_id++;
+      leaf = f;
+      int repeated = 0;
+      for (int j = 0; j < depth && !repeated; j++) {
+        repeated = seen[j] == f;
+      }
+      if (!repeated && depth < PROFILER_MAX_DEPTH) {
+        seen[depth++] = f;
+        f->total += e->count;
+      }
+    }
+    if (leaf)
+      leaf->count += e->count;
+    free(copy);
+  }
+}
+
+static int profile_compare_self(const void *a, const void *b) {
+  const ProfileEntry *x = *(ProfileEntry *const *)a;
+  const ProfileEntry *y = *(ProfileEntry *const *)b;
+  return x->count < y->count ? 1 : x->count > y->count ? -1 : 0;
+}
+
+// 打印自身样本数最多的 limit 个函数
+static void profiler_print_top(Profiler *p, int limit) {
+  ProfileTable funcs;
+  profiler_functions(p, &funcs);
+
+  ProfileEntry **sorted = malloc((funcs.count + 1) * sizeof(ProfileEntry *));
+  int n = 0;
+  for (int i = 0; i < funcs.capacity; i++) {
+    if (funcs.entries[i].key)
+      sorted[n++] = &funcs.entries[i];
+  }
+  qsort(sorted, n, sizeof(ProfileEntry *), profile_compare_self);
+
+  double period_ms = 1000.0 / p->hz;
+  printf("Profile: %ld samples at %d Hz (%ld outside the interpreter), "
+         "sampling cost %.2f%% of profiled CPU time\n",
+         p->samples, p->hz, p->host_samples,
+         p->samples ? p->sample_ms / (p->samples * period_ms) * 100 : 0);
+  printf("%7s %7s  %s\n", "self%", "total%", "function");
+  for (int i = 0; i < n && i < limit; i++) {
+    printf("%6.2f%% %6.2f%%  %s\n", sorted[i]->count * 100.0 / p->samples,
+           sorted[i]->total * 100.0 / p->samples, sorted[i]->key);
+  }
+
+  free(sorted);
+  profile_table_free(&funcs);
+}
+
+// 折叠栈格式，每行 "root;...;leaf count"，可直接交给 flamegraph.pl
+static int profiler_write_folded(Profiler *p, const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return -1;
+  for (int i = 0; i < p->stacks.capacity; i++) {
+    ProfileEntry *e = &p->stacks.entries[i];
+    if (e->key)
+      fprintf(f, "%s %ld\n", e->key, e->count);
+  }
+  return fclose(f);
+}
+
+// 最小的 protobuf 编码器，只覆盖 profile.proto 用到的类型
+typedef struct {
+  uint8_t *data;
+  size_t len;
+  size_t capacity;
+} PbBuf;
+
+static void pb_put(PbBuf *b, const void *data, size_t len) {
+  if (b->len + len > b->capacity) {
+    b->capacity = (b->len + len) * 2;
+    b->data = realloc(b->data, b->capacity);
+  }
+  memcpy(b->data + b->len, data, len);
+  b->len += len;
+}
+
+static void pb_varint(PbBuf *b, uint64_t v) {
+  uint8_t buf[10];
+  int n = 0;
+  do {
+    buf[n++] = (v & 0x7f) | (v > 0x7f ? 0x80 : 0);
+    v >>= 7;
+  } while (v);
+  pb_put(b, buf, n);
+}
+
+static void pb_uint(PbBuf *b, int field, uint64_t v) {
+  pb_varint(b, (uint64_t)field << 3);
+  pb_varint(b, v);
+}
+
+static void pb_bytes(PbBuf *b, int field, const void *data, size_t len) {
+  pb_varint(b, (uint64_t)field << 3 | 2);
+  pb_varint(b, len);
+  pb_put(b, data, len);
+}
+
+// 把子消息作为 field 写入 b，然后清空 msg 以便复用
+static void pb_message(PbBuf *b, int field, PbBuf *msg) {
+  pb_bytes(b, field, msg->data, msg->len);
+  msg->len = 0;
+}
+
+static void pb_value_type(PbBuf *b, int field, int type, int unit) {
+  PbBuf msg = {0};
+  pb_uint(&msg, 1, type);
+  pb_uint(&msg, 2, unit);
+  pb_message(b, field, &msg);
+  free(msg.data);
+}
+
+// pprof 的 profile.proto 格式（未压缩，pprof 可以直接读取）。
+// 每个函数对应一个同 id 的 location，帧 "name (file)" 拆成函数名和文件名
+static int profiler_write_pprof(Profiler *p, const char *path) {
+  ProfileTable funcs;
+  profiler_functions(p, &funcs);
+
+  // 字符串表：0 必须是空串，1-4 为样本类型，之后每个函数占两项
+  enum { STR_SAMPLES = 1, STR_COUNT, STR_CPU, STR_NANOSECONDS, STR_FIRST };
+  PbBuf out = {0}, msg = {0}, inner = {0}, packed = {0};
+  long period_ns = 1000000000L / p->hz;
+
+  pb_value_type(&out, 1, STR_SAMPLES, STR_COUNT);
+  pb_value_type(&out, 1, STR_CPU, STR_NANOSECONDS);
+
+  for (int i = 0; i < p->stacks.capacity; i++) {
+    ProfileEntry *e = &p->stacks.entries[i];
+    if (!e->key)
+      continue;
+    // location_id 从叶子到根
+    char *copy = strdup(e->key);
+    int ids[PROFILER_MAX_DEPTH];
+    int depth = 0;
+    char *save = NULL;
+    for (char *frame = strtok_r(copy, ";", &save);
+         frame && depth < PROFILER_MAX_DEPTH;
+         frame = strtok_r(NULL, ";", &save)) {
+      ids[depth++] = profile_table_find(&funcs, frame, 0)->id;
+    }
+    free(copy);
+    for (int j = depth - 1; j >= 0; j--) {
+      pb_varint(&packed, ids[j]);
+    }
+    pb_message(&msg, 1, &packed);
+    pb_varint(&packed, e->count);
+    pb_varint(&packed, e->count * period_ns);
+    pb_message(&msg, 2, &packed);
+    pb_message(&out, 2, &msg);
+  }
+
+  for (int i = 0; i < funcs.capacity; i++) {
+    ProfileEntry *f = &funcs.entries[i];
+    if (!f->key)
+      continue;
+    pb_uint(&msg, 1, f->id);
+    pb_uint(&inner, 1, f->id);
+    pb_message(&msg, 4, &inner);
+    pb_message(&out, 4, &msg);
+
+    pb_uint(&msg, 1, f->id);
+    pb_uint(&msg, 2, STR_FIRST + (f->id - 1) * 2);
+    pb_uint(&msg, 3, STR_FIRST + (f->id - 1) * 2);
+    pb_uint(&msg, 4, STR_FIRST + (f->id - 1) * 2 + 1);
+    pb_message(&out, 5, &msg);
+  }
+
+  // 按 id 顺序写出函数名和文件名
+  const char *fixed[STR_FIRST] = {"", "samples", "count", "cpu", "nanoseconds"};
+  for (int i = 0; i < STR_FIRST; i++) {
+    pb_bytes(&out, 6, fixed[i], strlen(fixed[i]));
+  }
+  ProfileEntry **by_id = calloc(funcs.count + 1, sizeof(ProfileEntry *));
+  for (int i = 0; i < funcs.capacity; i++) {
+    if (funcs.entries[i].key)
+      by_id[funcs.entries[i].id] = &funcs.entries[i];
+  }
+  for (int id = 1; id <= funcs.count; id++) {
+    const char *key = by_id[id]->key;
+    const char *paren = strstr(key, " (");
+    size_t name_len = paren ? (size_t)(paren - key) : strlen(key);
+    pb_bytes(&out, 6, key, name_len);
+    if (paren && key[strlen(key) - 1] == ')')
+      pb_bytes(&out, 6, paren + 2, strlen(paren + 2) - 1);
+    else
+      pb_bytes(&out, 6, "", 0);
+  }
+  free(by_id);
+
+  pb_uint(&out, 10, (uint64_t)((get_time_ms() - p->start_ms) * 1e6));
+  pb_value_type(&out, 11, STR_CPU, STR_NANOSECONDS);
+  pb_uint(&out, 12, period_ns);
+
+  int ret = -1;
+  FILE *f = fopen(path, "wb");
+  if (f) {
+    ret = fwrite(out.data, 1, out.len, f) == out.len ? 0 : -1;
+    if (fclose(f) != 0)
+      ret = -1;
+  }
+
+  free(out.data);
+  free(msg.data);
+  free(inner.data);
+  free(packed.data);
+  profile_table_free(&funcs);
+  return ret;
+}
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef HELPERS_SHA256_C
+#define HELPERS_SHA256_C
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SHA256_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#endif
+#define SHA256_ARM64 1
+#endif
+
+// SHA-256（FIPS 180-4），用于内容寻址的缓存键和脚本的 crypto 模块。
+// 有 SHA 扩展（x86 SHA-NI、ARMv8 Crypto）时用硬件指令压缩块
+typedef struct {
+  uint32_t state[8];
+  uint64_t length; // 已输入的字节数
+  uint8_t block[64];
+  size_t block_len;
+} Sha256;
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+#define SHA256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+// 处理 count 个连续的 64 字节块
+static void sha256_blocks_scalar(uint32_t state[8], const uint8_t *data,
+                                 size_t count) {
+  for (; count > 0; count--, data += 64) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+      w[i] = (uint32_t)data[i * 4] << 24 | (uint32_t)data[i * 4 + 1] << 16 |
+             (uint32_t)data[i * 4 + 2] << 8 | data[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+      uint32_t s0 = SHA256_ROTR(w[i - 15], 7) ^ SHA256_ROTR(w[i - 15], 18) ^
+                    (w[i - 15] >> 3);
+      uint32_t s1 = SHA256_ROTR(w[i - 2], 17) ^ SHA256_ROTR(w[i - 2], 19) ^
+                    (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+      uint32_t s1 = SHA256_ROTR(e, 6) ^ SHA256_ROTR(e, 11) ^ SHA256_ROTR(e, 25);
+      uint32_t ch = (e & f) ^ (~e & g);
+      uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+      uint32_t s0 = SHA256_ROTR(a, 2) ^ SHA256_ROTR(a, 13) ^ SHA256_ROTR(a, 22);
+      uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+      uint32_t t2 = s0 + maj;
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+  }
+}
+
+#if defined(SHA256_X86)
+
+static int sha256_has_shani(void) {
+  static int has_shani = -1;
+  if (has_shani < 0) {
+    __builtin_cpu_init();
+    has_shani = __builtin_cpu_supports("sha") &&
+                        __builtin_cpu_supports("sse4.1")
+                    ? 1
+                    : 0;
+  }
+  return has_shani;
+}
+
+// 第 g 组 4 轮。m0 是本组的消息，m1..m3 依次是之后三组的消息；
+// 同时用 sha256msg1/msg2 计算后面各组的消息
+#define SHA256_NI_ROUNDS(g, m0, m1, m2, m3)                                    \
+  do {                                                                         \
+    if (g < 4)                                                                 \
+      m0 = _mm_shuffle_epi8(                                                   \
+          _mm_loadu_si128((const __m128i *)(data + g * 16)), mask);            \
+    msg = _mm_add_epi32(m0,                                                    \
+                        _mm_loadu_si128((const __m128i *)&sha256_k[g * 4]));   \
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);                       \
+    if (g >= 3 && g < 15) {                                                    \
+      m1 = _mm_add_epi32(m1, _mm_alignr_epi8(m0, m3, 4));                      \
+      m1 = _mm_sha256msg2_epu32(m1, m0);                                       \
+    }                                                                          \
+    msg = _mm_shuffle_epi32(msg, 0x0E);                                        \
+    state0 = _mm_sha256rnds2_epu32(state0, state1, msg);                       \
+    if (g >= 1 && g < 13)                                                      \
+      m3 = _mm_sha256msg1_epu32(m3, m0);                                       \
+  } while (0)
+
+__attribute__((target("sha,sse4.1"))) static void
+sha256_blocks_shani(uint32_t state[8], const uint8_t *data, size_t count) {
+  const __m128i mask =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+  __m128i msg, m0, m1, m2, m3;
+
+  // 硬件指令要求的状态排列是 ABEF 和 CDGH
+  __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *)&state[0]), 0xB1);
+  __m128i state1 =
+      _mm_shuffle_epi32(_mm_loadu_si128((__m128i *)&state[4]), 0x1B);
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+  for (; count > 0; count--, data += 64) {
+    __m128i abef = state0, cdgh = state1;
+    m0 = m1 = m2 = m3 = _mm_setzero_si128();
+    SHA256_NI_ROUNDS(0, m0, m1, m2, m3);
+    SHA256_NI_ROUNDS(1, m1, m2, m3, m0);
+    SHA256_NI_ROUNDS(2, m2, m3, m0, m1);
+    SHA256_NI_ROUNDS(3, m3, m0, m1, m2);
+    SHA256_NI_ROUNDS(4, m0, m1, m2, m3);
+    SHA256_NI_ROUNDS(5, m1, m2, m3, m0);
+    SHA256_NI_ROUNDS(6, m2, m3, m0, m1);
+    SHA256_NI_ROUNDS(7, m3, m0, m1, m2);
+    SHA256_NI_ROUNDS(8, m0, m1, m2, m3);
+    SHA256_NI_ROUNDS(9, m1, m2, m3, m0);
+    SHA256_NI_ROUNDS(10, m2, m3, m0, m1);
+    SHA256_NI_ROUNDS(11, m3, m0, m1, m2);
+    SHA256_NI_ROUNDS(12, m0, m1, m2, m3);
+    SHA256_NI_ROUNDS(13, m1, m2, m3, m0);
+    SHA256_NI_ROUNDS(14, m2, m3, m0, m1);
+    SHA256_NI_ROUNDS(15, m3, m0, m1, m2);
+    state0 = _mm_add_epi32(state0, abef);
+    state1 = _mm_add_epi32(state1, cdgh);
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B);
+  state1 = _mm_shuffle_epi32(state1, 0xB1);
+  _mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(tmp, state1, 0xF0));
+  _mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+
+#undef SHA256_NI_ROUNDS
+
+#elif defined(SHA256_ARM64)
+
+static int sha256_has_sha2(void) {
+#if defined(__linux__)
+  static int has_sha2 = -1;
+  if (has_sha2 < 0)
+    has_sha2 = getauxval(AT_HWCAP) & HWCAP_SHA2 ? 1 : 0;
+  return has_sha2;
+#elif defined(__ARM_FEATURE_SHA2) || defined(__APPLE__)
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+// 第 g 组 4 轮，m0 是本组的消息，前 12 组同时计算第 g + 4 组的消息
+#define SHA256_ARM_ROUNDS(g, m0, m1, m2, m3)                                   \
+  do {                                                                         \
+    uint32x4_t wk = vaddq_u32(m0, vld1q_u32(&sha256_k[g * 4]));                \
+    uint32x4_t abcd = state0;                                                  \
+    if (g < 12)                                                                \
+      m0 = vsha256su0q_u32(m0, m1);                                            \
+    state0 = vsha256hq_u32(state0, state1, wk);                                \
+    state1 = vsha256h2q_u32(state1, abcd, wk);                                 \
+    if (g < 12)                                                                \
+      m0 = vsha256su1q_u32(m0, m2, m3);                                        \
+  } while (0)
+
+__attribute__((target("+crypto"))) static void
+sha256_blocks_arm64(uint32_t state[8], const uint8_t *data, size_t count) {
+  uint32x4_t state0 = vld1q_u32(&state[0]);
+  uint32x4_t state1 = vld1q_u32(&state[4]);
+
+  for (; count > 0; count--, data += 64) {
+    uint32x4_t abcd = state0, efgh = state1;
+    uint32x4_t m0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data)));
+    uint32x4_t m1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+    uint32x4_t m2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+    uint32x4_t m3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+    SHA256_ARM_ROUNDS(0, m0, m1, m2, m3);
+    SHA256_ARM_ROUNDS(1, m1, m2, m3, m0);
+    SHA256_ARM_ROUNDS(2, m2, m3, m0, m1);
+    SHA256_ARM_ROUNDS(3, m3, m0, m1, m2);
+    SHA256_ARM_ROUNDS(4, m0, m1, m2, m3);
+    SHA256_ARM_ROUNDS(5, m1, m2, m3, m0);
+    SHA256_ARM_ROUNDS(6, m2, m3, m0, m1);
+    SHA256_ARM_ROUNDS(7, m3, m0, m1, m2);
+    SHA256_ARM_ROUNDS(8, m0, m1, m2, m3);
+    SHA256_ARM_ROUNDS(9, m1, m2, m3, m0);
+    SHA256_ARM_ROUNDS(10, m2, m3, m0, m1);
+    SHA256_ARM_ROUNDS(11, m3, m0, m1, m2);
+    SHA256_ARM_ROUNDS(12, m0, m1, m2, m3);
+    SHA256_ARM_ROUNDS(13, m1, m2, m3, m0);
+    SHA256_ARM_ROUNDS(14, m2, m3, m0, m1);
+    SHA256_ARM_ROUNDS(15, m3, m0, m1, m2);
+    state0 = vaddq_u32(state0, abcd);
+    state1 = vaddq_u32(state1, efgh);
+  }
+
+  vst1q_u32(&state[0], state0);
+  vst1q_u32(&state[4], state1);
+}
+
+#undef SHA256_ARM_ROUNDS
+
+#endif
+
+static void sha256_blocks(uint32_t state[8], const uint8_t *data,
+                          size_t count) {
+#if defined(SHA256_X86)
+  if (sha256_has_shani()) {
+    sha256_blocks_shani(state, data, count);
+    return;
+  }
+#elif defined(SHA256_ARM64)
+  if (sha256_has_sha2()) {
+    sha256_blocks_arm64(state, data, count);
+    return;
+  }
+#endif
+  sha256_blocks_scalar(state, data, count);
+}
+
+static void sha256_init(Sha256 *s) {
+  static const uint32_t init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                   0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                   0x1f83d9ab, 0x5be0cd19};
+  memcpy(s->state, init, sizeof(init));
+  s->length = 0;
+  s->block_len = 0;
+}
+
+static void sha256_update(Sha256 *s, const void *data, size_t len) {
+  const uint8_t *p = data;
+  s->length += len;
+
+  if (s->block_len > 0) {
+    size_t n = 64 - s->block_len < len ? 64 - s->block_len : len;
+    memcpy(s->block + s->block_len, p, n);
+    s->block_len += n;
+    p += n;
+    len -= n;
+    if (s->block_len < 64)
+      return;
+    sha256_blocks(s->state, s->block, 1);
+    s->block_len = 0;
+  }
+
+  // 整块直接从输入处理，不经过缓冲区
+  sha256_blocks(s->state, p, len / 64);
+  p += len / 64 * 64;
+  len %= 64;
+
+  memcpy(s->block, p, len);
+  s->block_len = len;
+}
+
+static void sha256_final(Sha256 *s, uint8_t digest[32]) {
+  uint64_t bits = s->length * 8;
+  uint8_t pad[72] = {0x80};
+  // 填充到 56 mod 64 字节，再追加 64 位大端长度
+  size_t pad_len = (s->block_len < 56 ? 56 : 120) - s->block_len;
+  for (int i = 0; i < 8; i++) {
+    pad[pad_len + i] = (uint8_t)(bits >> (56 - i * 8));
+  }
+  sha256_update(s, pad, pad_len + 8);
+
+  for (int i = 0; i < 8; i++) {
+    digest[i * 4] = (uint8_t)(s->state[i] >> 24);
+    digest[i * 4 + 1] = (uint8_t)(s->state[i] >> 16);
+    digest[i * 4 + 2] = (uint8_t)(s->state[i] >> 8);
+    digest[i * 4 + 3] = (uint8_t)s->state[i];
+  }
+}
+
+static void sha256(const void *data, size_t len, uint8_t digest[32]) {
+  Sha256 s;
+  sha256_init(&s);
+  sha256_update(&s, data, len);
+  sha256_final(&s, digest);
+}
+
+// 把摘要写成 64 个十六进制字符，hex 至少 65 字节
+static void sha256_hex(const uint8_t digest[32], char *hex) {
+  static const char digits[] = "0123456789abcdef";
+  for (int i = 0; i < 32; i++) {
+    hex[i * 2] = digits[digest[i] >> 4];
+    hex[i * 2 + 1] = digits[digest[i] & 15];
+  }
+  hex[64] = '\0';
+}
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef HELPERS_TRACE_C
+#define HELPERS_TRACE_C
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * 时间线追踪，输出 Chrome trace JSON，可在 Perfetto（ui.perfetto.dev）
+ * 或 chrome://tracing 中查看。
+ *
+ * 每个线程一个环形缓冲区，只有所属线程写入：写好事件再 release 递增
+ * 写指针，没有锁。缓冲区满时覆盖最旧的事件，导出时只保留最近的部分。
+ * 一个区间在结束时记成一条带时长的事件（Chrome 的 "X"），环回只会
+ * 丢掉整个区间，不会留下不配对的开始或结束。排队等待、定时器延迟这类
+ * 会彼此重叠的区间记成异步事件（"b"/"e"），在 Perfetto 中各占一行。
+ *
+ * 未开启时 trace_begin/trace_end 都只有一次对 trace_enabled 的判断。
+ * 事件名、分类和 detail 只保存指针，必须在导出之前一直有效（字符串
+ * 字面量、命令行参数）。
+ */
+
+#define TRACE_DEFAULT_EVENTS (1 << 15)
+#define TRACE_THREAD_MAX 256
+// 事件没有编号
+#define TRACE_NO_ID (-1)
+
+typedef struct {
+  const char *cat;
+  const char *name;
+  const char *detail; // 可以为 NULL
+  uint64_t ts_ns;
+  uint64_t dur_ns;
+  int64_t id;
+  int async;
+} TraceEvent;
+
+typedef struct {
+  char name[32];
+  int tid;
+  uint64_t capacity; // 2 的幂
+  _Atomic uint64_t head; // 已写入的事件总数
+  TraceEvent *events;
+} TraceBuffer;
+
+// 开启后不再改变，在创建记录线程之前设置
+static int trace_enabled = 0;
+static uint64_t trace_capacity = TRACE_DEFAULT_EVENTS;
+static uint64_t trace_start_ns = 0;
+static TraceBuffer *_Atomic trace_buffers[TRACE_THREAD_MAX];
+static atomic_int trace_buffer_count = 0;
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local TraceBuffer *trace_local = NULL;
+
+static inline uint64_t trace_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// 开启追踪，events 为每个线程保留的事件数，向上取整到 2 的幂
+static void trace_init(uint64_t events) {
+  uint64_t capacity = 1;
+  while (capacity < events)
+    capacity <<= 1;
+  trace_capacity = capacity;
+  trace_start_ns = trace_now_ns();
+  trace_enabled = 1;
+}
+
+// 为当前线程分配环形缓冲区，name 显示为 Perfetto 中的线程名
+static int trace_thread_attach(const char *name) {
+  if (!trace_enabled || trace_local)
+    return 0;
+  TraceBuffer *b = calloc(1, sizeof(TraceBuffer));
+  if (!b)
+    return -1;
+  b->events = malloc(trace_capacity * sizeof(TraceEvent));
+  if (!b->events) {
+    free(b);
+    return -1;
+  }
+  snprintf(b->name, sizeof(b->name), "%s", name);
+  b->capacity = trace_capacity;
+  atomic_init(&b->head, 0);
+
+  pthread_mutex_lock(&trace_mutex);
+  int index = atomic_load(&trace_buffer_count);
+  if (index >= TRACE_THREAD_MAX) {
+    pthread_mutex_unlock(&trace_mutex);
+    free(b->events);
+    free(b);
+    return -1;
+  }
+  b->tid = index + 1;
+  atomic_store(&trace_buffers[index], b);
+  atomic_store(&trace_buffer_count, index + 1);
+  pthread_mutex_unlock(&trace_mutex);
+  trace_local = b;
+  return 0;
+}
+
+// 线程退出后缓冲区仍然保留，直到导出
+static void trace_thread_detach(void) { trace_local = NULL; }
+
+static void trace_record(const char *cat, const char *name, uint64_t start,
+                         uint64_t end, int64_t id, const char *detail,
+                         int async) {
+  TraceBuffer *b = trace_local;
+  if (!b)
+    return;
+  uint64_t head = atomic_load_explicit(&b->head, memory_order_relaxed);
+  TraceEvent *e = &b->events[head & (b->capacity - 1)];
+  e->cat = cat;
+  e->name = name;
+  e->detail = detail;
+  e->ts_ns = start;
+  e->dur_ns = end > start ? end - start : 0;
+  e->id = id;
+  e->async = async;
+  atomic_store_explicit(&b->head, head + 1, memory_order_release);
+}
+
+// 区间开始，返回开始时间；未开启时返回 0
+static inline uint64_t trace_begin(void) {
+  if (!trace_enabled)
+    return 0;
+  return trace_now_ns();
+}
+
+// 区间结束，记录从 start 到现在的一条事件
+static inline void trace_end(const char *cat, const char *name,
+                             uint64_t start) {
+  if (!trace_enabled)
+    return;
+  trace_record(cat, name, start, trace_now_ns(), TRACE_NO_ID, NULL, 0);
+}
+
+// 同 trace_end，附带编号和说明（如任务号和文件名）
+static inline void trace_end_id(const char *cat, const char *name,
+                                uint64_t start, int64_t id,
+                                const char *detail) {
+  if (!trace_enabled)
+    return;
+  trace_record(cat, name, start, trace_now_ns(), id, detail, 0);
+}
+
+// 可能与其他区间重叠的异步区间，start 和 end 为 CLOCK_MONOTONIC 纳秒
+static inline void trace_async(const char *cat, const char *name,
+                               uint64_t start, uint64_t end, int64_t id,
+                               const char *detail) {
+  if (!trace_enabled)
+    return;
+  trace_record(cat, name, start, end, id, detail, 1);
+}
+
+// 把 get_time_ms 的毫秒时间戳换算成追踪用的纳秒
+static inline uint64_t trace_ms_to_ns(double ms) {
+  return (uint64_t)(ms * 1e6);
+}
+
+static void trace_write_string(FILE *f, const char *s) {
+  fputc('"', f);
+  for (; *s; s++) {
+    unsigned char c = *s;
+    if (c == '"' || c == '\\')
+      fprintf(f, "\\%c", c);
+    else if (c < 0x20)
+      fprintf(f, "\\u%04x", c);
+    else
+      fputc(c, f);
+  }
+  fputc('"', f);
+}
+
+static void trace_write_args(FILE *f, const TraceEvent *e) {
+  if (e->id == TRACE_NO_ID && !e->detail)
+    return;
+  fprintf(f, ",\"args\":{");
+  if (e->id != TRACE_NO_ID)
+    fprintf(f, "\"id\":%lld", (long long)e->id);
+  if (e->detail) {
+    fprintf(f, "%s\"detail\":", e->id != TRACE_NO_ID ? "," : "");
+    trace_write_string(f, e->detail);
+  }
+  fputc('}', f);
+}
+
+// 写出一个事件的公共字段
+static void trace_write_head(FILE *f, const TraceEvent *e, const char *ph,
+                             double ts_us, int tid, int *first) {
+  fprintf(f, "%s\n{\"ph\":\"%s\",\"cat\":", *first ? "" : ",", ph);
+  *first = 0;
+  trace_write_string(f, e->cat);
+  fprintf(f, ",\"name\":");
+  trace_write_string(f, e->name);
+  fprintf(f, ",\"pid\":1,\"tid\":%d,\"ts\":%.3f", tid, ts_us);
+}
+
+// 导出所有缓冲区中的事件，所有记录线程都应已停止。
+// 返回写出的事件数，*dropped 为被覆盖的事件数
+static long trace_write_json(const char *path, long *dropped) {
+  *dropped = 0;
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return -1;
+
+  long written = 0;
+  int first = 1;
+  fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  int count = atomic_load(&trace_buffer_count);
+  for (int i = 0; i < count; i++) {
+    TraceBuffer *b = atomic_load(&trace_buffers[i]);
+    fprintf(f, "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,"
+               "\"tid\":%d,\"args\":{\"name\":",
+            first ? "" : ",", b->tid);
+    first = 0;
+    trace_write_string(f, b->name);
+    fprintf(f, "}}");
+
+    uint64_t head = atomic_load_explicit(&b->head, memory_order_acquire);
+    uint64_t begin = head > b->capacity ? head - b->capacity : 0;
+    *dropped += begin;
+    for (uint64_t n = begin; n < head; n++) {
+      const TraceEvent *e = &b->events[n & (b->capacity - 1)];
+      // 开启之前的时间戳（例如开启前入队的任务）截到 0
+      double ts_us = e->ts_ns > trace_start_ns
+                         ? (e->ts_ns - trace_start_ns) / 1000.0
+                         : 0;
+      if (e->async) {
+        trace_write_head(f, e, "b", ts_us, b->tid, &first);
+        fprintf(f, ",\"id\":%lld", (long long)e->id);
+        trace_write_args(f, e);
+        fputc('}', f);
+        trace_write_head(f, e, "e", ts_us + e->dur_ns / 1000.0, b->tid,
+                         &first);
+        fprintf(f, ",\"id\":%lld}", (long long)e->id);
+      } else {
+        trace_write_head(f, e, "X", ts_us, b->tid, &first);
+        fprintf(f, ",\"dur\":%.3f", e->dur_ns / 1000.0);
+        trace_write_args(f, e);
+        fputc('}', f);
+      }
+      written++;
+    }
+  }
+  fprintf(f, "\n]}\n");
+  if (fclose(f) != 0)
+    return -1;
+  return written;
+}
+
+static void trace_free(void) {
+  int count = atomic_load(&trace_buffer_count);
+  for (int i = 0; i < count; i++) {
+    TraceBuffer *b = atomic_load(&trace_buffers[i]);
+    free(b->events);
+    free(b);
+  }
+  atomic_store(&trace_buffer_count, 0);
+  trace_local = NULL;
+  trace_enabled = 0;
+}
+
+#endif